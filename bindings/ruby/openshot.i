@@ -40,6 +40,9 @@
 #endif
 %shared_ptr(juce::AudioBuffer<float>)
 %shared_ptr(openshot::Frame)
+%shared_ptr(openshot::CacheEvictionPolicy)
+%shared_ptr(openshot::LRUEvictionPolicy)
+%shared_ptr(openshot::PlayheadEvictionPolicy)
 
 /* Instantiate the required template specializations */
 %template() std::map<std::string, int>;
@@ -65,7 +68,10 @@
 #include "AudioDevices.h"
 #include "CacheBase.h"
 #include "CacheDisk.h"
+#include "CacheEvictionPolicy.h"
 #include "CacheMemory.h"
+#include "CacheSharded.h"
+#include "CacheTiered.h"
 #include "ChannelLayouts.h"
 #include "ChunkReader.h"
 #include "ChunkWriter.h"
@@ -133,9 +139,12 @@
 %include "ReaderBase.h"
 %include "WriterBase.h"
 %include "AudioDevices.h"
+%include "CacheEvictionPolicy.h"
 %include "CacheBase.h"
 %include "CacheDisk.h"
 %include "CacheMemory.h"
+%include "CacheSharded.h"
+%include "CacheTiered.h"
 %include "ChannelLayouts.h"
 %include "ChunkReader.h"
 %include "ChunkWriter.h"
@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @brief Source file for cache contention benchmark (example app for libopenshot)
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CacheBase.h"
+#include "CacheMemory.h"
+#include "CacheSharded.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+// Number of distinct frame numbers touched by the benchmark
+const int frame_count = 2000;
+
+// Number of cache operations per thread
+const int operations_per_thread = 200000;
+
+// Hammer a cache from many threads (mostly GetFrame, with an Add on every miss
+// and for 1 in 10 operations), and return the total operations per second
+double RunBenchmark(CacheBase& cache, int thread_count,
+                    const std::vector<std::shared_ptr<Frame>>& frames)
+{
+    using double_sec = std::chrono::duration<double>;
+
+    cache.Clear();
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < thread_count; t++) {
+        threads.push_back(std::thread([&cache, &frames, t]() {
+            std::mt19937 random(t);
+            std::uniform_int_distribution<int> frame_index(0, frame_count - 1);
+            for (int i = 0; i < operations_per_thread; i++) {
+                const auto& frame = frames[frame_index(random)];
+                if (i % 10 == 0 || !cache.GetFrame(frame->number))
+                    cache.Add(frame);
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    return (double(thread_count) * operations_per_thread) / double_sec(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+
+    // Create small frames (so the benchmark measures locking, not memory bandwidth)
+    std::vector<std::shared_ptr<Frame>> frames;
+    for (int i = 1; i <= frame_count; i++) {
+        auto f = std::make_shared<Frame>(i, 64, 36, "#000000");
+        f->AddColor(64, 36, "#000000");
+        frames.push_back(f);
+    }
+
+    // Room for half of the frames (so eviction is part of the workload)
+    const int64_t max_bytes = frames[0]->GetBytes() * frame_count / 2;
+    CacheMemory memory_cache(max_bytes);
+    CacheSharded sharded_cache(max_bytes);
+
+    std::cout << "threads\tCacheMemory (ops/s)\tCacheSharded (ops/s)\n";
+    for (int thread_count : {1, 2, 4, 8, 16, 32}) {
+        double memory_ops = RunBenchmark(memory_cache, thread_count, frames);
+        double sharded_ops = RunBenchmark(sharded_cache, thread_count, frames);
+        std::cout << thread_count << "\t"
+                  << static_cast<int64_t>(memory_ops) << "\t\t\t"
+                  << static_cast<int64_t>(sharded_ops) << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file
+ * @brief Source file for image compositing benchmark (example app for libopenshot)
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+#include <QSize>
+#include <QTransform>
+#include "ImageCompositor.h"
+
+using namespace openshot;
+
+// Number of layers composited per measurement
+const int iterations = 100;
+
+// Composite a layer many times (like Clip::apply_keyframes), and return the milliseconds per layer
+double RunBenchmark(QImage& background, const QImage& layer, const QTransform& transform, bool use_painter)
+{
+    using double_ms = std::chrono::duration<double, std::milli>;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        if (use_painter) {
+            QPainter painter(&background);
+            painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, true);
+            painter.setTransform(transform);
+            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+            painter.drawImage(0, 0, layer);
+            painter.end();
+        } else {
+            ImageCompositor::Composite(background, layer, transform);
+        }
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    return double_ms(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::cout << "size\tlayer\t\t\tQPainter (ms)\tImageCompositor (ms)\n";
+    for (QSize size : {QSize(1920, 1080), QSize(3840, 2160)}) {
+        QImage background(size, QImage::Format_RGBA8888_Premultiplied);
+        background.fill(QColor(20, 40, 60));
+
+        // An opaque layer (i.e. a video), and a half transparent layer (i.e. a faded title)
+        QImage opaque_layer(size, QImage::Format_RGBA8888_Premultiplied);
+        opaque_layer.fill(QColor(200, 100, 50));
+        QImage transparent_layer(size, QImage::Format_RGBA8888_Premultiplied);
+        transparent_layer.fill(QColor(200, 100, 50, 128));
+
+        const std::string name = std::to_string(size.width()) + "x" + std::to_string(size.height());
+        for (const QTransform& transform : {QTransform(), QTransform::fromTranslate(16, 9)}) {
+            const std::string moved = transform.isIdentity() ? "" : " (moved)";
+            std::cout << name << "\topaque" << moved << "\t\t"
+                      << RunBenchmark(background, opaque_layer, transform, true) << "\t\t"
+                      << RunBenchmark(background, opaque_layer, transform, false) << "\n";
+            std::cout << name << "\ttransparent" << moved << "\t"
+                      << RunBenchmark(background, transparent_layer, transform, true) << "\t\t"
+                      << RunBenchmark(background, transparent_layer, transform, false) << "\n";
+        }
+    }
+
+    return 0;
+}
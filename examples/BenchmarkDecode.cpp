@@ -0,0 +1,45 @@
+/**
+ * @file
+ * @brief Source file for video decoding benchmark (example app for libopenshot)
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <iostream>
+#include <string>
+#include "BenchmarkDecode.h"
+
+using namespace openshot;
+
+// Number of frames converted per swscale measurement
+const int iterations = 200;
+
+int main(int argc, char* argv[]) {
+    // Decode (and convert) every frame of the test video (in order), as fast as possible
+    const std::string path = argc > 1 ? argv[1] : std::string(TEST_MEDIA_PATH) + "test.mp4";
+    FFmpegReader reader(path);
+    reader.Open();
+    std::cout << path << " (" << reader.info.width << "x" << reader.info.height << "): "
+              << RunDecodeBenchmark(reader, reader.info.video_length) << " frames per second decoded\n\n";
+
+    // Compare the cost of converting each frame with a new scaling context (as FFmpegReader did), and with a reused
+    // context (at full size, and at a half size preview)
+    std::cout << "size\t\tnew context (fps)\treused context (fps)\n";
+    const int width = reader.info.width;
+    const int height = reader.info.height;
+    for (int divisor : {1, 2}) {
+        const int scaled_width = width / divisor;
+        const int scaled_height = height / divisor;
+        std::cout << scaled_width << "x" << scaled_height << "\t"
+                  << RunScaleBenchmark(width, height, scaled_width, scaled_height, false, iterations) << "\t\t\t"
+                  << RunScaleBenchmark(width, height, scaled_width, scaled_height, true, iterations) << "\n";
+    }
+
+    reader.Close();
+    return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Header file for video decoding benchmark functions (example app for libopenshot)
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_BENCHMARK_DECODE_H
+#define OPENSHOT_BENCHMARK_DECODE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include "FFmpegReader.h"
+#include "Frame.h"
+
+extern "C" {
+    #include <libavutil/imgutils.h>
+}
+
+// Decode frames of an open reader (in order), as fast as possible, and return the frames per second. The image of
+// each frame is requested, so its conversion to RGBA is measured too (even if the reader converts images lazily).
+inline double RunDecodeBenchmark(openshot::FFmpegReader& reader, int64_t frames)
+{
+    using double_sec = std::chrono::duration<double>;
+
+    frames = std::min(frames, reader.info.video_length);
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int64_t frame = 1; frame <= frames; frame++)
+        reader.GetFrame(frame)->GetImage();
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    return frames / double_sec(end - start).count();
+}
+
+// Convert a YUV frame to RGBA many times (like FFmpegReader::ProcessVideoPacket), and return the frames per second.
+// Either a new scaling context is created (and freed) for each frame, or one context is reused for every frame.
+inline double RunScaleBenchmark(int width, int height, int scaled_width, int scaled_height, bool reuse_context, int iterations)
+{
+    using double_sec = std::chrono::duration<double>;
+
+    // A source frame (in the most common pixel format of videos), and a destination RGBA frame
+    AVFrame* source = av_frame_alloc();
+    AVFrame* destination = av_frame_alloc();
+    av_image_alloc(source->data, source->linesize, width, height, AV_PIX_FMT_YUV420P, 32);
+    av_image_alloc(destination->data, destination->linesize, scaled_width, scaled_height, AV_PIX_FMT_RGBA, 32);
+
+    SwsContext* context = NULL;
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        if (reuse_context)
+            context = sws_getCachedContext(context, width, height, AV_PIX_FMT_YUV420P, scaled_width, scaled_height,
+                                           AV_PIX_FMT_RGBA, SWS_FAST_BILINEAR, NULL, NULL, NULL);
+        else
+            context = sws_getContext(width, height, AV_PIX_FMT_YUV420P, scaled_width, scaled_height,
+                                     AV_PIX_FMT_RGBA, SWS_FAST_BILINEAR, NULL, NULL, NULL);
+        sws_scale(context, source->data, source->linesize, 0, height, destination->data, destination->linesize);
+        if (!reuse_context) {
+            sws_freeContext(context);
+            context = NULL;
+        }
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    sws_freeContext(context);
+    av_freep(&source->data[0]);
+    av_freep(&destination->data[0]);
+    av_frame_free(&source);
+    av_frame_free(&destination);
+
+    return iterations / double_sec(end - start).count();
+}
+
+#endif
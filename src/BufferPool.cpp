@@ -0,0 +1,220 @@
+/**
+ * @file
+ * @brief Source file for BufferPool class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "BufferPool.h"
+
+#include <algorithm>
+
+#include <AppConfig.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace openshot;
+
+namespace {
+	// Each pixel buffer starts with a header (which remembers the bucket size), and the
+	// header is padded so the pixels keep the alignment of the allocation
+	const size_t BUFFER_HEADER_SIZE = 64;
+
+	// Audio buffers are allocated in multiples of this many samples per channel (so the audio of
+	// frames with a slightly different number of samples, such as 1601 and 1602, shares a bucket)
+	const int AUDIO_BUCKET_SAMPLES = 1024;
+
+	// Default max size of the free buffers (about 8 frames at 4K, or 64 frames at 1080p)
+	const int64_t DEFAULT_MAX_BYTES = 256 * 1024 * 1024;
+}
+
+// Default constructor (use Instance() instead)
+BufferPool::BufferPool() : free_bytes(0), max_bytes(DEFAULT_MAX_BYTES) { }
+
+// Get the global instance of the pool
+BufferPool* BufferPool::Instance()
+{
+	// Created only once (even when many threads create frames at once), and never destroyed
+	static BufferPool* instance = new BufferPool;
+	return instance;
+}
+
+// Get the bucket size of a buffer (rounded up to a whole page)
+size_t BufferPool::BucketSize(size_t bytes)
+{
+	const size_t page_size = 4096;
+	return ((bytes + page_size - 1) / page_size) * page_size;
+}
+
+// Get the bucket size of an audio buffer (rounded up to a multiple of AUDIO_BUCKET_SAMPLES)
+int BufferPool::AudioBucketSamples(int samples)
+{
+	return std::max(1, (samples + AUDIO_BUCKET_SAMPLES - 1) / AUDIO_BUCKET_SAMPLES) * AUDIO_BUCKET_SAMPLES;
+}
+
+// Get a buffer of at least this many bytes
+unsigned char* BufferPool::Allocate(size_t bytes)
+{
+	size_t bucket = BucketSize(bytes);
+	unsigned char* buffer = nullptr;
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		auto free_list = free_buffers.find(bucket);
+		if (free_list != free_buffers.end() && !free_list->second.empty()) {
+			buffer = free_list->second.back();
+			free_list->second.pop_back();
+			free_bytes -= bucket;
+		}
+	}
+
+	// Nothing to recycle, so allocate a new buffer (outside of the lock)
+	if (!buffer) {
+		buffer = new unsigned char[BUFFER_HEADER_SIZE + bucket];
+		*reinterpret_cast<size_t*>(buffer) = bucket;
+	}
+
+	return buffer + BUFFER_HEADER_SIZE;
+}
+
+// Return a buffer (from Allocate) to the pool
+void BufferPool::Release(unsigned char* buffer)
+{
+	if (!buffer)
+		return;
+
+	buffer -= BUFFER_HEADER_SIZE;
+	size_t bucket = *reinterpret_cast<size_t*>(buffer);
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		if (free_bytes + (int64_t) bucket <= max_bytes) {
+			free_buffers[bucket].push_back(buffer);
+			free_bytes += bucket;
+			return;
+		}
+	}
+
+	// The pool is full
+	delete[] buffer;
+}
+
+// Create an image, whose pixels are returned to the pool when the image is destroyed
+std::shared_ptr<QImage> BufferPool::CreateImage(int width, int height, QImage::Format format)
+{
+	// Scan-lines are 32-bit aligned (as QImage expects)
+	int bytes_per_line = ((width * QImage::toPixelFormat(format).bitsPerPixel() + 31) / 32) * 4;
+	size_t bytes = size_t(bytes_per_line) * height;
+	if (bytes == 0)
+		return std::make_shared<QImage>(width, height, format);
+
+	unsigned char* pixels = Allocate(bytes);
+	return std::make_shared<QImage>(
+		pixels, width, height, bytes_per_line, format,
+		(QImageCleanupFunction) &openshot::releasePooledBuffer,
+		(void*) pixels);
+}
+
+// Create an audio buffer, which is returned to the pool when it is destroyed
+std::shared_ptr<juce::AudioBuffer<float> > BufferPool::CreateAudioBuffer(int channels, int samples)
+{
+	const int bucket_samples = AudioBucketSamples(samples);
+	const int64_t bucket_bytes = int64_t(channels) * bucket_samples * sizeof(float);
+	juce::AudioBuffer<float>* buffer = nullptr;
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		auto free_list = free_audio_buffers.find(std::make_pair(channels, bucket_samples));
+		if (free_list != free_audio_buffers.end() && !free_list->second.empty()) {
+			buffer = free_list->second.back();
+			free_list->second.pop_back();
+			free_bytes -= bucket_bytes;
+		}
+	}
+
+	if (!buffer)
+		// Allocate the whole bucket (so the buffer can be reused for any size in the bucket)
+		buffer = new juce::AudioBuffer<float>(channels, bucket_samples);
+
+	// Shrink the buffer to the requested size (which keeps its memory)
+	buffer->setSize(channels, samples, false, false, true);
+
+	// A buffer which was resized (such as by Frame::ResizeAudio) has a new allocation (of an unknown size), so it is not pooled
+	return std::shared_ptr<juce::AudioBuffer<float> >(buffer, [channels, samples, bucket_samples](juce::AudioBuffer<float>* released) {
+		bool resized = released->getNumChannels() != channels || released->getNumSamples() != samples;
+		BufferPool::Instance()->ReleaseAudioBuffer(released, resized ? 0 : bucket_samples);
+	});
+}
+
+// Return an audio buffer (from CreateAudioBuffer) to the pool
+void BufferPool::ReleaseAudioBuffer(juce::AudioBuffer<float>* buffer, int bucket_samples)
+{
+	const int channels = buffer->getNumChannels();
+	if (bucket_samples > 0) {
+		const int64_t bucket_bytes = int64_t(channels) * bucket_samples * sizeof(float);
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		if (free_bytes + bucket_bytes <= max_bytes) {
+			free_audio_buffers[std::make_pair(channels, bucket_samples)].push_back(buffer);
+			free_bytes += bucket_bytes;
+			return;
+		}
+	}
+
+	// The pool is full (or the buffer was resized)
+	delete buffer;
+}
+
+// Free all pooled buffers
+void BufferPool::Clear()
+{
+	std::unordered_map<size_t, std::vector<unsigned char*> > buffers;
+	std::map<std::pair<int, int>, std::vector<juce::AudioBuffer<float>*> > audio_buffers;
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		buffers.swap(free_buffers);
+		audio_buffers.swap(free_audio_buffers);
+		free_bytes = 0;
+	}
+
+	for (auto& free_list : buffers)
+		for (auto buffer : free_list.second)
+			delete[] buffer;
+	for (auto& free_list : audio_buffers)
+		for (auto buffer : free_list.second)
+			delete buffer;
+}
+
+// Gets the total size of the free buffers
+int64_t BufferPool::GetBytes()
+{
+	const std::lock_guard<std::mutex> lock(poolMutex);
+	return free_bytes;
+}
+
+// Gets the max size of the free buffers
+int64_t BufferPool::GetMaxBytes()
+{
+	const std::lock_guard<std::mutex> lock(poolMutex);
+	return max_bytes;
+}
+
+// Set the max size of the free buffers
+void BufferPool::SetMaxBytes(int64_t number_of_bytes)
+{
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		max_bytes = number_of_bytes;
+		if (free_bytes <= max_bytes)
+			return;
+	}
+
+	// Free the pooled buffers (which no longer fit)
+	Clear();
+}
+
+// QImage cleanup function, which returns a buffer from BufferPool::Allocate to the pool
+void openshot::releasePooledBuffer(void* info)
+{
+	BufferPool::Instance()->Release(reinterpret_cast<unsigned char*>(info));
+}
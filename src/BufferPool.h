@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Header file for BufferPool class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_BUFFER_POOL_H
+#define OPENSHOT_BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <QImage>
+
+namespace juce {
+	template <typename Type> class AudioBuffer;
+}
+
+namespace openshot {
+
+	/**
+	 * @brief This class recycles the pixel and audio sample buffers of Frame objects.
+	 *
+	 * Rendering allocates (and frees) a full size image for every frame, which at 4K and 60 fps is
+	 * gigabytes of memory per second. Instead of returning these buffers to the system (and paying for
+	 * new page faults on the next frame), released buffers are kept in size buckets, and handed out again
+	 * the next time a buffer of the same size is needed. The free buffers are limited to a max number of
+	 * bytes, and all methods are thread-safe.
+	 *
+	 * @code
+	 * // Create an image, whose pixels are returned to the pool when the image is destroyed
+	 * std::shared_ptr<QImage> image = openshot::BufferPool::Instance()->CreateImage(1920, 1080, QImage::Format_RGBA8888_Premultiplied);
+	 * @endcode
+	 */
+	class BufferPool {
+	private:
+		std::mutex poolMutex; ///< Protects the free buffers
+		std::unordered_map<size_t, std::vector<unsigned char*> > free_buffers; ///< Free pixel buffers (by bucket size)
+		std::map<std::pair<int, int>, std::vector<juce::AudioBuffer<float>*> > free_audio_buffers; ///< Free audio buffers (by channels and bucket samples)
+		int64_t free_bytes; ///< Total allocated size of all free buffers
+		int64_t max_bytes; ///< Max size of all free buffers (0 = no pooling)
+
+		/// Default constructor (use Instance() instead)
+		BufferPool();
+
+		/// Get the bucket size of a buffer (bytes are rounded up, so similar sizes share a bucket)
+		static size_t BucketSize(size_t bytes);
+
+		/// Get the bucket size of an audio buffer (samples are rounded up, so similar sizes share a bucket)
+		static int AudioBucketSamples(int samples);
+
+		/// @brief Return an audio buffer (from CreateAudioBuffer) to the pool
+		/// @param buffer The buffer to release
+		/// @param bucket_samples The samples per channel allocated for the buffer (0 = unknown, so the buffer is freed)
+		void ReleaseAudioBuffer(juce::AudioBuffer<float>* buffer, int bucket_samples);
+
+	public:
+		/// Get the global instance of the pool (which is never destroyed, since frames can outlive everything else)
+		static BufferPool* Instance();
+
+		/// @brief Get a buffer of at least this many bytes (the contents are not initialized)
+		/// @param bytes The number of bytes needed
+		unsigned char* Allocate(size_t bytes);
+
+		/// @brief Return a buffer (from Allocate) to the pool
+		/// @param buffer The buffer to release (or NULL)
+		void Release(unsigned char* buffer);
+
+		/// @brief Create an image, whose pixels are returned to the pool when the image is destroyed
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param format The pixel format of the image (the pixels are not initialized)
+		std::shared_ptr<QImage> CreateImage(int width, int height, QImage::Format format);
+
+		/// @brief Create an audio buffer, which is returned to the pool when it is destroyed
+		/// @param channels The number of channels
+		/// @param samples The number of samples per channel (the samples are not initialized)
+		std::shared_ptr<juce::AudioBuffer<float> > CreateAudioBuffer(int channels, int samples);
+
+		/// Free all pooled buffers
+		void Clear();
+
+		/// Gets the total size of the free buffers
+		int64_t GetBytes();
+
+		/// Gets the max size of the free buffers
+		int64_t GetMaxBytes();
+
+		/// @brief Set the max size of the free buffers (extra buffers are freed instead of being pooled)
+		/// @param number_of_bytes The maximum bytes of free buffers to keep (0 = no pooling)
+		void SetMaxBytes(int64_t number_of_bytes);
+	};
+
+	/// QImage cleanup function, which returns a buffer from BufferPool::Allocate to the pool
+	void releasePooledBuffer(void* info);
+
+}
+
+#endif
@@ -21,7 +21,8 @@ using namespace openshot;
 CacheBase::CacheBase() : CacheBase::CacheBase(0) { }
 
 // Constructor that sets the max frames to cache
-CacheBase::CacheBase(int64_t max_bytes) : max_bytes(max_bytes) {
+CacheBase::CacheBase(int64_t max_bytes) : max_bytes(max_bytes), hits(0), misses(0), inserts(0), evictions(0),
+	bytes_in(0), bytes_out(0), lock_wait_ns(0) {
 	// Init the mutex
 	cacheMutex = new std::recursive_mutex();
 }
@@ -34,6 +35,60 @@ void CacheBase::SetMaxBytesFromInfo(int64_t number_of_frames, int width, int hei
 	SetMaxBytes(bytes);
 }
 
+// Get the eviction policy which needs scoring (caller must hold the cache mutex)
+std::shared_ptr<CacheEvictionPolicy> CacheBase::Policy()
+{
+	// The least recently used policy needs no scoring
+	if (eviction_policy && eviction_policy->IsLeastRecentlyUsed())
+		return std::shared_ptr<CacheEvictionPolicy>();
+
+	return eviction_policy;
+}
+
+// Get the eviction policy
+std::shared_ptr<CacheEvictionPolicy> CacheBase::GetEvictionPolicy()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	return eviction_policy;
+}
+
+// Set the policy which decides which frame to purge first
+void CacheBase::SetEvictionPolicy(std::shared_ptr<CacheEvictionPolicy> policy)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	eviction_policy = policy;
+}
+
+// Get the counters of this cache's activity
+CacheMetrics CacheBase::GetMetrics()
+{
+	CacheMetrics metrics;
+	metrics.hits = hits;
+	metrics.misses = misses;
+	metrics.inserts = inserts;
+	metrics.evictions = evictions;
+	metrics.bytes_in = bytes_in;
+	metrics.bytes_out = bytes_out;
+	metrics.lock_wait_ns = lock_wait_ns;
+	return metrics;
+}
+
+// Reset the counters of this cache's activity
+void CacheBase::ResetMetrics()
+{
+	hits = 0;
+	misses = 0;
+	inserts = 0;
+	evictions = 0;
+	bytes_in = 0;
+	bytes_out = 0;
+	lock_wait_ns = 0;
+}
+
 // Generate Json::Value for this object
 Json::Value CacheBase::JsonValue() {
 
@@ -43,6 +98,16 @@ Json::Value CacheBase::JsonValue() {
 	max_bytes_stream << max_bytes;
 	root["max_bytes"] = max_bytes_stream.str();
 
+	// Add metrics (use strings, since int64_ts are not supported in JSON)
+	CacheMetrics metrics = GetMetrics();
+	root["metrics"]["hits"] = std::to_string(metrics.hits);
+	root["metrics"]["misses"] = std::to_string(metrics.misses);
+	root["metrics"]["inserts"] = std::to_string(metrics.inserts);
+	root["metrics"]["evictions"] = std::to_string(metrics.evictions);
+	root["metrics"]["bytes_in"] = std::to_string(metrics.bytes_in);
+	root["metrics"]["bytes_out"] = std::to_string(metrics.bytes_out);
+	root["metrics"]["lock_wait_ns"] = std::to_string(metrics.lock_wait_ns);
+
 	// return JsonValue
 	return root;
 }
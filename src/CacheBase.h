@@ -13,14 +13,78 @@
 #ifndef OPENSHOT_CACHE_BASE_H
 #define OPENSHOT_CACHE_BASE_H
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
 
+#include "CacheEvictionPolicy.h"
 #include "Json.h"
 
 namespace openshot {
 	class Frame;
 
+	/**
+	 * @brief Counters of a cache's activity (since it was created, or since its metrics were reset)
+	 *
+	 * Use these to size caches, and to spot caches which thrash (i.e. many inserts and evictions, but few hits).
+	 */
+	struct CacheMetrics {
+		int64_t hits; ///< Number of GetFrame calls which found a frame
+		int64_t misses; ///< Number of GetFrame calls which found no frame
+		int64_t inserts; ///< Number of frames added (frames which were already cached are not counted)
+		int64_t evictions; ///< Number of frames purged, because the cache exceeded its max bytes
+		int64_t bytes_in; ///< Total size of the inserted frames
+		int64_t bytes_out; ///< Total size of the frames returned by GetFrame
+		int64_t lock_wait_ns; ///< Total time threads spent waiting for the cache's locks (in nanoseconds)
+	};
+
+	/**
+	 * @brief Scoped lock for the mutexes of a cache, which adds the time spent waiting for the lock to a counter
+	 *
+	 * The lock is tried first, so the clock is only read when a thread actually has to wait.
+	 */
+	template <typename Mutex>
+	class CacheLock {
+	private:
+		Mutex& mutex;
+
+	public:
+		CacheLock(Mutex& mutex, std::atomic<int64_t>& wait_ns) : mutex(mutex) {
+			if (!mutex.try_lock()) {
+				auto start = std::chrono::steady_clock::now();
+				mutex.lock();
+				wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			}
+		}
+		~CacheLock() { mutex.unlock(); }
+
+		CacheLock(const CacheLock&) = delete;
+		CacheLock& operator=(const CacheLock&) = delete;
+	};
+
+	/**
+	 * @brief Scoped shared (reader) lock, which adds the time spent waiting for the lock to a counter
+	 */
+	template <typename Mutex>
+	class CacheSharedLock {
+	private:
+		Mutex& mutex;
+
+	public:
+		CacheSharedLock(Mutex& mutex, std::atomic<int64_t>& wait_ns) : mutex(mutex) {
+			if (!mutex.try_lock_shared()) {
+				auto start = std::chrono::steady_clock::now();
+				mutex.lock_shared();
+				wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			}
+		}
+		~CacheSharedLock() { mutex.unlock_shared(); }
+
+		CacheSharedLock(const CacheSharedLock&) = delete;
+		CacheSharedLock& operator=(const CacheSharedLock&) = delete;
+	};
+
 	/**
 	 * @brief All cache managers in libopenshot are based on this CacheBase class
 	 *
@@ -37,6 +101,30 @@ namespace openshot {
 		/// Mutex for multiple threads
 		std::recursive_mutex *cacheMutex;
 
+		std::shared_ptr<openshot::CacheEvictionPolicy> eviction_policy; ///< Decides which frame to purge first (NULL = least recently used)
+		std::atomic<int64_t> hits; ///< Number of GetFrame calls which found a frame
+		std::atomic<int64_t> misses; ///< Number of GetFrame calls which found no frame
+		std::atomic<int64_t> inserts; ///< Number of frames added
+		std::atomic<int64_t> evictions; ///< Number of frames purged by CleanUp
+		std::atomic<int64_t> bytes_in; ///< Total size of the inserted frames
+		std::atomic<int64_t> bytes_out; ///< Total size of the frames returned by GetFrame
+		std::atomic<int64_t> lock_wait_ns; ///< Total time spent waiting for locks (in nanoseconds)
+
+		/// @brief Count a GetFrame call as a hit or a miss
+		/// @param found Was the frame found in the cache
+		/// @param bytes The size of the returned frame
+		void CountLookup(bool found, int64_t bytes=0) { if (found) { hits++; bytes_out += bytes; } else misses++; };
+
+		/// @brief Count an inserted frame
+		/// @param bytes The size of the inserted frame
+		void CountInsert(int64_t bytes) { inserts++; bytes_in += bytes; };
+
+		/// Count a frame purged by CleanUp
+		void CountEviction() { evictions++; };
+
+		/// Get the eviction policy which needs scoring (NULL = least recently used, caller must hold the cache mutex)
+		std::shared_ptr<openshot::CacheEvictionPolicy> Policy();
+
 
 	public:
 		/// Default constructor, no max bytes
@@ -94,6 +182,25 @@ namespace openshot {
 		/// @param channels The number of audio channels in the frame
 		void SetMaxBytesFromInfo(int64_t number_of_frames, int width, int height, int sample_rate, int channels);
 
+		/// Get the eviction policy (NULL = least recently used)
+		std::shared_ptr<openshot::CacheEvictionPolicy> GetEvictionPolicy();
+
+		/// @brief Set the policy which decides which frame to purge first, once the cache exceeds its max bytes
+		/// @param policy The eviction policy (NULL = least recently used)
+		virtual void SetEvictionPolicy(std::shared_ptr<openshot::CacheEvictionPolicy> policy);
+
+		/// Get the number of GetFrame calls which found a frame
+		int64_t GetHits() { return hits; };
+
+		/// Get the number of GetFrame calls which found no frame
+		int64_t GetMisses() { return misses; };
+
+		/// Get the counters of this cache's activity
+		virtual openshot::CacheMetrics GetMetrics();
+
+		/// Reset the counters of this cache's activity
+		virtual void ResetMetrics();
+
 		// Get and Set JSON methods
 		virtual std::string Json() = 0; ///< Generate JSON string of this object
 		virtual void SetJson(const std::string value) = 0; ///< Load JSON string into this object
@@ -16,19 +16,187 @@
 #include "QtUtilities.h"
 
 #include <Qt>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QString>
-#include <QTextStream>
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
 
 using namespace std;
 using namespace openshot;
 
+namespace {
+	// Identifies binary cache files written by CacheDisk
+	const char CACHE_FILE_MAGIC[4] = {'O', 'S', 'C', 'F'};
+	const uint32_t CACHE_FILE_VERSION = 1;
+
+	// Header at the start of each binary cache file (native byte order). It is followed by
+	// width * height * 4 bytes of RGBA8888 (premultiplied) pixels, and then by
+	// channels * sample_count float32 samples (planar, one channel after another).
+	struct CacheFileHeader {
+		char magic[4];
+		uint32_t version;
+		int32_t width; ///< 0 if no pixel data follows
+		int32_t height;
+		int32_t sample_rate;
+		int32_t channels; ///< 0 if no audio data follows
+		int32_t sample_count;
+		int32_t channel_layout;
+	};
+
+	// The persisted index is a text file, which starts with a header line, followed by one line per change:
+	// "A <frame number> <bytes> <checksum>" when a frame is added, "R <frame number>" when it is removed, and
+	// "C" when the content changed (which drops all previous frames). It is compacted each time it is loaded.
+	const char INDEX_FILE_NAME[] = "index";
+	const char INDEX_FILE_HEADER[] = "OSCI 1";
+
+	// Fast 64-bit checksum (FNV-1a, 8 bytes at a time), to detect truncated or corrupted cache files
+	uint64_t Checksum(const uchar* data, int64_t size, uint64_t hash)
+	{
+		const uint64_t prime = 0x100000001b3ULL;
+		int64_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(word));
+			hash = (hash ^ word) * prime;
+			hash ^= hash >> 32;
+		}
+		for (; i < size; i++)
+			hash = (hash ^ data[i]) * prime;
+		return hash;
+	}
+
+	// Checksum of a file's contents (continuing from a previous checksum)
+	uint64_t FileChecksum(const QString& file_path, uint64_t hash)
+	{
+		QFile file(file_path);
+		if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+			return hash;
+
+		const uchar* data = file.map(0, file.size());
+		if (!data)
+			return hash;
+
+		return Checksum(data, file.size(), hash);
+	}
+
+	// Get the frame's image, adjusted for pixel ratio and scale (the same way Frame::Save does)
+	std::shared_ptr<QImage> GetScaledImage(std::shared_ptr<Frame> frame, float scale)
+	{
+		std::shared_ptr<QImage> image = frame->GetImage();
+		Fraction pixel_ratio = frame->GetPixelRatio();
+
+		if (pixel_ratio.num != 1 || pixel_ratio.den != 1)
+			image = std::make_shared<QImage>(image->scaled(
+				image->width(), image->height() * pixel_ratio.Reciprocal().ToDouble(),
+				Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+
+		if (fabs(scale) > 1.001 || fabs(scale) < 0.999)
+			image = std::make_shared<QImage>(image->scaled(
+				image->width() * scale, image->height() * scale,
+				Qt::KeepAspectRatio, Qt::SmoothTransformation));
+
+		if (image->format() != QImage::Format_RGBA8888_Premultiplied)
+			image = std::make_shared<QImage>(image->convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+
+		return image;
+	}
+
+	// Write a binary cache file, with optional image data and the frame's audio data (if any)
+	bool WriteCacheFile(const QString& file_path, std::shared_ptr<QImage> image, std::shared_ptr<Frame> frame)
+	{
+		QFile file(file_path);
+		if (!file.open(QIODevice::WriteOnly))
+			return false;
+
+		CacheFileHeader header = {};
+		memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic));
+		header.version = CACHE_FILE_VERSION;
+		if (image) {
+			header.width = image->width();
+			header.height = image->height();
+		}
+		if (frame->has_audio_data) {
+			header.sample_rate = frame->SampleRate();
+			header.channels = frame->GetAudioChannelsCount();
+			header.sample_count = frame->GetAudioSamplesCount();
+			header.channel_layout = frame->ChannelsLayout();
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		// Write pixels (one scan-line at a time, in case of padded lines)
+		for (int row = 0; row < header.height; row++)
+			file.write(reinterpret_cast<const char*>(image->constScanLine(row)), header.width * 4);
+
+		// Write planar audio samples
+		for (int channel = 0; channel < header.channels; channel++)
+			file.write(reinterpret_cast<const char*>(frame->GetAudioSamples(channel)), header.sample_count * sizeof(float));
+
+		return file.error() == QFileDevice::NoError;
+	}
+
+	// Memory-map a binary cache file, and copy its image and audio data into a frame
+	bool ReadCacheFile(const QString& file_path, std::shared_ptr<Frame> frame)
+	{
+		QFile file(file_path);
+		if (!file.open(QIODevice::ReadOnly) || file.size() < (qint64) sizeof(CacheFileHeader))
+			return false;
+
+		const uchar* data = file.map(0, file.size());
+		if (!data)
+			return false;
+
+		CacheFileHeader header;
+		memcpy(&header, data, sizeof(header));
+		int64_t image_bytes = int64_t(header.width) * header.height * 4;
+		int64_t audio_bytes = int64_t(header.channels) * header.sample_count * sizeof(float);
+		if (memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+			header.version != CACHE_FILE_VERSION ||
+			(image_bytes != 0 && (header.width <= 0 || header.height <= 0)) ||
+			header.channels < 0 || header.sample_count < 0 ||
+			file.size() < (qint64) (sizeof(header) + image_bytes + audio_bytes))
+			return false;
+
+		// Copy pixel data (no decoding needed)
+		const uchar* pixels = data + sizeof(header);
+		if (image_bytes > 0) {
+			auto image = std::make_shared<QImage>(header.width, header.height, QImage::Format_RGBA8888_Premultiplied);
+			if (image->isNull())
+				return false;
+			for (int row = 0; row < header.height; row++)
+				memcpy(image->scanLine(row), pixels + int64_t(row) * header.width * 4, header.width * 4);
+			frame->AddImage(image);
+		}
+
+		// Copy audio data
+		if (audio_bytes > 0) {
+			const float* samples = reinterpret_cast<const float*>(pixels + image_bytes);
+			frame->ResizeAudio(header.channels, header.sample_count, header.sample_rate, (ChannelLayout) header.channel_layout);
+			for (int channel = 0; channel < header.channels; channel++)
+				frame->AddAudio(true, channel, 0, samples + int64_t(channel) * header.sample_count, header.sample_count, 1.0);
+		}
+
+		return true;
+	}
+}
+
 // Default constructor, no max bytes
 CacheDisk::CacheDisk(std::string cache_path, std::string format, float quality, float scale) : CacheBase(0) {
 	// Set cache type name
 	cache_type = "CacheDisk";
 	range_version = 0;
 	needs_range_processing = false;
-	frame_size_bytes = 0;
+	total_bytes = 0;
+	stale_bytes = 0;
+	content_changed = false;
 	image_format = format;
 	image_quality = quality;
 	image_scale = scale;
@@ -44,7 +212,9 @@ CacheDisk::CacheDisk(std::string cache_path, std::string format, float quality,
 	cache_type = "CacheDisk";
 	range_version = 0;
 	needs_range_processing = false;
-	frame_size_bytes = 0;
+	total_bytes = 0;
+	stale_bytes = 0;
+	content_changed = false;
 	image_format = format;
 	image_quality = quality;
 	image_scale = scale;
@@ -68,6 +238,7 @@ void CacheDisk::InitPath(std::string cache_path) {
 
 	// Init QDir with cache directory
 	path = QDir(qpath);
+	base_path = path;
 
 	// Check if cache directory exists
 	if (!path.exists())
@@ -75,14 +246,260 @@ void CacheDisk::InitPath(std::string cache_path) {
 		path.mkpath(qpath);
 }
 
+// Get the path of a frame's image (or raw) file
+QString CacheDisk::FramePath(int64_t frame_number) {
+	return path.path() + "/" + QString("%1.").arg(frame_number) + QString(image_format.c_str()).toLower();
+}
+
+// Get the path of a frame's audio file
+QString CacheDisk::AudioPath(int64_t frame_number) {
+	return path.path() + "/" + QString("%1").arg(frame_number) + ".audio";
+}
+
+// Calculate the size and checksum of a frame's files
+CacheDisk::IndexEntry CacheDisk::CreateIndexEntry(int64_t frame_number) {
+	IndexEntry entry;
+	entry.bytes = 0;
+	entry.checksum = 0xcbf29ce484222325ULL;
+	entry.verified = true;
+
+	QFileInfo image_file(FramePath(frame_number));
+	QFileInfo audio_file(AudioPath(frame_number));
+	if (image_file.exists()) {
+		entry.bytes += image_file.size();
+		entry.checksum = FileChecksum(image_file.filePath(), entry.checksum);
+	}
+	if (!IsRawFormat() && audio_file.exists()) {
+		entry.bytes += audio_file.size();
+		entry.checksum = FileChecksum(audio_file.filePath(), entry.checksum);
+	}
+	return entry;
+}
+
+// Get the actual size of a frame's files (from the persisted index, if the frame is in it)
+int64_t CacheDisk::FrameFileBytes(int64_t frame_number) {
+	auto entry = index_entries.find(frame_number);
+	if (entry != index_entries.end())
+		return entry->second.bytes;
+
+	int64_t bytes = QFileInfo(FramePath(frame_number)).size();
+	if (!IsRawFormat())
+		bytes += QFileInfo(AudioPath(frame_number)).size();
+	return bytes;
+}
+
+// Append a line to the persisted index
+void CacheDisk::AppendIndex(const QString& line) {
+	QFile index_file(path.path() + "/" + INDEX_FILE_NAME);
+	if (!index_file.open(QIODevice::WriteOnly | QIODevice::Append))
+		return;
+
+	// A new (or cleared) index starts with the header
+	if (index_file.size() == 0)
+		index_file.write(QByteArray(INDEX_FILE_HEADER) + "\n");
+	index_file.write((line + "\n").toUtf8());
+}
+
+// Load the persisted index of the current content
+void CacheDisk::LoadIndex() {
+	std::map<int64_t, IndexEntry> entries;
+	std::map<int64_t, int64_t> last_added; // line number of the last time each frame was added
+
+	// Replay the index
+	QFile index_file(path.path() + "/" + INDEX_FILE_NAME);
+	if (index_file.open(QIODevice::ReadOnly)) {
+		QStringList lines = QString::fromUtf8(index_file.readAll()).split('\n');
+		if (!lines.isEmpty() && lines.first() == INDEX_FILE_HEADER) {
+			for (int line_number = 1; line_number < lines.size(); line_number++) {
+				QStringList fields = lines[line_number].split(' ');
+				if (fields.size() == 1 && fields[0] == "C") {
+					entries.clear();
+					continue;
+				}
+
+				bool valid_number = false;
+				int64_t frame_number = fields.size() > 1 ? fields[1].toLongLong(&valid_number) : 0;
+				if (!valid_number)
+					continue;
+
+				if (fields.size() == 4 && fields[0] == "A") {
+					IndexEntry entry;
+					entry.bytes = fields[2].toLongLong();
+					entry.checksum = fields[3].toULongLong(nullptr, 16);
+					entry.verified = false;
+					entries[frame_number] = entry;
+					last_added[frame_number] = line_number;
+				} else if (fields.size() == 2 && fields[0] == "R") {
+					entries.erase(frame_number);
+				}
+			}
+		}
+		index_file.close();
+	}
+
+	// Keep the frames whose files are still there (oldest first)
+	std::vector<std::pair<int64_t, int64_t> > valid_frames;
+	for (const auto& entry : entries) {
+		QFileInfo image_file(FramePath(entry.first));
+		QFileInfo audio_file(AudioPath(entry.first));
+		int64_t bytes = image_file.size() + (!IsRawFormat() && audio_file.exists() ? audio_file.size() : 0);
+		if (!image_file.exists() || bytes != entry.second.bytes) {
+			QFile::remove(image_file.filePath());
+			QFile::remove(audio_file.filePath());
+			continue;
+		}
+		valid_frames.push_back(std::make_pair(last_added[entry.first], entry.first));
+	}
+	std::sort(valid_frames.begin(), valid_frames.end());
+
+	// Rewrite the compacted index (which also marks this content as recently used)
+	QSaveFile compacted_file(index_file.fileName());
+	if (compacted_file.open(QIODevice::WriteOnly))
+		compacted_file.write(QByteArray(INDEX_FILE_HEADER) + "\n");
+
+	for (const auto& valid_frame : valid_frames) {
+		int64_t frame_number = valid_frame.second;
+		const IndexEntry& entry = entries[frame_number];
+		index_entries[frame_number] = entry;
+		frames[frame_number] = entry.bytes;
+		total_bytes += entry.bytes;
+		frame_numbers.push_front(frame_number);
+		ordered_frame_numbers.push_back(frame_number);
+		needs_range_processing = true;
+
+		compacted_file.write(QString("A %1 %2 %3\n").arg(frame_number).arg(entry.bytes).arg(entry.checksum, 0, 16).toUtf8());
+	}
+	compacted_file.commit();
+}
+
+// Find the persisted folders of other content
+void CacheDisk::FindStaleFolders() {
+	stale_folders.clear();
+	stale_bytes = 0;
+
+	// Folders are sorted by modification time (oldest first), since adding or removing frames touches the folder
+	QFileInfoList folders = base_path.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Time | QDir::Reversed);
+	for (const auto& folder : folders) {
+		if (folder.fileName().toStdString() == content_hash || !QFile::exists(folder.filePath() + "/" + INDEX_FILE_NAME))
+			continue;
+
+		int64_t bytes = 0;
+		QDirIterator files(folder.filePath(), QDir::Files);
+		while (files.hasNext()) {
+			files.next();
+			bytes += files.fileInfo().size();
+		}
+		stale_folders.push_back(std::make_pair(folder.filePath(), bytes));
+		stale_bytes += bytes;
+	}
+}
+
+// The content is being changed, so the persisted index no longer matches the content key
+void CacheDisk::ContentChanged() {
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	if (!IsPersistent() || content_changed)
+		return;
+
+	// Frames are kept (and indexed again) when the changed content is keyed
+	AppendIndex("C");
+	content_changed = true;
+}
+
+// Persist the cache index, and use the cached frames of this content
+void CacheDisk::SetContentKey(std::string content_key, bool keep_frames) {
+	// Hash the key (the content can be large, and the hash is used as the folder name)
+	QByteArray key(content_key.data(), content_key.size());
+	std::string hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex().left(16).toStdString();
+
+	SwitchContent(hash, keep_frames);
+}
+
+// Switch to the folder of another content hash
+void CacheDisk::SwitchContent(std::string hash, bool keep_frames) {
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	if (hash == content_hash) {
+		// The content changed back (such as with an undo), so index the frames again (oldest first)
+		if (content_changed) {
+			for (auto frame_number = frame_numbers.rbegin(); frame_number != frame_numbers.rend(); ++frame_number) {
+				const IndexEntry& entry = index_entries[*frame_number];
+				AppendIndex(QString("A %1 %2 %3").arg(*frame_number).arg(entry.bytes).arg(entry.checksum, 0, 16));
+			}
+			content_changed = false;
+		}
+		return;
+	}
+
+	// Remember the frames of the previous content
+	QDir previous_path = path;
+	bool was_persistent = IsPersistent();
+	bool was_changed = content_changed;
+	std::deque<int64_t> previous_frames;
+	std::map<int64_t, IndexEntry> previous_entries;
+	previous_frames.swap(frame_numbers);
+	previous_entries.swap(index_entries);
+	frames.clear();
+	ordered_frame_numbers.clear();
+	needs_range_processing = true;
+	total_bytes = 0;
+
+	// Switch to the folder of the new content, and load its index
+	content_hash = hash;
+	content_changed = false;
+	path = QDir(base_path.path() + "/" + QString(content_hash.c_str()));
+	if (!path.exists())
+		path.mkpath(path.path());
+	LoadIndex();
+
+	// Move (or forget) the previous frames (least recently used last)
+	for (const auto frame_number : previous_frames) {
+		QString previous_frame_path(previous_path.path() + "/" + QFileInfo(FramePath(frame_number)).fileName());
+		QString previous_audio_path(previous_path.path() + "/" + QFileInfo(AudioPath(frame_number)).fileName());
+
+		if (keep_frames && !frames.count(frame_number)) {
+			QFile::remove(FramePath(frame_number));
+			QFile::remove(AudioPath(frame_number));
+			bool moved = QFile::rename(previous_frame_path, FramePath(frame_number));
+			if (moved && QFile::exists(previous_audio_path))
+				moved = QFile::rename(previous_audio_path, AudioPath(frame_number));
+
+			if (moved) {
+				// Reuse the checksum (if known)
+				IndexEntry entry = previous_entries.count(frame_number) ? previous_entries[frame_number] : CreateIndexEntry(frame_number);
+				index_entries[frame_number] = entry;
+				AppendIndex(QString("A %1 %2 %3").arg(frame_number).arg(entry.bytes).arg(entry.checksum, 0, 16));
+
+				frames[frame_number] = entry.bytes;
+				total_bytes += entry.bytes;
+				frame_numbers.push_back(frame_number);
+				ordered_frame_numbers.push_back(frame_number);
+				continue;
+			}
+		}
+
+		// Frames of persisted content stay on disk (for the next time that content is used)
+		if (!was_persistent || was_changed) {
+			QFile::remove(previous_frame_path);
+			QFile::remove(previous_audio_path);
+		}
+	}
+
+	// Garbage collect other content (if the cache is full)
+	FindStaleFolders();
+	CleanUp();
+}
+
 // Calculate ranges of frames
 void CacheDisk::CalculateRanges() {
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
 	// Only calculate when something has changed
 	if (needs_range_processing) {
 
-		// Create a scoped lock, to protect the cache from multiple threads
-                const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
-
 		// Sort ordered frame #s, and calculate JSON ranges
 		std::sort(ordered_frame_numbers.begin(), ordered_frame_numbers.end());
 
@@ -92,37 +509,39 @@ void CacheDisk::CalculateRanges() {
 		// Increment range version
 		range_version++;
 
-		int64_t starting_frame = *ordered_frame_numbers.begin();
-		int64_t ending_frame = starting_frame;
+		if (!ordered_frame_numbers.empty()) {
+			int64_t starting_frame = *ordered_frame_numbers.begin();
+			int64_t ending_frame = starting_frame;
 
-		// Loop through all known frames (in sequential order)
-		for (const auto frame_number : ordered_frame_numbers) {
-			if (frame_number - ending_frame > 1) {
-				// End of range detected
-				Json::Value range;
+			// Loop through all known frames (in sequential order)
+			for (const auto frame_number : ordered_frame_numbers) {
+				if (frame_number - ending_frame > 1) {
+					// End of range detected
+					Json::Value range;
 
-				// Add JSON object with start/end attributes
-				// Use strings, since int64_ts are supported in JSON
-				range["start"] = std::to_string(starting_frame);
-				range["end"] = std::to_string(ending_frame);
-				ranges.append(range);
+					// Add JSON object with start/end attributes
+					// Use strings, since int64_ts are supported in JSON
+					range["start"] = std::to_string(starting_frame);
+					range["end"] = std::to_string(ending_frame);
+					ranges.append(range);
 
-				// Set new starting range
-				starting_frame = frame_number;
-			}
+					// Set new starting range
+					starting_frame = frame_number;
+				}
 
-			// Set current frame as end of range, and keep looping
-			ending_frame = frame_number;
-		}
+				// Set current frame as end of range, and keep looping
+				ending_frame = frame_number;
+			}
 
-		// APPEND FINAL VALUE
-		Json::Value range;
+			// APPEND FINAL VALUE
+			Json::Value range;
 
-		// Add JSON object with start/end attributes
-		// Use strings, since int64_ts are supported in JSON
-		range["start"] = std::to_string(starting_frame);
-		range["end"] = std::to_string(ending_frame);
-		ranges.append(range);
+			// Add JSON object with start/end attributes
+			// Use strings, since int64_ts are supported in JSON
+			range["start"] = std::to_string(starting_frame);
+			range["end"] = std::to_string(ending_frame);
+			ranges.append(range);
+		}
 
 		// Cache range JSON as string
 		json_ranges = ranges.toStyledString();
@@ -147,7 +566,7 @@ CacheDisk::~CacheDisk()
 void CacheDisk::Add(std::shared_ptr<Frame> frame)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 	int64_t frame_number = frame->number;
 
 	// Freshen frame if it already exists
@@ -157,46 +576,37 @@ void CacheDisk::Add(std::shared_ptr<Frame> frame)
 
 	else
 	{
-		// Add frame to queue and map
-		frames[frame_number] = frame_number;
+		// Add frame to queue (and to the map, once its size is known)
 		frame_numbers.push_front(frame_number);
 		ordered_frame_numbers.push_back(frame_number);
 		needs_range_processing = true;
 
 		// Save image to disk (if needed)
-		QString frame_path(path.path() + "/" + QString("%1.").arg(frame_number) + QString(image_format.c_str()).toLower());
-		frame->Save(frame_path.toStdString(), image_scale, image_format, image_quality);
-		if (frame_size_bytes == 0) {
-			// Get compressed size of frame image (to correctly apply max size against)
-			QFile image_file(frame_path);
-			frame_size_bytes = image_file.size();
+		QString frame_path(FramePath(frame_number));
+		if (IsRawFormat()) {
+			// Save raw pixels and audio into a single binary file
+			WriteCacheFile(frame_path, GetScaledImage(frame, image_scale), frame);
+		} else {
+			frame->Save(frame_path.toStdString(), image_scale, image_format, image_quality);
+
+			// Save audio data (if needed)
+			if (frame->has_audio_data)
+				WriteCacheFile(AudioPath(frame_number), nullptr, frame);
 		}
-
-		// Save audio data (if needed)
-		if (frame->has_audio_data) {
-			QString audio_path(path.path() + "/" + QString("%1").arg(frame_number) + ".audio");
-			QFile audio_file(audio_path);
-
-			if (audio_file.open(QIODevice::WriteOnly)) {
-				QTextStream audio_stream(&audio_file);
-				audio_stream << frame->SampleRate() << Qt::endl;
-				audio_stream << frame->GetAudioChannelsCount() << Qt::endl;
-				audio_stream << frame->GetAudioSamplesCount() << Qt::endl;
-				audio_stream << frame->ChannelsLayout() << Qt::endl;
-
-				// Loop through all samples
-				for (int channel = 0; channel < frame->GetAudioChannelsCount(); channel++)
-				{
-					// Get audio for this channel
-					float *samples = frame->GetAudioSamples(channel);
-					for (int sample = 0; sample < frame->GetAudioSamplesCount(); sample++)
-						audio_stream << samples[sample] << Qt::endl;
-				}
-
-			}
-
+		// Add frame to the persisted index (if any, and once the changed content is keyed)
+		if (IsPersistent()) {
+			IndexEntry entry = CreateIndexEntry(frame_number);
+			index_entries[frame_number] = entry;
+			if (!content_changed)
+				AppendIndex(QString("A %1 %2 %3").arg(frame_number).arg(entry.bytes).arg(entry.checksum, 0, 16));
 		}
 
+		// Keep a running total of the (compressed) sizes of the frames, to correctly apply max size against
+		int64_t bytes = FrameFileBytes(frame_number);
+		frames[frame_number] = bytes;
+		total_bytes += bytes;
+		CountInsert(bytes);
+
 		// Clean up old frames
 		CleanUp();
 	}
@@ -204,80 +614,69 @@ void CacheDisk::Add(std::shared_ptr<Frame> frame)
 
 // Check if frame is already contained in cache
 bool CacheDisk::Contains(int64_t frame_number) {
-    if (frames.count(frame_number) > 0) {
-        return true;
-    } else {
-        return false;
-    }
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	return frames.count(frame_number) > 0;
 }
 
 // Get a frame from the cache (or NULL shared_ptr if no frame is found)
 std::shared_ptr<Frame> CacheDisk::GetFrame(int64_t frame_number)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	// Does frame exists in cache?
 	if (frames.count(frame_number)) {
 		// Does frame exist on disk
-		QString frame_path(path.path() + "/" + QString("%1.").arg(frame_number) + QString(image_format.c_str()).toLower());
+		QString frame_path(FramePath(frame_number));
 		if (path.exists(frame_path)) {
 
-			// Load image file
-			auto image = std::make_shared<QImage>();
-			image->load(frame_path);
-
-			// Set pixel formatimage->
-			image = std::make_shared<QImage>(image->convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+			// Validate frames of a previous session (once), so corrupted files are never returned
+			auto entry = index_entries.find(frame_number);
+			if (entry != index_entries.end() && !entry->second.verified) {
+				if (CreateIndexEntry(frame_number).checksum != entry->second.checksum) {
+					Remove(frame_number);
+					CountLookup(false);
+					return std::shared_ptr<Frame>();
+				}
+				entry->second.verified = true;
+			}
 
 			// Create frame object
 			auto frame = std::make_shared<Frame>();
 			frame->number = frame_number;
-			frame->AddImage(image);
 
-			// Get audio data (if found)
-			QString audio_path(path.path() + "/" + QString("%1").arg(frame_number) + ".audio");
-			QFile audio_file(audio_path);
-			if (audio_file.exists()) {
-				// Open audio file
-				QTextStream in(&audio_file);
-				if (audio_file.open(QIODevice::ReadOnly)) {
-					int sample_rate = in.readLine().toInt();
-					int channels = in.readLine().toInt();
-					int sample_count = in.readLine().toInt();
-					int channel_layout = in.readLine().toInt();
-
-					// Set basic audio properties
-					frame->ResizeAudio(channels, sample_count, sample_rate, (ChannelLayout) channel_layout);
-
-					// Loop through audio samples and add to frame
-					int current_channel = 0;
-					int current_sample = 0;
-					float *channel_samples = new float[sample_count];
-					while (!in.atEnd()) {
-						// Add sample to channel array
-						channel_samples[current_sample] = in.readLine().toFloat();
-						current_sample++;
-
-						if (current_sample == sample_count) {
-							// Add audio to frame
-							frame->AddAudio(true, current_channel, 0, channel_samples, sample_count, 1.0);
-
-							// Increment channel, and reset sample position
-							current_channel++;
-							current_sample = 0;
-						}
-
-					}
+			if (IsRawFormat()) {
+				// Map raw pixels and audio directly from disk
+				if (!ReadCacheFile(frame_path, frame)) {
+					CountLookup(false);
+					return std::shared_ptr<Frame>();
 				}
+
+			} else {
+				// Load image file
+				auto image = std::make_shared<QImage>();
+				image->load(frame_path);
+
+				// Set pixel format
+				image = std::make_shared<QImage>(image->convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+				frame->AddImage(image);
+
+				// Get audio data (if found)
+				QString audio_path(AudioPath(frame_number));
+				if (QFile::exists(audio_path))
+					ReadCacheFile(audio_path, frame);
 			}
 
 			// return the Frame object
+			CountLookup(true, FrameFileBytes(frame_number));
 			return frame;
 		}
 	}
 
 	// no Frame found
+	CountLookup(false);
 	return std::shared_ptr<Frame>();
 }
 
@@ -285,7 +684,7 @@ std::shared_ptr<Frame> CacheDisk::GetFrame(int64_t frame_number)
 std::shared_ptr<Frame> CacheDisk::GetSmallestFrame()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	// Loop through frame numbers
 	std::deque<int64_t>::iterator itr;
@@ -308,14 +707,7 @@ std::shared_ptr<Frame> CacheDisk::GetSmallestFrame()
 int64_t CacheDisk::GetBytes()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
-
-	int64_t  total_bytes = 0;
-
-	// Loop through frames, and calculate total bytes
-	std::deque<int64_t>::reverse_iterator itr;
-	for(itr = frame_numbers.rbegin(); itr != frame_numbers.rend(); ++itr)
-		total_bytes += frame_size_bytes;
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	return total_bytes;
 }
@@ -330,7 +722,7 @@ void CacheDisk::Remove(int64_t frame_number)
 void CacheDisk::Remove(int64_t start_frame_number, int64_t end_frame_number)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	// Loop through frame numbers
 	std::deque<int64_t>::iterator itr;
@@ -351,21 +743,27 @@ void CacheDisk::Remove(int64_t start_frame_number, int64_t end_frame_number)
 	{
 		if (*itr_ordered >= start_frame_number && *itr_ordered <= end_frame_number)
 		{
-			// erase frame number
-			frames.erase(*itr_ordered);
+			// erase frame number (and its size)
+			auto frame = frames.find(*itr_ordered);
+			if (frame != frames.end()) {
+				total_bytes -= frame->second;
+				frames.erase(frame);
+			}
 
 			// Remove the image file (if it exists)
-			QString frame_path(path.path() + "/" + QString("%1.").arg(*itr_ordered) + QString(image_format.c_str()).toLower());
-			QFile image_file(frame_path);
+			QFile image_file(FramePath(*itr_ordered));
 			if (image_file.exists())
 				image_file.remove();
 
 			// Remove audio file (if it exists)
-			QString audio_path(path.path() + "/" + QString("%1").arg(*itr_ordered) + ".audio");
-			QFile audio_file(audio_path);
+			QFile audio_file(AudioPath(*itr_ordered));
 			if (audio_file.exists())
 				audio_file.remove();
 
+			// Remove frame from the persisted index (if any)
+			if (index_entries.erase(*itr_ordered))
+				AppendIndex(QString("R %1").arg(*itr_ordered));
+
 			itr_ordered = ordered_frame_numbers.erase(itr_ordered);
 		} else
 			itr_ordered++;
@@ -382,7 +780,7 @@ void CacheDisk::MoveToFront(int64_t frame_number)
 	if (frames.count(frame_number))
 	{
 		// Create a scoped lock, to protect the cache from multiple threads
-		const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+		const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 		// Loop through frame numbers
 		std::deque<int64_t>::iterator itr;
@@ -405,33 +803,59 @@ void CacheDisk::MoveToFront(int64_t frame_number)
 void CacheDisk::Clear()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	// Clear all containers
 	frames.clear();
 	frame_numbers.clear();
 	ordered_frame_numbers.clear();
+	index_entries.clear();
 	needs_range_processing = true;
-	frame_size_bytes = 0;
+	total_bytes = 0;
 
-	// Delete cache directory, and recreate it
+	// Delete cache directory (only the current content's folder, when persisted), and recreate it
 	QString current_path = path.path();
 	path.removeRecursively();
-
-	// Re-init folder
-	InitPath(current_path.toStdString());
+	path.mkpath(current_path);
 }
 
 // Count the frames in the queue
 int64_t CacheDisk::Count()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	// Return the number of frames in the cache
 	return frames.size();
 }
 
+// Are frames stored as raw binary files (instead of encoded images)
+bool CacheDisk::IsRawFormat() {
+	return QString(image_format.c_str()).toLower() == "raw";
+}
+
+// Get the next frame number to purge (caller must hold the cache mutex)
+int64_t CacheDisk::NextToEvict()
+{
+	// Without a policy, the least recently used frame goes first
+	std::shared_ptr<CacheEvictionPolicy> policy = Policy();
+	if (!policy)
+		return frame_numbers.back();
+
+	// Score every frame (ties go to the older frame)
+	int64_t next = frame_numbers.front();
+	double next_score = policy->EvictionScore(next, 0);
+	for (size_t age = 1; age < frame_numbers.size(); age++) {
+		double score = policy->EvictionScore(frame_numbers[age], age);
+		if (score >= next_score) {
+			next = frame_numbers[age];
+			next_score = score;
+		}
+	}
+
+	return next;
+}
+
 // Clean up cached frames that exceed the number in our max_bytes variable
 void CacheDisk::CleanUp()
 {
@@ -439,15 +863,24 @@ void CacheDisk::CleanUp()
 	if (max_bytes > 0)
 	{
 		// Create a scoped lock, to protect the cache from multiple threads
-		const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+		const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+		// Remove the persisted folders of other content first (least recently used first)
+		while (GetBytes() + stale_bytes > max_bytes && !stale_folders.empty())
+		{
+			QDir(stale_folders.front().first).removeRecursively();
+			stale_bytes -= stale_folders.front().second;
+			stale_folders.pop_front();
+		}
 
 		while (GetBytes() > max_bytes && frame_numbers.size() > 20)
 		{
-			// Get the oldest frame number.
-			int64_t frame_to_remove = frame_numbers.back();
+			// Get the oldest frame number (or the frame chosen by the eviction policy)
+			int64_t frame_to_remove = NextToEvict();
 
 			// Remove frame_number and frame
 			Remove(frame_to_remove);
+			CountEviction();
 		}
 	}
 }
@@ -468,14 +901,14 @@ Json::Value CacheDisk::JsonValue() {
 	// Create root json object
 	Json::Value root = CacheBase::JsonValue(); // get parent properties
 	root["type"] = cache_type;
-	root["path"] = path.path().toStdString();
+	root["path"] = base_path.path().toStdString();
+	root["persistent"] = IsPersistent();
 
 	Json::Value version;
 	std::stringstream range_version_str;
 	range_version_str << range_version;
 	root["version"] = range_version_str.str();
 
-	// Parse and append range data (if any)
 	// Parse and append range data (if any)
 	try {
 		const Json::Value ranges = openshot::stringToJson(json_ranges);
@@ -506,15 +939,46 @@ void CacheDisk::SetJson(const std::string value) {
 // Load Json::Value into this object
 void CacheDisk::SetJsonValue(const Json::Value root) {
 
-	// Close timeline before we do anything (this also removes all open and closing clips)
-	Clear();
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	// Remove all cached frames (unless they are persisted, since they are kept for the next session)
+	if (!IsPersistent())
+		Clear();
 
 	// Set parent data
 	CacheBase::SetJsonValue(root);
 
 	if (!root["type"].isNull())
 		cache_type = root["type"].asString();
-	if (!root["path"].isNull())
-		// Update duration of timeline
+	if (!root["path"].isNull() && (!IsPersistent() || QDir(root["path"].asString().c_str()).absolutePath() != base_path.absolutePath())) {
+		// Forget the persisted frames (without removing them), and load the index of the same content in the new folder
+		std::string hash = content_hash;
+		bool was_changed = content_changed;
+		if (!hash.empty()) {
+			frames.clear();
+			frame_numbers.clear();
+			ordered_frame_numbers.clear();
+			index_entries.clear();
+			needs_range_processing = true;
+			total_bytes = 0;
+		}
+		content_hash = "";
 		InitPath(root["path"].asString());
+
+		// Switch to the same content in the new folder (if persisted)
+		if (!hash.empty())
+			SwitchContent(hash, false);
+
+		// The frames of the content (before it changed) stay persisted in the new folder, but are not used
+		if (was_changed) {
+			frames.clear();
+			frame_numbers.clear();
+			ordered_frame_numbers.clear();
+			index_entries.clear();
+			needs_range_processing = true;
+			total_bytes = 0;
+			content_changed = true;
+		}
+	}
 }
@@ -16,6 +16,8 @@
 #include <map>
 #include <deque>
 #include <memory>
+#include <string>
+#include <utility>
 
 #include "CacheBase.h"
 
@@ -30,17 +32,54 @@ namespace openshot {
 	 * It is used by the Timeline class, if enabled, to cache video and audio frames to disk, to cut down on CPU
 	 * and memory utilization. This will thrash a user's disk, but save their memory and CPU. It's a trade off that
 	 * sometimes makes perfect sense. You can also set the max number of bytes to cache.
+	 *
+	 * Audio is always stored as raw float samples. When the "raw" image format is used, each frame is stored
+	 * as a single binary file (a small header, the RGBA pixels, and the planar audio samples), which is
+	 * memory-mapped and copied back into a Frame without any image decoding.
+	 *
+	 * The cache can also persist its frames between sessions. SetContentKey() moves the cache into a sub-folder
+	 * named after a hash of the content (such as the JSON of a project), which also holds an index of the cached
+	 * frame numbers, sizes, and checksums. Opening the same content again reuses those frames right away, and
+	 * each reused frame is validated against its checksum before it is returned. When the cache is full, the
+	 * sub-folders of other content are removed first (least recently used first).
+	 *
+	 * @code
+	 * openshot::CacheDisk cache("/home/user/.openshot/cache", "raw", 1.0, 1.0, 2LL * 1024 * 1024 * 1024);
+	 * cache.SetContentKey(project_json);
+	 *
+	 * // While the content is edited, the frames still in the cache stay valid for the changed content
+	 * cache.ContentChanged();
+	 * timeline.ApplyJsonDiff(diff);
+	 *
+	 * // Key the cache by the changed content (once, such as when the project is closed)
+	 * cache.SetContentKey(timeline.CacheKey(), true);
+	 * @endcode
+	 *
+	 * A Timeline does this itself, when a persisted CacheDisk is its cache (see Timeline::SetCache).
 	 */
 	class CacheDisk : public CacheBase {
 	private:
+		/// A frame of the persisted index
+		struct IndexEntry {
+			int64_t bytes; ///< Total size of the frame's files
+			uint64_t checksum; ///< Checksum of the frame's files
+			bool verified; ///< The files have been checked against the checksum (or were written by this session)
+		};
+
 		QDir path; ///< This is the folder path of the cache directory
-		std::map<int64_t, int64_t> frames;	///< This map holds the frame number and Frame objects
+		QDir base_path; ///< The folder path of the cache (path is a sub-folder of it, when the index is persisted)
+		std::string content_hash; ///< Hash of the content key (empty = the index is not persisted)
+		bool content_changed; ///< The content changed since it was keyed (so added frames are not persisted yet)
+		std::map<int64_t, IndexEntry> index_entries; ///< The persisted index (by frame number)
+		std::deque<std::pair<QString, int64_t> > stale_folders; ///< Persisted folders of other content, and their sizes (least recently used first)
+		int64_t stale_bytes; ///< Total size of the stale folders
+		std::map<int64_t, int64_t> frames;	///< This map holds the frame numbers, and the sizes of their files
 		std::deque<int64_t> frame_numbers;	///< This queue holds a sequential list of cached Frame numbers
 		std::string image_format;
 		float image_quality;
 		float image_scale;
 
-		int64_t frame_size_bytes; ///< The size of the cached frame in bytes
+		int64_t total_bytes; ///< The total size of the cached frames' files
 		bool needs_range_processing; ///< Something has changed, and the range data needs to be re-calculated
 		std::string json_ranges; ///< JSON ranges of frame numbers
 		std::vector<int64_t> ordered_frame_numbers; ///< Ordered list of frame numbers used by cache
@@ -50,23 +89,53 @@ namespace openshot {
 		/// Clean up cached frames that exceed the max number of bytes
 		void CleanUp();
 
+		/// Get the next frame number to purge (caller must hold the cache mutex, and the cache must not be empty)
+		int64_t NextToEvict();
+
 		/// Init path directory
 		void InitPath(std::string cache_path);
 
 		/// Calculate ranges of frames
 		void CalculateRanges();
 
+		/// Are frames stored as raw binary files (instead of encoded images)
+		bool IsRawFormat();
+
+		/// Get the path of a frame's image (or raw) file
+		QString FramePath(int64_t frame_number);
+
+		/// Get the path of a frame's audio file (only used for encoded image formats)
+		QString AudioPath(int64_t frame_number);
+
+		/// Calculate the size and checksum of a frame's files
+		IndexEntry CreateIndexEntry(int64_t frame_number);
+
+		/// Get the actual size of a frame's files (from the persisted index, if the frame is in it)
+		int64_t FrameFileBytes(int64_t frame_number);
+
+		/// Append a line to the persisted index
+		void AppendIndex(const QString& line);
+
+		/// Load the persisted index of the current content (dropping frames which are missing or have the wrong size)
+		void LoadIndex();
+
+		/// Find the persisted folders of other content (for garbage collection)
+		void FindStaleFolders();
+
+		/// Switch to the folder of another content hash
+		void SwitchContent(std::string hash, bool keep_frames);
+
 	public:
 		/// @brief Default constructor, no max bytes
 		/// @param cache_path The folder path of the cache directory (empty string = /tmp/preview-cache/)
-		/// @param format The image format for disk caching (ppm, jpg, png)
+		/// @param format The image format for disk caching (ppm, jpg, png, raw)
 		/// @param quality The quality of the image (1.0=highest quality/slowest speed, 0.0=worst quality/fastest speed)
 		/// @param scale The scale factor for the preview images (1.0 = original size, 0.5=half size, 0.25=quarter size, etc...)
 		CacheDisk(std::string cache_path, std::string format, float quality, float scale);
 
 		/// @brief Constructor that sets the max bytes to cache
 		/// @param cache_path The folder path of the cache directory (empty string = /tmp/preview-cache/)
-		/// @param format The image format for disk caching (ppm, jpg, png)
+		/// @param format The image format for disk caching (ppm, jpg, png, raw)
 		/// @param quality The quality of the image (1.0=highest quality/slowest speed, 0.0=worst quality/fastest speed)
 		/// @param scale The scale factor for the preview images (1.0 = original size, 0.5=half size, 0.25=quarter size, etc...)
 		/// @param max_bytes The maximum bytes to allow in the cache. Once exceeded, the cache will purge the oldest frames.
@@ -99,6 +168,9 @@ namespace openshot {
 		/// Get the smallest frame number
 		std::shared_ptr<openshot::Frame> GetSmallestFrame();
 
+		/// Is the cache index persisted between sessions (see SetContentKey)
+		bool IsPersistent() { return !content_hash.empty(); };
+
 		/// @brief Move frame to front of queue (so it lasts longer)
 		/// @param frame_number The frame number of the cached frame
 		void MoveToFront(int64_t frame_number);
@@ -112,6 +184,17 @@ namespace openshot {
 		/// @param end_frame_number The ending frame number of the cached frame
 		void Remove(int64_t start_frame_number, int64_t end_frame_number);
 
+		/// @brief The content is being changed (such as by a JSON diff), so the frames added from now on may not
+		/// match the content key any more. The persisted index of the key is invalidated (in case the content is
+		/// never keyed again, such as after a crash), until SetContentKey() is called with the changed content.
+		void ContentChanged();
+
+		/// @brief Persist the cache index, and use the cached frames of this content (if any)
+		/// @param content_key Identifies the cached content, such as the JSON of a project (only a hash of it is stored)
+		/// @param keep_frames Move the frames which are cached now to the new content (when they are still valid for it).
+		/// Otherwise they stay persisted under the previous content key.
+		void SetContentKey(std::string content_key, bool keep_frames=false);
+
 		// Get and Set JSON methods
 		std::string Json(); ///< Generate JSON string of this object
 		void SetJson(const std::string value); ///< Load JSON string into this object
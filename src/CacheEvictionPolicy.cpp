@@ -0,0 +1,40 @@
+/**
+ * @file
+ * @brief Source file for CacheEvictionPolicy classes
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "CacheEvictionPolicy.h"
+
+using namespace openshot;
+
+// Default constructor
+PlayheadEvictionPolicy::PlayheadEvictionPolicy(double behind_weight)
+	: playhead_position(1), playhead_direction(1), behind_weight(behind_weight) { }
+
+// Score a cached frame (by its distance from the playhead)
+double PlayheadEvictionPolicy::EvictionScore(int64_t frame_number, int64_t age)
+{
+	int direction = playhead_direction;
+	double distance = double(frame_number - playhead_position) * (direction < 0 ? -1.0 : 1.0);
+
+	// While paused, frames on both sides of the playhead are equally useful
+	if (distance >= 0.0 || direction == 0)
+		return distance < 0.0 ? -distance : distance;
+
+	// Frames behind the playhead (which were already played) go first
+	return -distance * behind_weight;
+}
+
+// Move the playhead
+void PlayheadEvictionPolicy::SetPlayhead(int64_t position, int speed)
+{
+	playhead_position = position;
+	playhead_direction = (speed > 0) - (speed < 0);
+}
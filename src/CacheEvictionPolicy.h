@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Header file for CacheEvictionPolicy classes
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_CACHE_EVICTION_POLICY_H
+#define OPENSHOT_CACHE_EVICTION_POLICY_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace openshot {
+
+	/**
+	 * @brief This abstract class decides which frame a cache purges first, once it exceeds its max bytes.
+	 *
+	 * Each cached frame is given a score, and the frame with the highest score is purged first. Policies
+	 * can be shared by many caches (and threads), so their methods must be thread-safe. Caches without a
+	 * policy purge the least recently used frame (without scoring every frame).
+	 */
+	class CacheEvictionPolicy {
+	public:
+		virtual ~CacheEvictionPolicy() = default;
+
+		/// Get the name of the policy
+		virtual std::string Name() = 0;
+
+		/// @brief Score a cached frame (the frame with the highest score is purged first)
+		/// @param frame_number The frame number of the cached frame
+		/// @param age How recently the frame was used (0 = the most recently used frame, higher = older)
+		virtual double EvictionScore(int64_t frame_number, int64_t age) = 0;
+
+		/// Does this policy purge the least recently used frame (so caches can skip scoring frames)
+		virtual bool IsLeastRecentlyUsed() { return false; }
+
+		/// @brief Does this policy score frames by their distance from some frame (ignoring their age)
+		///
+		/// The scores only grow with the distance, so the smallest or largest cached frame number always scores
+		/// highest, and caches which keep their frame numbers in order only score those 2 frames.
+		virtual bool IsScoredByDistance() { return false; }
+	};
+
+	/**
+	 * @brief This policy purges the least recently used frame first (the default behavior of all caches).
+	 */
+	class LRUEvictionPolicy : public CacheEvictionPolicy {
+	public:
+		/// Get the name of the policy
+		std::string Name() { return "LRU"; }
+
+		/// Score a cached frame (older frames are purged first)
+		double EvictionScore(int64_t frame_number, int64_t age) { return age; }
+
+		/// Does this policy purge the least recently used frame
+		bool IsLeastRecentlyUsed() { return true; }
+	};
+
+	/**
+	 * @brief This policy keeps the frames near (and ahead of) the playhead, and purges the most distant frames first.
+	 *
+	 * During playback, a least recently used cache often purges the frames just ahead of the playhead (which
+	 * were cached a while ago, and are needed next), while keeping the frames that were just played. This policy
+	 * scores frames by their distance from the playhead instead, and frames behind the playhead (in the playback
+	 * direction) count as further away than frames ahead of it. The VideoCacheThread updates the playhead of any
+	 * PlayheadEvictionPolicy set on its reader's cache.
+	 *
+	 * @code
+	 * // Keep the frames around the playhead in the Timeline's cache
+	 * timeline.GetCache()->SetEvictionPolicy(std::make_shared<openshot::PlayheadEvictionPolicy>());
+	 * @endcode
+	 */
+	class PlayheadEvictionPolicy : public CacheEvictionPolicy {
+	private:
+		std::atomic<int64_t> playhead_position; ///< The current frame number of the playhead
+		std::atomic<int> playhead_direction; ///< The playback direction (1 = forward, -1 = backward, 0 = paused)
+		double behind_weight; ///< How much further away frames behind the playhead count
+
+	public:
+		/// @brief Default constructor
+		/// @param behind_weight How much further away frames behind the playhead count (compared to frames ahead of it)
+		PlayheadEvictionPolicy(double behind_weight=4.0);
+
+		/// Get the name of the policy
+		std::string Name() { return "Playhead"; }
+
+		/// Score a cached frame (by its distance from the playhead)
+		double EvictionScore(int64_t frame_number, int64_t age);
+
+		/// Does this policy score frames by their distance from some frame
+		bool IsScoredByDistance() { return true; }
+
+		/// Get the current frame number of the playhead
+		int64_t GetPlayheadPosition() { return playhead_position; }
+
+		/// @brief Move the playhead
+		/// @param position The current frame number of the playhead
+		/// @param speed The playback speed and direction (1=normal, 2=fast, -1=rewind, 0=paused, etc...)
+		void SetPlayhead(int64_t position, int speed);
+	};
+
+}
+
+#endif
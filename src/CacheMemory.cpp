@@ -14,15 +14,180 @@
 #include "Exceptions.h"
 #include "Frame.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <tuple>
+
 using namespace std;
 using namespace openshot;
 
+namespace {
+	// QOI-style opcodes (see https://qoiformat.org). Each pixel is encoded as a run of the
+	// previous pixel, a reference to a recently seen pixel, a small difference from the
+	// previous pixel, or a full RGB / RGBA value.
+	const unsigned char QOI_OP_INDEX = 0x00; // 00xxxxxx
+	const unsigned char QOI_OP_DIFF = 0x40; // 01xxxxxx
+	const unsigned char QOI_OP_LUMA = 0x80; // 10xxxxxx
+	const unsigned char QOI_OP_RUN = 0xc0; // 11xxxxxx
+	const unsigned char QOI_OP_RGB = 0xfe;
+	const unsigned char QOI_OP_RGBA = 0xff;
+	const unsigned char QOI_MASK = 0xc0;
+
+	// A single RGBA8888 pixel
+	struct Pixel {
+		unsigned char r, g, b, a;
+		bool operator==(const Pixel& other) const {
+			return r == other.r && g == other.g && b == other.b && a == other.a;
+		}
+	};
+
+	// Position of a pixel in the table of recently seen pixels
+	inline int PixelHash(const Pixel& p) {
+		return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+	}
+
+	// Losslessly compress an RGBA8888 image (pixels are read one scan-line at a time)
+	std::vector<unsigned char> EncodePixels(const QImage& image)
+	{
+		std::vector<unsigned char> data;
+		data.reserve(int64_t(image.width()) * image.height());
+
+		Pixel index[64] = {};
+		Pixel previous = {0, 0, 0, 255};
+		int run = 0;
+
+		for (int row = 0; row < image.height(); row++) {
+			const unsigned char* line = image.constScanLine(row);
+			for (int col = 0; col < image.width(); col++) {
+				Pixel p;
+				memcpy(&p, line + col * 4, 4);
+
+				if (p == previous) {
+					// Extend the current run (up to 62 pixels per opcode)
+					if (++run == 62) {
+						data.push_back(QOI_OP_RUN | (run - 1));
+						run = 0;
+					}
+					continue;
+				}
+				if (run > 0) {
+					data.push_back(QOI_OP_RUN | (run - 1));
+					run = 0;
+				}
+
+				int hash = PixelHash(p);
+				if (index[hash] == p) {
+					data.push_back(QOI_OP_INDEX | hash);
+				} else {
+					index[hash] = p;
+					if (p.a == previous.a) {
+						signed char dr = p.r - previous.r;
+						signed char dg = p.g - previous.g;
+						signed char db = p.b - previous.b;
+						signed char dr_dg = dr - dg;
+						signed char db_dg = db - dg;
+
+						if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+							data.push_back(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+						} else if (dr_dg > -9 && dr_dg < 8 && dg > -33 && dg < 32 && db_dg > -9 && db_dg < 8) {
+							data.push_back(QOI_OP_LUMA | (dg + 32));
+							data.push_back((dr_dg + 8) << 4 | (db_dg + 8));
+						} else {
+							data.push_back(QOI_OP_RGB);
+							data.push_back(p.r);
+							data.push_back(p.g);
+							data.push_back(p.b);
+						}
+					} else {
+						data.push_back(QOI_OP_RGBA);
+						data.push_back(p.r);
+						data.push_back(p.g);
+						data.push_back(p.b);
+						data.push_back(p.a);
+					}
+				}
+				previous = p;
+			}
+		}
+		if (run > 0)
+			data.push_back(QOI_OP_RUN | (run - 1));
+
+		data.shrink_to_fit();
+		return data;
+	}
+
+	// Decode pixels compressed by EncodePixels into an image (of the original size)
+	void DecodePixels(const std::vector<unsigned char>& data, QImage& image)
+	{
+		Pixel index[64] = {};
+		Pixel p = {0, 0, 0, 255};
+		int run = 0;
+		size_t position = 0;
+
+		for (int row = 0; row < image.height(); row++) {
+			unsigned char* line = image.scanLine(row);
+			for (int col = 0; col < image.width(); col++) {
+				if (run > 0) {
+					run--;
+				} else if (position < data.size()) {
+					unsigned char op = data[position++];
+					if (op == QOI_OP_RGB) {
+						p.r = data[position++];
+						p.g = data[position++];
+						p.b = data[position++];
+					} else if (op == QOI_OP_RGBA) {
+						p.r = data[position++];
+						p.g = data[position++];
+						p.b = data[position++];
+						p.a = data[position++];
+					} else if ((op & QOI_MASK) == QOI_OP_INDEX) {
+						p = index[op];
+					} else if ((op & QOI_MASK) == QOI_OP_DIFF) {
+						p.r += ((op >> 4) & 0x03) - 2;
+						p.g += ((op >> 2) & 0x03) - 2;
+						p.b += (op & 0x03) - 2;
+					} else if ((op & QOI_MASK) == QOI_OP_LUMA) {
+						unsigned char next = data[position++];
+						int dg = (op & 0x3f) - 32;
+						p.r += dg - 8 + ((next >> 4) & 0x0f);
+						p.g += dg;
+						p.b += dg - 8 + (next & 0x0f);
+					} else {
+						run = op & 0x3f;
+					}
+					index[PixelHash(p)] = p;
+				}
+				memcpy(line + col * 4, &p, 4);
+			}
+		}
+	}
+}
+
+// The compressed image and raw audio data of a Frame
+struct CacheMemory::CompressedFrame {
+	int width;
+	int height;
+	Fraction pixel_ratio;
+	std::vector<unsigned char> pixels; ///< QOI-style compressed RGBA8888 (premultiplied) pixels
+	int sample_rate;
+	int channels;
+	int sample_count;
+	ChannelLayout channel_layout;
+	bool has_audio_data;
+	std::vector<float> samples; ///< Planar audio samples (one channel after another)
+};
+
 // Default constructor, no max bytes
 CacheMemory::CacheMemory() : CacheBase(0) {
 	// Set cache type name
 	cache_type = "CacheMemory";
 	range_version = 0;
 	needs_range_processing = false;
+	total_bytes = 0;
+	compress_frames = false;
+	order_frame_numbers = false;
+	use_count = 0;
 }
 
 // Constructor that sets the max bytes to cache
@@ -31,6 +196,10 @@ CacheMemory::CacheMemory(int64_t max_bytes) : CacheBase(max_bytes) {
 	cache_type = "CacheMemory";
 	range_version = 0;
 	needs_range_processing = false;
+	total_bytes = 0;
+	compress_frames = false;
+	order_frame_numbers = false;
+	use_count = 0;
 }
 
 // Default destructor
@@ -38,7 +207,6 @@ CacheMemory::~CacheMemory()
 {
 	frames.clear();
 	frame_numbers.clear();
-	ordered_frame_numbers.clear();
 
 	// remove mutex
 	delete cacheMutex;
@@ -47,13 +215,17 @@ CacheMemory::~CacheMemory()
 
 // Calculate ranges of frames
 void CacheMemory::CalculateRanges() {
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
 	// Only calculate when something has changed
 	if (needs_range_processing) {
 
-		// Create a scoped lock, to protect the cache from multiple threads
-		const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
-
-		// Sort ordered frame #s, and calculate JSON ranges
+		// Collect and sort frame #s (only done when the JSON is requested)
+		std::vector<int64_t> ordered_frame_numbers;
+		ordered_frame_numbers.reserve(frames.size());
+		for (const auto& entry : frames)
+			ordered_frame_numbers.push_back(entry.first);
 		std::sort(ordered_frame_numbers.begin(), ordered_frame_numbers.end());
 
 		// Clear existing JSON variable
@@ -62,39 +234,39 @@ void CacheMemory::CalculateRanges() {
 		// Increment range version
 		range_version++;
 
-		std::vector<int64_t>::iterator itr_ordered;
-		int64_t starting_frame = *ordered_frame_numbers.begin();
-		int64_t ending_frame = *ordered_frame_numbers.begin();
-
-		// Loop through all known frames (in sequential order)
-		for (itr_ordered = ordered_frame_numbers.begin(); itr_ordered != ordered_frame_numbers.end(); ++itr_ordered) {
-			int64_t frame_number = *itr_ordered;
-			if (frame_number - ending_frame > 1) {
-				// End of range detected
-				Json::Value range;
-
-				// Add JSON object with start/end attributes
-				// Use strings, since int64_ts are supported in JSON
-				range["start"] = std::to_string(starting_frame);
-				range["end"] = std::to_string(ending_frame);
-				ranges.append(range);
-
-				// Set new starting range
-				starting_frame = frame_number;
-			}
+		if (!ordered_frame_numbers.empty()) {
+			int64_t starting_frame = ordered_frame_numbers.front();
+			int64_t ending_frame = ordered_frame_numbers.front();
 
-			// Set current frame as end of range, and keep looping
-			ending_frame = frame_number;
-		}
+			// Loop through all known frames (in sequential order)
+			for (const auto frame_number : ordered_frame_numbers) {
+				if (frame_number - ending_frame > 1) {
+					// End of range detected
+					Json::Value range;
 
-		// APPEND FINAL VALUE
-		Json::Value range;
+					// Add JSON object with start/end attributes
+					// Use strings, since int64_ts are supported in JSON
+					range["start"] = std::to_string(starting_frame);
+					range["end"] = std::to_string(ending_frame);
+					ranges.append(range);
 
-		// Add JSON object with start/end attributes
-		// Use strings, since int64_ts are not supported in JSON
-		range["start"] = std::to_string(starting_frame);
-		range["end"] = std::to_string(ending_frame);
-		ranges.append(range);
+					// Set new starting range
+					starting_frame = frame_number;
+				}
+
+				// Set current frame as end of range, and keep looping
+				ending_frame = frame_number;
+			}
+
+			// APPEND FINAL VALUE
+			Json::Value range;
+
+			// Add JSON object with start/end attributes
+			// Use strings, since int64_ts are not supported in JSON
+			range["start"] = std::to_string(starting_frame);
+			range["end"] = std::to_string(ending_frame);
+			ranges.append(range);
+		}
 
 		// Cache range JSON as string
 		json_ranges = ranges.toStyledString();
@@ -107,22 +279,52 @@ void CacheMemory::CalculateRanges() {
 // Add a Frame to the cache
 void CacheMemory::Add(std::shared_ptr<Frame> frame)
 {
+	// Compress the frame before locking (frames without an image are not worth compressing)
+	std::shared_ptr<CompressedFrame> compressed;
+	if (compress_frames && frame->has_image_data)
+		compressed = CompressFrame(frame);
+
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 	int64_t frame_number = frame->number;
 
-	// Freshen frame if it already exists
-	if (frames.count(frame_number))
+	auto existing = frames.find(frame_number);
+	if (existing != frames.end())
+	{
+		// Compressed frames are copies, so replace them with the latest data
+		if (compressed) {
+			existing->second.frame.reset();
+			existing->second.compressed = compressed;
+		} else if (existing->second.compressed) {
+			existing->second.frame = frame;
+			existing->second.compressed.reset();
+		}
+
+		// Frames are often re-added after more image or audio data is
+		// loaded into them, so refresh the byte total for this entry
+		RefreshEntryBytes(existing->second);
+
 		// Move frame to front of queue
 		MoveToFront(frame_number);
-
+		CleanUp();
+	}
 	else
 	{
 		// Add frame to queue and map
-		frames[frame_number] = frame;
 		frame_numbers.push_front(frame_number);
-		ordered_frame_numbers.push_back(frame_number);
+		CacheEntry& entry = frames[frame_number];
+		if (compressed)
+			entry.compressed = compressed;
+		else
+			entry.frame = frame;
+		entry.lru_position = frame_numbers.begin();
+		entry.last_used = ++use_count;
+		if (order_frame_numbers)
+			ordered_frame_numbers.insert(frame_number);
+		entry.bytes = EntryBytes(entry);
+		total_bytes += entry.bytes;
 		needs_range_processing = true;
+		CountInsert(entry.bytes);
 
 		// Clean up old frames
 		CleanUp();
@@ -131,42 +333,59 @@ void CacheMemory::Add(std::shared_ptr<Frame> frame)
 
 // Check if frame is already contained in cache
 bool CacheMemory::Contains(int64_t frame_number) {
-    if (frames.count(frame_number) > 0) {
-        return true;
-    } else {
-        return false;
-    }
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	return frames.count(frame_number) > 0;
 }
 
 // Get a frame from the cache (or NULL shared_ptr if no frame is found)
 std::shared_ptr<Frame> CacheMemory::GetFrame(int64_t frame_number)
 {
-	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
-
-	// Does frame exists in cache?
-	if (frames.count(frame_number))
-		// return the Frame object
-		return frames[frame_number];
+	std::shared_ptr<Frame> frame;
+	std::shared_ptr<CompressedFrame> compressed;
+	{
+		// Create a scoped lock, to protect the cache from multiple threads
+		const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+		// Does frame exists in cache?
+		auto entry = frames.find(frame_number);
+		if (entry == frames.end()) {
+			// no Frame found
+			CountLookup(false);
+			return std::shared_ptr<Frame>();
+		}
+		frame = entry->second.frame;
+		compressed = entry->second.compressed;
+
+		// Cached frames can gain image or audio data after they are added (so refresh their size when used,
+		// and enforce the max bytes, which can evict this entry)
+		bool grew = RefreshEntryBytes(entry->second);
+		CountLookup(true, entry->second.bytes);
+		if (grew)
+			CleanUp();
+
+		if (!compressed)
+			// return the Frame object
+			return frame;
+	}
 
-	else
-		// no Frame found
-		return std::shared_ptr<Frame>();
+	// Decode a new Frame object (without blocking other threads)
+	return DecompressFrame(frame_number, compressed);
 }
 
 // Get the smallest frame number (or NULL shared_ptr if no frame is found)
 std::shared_ptr<Frame> CacheMemory::GetSmallestFrame()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	// Loop through frame numbers
-	std::deque<int64_t>::iterator itr;
 	int64_t smallest_frame = -1;
-	for(itr = frame_numbers.begin(); itr != frame_numbers.end(); ++itr)
+	for (const auto frame_number : frame_numbers)
 	{
-		if (*itr < smallest_frame || smallest_frame == -1)
-			smallest_frame = *itr;
+		if (frame_number < smallest_frame || smallest_frame == -1)
+			smallest_frame = frame_number;
 	}
 
 	// Return frame (if any)
@@ -177,88 +396,289 @@ std::shared_ptr<Frame> CacheMemory::GetSmallestFrame()
 	}
 }
 
-// Gets the maximum bytes value
-int64_t CacheMemory::GetBytes()
+// Get the next frame to be purged (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheMemory::GetOldestFrame()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
-	int64_t total_bytes = 0;
+	if (frame_numbers.empty())
+		return std::shared_ptr<Frame>();
 
-	// Loop through frames, and calculate total bytes
-	std::deque<int64_t>::reverse_iterator itr;
-	for(itr = frame_numbers.rbegin(); itr != frame_numbers.rend(); ++itr)
-	{
-		total_bytes += frames[*itr]->GetBytes();
+	return GetFrame(*NextToEvict());
+}
+
+// Remove the next frame to be purged, without decoding it
+bool CacheMemory::TakeOldestFrame(StoredFrame& stored)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	if (frame_numbers.empty())
+		return false;
+
+	auto entry = frames.find(*NextToEvict());
+	stored.number = entry->first;
+	stored.bytes = entry->second.bytes;
+	stored.frame = entry->second.frame;
+	stored.compressed = entry->second.compressed;
+	RemoveEntry(entry);
+	return true;
+}
+
+// Add a frame taken out of a cache (compressed frames are added as-is)
+void CacheMemory::AddStored(const StoredFrame& stored)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	// Replace any existing copy of this frame
+	auto existing = frames.find(stored.number);
+	if (existing != frames.end())
+		RemoveEntry(existing);
+
+	// Add frame to queue and map
+	frame_numbers.push_front(stored.number);
+	CacheEntry& entry = frames[stored.number];
+	entry.frame = stored.frame;
+	entry.compressed = stored.compressed;
+	entry.lru_position = frame_numbers.begin();
+	entry.last_used = ++use_count;
+	if (order_frame_numbers)
+		ordered_frame_numbers.insert(stored.number);
+	entry.bytes = EntryBytes(entry);
+	total_bytes += entry.bytes;
+	needs_range_processing = true;
+	CountInsert(entry.bytes);
+
+	// Clean up old frames
+	CleanUp();
+}
+
+// Get the Frame object of a frame taken out of the cache (decoding a new Frame, if compressed)
+std::shared_ptr<Frame> CacheMemory::StoredFrame::GetFrame() const
+{
+	if (!compressed)
+		return frame;
+
+	return DecompressFrame(number, compressed);
+}
+
+// Get the position of the next frame to purge (caller must hold the cache mutex)
+std::list<int64_t>::iterator CacheMemory::NextToEvict()
+{
+	// Without a policy, the least recently used frame goes first
+	std::shared_ptr<CacheEvictionPolicy> policy = Policy();
+	if (!policy)
+		return std::prev(frame_numbers.end());
+
+	// Frames scored by distance: only the smallest and largest frame numbers can score highest (ties go to the older frame)
+	if (order_frame_numbers) {
+		const CacheEntry& first = frames.find(*ordered_frame_numbers.begin())->second;
+		const CacheEntry& last = frames.find(*ordered_frame_numbers.rbegin())->second;
+		double first_score = policy->EvictionScore(*ordered_frame_numbers.begin(), 0);
+		double last_score = policy->EvictionScore(*ordered_frame_numbers.rbegin(), 0);
+		if (first_score > last_score || (first_score == last_score && first.last_used < last.last_used))
+			return first.lru_position;
+		return last.lru_position;
 	}
 
+	// Score every frame (ties go to the older frame)
+	auto next = frame_numbers.begin();
+	double next_score = policy->EvictionScore(*next, 0);
+	int64_t age = 1;
+	for (auto itr = std::next(frame_numbers.begin()); itr != frame_numbers.end(); ++itr, ++age) {
+		double score = policy->EvictionScore(*itr, age);
+		if (score >= next_score) {
+			next = itr;
+			next_score = score;
+		}
+	}
+
+	return next;
+}
+
+// Set the policy which decides which frame to purge first
+void CacheMemory::SetEvictionPolicy(std::shared_ptr<CacheEvictionPolicy> policy)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	CacheBase::SetEvictionPolicy(policy);
+
+	// Keep the frame numbers in order, if the policy scores frames by distance
+	order_frame_numbers = policy && policy->IsScoredByDistance();
+	ordered_frame_numbers.clear();
+	if (order_frame_numbers)
+		for (const auto& entry : frames)
+			ordered_frame_numbers.insert(entry.first);
+}
+
+// Are the images of added frames compressed?
+bool CacheMemory::IsCompressed()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	return compress_frames;
+}
+
+// Enable or disable compressed mode (only affects frames added from now on)
+void CacheMemory::SetCompressed(bool compressed)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	compress_frames = compressed;
+}
+
+// Compress the image and audio data of a frame
+std::shared_ptr<CacheMemory::CompressedFrame> CacheMemory::CompressFrame(std::shared_ptr<Frame> frame)
+{
+	auto compressed = std::make_shared<CompressedFrame>();
+
+	// Compress pixels
+	std::shared_ptr<QImage> image = frame->GetImage();
+	compressed->width = image->width();
+	compressed->height = image->height();
+	compressed->pixel_ratio = frame->GetPixelRatio();
+	compressed->pixels = EncodePixels(*image);
+
+	// Copy planar audio samples (audio is small, and rarely compresses well)
+	compressed->sample_rate = frame->SampleRate();
+	compressed->channels = frame->GetAudioChannelsCount();
+	compressed->sample_count = frame->GetAudioSamplesCount();
+	compressed->channel_layout = frame->ChannelsLayout();
+	compressed->has_audio_data = frame->has_audio_data;
+	compressed->samples.resize(int64_t(compressed->channels) * compressed->sample_count);
+	for (int channel = 0; channel < compressed->channels && compressed->sample_count > 0; channel++)
+		memcpy(compressed->samples.data() + int64_t(channel) * compressed->sample_count,
+			   frame->GetAudioSamples(channel), compressed->sample_count * sizeof(float));
+
+	return compressed;
+}
+
+// Decode a new Frame from compressed data
+std::shared_ptr<Frame> CacheMemory::DecompressFrame(int64_t frame_number, std::shared_ptr<CompressedFrame> compressed)
+{
+	auto frame = std::make_shared<Frame>(frame_number, compressed->width, compressed->height, "#000000",
+										 compressed->sample_count, compressed->channels);
+
+	// Decode pixels
+	auto image = std::make_shared<QImage>(compressed->width, compressed->height, QImage::Format_RGBA8888_Premultiplied);
+	DecodePixels(compressed->pixels, *image);
+	frame->AddImage(image);
+	frame->SetPixelRatio(compressed->pixel_ratio.num, compressed->pixel_ratio.den);
+
+	// Copy audio samples
+	frame->ResizeAudio(compressed->channels, compressed->sample_count, compressed->sample_rate, compressed->channel_layout);
+	for (int channel = 0; channel < compressed->channels && compressed->sample_count > 0; channel++)
+		frame->AddAudio(true, channel, 0, compressed->samples.data() + int64_t(channel) * compressed->sample_count,
+						compressed->sample_count, 1.0);
+	frame->has_audio_data = compressed->has_audio_data;
+
+	return frame;
+}
+
+// Get the size of a cache entry (in bytes)
+int64_t CacheMemory::EntryBytes(const CacheEntry& entry)
+{
+	if (!entry.compressed)
+		return entry.frame->GetBytes();
+
+	return sizeof(CompressedFrame) + entry.compressed->pixels.size() + entry.compressed->samples.size() * sizeof(float);
+}
+
+// Gets the maximum bytes value
+int64_t CacheMemory::GetBytes()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
 	return total_bytes;
 }
 
 // Remove a specific frame
 void CacheMemory::Remove(int64_t frame_number)
 {
-	Remove(frame_number, frame_number);
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	auto entry = frames.find(frame_number);
+	if (entry != frames.end())
+		RemoveEntry(entry);
 }
 
 // Remove range of frames
 void CacheMemory::Remove(int64_t start_frame_number, int64_t end_frame_number)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
-	// Loop through frame numbers
-	std::deque<int64_t>::iterator itr;
-	for(itr = frame_numbers.begin(); itr != frame_numbers.end();)
+	if (start_frame_number > end_frame_number)
+		return;
+
+	// Visit whichever is smaller: the requested range, or the cached frames
+	uint64_t range_size = static_cast<uint64_t>(end_frame_number) - static_cast<uint64_t>(start_frame_number);
+	if (range_size < frames.size())
 	{
-		if (*itr >= start_frame_number && *itr <= end_frame_number)
+		for (int64_t frame_number = start_frame_number; frame_number <= end_frame_number; frame_number++)
 		{
-			// erase frame number
-			itr = frame_numbers.erase(itr);
-		}else
-			itr++;
+			auto entry = frames.find(frame_number);
+			if (entry != frames.end())
+				RemoveEntry(entry);
+		}
 	}
-
-	// Loop through ordered frame numbers
-	std::vector<int64_t>::iterator itr_ordered;
-	for(itr_ordered = ordered_frame_numbers.begin(); itr_ordered != ordered_frame_numbers.end();)
+	else
 	{
-		if (*itr_ordered >= start_frame_number && *itr_ordered <= end_frame_number)
+		for (auto entry = frames.begin(); entry != frames.end();)
 		{
-			// erase frame number
-			frames.erase(*itr_ordered);
-			itr_ordered = ordered_frame_numbers.erase(itr_ordered);
-		}else
-			itr_ordered++;
+			auto current = entry++;
+			if (current->first >= start_frame_number && current->first <= end_frame_number)
+				RemoveEntry(current);
+		}
 	}
+}
+
+// Remove a single cache entry (caller must hold the cache mutex)
+void CacheMemory::RemoveEntry(std::unordered_map<int64_t, CacheEntry>::iterator entry)
+{
+	total_bytes -= entry->second.bytes;
+	frame_numbers.erase(entry->second.lru_position);
+	if (order_frame_numbers)
+		ordered_frame_numbers.erase(entry->first);
+	frames.erase(entry);
 
 	// Needs range processing (since cache has changed)
 	needs_range_processing = true;
 }
 
+// Refresh the size of a cache entry, and update the byte total (caller must hold the cache mutex)
+bool CacheMemory::RefreshEntryBytes(CacheEntry& entry)
+{
+	int64_t frame_bytes = EntryBytes(entry);
+	int64_t growth = frame_bytes - entry.bytes;
+	total_bytes += growth;
+	entry.bytes = frame_bytes;
+	return growth > 0;
+}
+
 // Move frame to front of queue (so it lasts longer)
 void CacheMemory::MoveToFront(int64_t frame_number)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	// Does frame exists in cache?
-	if (frames.count(frame_number))
-	{
-		// Loop through frame numbers
-		std::deque<int64_t>::iterator itr;
-		for(itr = frame_numbers.begin(); itr != frame_numbers.end(); ++itr)
-		{
-			if (*itr == frame_number)
-			{
-				// erase frame number
-				frame_numbers.erase(itr);
-
-				// add frame number to 'front' of queue
-				frame_numbers.push_front(frame_number);
-				break;
-			}
-		}
+	auto entry = frames.find(frame_number);
+	if (entry != frames.end()) {
+		// Relink frame number at the 'front' of queue (iterators remain valid)
+		frame_numbers.splice(frame_numbers.begin(), frame_numbers, entry->second.lru_position);
+		entry->second.last_used = ++use_count;
+
+		// Refresh its size (since it may have changed since it was added), and enforce the max bytes
+		if (RefreshEntryBytes(entry->second))
+			CleanUp();
 	}
 }
 
@@ -266,11 +686,12 @@ void CacheMemory::MoveToFront(int64_t frame_number)
 void CacheMemory::Clear()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	frames.clear();
 	frame_numbers.clear();
 	ordered_frame_numbers.clear();
+	total_bytes = 0;
 	needs_range_processing = true;
 }
 
@@ -278,7 +699,7 @@ void CacheMemory::Clear()
 int64_t CacheMemory::Count()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
 	// Return the number of frames in the cache
 	return frames.size();
@@ -291,15 +712,36 @@ void CacheMemory::CleanUp()
 	if (max_bytes > 0)
 	{
 		// Create a scoped lock, to protect the cache from multiple threads
-		const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+		const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
 
-		while (GetBytes() > max_bytes && frame_numbers.size() > 20)
+		// A policy which scores the age of frames (which changes each time a frame is used) scores every frame once per
+		// clean up, and the frames are purged from a heap (highest score first, ties go to the older frame)
+		std::shared_ptr<CacheEvictionPolicy> policy = Policy();
+		if (policy && !order_frame_numbers && total_bytes > max_bytes && frame_numbers.size() > 20)
 		{
-			// Get the oldest frame number.
-			int64_t frame_to_remove = frame_numbers.back();
+			std::vector<std::tuple<double, int64_t, int64_t>> candidates; // score, age, frame number
+			candidates.reserve(frame_numbers.size());
+			int64_t age = 0;
+			for (auto frame_number : frame_numbers) {
+				candidates.emplace_back(policy->EvictionScore(frame_number, age), age, frame_number);
+				age++;
+			}
+			std::make_heap(candidates.begin(), candidates.end());
+
+			while (total_bytes > max_bytes && frame_numbers.size() > 20)
+			{
+				std::pop_heap(candidates.begin(), candidates.end());
+				RemoveEntry(frames.find(std::get<2>(candidates.back())));
+				candidates.pop_back();
+				CountEviction();
+			}
+		}
 
-			// Remove frame_number and frame
-			Remove(frame_to_remove);
+		while (total_bytes > max_bytes && frame_numbers.size() > 20)
+		{
+			// Remove the oldest frame number and frame (or the frame chosen by the eviction policy)
+			RemoveEntry(frames.find(*NextToEvict()));
+			CountEviction();
 		}
 	}
 }
@@ -323,6 +765,7 @@ Json::Value CacheMemory::JsonValue() {
 	root["type"] = cache_type;
 
 	root["version"] = std::to_string(range_version);
+	root["compressed"] = IsCompressed();
 
 	// Parse and append range data (if any)
 	try {
@@ -362,4 +805,6 @@ void CacheMemory::SetJsonValue(const Json::Value root) {
 
 	if (!root["type"].isNull())
 		cache_type = root["type"].asString();
+	if (!root["compressed"].isNull())
+		SetCompressed(root["compressed"].asBool());
 }
@@ -14,8 +14,11 @@
 #define OPENSHOT_CACHE_MEMORY_H
 
 #include <map>
-#include <deque>
+#include <list>
 #include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "CacheBase.h"
 
@@ -29,25 +32,86 @@ namespace openshot {
 	 * high cost of decoding streams, once a frame is decoded, converted to RGB, and a Frame object is created,
 	 * it critical to keep these Frames cached for performance reasons.  However, the larger the cache, the more memory
 	 * is required.  You can set the max number of bytes to cache.
+	 *
+	 * Frames are stored in a hash map, and each entry keeps an iterator into a least-recently-used list, so
+	 * adding, looking up, freshening, and removing a frame are all constant-time operations. The total size of
+	 * the cache is tracked incrementally, so enforcing the max bytes limit never has to walk the whole cache. Since
+	 * cached frames can still be changed (such as by AddImage or ResizeAudio), the size of each frame is refreshed
+	 * whenever it is added again, looked up, or moved to the front.
+	 *
+	 * In compressed mode (see SetCompressed), the image of each added frame is packed with a fast lossless
+	 * codec (QOI-style), and a new Frame is decoded each time GetFrame is called. GetBytes() reports the real
+	 * (compressed) sizes, so the same max bytes holds several times more frames. Since GetFrame returns a copy,
+	 * this mode is meant for caches of finished frames (such as the Timeline's final cache), and not for caches
+	 * whose frames are still being filled in after they are added.
 	 */
 	class CacheMemory : public CacheBase {
 	private:
-		std::map<int64_t, std::shared_ptr<openshot::Frame> > frames;	///< This map holds the frame number and Frame objects
-		std::deque<int64_t> frame_numbers;	///< This queue holds a sequential list of cached Frame numbers
+		/// The compressed image and raw audio data of a Frame (defined in CacheMemory.cpp)
+		struct CompressedFrame;
+
+		/// A cached Frame, and its position in the least-recently-used list
+		struct CacheEntry {
+			std::shared_ptr<openshot::Frame> frame; ///< The cached Frame object (NULL if compressed)
+			std::shared_ptr<CompressedFrame> compressed; ///< The compressed Frame data (NULL if not compressed)
+			std::list<int64_t>::iterator lru_position; ///< Position of this frame number in frame_numbers
+			int64_t bytes; ///< Size of the frame (in bytes), as of the last time it was added or used
+			int64_t last_used; ///< The use_count when the frame was last added or used (so eviction ties go to the older frame)
+		};
+
+		std::unordered_map<int64_t, CacheEntry> frames;	///< This map holds the frame number and cache entries
+		std::list<int64_t> frame_numbers;	///< This list holds the cached Frame numbers (most recently used at the front)
+		std::set<int64_t> ordered_frame_numbers; ///< The cached Frame numbers in order (only kept while the eviction policy scores frames by distance)
+		bool order_frame_numbers; ///< Keep ordered_frame_numbers (since the eviction policy scores frames by distance)
+		int64_t use_count; ///< Incremented each time a frame is added or used
+		int64_t total_bytes; ///< Running total of the bytes held by all cached frames
+		bool compress_frames; ///< Compress the images of frames as they are added
 
 		bool needs_range_processing; ///< Something has changed, and the range data needs to be re-calculated
 		std::string json_ranges; ///< JSON ranges of frame numbers
-		std::vector<int64_t> ordered_frame_numbers; ///< Ordered list of frame numbers used by cache
 		std::map<int64_t, int64_t> frame_ranges;	///< This map holds the ranges of frames, useful for quickly displaying the contents of the cache
 		int64_t range_version; ///< The version of the JSON range data (incremented with each change)
 
 		/// Clean up cached frames that exceed the max number of bytes
 		void CleanUp();
 
+		/// Compress the image and audio data of a frame
+		static std::shared_ptr<CompressedFrame> CompressFrame(std::shared_ptr<openshot::Frame> frame);
+
+		/// Decode a new Frame from compressed data
+		static std::shared_ptr<openshot::Frame> DecompressFrame(int64_t frame_number, std::shared_ptr<CompressedFrame> compressed);
+
+		/// Get the size of a cache entry (in bytes)
+		static int64_t EntryBytes(const CacheEntry& entry);
+
+		/// Get the position of the next frame to purge in frame_numbers (caller must hold the cache mutex, and the cache must not be empty)
+		std::list<int64_t>::iterator NextToEvict();
+
+		/// @brief Refresh the size of a cache entry (cached frames can gain image or audio data after they are added),
+		/// and update the byte total (caller must hold the cache mutex)
+		/// @returns True if the entry grew
+		bool RefreshEntryBytes(CacheEntry& entry);
+
+		/// Remove a single cache entry, and update the byte total (caller must hold the cache mutex)
+		void RemoveEntry(std::unordered_map<int64_t, CacheEntry>::iterator entry);
+
 		/// Calculate ranges of frames
 		void CalculateRanges();
 
 	public:
+#ifndef SWIG
+		/// A frame taken out of the cache as it was stored (so a compressed frame is only decoded when it is needed)
+		struct StoredFrame {
+			int64_t number; ///< The frame number
+			int64_t bytes; ///< Size of the stored frame (in bytes)
+			std::shared_ptr<openshot::Frame> frame; ///< The Frame object (NULL if compressed)
+			std::shared_ptr<CompressedFrame> compressed; ///< The compressed Frame data (NULL if not compressed)
+
+			/// Get the Frame object (decoding a new Frame, if compressed)
+			std::shared_ptr<openshot::Frame> GetFrame() const;
+		};
+#endif
+
 		/// Default constructor, no max bytes
 		CacheMemory();
 
@@ -82,6 +146,31 @@ namespace openshot {
 		/// Get the smallest frame number
 		std::shared_ptr<openshot::Frame> GetSmallestFrame();
 
+		/// Get the next frame to be purged (the least recently used frame, unless an eviction policy is set)
+		std::shared_ptr<openshot::Frame> GetOldestFrame();
+
+		/// Are the images of added frames compressed?
+		bool IsCompressed();
+
+		/// @brief Set the policy which decides which frame to purge first, once the cache exceeds its max bytes
+		/// @param policy The eviction policy (NULL = least recently used)
+		void SetEvictionPolicy(std::shared_ptr<openshot::CacheEvictionPolicy> policy);
+
+#ifndef SWIG
+		/// @brief Add a frame taken out of a cache (compressed frames are added as-is, without decoding them)
+		/// @param stored The frame, as it was stored
+		void AddStored(const StoredFrame& stored);
+
+		/// @brief Remove the next frame to be purged, without decoding it (such as to move it to another cache tier)
+		/// @returns False if the cache is empty
+		/// @param stored Set to the removed frame, as it was stored
+		bool TakeOldestFrame(StoredFrame& stored);
+#endif
+
+		/// @brief Enable or disable compressed mode (only affects frames added from now on)
+		/// @param compressed Compress the images of added frames (trading some CPU time for memory)
+		void SetCompressed(bool compressed);
+
 		/// @brief Move frame to front of queue (so it lasts longer)
 		/// @param frame_number The frame number of the cached frame
 		void MoveToFront(int64_t frame_number);
@@ -0,0 +1,479 @@
+/**
+ * @file
+ * @brief Source file for CacheSharded class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "CacheSharded.h"
+#include "Exceptions.h"
+#include "Frame.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace openshot;
+
+// Default constructor, no max bytes
+CacheSharded::CacheSharded() : CacheSharded::CacheSharded(0) { }
+
+// Constructor that sets the max bytes to cache
+CacheSharded::CacheSharded(int64_t max_bytes, int number_of_shards) : CacheBase(max_bytes),
+	total_bytes(0), total_frames(0), access_counter(0), needs_range_processing(false)
+{
+	// Set cache type name
+	cache_type = "CacheSharded";
+	range_version = 0;
+
+	// Create shards
+	InitShards(number_of_shards);
+}
+
+// Default destructor
+CacheSharded::~CacheSharded()
+{
+	shards.clear();
+
+	// remove mutex
+	delete cacheMutex;
+}
+
+// Create the shards
+void CacheSharded::InitShards(int number_of_shards)
+{
+	// Round up to a power of 2 (so a frame's shard is a simple mask)
+	int shard_count = 1;
+	while (shard_count < number_of_shards)
+		shard_count *= 2;
+
+	for (int index = 0; index < shard_count; index++) {
+		shards.push_back(std::unique_ptr<CacheShard>(new CacheShard()));
+		shards.back()->has_oldest = false;
+	}
+}
+
+// Get the shard which holds a frame number
+CacheSharded::CacheShard& CacheSharded::ShardFor(int64_t frame_number)
+{
+	// Consecutive frames land in different shards
+	return *shards[static_cast<uint64_t>(frame_number) & (shards.size() - 1)];
+}
+
+// Calculate ranges of frames
+void CacheSharded::CalculateRanges() {
+	// Create a scoped lock, to protect the range data from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	// Only calculate when something has changed
+	if (needs_range_processing.exchange(false)) {
+
+		// Collect and sort frame #s from all shards
+		std::vector<int64_t> ordered_frame_numbers;
+		for (auto& shard : shards) {
+			const CacheSharedLock<std::shared_timed_mutex> shard_lock(shard->mutex, lock_wait_ns);
+			for (const auto& entry : shard->frames)
+				ordered_frame_numbers.push_back(entry.first);
+		}
+		std::sort(ordered_frame_numbers.begin(), ordered_frame_numbers.end());
+
+		// Clear existing JSON variable
+		Json::Value ranges = Json::Value(Json::arrayValue);
+
+		// Increment range version
+		range_version++;
+
+		if (!ordered_frame_numbers.empty()) {
+			int64_t starting_frame = ordered_frame_numbers.front();
+			int64_t ending_frame = ordered_frame_numbers.front();
+
+			// Loop through all known frames (in sequential order)
+			for (const auto frame_number : ordered_frame_numbers) {
+				if (frame_number - ending_frame > 1) {
+					// End of range detected
+					Json::Value range;
+
+					// Add JSON object with start/end attributes
+					// Use strings, since int64_ts are supported in JSON
+					range["start"] = std::to_string(starting_frame);
+					range["end"] = std::to_string(ending_frame);
+					ranges.append(range);
+
+					// Set new starting range
+					starting_frame = frame_number;
+				}
+
+				// Set current frame as end of range, and keep looping
+				ending_frame = frame_number;
+			}
+
+			// APPEND FINAL VALUE
+			Json::Value range;
+
+			// Add JSON object with start/end attributes
+			// Use strings, since int64_ts are not supported in JSON
+			range["start"] = std::to_string(starting_frame);
+			range["end"] = std::to_string(ending_frame);
+			ranges.append(range);
+		}
+
+		// Cache range JSON as string
+		json_ranges = ranges.toStyledString();
+	}
+}
+
+// Add a Frame to the cache
+void CacheSharded::Add(std::shared_ptr<Frame> frame)
+{
+	int64_t frame_number = frame->number;
+	CacheShard& shard = ShardFor(frame_number);
+	uint64_t access = ++access_counter;
+
+	{
+		// Lock only this shard (for writing)
+		const CacheLock<std::shared_timed_mutex> lock(shard.mutex, lock_wait_ns);
+
+		auto existing = shard.frames.find(frame_number);
+		if (existing != shard.frames.end())
+		{
+			// Refresh the byte total for this entry, and freshen it
+			int64_t frame_bytes = existing->second.frame->GetBytes();
+			total_bytes += frame_bytes - existing->second.bytes;
+			existing->second.bytes = frame_bytes;
+			existing->second.last_used = access;
+			return;
+		}
+
+		// Add frame to queue and map
+		shard.frame_numbers.push_front(frame_number);
+		CacheEntry& entry = shard.frames[frame_number];
+		entry.frame = frame;
+		entry.queue_position = shard.frame_numbers.begin();
+		entry.bytes = frame->GetBytes();
+		entry.last_used = access;
+		entry.queued_at = access;
+		total_bytes += entry.bytes;
+		total_frames++;
+		needs_range_processing = true;
+		CountInsert(entry.bytes);
+	}
+
+	// Clean up old frames
+	CleanUp();
+}
+
+// Check if frame is already contained in cache
+bool CacheSharded::Contains(int64_t frame_number) {
+	CacheShard& shard = ShardFor(frame_number);
+	const CacheSharedLock<std::shared_timed_mutex> lock(shard.mutex, lock_wait_ns);
+
+	return shard.frames.count(frame_number) > 0;
+}
+
+// Get a frame from the cache (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheSharded::GetFrame(int64_t frame_number)
+{
+	// Lock only this shard (for reading)
+	CacheShard& shard = ShardFor(frame_number);
+	const CacheSharedLock<std::shared_timed_mutex> lock(shard.mutex, lock_wait_ns);
+
+	// Does frame exists in cache?
+	auto entry = shard.frames.find(frame_number);
+	if (entry != shard.frames.end()) {
+		// return the Frame object
+		CountLookup(true, entry->second.bytes);
+		return entry->second.frame;
+
+	} else {
+		// no Frame found
+		CountLookup(false);
+		return std::shared_ptr<Frame>();
+	}
+}
+
+// Get the smallest frame number (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheSharded::GetSmallestFrame()
+{
+	// Loop through frame numbers of all shards
+	int64_t smallest_frame = -1;
+	for (auto& shard : shards) {
+		const CacheSharedLock<std::shared_timed_mutex> lock(shard->mutex, lock_wait_ns);
+		for (const auto& entry : shard->frames)
+			if (entry.first < smallest_frame || smallest_frame == -1)
+				smallest_frame = entry.first;
+	}
+
+	// Return frame (if any)
+	if (smallest_frame != -1) {
+		return GetFrame(smallest_frame);
+	} else {
+		return NULL;
+	}
+}
+
+// Gets the maximum bytes value
+int64_t CacheSharded::GetBytes()
+{
+	return total_bytes;
+}
+
+// Remove a specific frame
+void CacheSharded::Remove(int64_t frame_number)
+{
+	CacheShard& shard = ShardFor(frame_number);
+	const CacheLock<std::shared_timed_mutex> lock(shard.mutex, lock_wait_ns);
+
+	auto entry = shard.frames.find(frame_number);
+	if (entry != shard.frames.end())
+		RemoveEntry(shard, entry);
+}
+
+// Remove range of frames
+void CacheSharded::Remove(int64_t start_frame_number, int64_t end_frame_number)
+{
+	if (start_frame_number > end_frame_number)
+		return;
+
+	// Visit whichever is smaller: the requested range, or the cached frames
+	uint64_t range_size = static_cast<uint64_t>(end_frame_number) - static_cast<uint64_t>(start_frame_number);
+	if (range_size < static_cast<uint64_t>(total_frames))
+	{
+		for (int64_t frame_number = start_frame_number; frame_number <= end_frame_number; frame_number++)
+			Remove(frame_number);
+	}
+	else
+	{
+		for (auto& shard : shards) {
+			const CacheLock<std::shared_timed_mutex> lock(shard->mutex, lock_wait_ns);
+			for (auto entry = shard->frames.begin(); entry != shard->frames.end();)
+			{
+				auto current = entry++;
+				if (current->first >= start_frame_number && current->first <= end_frame_number)
+					RemoveEntry(*shard, current);
+			}
+		}
+	}
+}
+
+// Remove a single cache entry (caller must hold the shard's exclusive lock)
+void CacheSharded::RemoveEntry(CacheShard& shard, std::unordered_map<int64_t, CacheEntry>::iterator entry)
+{
+	total_bytes -= entry->second.bytes;
+	total_frames--;
+	shard.frame_numbers.erase(entry->second.queue_position);
+	shard.frames.erase(entry);
+
+	// Needs range processing (since cache has changed)
+	needs_range_processing = true;
+}
+
+// Move frame to front of queue (so it lasts longer)
+void CacheSharded::MoveToFront(int64_t frame_number)
+{
+	// Stamping the access only needs a shared lock (the queue is fixed up during clean up)
+	CacheShard& shard = ShardFor(frame_number);
+	const CacheSharedLock<std::shared_timed_mutex> lock(shard.mutex, lock_wait_ns);
+
+	auto entry = shard.frames.find(frame_number);
+	if (entry != shard.frames.end())
+		entry->second.last_used = ++access_counter;
+}
+
+// Clear the cache of all frames
+void CacheSharded::Clear()
+{
+	for (auto& shard : shards) {
+		const CacheLock<std::shared_timed_mutex> lock(shard->mutex, lock_wait_ns);
+		for (const auto& entry : shard->frames) {
+			total_bytes -= entry.second.bytes;
+			total_frames--;
+		}
+		shard->frames.clear();
+		shard->frame_numbers.clear();
+	}
+	needs_range_processing = true;
+}
+
+// Count the frames in the queue
+int64_t CacheSharded::Count()
+{
+	// Return the number of frames in the cache
+	return total_frames;
+}
+
+// Purge the frames with the highest eviction scores (caller must hold cleanupMutex)
+void CacheSharded::CleanUpScored(std::shared_ptr<CacheEvictionPolicy> policy)
+{
+	while (total_bytes > max_bytes && total_frames > 20)
+	{
+		// Score the frames of all shards (the age of a frame is the number of accesses since it was used)
+		CacheShard* next_shard = nullptr;
+		int64_t next_frame = 0;
+		double next_score = 0.0;
+		uint64_t access = access_counter;
+		for (auto& shard : shards) {
+			const CacheSharedLock<std::shared_timed_mutex> lock(shard->mutex, lock_wait_ns);
+			for (const auto& entry : shard->frames) {
+				uint64_t last_used = entry.second.last_used;
+				double score = policy->EvictionScore(entry.first, last_used < access ? access - last_used : 0);
+				if (!next_shard || score > next_score) {
+					next_shard = shard.get();
+					next_frame = entry.first;
+					next_score = score;
+				}
+			}
+		}
+
+		// Nothing left to remove
+		if (!next_shard)
+			return;
+
+		// Remove the frame (unless it was removed in the meantime)
+		const CacheLock<std::shared_timed_mutex> lock(next_shard->mutex, lock_wait_ns);
+		auto entry = next_shard->frames.find(next_frame);
+		if (entry != next_shard->frames.end()) {
+			RemoveEntry(*next_shard, entry);
+			CountEviction();
+		}
+	}
+}
+
+// Find the least recently used frame of a shard (caller must hold the shard's exclusive lock)
+bool CacheSharded::FindOldest(CacheShard& shard, int64_t& frame_number, uint64_t& last_used)
+{
+	while (!shard.frame_numbers.empty()) {
+		CacheEntry& entry = shard.frames.find(shard.frame_numbers.back())->second;
+		last_used = entry.last_used;
+		if (last_used == entry.queued_at) {
+			frame_number = shard.frame_numbers.back();
+			return true;
+		}
+
+		// Frame was used since it was queued, so give it a second chance
+		entry.queued_at = last_used;
+		shard.frame_numbers.splice(shard.frame_numbers.begin(), shard.frame_numbers, entry.queue_position);
+	}
+
+	return false;
+}
+
+// Clean up cached frames that exceed the number in our max_bytes variable
+void CacheSharded::CleanUp()
+{
+	// Do we auto clean up? (re-checked after each pass, since frames added by
+	// other threads while the purging thread held the lock were skipped below)
+	while (max_bytes > 0 && total_bytes > max_bytes && total_frames > 20)
+	{
+		// Only one thread purges at a time (other threads just keep going)
+		std::unique_lock<std::mutex> cleanup_lock(cleanupMutex, std::try_to_lock);
+		if (!cleanup_lock.owns_lock())
+			return;
+
+		// An eviction policy scores every frame (instead of using the shards' least recently used frames)
+		std::shared_ptr<CacheEvictionPolicy> policy;
+		{
+			const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+			policy = Policy();
+		}
+		if (policy) {
+			CleanUpScored(policy);
+			continue;
+		}
+
+		// Find the oldest frame of any shard without a candidate (candidates are
+		// kept between calls, since new frames never replace a shard's oldest frame)
+		for (auto& shard : shards) {
+			if (!shard->has_oldest) {
+				const CacheLock<std::shared_timed_mutex> lock(shard->mutex, lock_wait_ns);
+				shard->has_oldest = FindOldest(*shard, shard->oldest_frame, shard->oldest_access);
+			}
+		}
+
+		while (total_bytes > max_bytes && total_frames > 20)
+		{
+			// Pick the least recently used frame across all shards
+			CacheShard* oldest = nullptr;
+			for (auto& shard : shards)
+				if (shard->has_oldest && (!oldest || shard->oldest_access < oldest->oldest_access))
+					oldest = shard.get();
+
+			// Nothing left to remove
+			if (!oldest)
+				return;
+
+			// Remove the oldest frame (unless it was used or removed in the meantime),
+			// and find the next oldest frame of that shard
+			const CacheLock<std::shared_timed_mutex> lock(oldest->mutex, lock_wait_ns);
+			auto entry = oldest->frames.find(oldest->oldest_frame);
+			if (entry != oldest->frames.end() && entry->second.last_used == oldest->oldest_access) {
+				RemoveEntry(*oldest, entry);
+				CountEviction();
+			}
+			oldest->has_oldest = FindOldest(*oldest, oldest->oldest_frame, oldest->oldest_access);
+		}
+	}
+}
+
+
+// Generate JSON string of this object
+std::string CacheSharded::Json() {
+
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object
+Json::Value CacheSharded::JsonValue() {
+
+	// Process range data (if anything has changed)
+	CalculateRanges();
+
+	// Create root json object
+	Json::Value root = CacheBase::JsonValue(); // get parent properties
+	root["type"] = cache_type;
+
+	root["version"] = std::to_string(range_version);
+
+	// Parse and append range data (if any)
+	try {
+		const Json::Value ranges = openshot::stringToJson(json_ranges);
+		root["ranges"] = ranges;
+	} catch (...) { }
+
+	// return JsonValue
+	return root;
+}
+
+// Load JSON string into this object
+void CacheSharded::SetJson(const std::string value) {
+
+	try
+	{
+		// Parse string to Json::Value
+		const Json::Value root = openshot::stringToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Load Json::Value into this object
+void CacheSharded::SetJsonValue(const Json::Value root) {
+
+	// Remove all cached frames
+	Clear();
+
+	// Set parent data
+	CacheBase::SetJsonValue(root);
+
+	if (!root["type"].isNull())
+		cache_type = root["type"].asString();
+}
@@ -0,0 +1,156 @@
+/**
+ * @file
+ * @brief Header file for CacheSharded class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_CACHE_SHARDED_H
+#define OPENSHOT_CACHE_SHARDED_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CacheBase.h"
+
+namespace openshot {
+	class Frame;
+
+	/**
+	 * @brief This class is a memory-based cache manager for Frame objects, optimized for many threads.
+	 *
+	 * Frames are spread across a number of shards (by frame number), and each shard has its own
+	 * reader/writer lock. Lookups (Contains, GetFrame) only take a shared lock, so many render threads
+	 * can read from the cache at once, and writers only block the one shard they touch.
+	 *
+	 * The max bytes limit applies to the whole cache. Every access stamps the frame with a global
+	 * counter, and when the cache is full, the least recently used frame across all shards is purged
+	 * (each shard keeps its frames in insertion order, and frames used since they were queued get a
+	 * second chance). With an eviction policy, every frame is scored instead, which is slower to purge.
+	 * Use this cache in place of CacheMemory when many threads hammer the same cache.
+	 */
+	class CacheSharded : public CacheBase {
+	private:
+		/// A cached Frame, and its position in the shard's queue
+		struct CacheEntry {
+			std::shared_ptr<openshot::Frame> frame; ///< The cached Frame object
+			std::list<int64_t>::iterator queue_position; ///< Position of this frame number in the shard's queue
+			int64_t bytes; ///< Size of the frame (in bytes), as of the last time it was added
+			std::atomic<uint64_t> last_used; ///< Access counter value when this frame was last used
+			uint64_t queued_at; ///< Access counter value when this frame was (re-)queued
+		};
+
+		/// A slice of the cache, with its own lock
+		struct CacheShard {
+			std::shared_timed_mutex mutex; ///< Shared for lookups, exclusive for changes
+			std::unordered_map<int64_t, CacheEntry> frames; ///< This map holds the frame number and cache entries
+			std::list<int64_t> frame_numbers; ///< Frame numbers, in the order they were queued (newest at the front)
+
+			bool has_oldest; ///< The shard has a clean up candidate (guarded by cleanupMutex)
+			int64_t oldest_frame; ///< The shard's least recently used frame number (guarded by cleanupMutex)
+			uint64_t oldest_access; ///< Access counter value of oldest_frame (guarded by cleanupMutex)
+		};
+
+		std::vector<std::unique_ptr<CacheShard> > shards; ///< All shards (the count is a power of 2)
+		std::atomic<int64_t> total_bytes; ///< Running total of the bytes held by all shards
+		std::atomic<int64_t> total_frames; ///< Running total of the frames held by all shards
+		std::atomic<uint64_t> access_counter; ///< Global counter used to order accesses across shards
+		std::mutex cleanupMutex; ///< Only one thread purges frames at a time
+
+		std::atomic<bool> needs_range_processing; ///< Something has changed, and the range data needs to be re-calculated
+		std::string json_ranges; ///< JSON ranges of frame numbers
+		int64_t range_version; ///< The version of the JSON range data (incremented with each change)
+
+		/// Get the shard which holds a frame number
+		CacheShard& ShardFor(int64_t frame_number);
+
+		/// Clean up cached frames that exceed the max number of bytes
+		void CleanUp();
+
+		/// Purge the frames with the highest eviction scores, until the cache fits (caller must hold cleanupMutex)
+		void CleanUpScored(std::shared_ptr<openshot::CacheEvictionPolicy> policy);
+
+		/// Find the least recently used frame of a shard (caller must hold the shard's exclusive lock)
+		bool FindOldest(CacheShard& shard, int64_t& frame_number, uint64_t& last_used);
+
+		/// Calculate ranges of frames
+		void CalculateRanges();
+
+		/// Remove a single cache entry (caller must hold the shard's exclusive lock)
+		void RemoveEntry(CacheShard& shard, std::unordered_map<int64_t, CacheEntry>::iterator entry);
+
+		/// Create the shards
+		void InitShards(int number_of_shards);
+
+	public:
+		/// Default constructor, no max bytes
+		CacheSharded();
+
+		/// @brief Constructor that sets the max bytes to cache
+		/// @param max_bytes The maximum bytes to allow in the cache. Once exceeded, the cache will purge the oldest frames.
+		/// @param number_of_shards The number of independently locked shards (rounded up to a power of 2)
+		CacheSharded(int64_t max_bytes, int number_of_shards=16);
+
+		// Default destructor
+		virtual ~CacheSharded();
+
+		/// @brief Add a Frame to the cache
+		/// @param frame The openshot::Frame object needing to be cached.
+		void Add(std::shared_ptr<openshot::Frame> frame);
+
+		/// Clear the cache of all frames
+		void Clear();
+
+		/// @brief Check if frame is already contained in cache
+		/// @param frame_number The frame number to be checked
+		bool Contains(int64_t frame_number);
+
+		/// Count the frames in the queue
+		int64_t Count();
+
+		/// @brief Get a frame from the cache
+		/// @param frame_number The frame number of the cached frame
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t frame_number);
+
+		/// Gets the maximum bytes value
+		int64_t GetBytes();
+
+		/// Get the number of shards
+		int GetShardCount() { return shards.size(); };
+
+		/// Get the smallest frame number
+		std::shared_ptr<openshot::Frame> GetSmallestFrame();
+
+		/// @brief Move frame to front of queue (so it lasts longer)
+		/// @param frame_number The frame number of the cached frame
+		void MoveToFront(int64_t frame_number);
+
+		/// @brief Remove a specific frame
+		/// @param frame_number The frame number of the cached frame
+		void Remove(int64_t frame_number);
+
+		/// @brief Remove a range of frames
+		/// @param start_frame_number The starting frame number of the cached frame
+		/// @param end_frame_number The ending frame number of the cached frame
+		void Remove(int64_t start_frame_number, int64_t end_frame_number);
+
+		// Get and Set JSON methods
+		std::string Json(); ///< Generate JSON string of this object
+		void SetJson(const std::string value); ///< Load JSON string into this object
+		Json::Value JsonValue(); ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root); ///< Load Json::Value into this object
+	};
+
+}
+
+#endif
@@ -0,0 +1,459 @@
+/**
+ * @file
+ * @brief Source file for CacheTiered class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "CacheTiered.h"
+#include "Exceptions.h"
+#include "Frame.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace openshot;
+
+// Default constructor, no max bytes
+CacheTiered::CacheTiered(std::string cache_path, std::string format, float quality, float scale)
+	: CacheTiered::CacheTiered(cache_path, format, quality, scale, 0, 0) { }
+
+// Constructor that sets the max bytes of each tier
+CacheTiered::CacheTiered(std::string cache_path, std::string format, float quality, float scale, int64_t max_bytes, int64_t disk_max_bytes)
+	: CacheBase(max_bytes), memory_cache(0), disk_cache(cache_path, format, quality, scale, disk_max_bytes)
+{
+	// Set cache type name
+	cache_type = "CacheTiered";
+	range_version = 0;
+	spilling_frame = 0;
+	is_spilling = false;
+	is_stopping = false;
+
+	// Start background thread (which writes demoted frames to disk)
+	spill_thread = std::thread(&CacheTiered::SpillFrames, this);
+}
+
+// Default destructor
+CacheTiered::~CacheTiered()
+{
+	// Stop background thread
+	{
+		const CacheLock<std::mutex> lock(spillMutex, lock_wait_ns);
+		is_stopping = true;
+	}
+	spill_condition.notify_all();
+	if (spill_thread.joinable())
+		spill_thread.join();
+
+	pending_frames.clear();
+
+	// remove mutex
+	delete cacheMutex;
+}
+
+// Write pending frames to the disk tier (runs on spill_thread)
+void CacheTiered::SpillFrames()
+{
+	std::unique_lock<std::mutex> lock(spillMutex);
+	while (true)
+	{
+		spill_condition.wait(lock, [this] { return is_stopping || !pending_frames.empty(); });
+		if (is_stopping)
+			break;
+
+		// Frames stay in the pending queue (visible to GetFrame) until they are on disk
+		auto pending = *pending_frames.begin();
+		spilling_frame = pending.first;
+		is_spilling = true;
+
+		// Write frame (without blocking callers). A compressed frame is decoded here, on the spill thread.
+		lock.unlock();
+		const CacheLock<std::mutex> disk_lock(diskMutex, lock_wait_ns);
+		disk_cache.Add(pending.second.GetFrame());
+		lock.lock();
+
+		pending_frames.erase(pending.first);
+		is_spilling = false;
+		spill_done_condition.notify_all();
+	}
+}
+
+// Wait for any in-progress disk write of a range of frames (caller must hold spill_lock)
+void CacheTiered::WaitForSpill(std::unique_lock<std::mutex>& spill_lock, int64_t start_frame_number, int64_t end_frame_number)
+{
+	spill_done_condition.wait(spill_lock, [&] {
+		return !is_spilling || spilling_frame < start_frame_number || spilling_frame > end_frame_number;
+	});
+}
+
+// Remove a range of frames from the pending queue (and wait for any in-progress write)
+void CacheTiered::RemovePending(int64_t start_frame_number, int64_t end_frame_number)
+{
+	std::unique_lock<std::mutex> spill_lock(spillMutex);
+	WaitForSpill(spill_lock, start_frame_number, end_frame_number);
+
+	pending_frames.erase(pending_frames.lower_bound(start_frame_number),
+						 pending_frames.upper_bound(end_frame_number));
+}
+
+// Add a Frame to the cache
+void CacheTiered::Add(std::shared_ptr<Frame> frame)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+	int64_t frame_number = frame->number;
+
+	if (!memory_cache.Contains(frame_number))
+	{
+		// Replace any older copy of this frame (in the lower tiers)
+		RemovePending(frame_number, frame_number);
+		disk_cache.Remove(frame_number);
+		CountInsert(frame->GetBytes());
+	}
+
+	// Add (or freshen) frame in the memory tier
+	memory_cache.Add(frame);
+
+	// Demote old frames
+	CleanUp();
+}
+
+// Check if frame is already contained in cache
+bool CacheTiered::Contains(int64_t frame_number)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	if (memory_cache.Contains(frame_number))
+		return true;
+
+	{
+		const CacheLock<std::mutex> spill_lock(spillMutex, lock_wait_ns);
+		if (pending_frames.count(frame_number))
+			return true;
+	}
+
+	return disk_cache.Contains(frame_number);
+}
+
+// Get a frame from the cache (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheTiered::GetFrame(int64_t frame_number)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	// Check memory tier
+	std::shared_ptr<Frame> frame = memory_cache.GetFrame(frame_number);
+	if (frame) {
+		CountLookup(true, frame->GetBytes());
+		return frame;
+	}
+
+	// Check frames waiting to be written to disk
+	{
+		std::unique_lock<std::mutex> spill_lock(spillMutex);
+		WaitForSpill(spill_lock, frame_number, frame_number);
+
+		auto pending = pending_frames.find(frame_number);
+		if (pending != pending_frames.end()) {
+			// Promote the frame as it was stored (without compressing it again)
+			frame = pending->second.GetFrame();
+			memory_cache.AddStored(pending->second);
+			pending_frames.erase(pending);
+		}
+	}
+
+	// Check disk tier
+	if (!frame && disk_cache.Contains(frame_number)) {
+		frame = disk_cache.GetFrame(frame_number);
+		disk_cache.Remove(frame_number);
+	}
+
+	// Promote frame to the memory tier
+	if (frame) {
+		if (!memory_cache.Contains(frame_number))
+			memory_cache.Add(frame);
+		CleanUp();
+	}
+
+	CountLookup(frame != nullptr, frame ? frame->GetBytes() : 0);
+	return frame;
+}
+
+// Get the smallest frame number (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheTiered::GetSmallestFrame()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	int64_t smallest_frame = -1;
+
+	std::shared_ptr<Frame> memory_frame = memory_cache.GetSmallestFrame();
+	if (memory_frame)
+		smallest_frame = memory_frame->number;
+
+	{
+		const CacheLock<std::mutex> spill_lock(spillMutex, lock_wait_ns);
+		if (!pending_frames.empty() && (pending_frames.begin()->first < smallest_frame || smallest_frame == -1))
+			smallest_frame = pending_frames.begin()->first;
+	}
+
+	std::shared_ptr<Frame> disk_frame = disk_cache.GetSmallestFrame();
+	if (disk_frame && (disk_frame->number < smallest_frame || smallest_frame == -1))
+		smallest_frame = disk_frame->number;
+
+	// Return frame (if any)
+	if (smallest_frame != -1) {
+		return GetFrame(smallest_frame);
+	} else {
+		return NULL;
+	}
+}
+
+// Gets the total bytes of all tiers
+int64_t CacheTiered::GetBytes()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	// Include frames not yet written to disk (without counting frames twice)
+	const CacheLock<std::mutex> disk_lock(diskMutex, lock_wait_ns);
+	const CacheLock<std::mutex> spill_lock(spillMutex, lock_wait_ns);
+	int64_t total_bytes = memory_cache.GetBytes() + disk_cache.GetBytes();
+	for (const auto& pending : pending_frames)
+		total_bytes += pending.second.bytes;
+
+	return total_bytes;
+}
+
+// Remove a specific frame
+void CacheTiered::Remove(int64_t frame_number)
+{
+	Remove(frame_number, frame_number);
+}
+
+// Remove range of frames
+void CacheTiered::Remove(int64_t start_frame_number, int64_t end_frame_number)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	memory_cache.Remove(start_frame_number, end_frame_number);
+	RemovePending(start_frame_number, end_frame_number);
+	disk_cache.Remove(start_frame_number, end_frame_number);
+}
+
+// Set the policy which decides which frames are demoted (and purged from disk) first
+void CacheTiered::SetEvictionPolicy(std::shared_ptr<CacheEvictionPolicy> policy)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	CacheBase::SetEvictionPolicy(policy);
+	memory_cache.SetEvictionPolicy(policy);
+	disk_cache.SetEvictionPolicy(policy);
+}
+
+// Get the counters of this cache's activity
+CacheMetrics CacheTiered::GetMetrics()
+{
+	CacheMetrics metrics = CacheBase::GetMetrics();
+
+	// Frames are only purged by the disk tier, and the tiers have their own locks
+	CacheMetrics memory_metrics = memory_cache.GetMetrics();
+	CacheMetrics disk_metrics = disk_cache.GetMetrics();
+	metrics.evictions += disk_metrics.evictions;
+	metrics.lock_wait_ns += memory_metrics.lock_wait_ns + disk_metrics.lock_wait_ns;
+	return metrics;
+}
+
+// Reset the counters of this cache's activity
+void CacheTiered::ResetMetrics()
+{
+	CacheBase::ResetMetrics();
+	memory_cache.ResetMetrics();
+	disk_cache.ResetMetrics();
+}
+
+// Clear the cache of all frames
+void CacheTiered::Clear()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	memory_cache.Clear();
+	{
+		std::unique_lock<std::mutex> spill_lock(spillMutex);
+		pending_frames.clear();
+		spill_done_condition.wait(spill_lock, [this] { return !is_spilling; });
+	}
+	disk_cache.Clear();
+}
+
+// Count the frames in all tiers
+int64_t CacheTiered::Count()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	// Include frames not yet written to disk (without counting frames twice)
+	const CacheLock<std::mutex> disk_lock(diskMutex, lock_wait_ns);
+	const CacheLock<std::mutex> spill_lock(spillMutex, lock_wait_ns);
+	int64_t count = memory_cache.Count() + disk_cache.Count() + pending_frames.size();
+
+	return count;
+}
+
+// Demote frames that exceed the number in our max_bytes variable
+void CacheTiered::CleanUp()
+{
+	// Do we auto clean up?
+	if (max_bytes > 0)
+	{
+		// Create a scoped lock, to protect the cache from multiple threads
+		const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+		bool demoted = false;
+		while (memory_cache.GetBytes() > max_bytes && memory_cache.Count() > 20)
+		{
+			// Move the oldest frame (or the frame chosen by the eviction policy) into the pending queue, as it
+			// was stored (so a compressed frame is not decoded on this thread)
+			CacheMemory::StoredFrame stored;
+			if (!memory_cache.TakeOldestFrame(stored))
+				break;
+
+			const CacheLock<std::mutex> spill_lock(spillMutex, lock_wait_ns);
+			pending_frames[stored.number] = stored;
+			demoted = true;
+		}
+
+		// Wake background thread
+		if (demoted)
+			spill_condition.notify_one();
+	}
+}
+
+// Calculate ranges of frames (across all tiers)
+void CacheTiered::CalculateRanges()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const CacheLock<std::recursive_mutex> lock(*cacheMutex, lock_wait_ns);
+
+	// Collect the ranges of each tier (without frames moving between tiers)
+	std::vector<std::pair<int64_t, int64_t> > tier_ranges;
+	{
+		const CacheLock<std::mutex> disk_lock(diskMutex, lock_wait_ns);
+		const CacheLock<std::mutex> spill_lock(spillMutex, lock_wait_ns);
+		for (const Json::Value& tier : {memory_cache.JsonValue(), disk_cache.JsonValue()})
+			for (const Json::Value& range : tier["ranges"])
+				tier_ranges.push_back(std::make_pair(std::stoll(range["start"].asString()),
+													 std::stoll(range["end"].asString())));
+		for (const auto& pending : pending_frames)
+			tier_ranges.push_back(std::make_pair(pending.first, pending.first));
+	}
+	std::sort(tier_ranges.begin(), tier_ranges.end());
+
+	// Clear existing JSON variable
+	Json::Value ranges = Json::Value(Json::arrayValue);
+
+	// Merge overlapping (and adjacent) ranges
+	for (size_t index = 0; index < tier_ranges.size();) {
+		int64_t starting_frame = tier_ranges[index].first;
+		int64_t ending_frame = tier_ranges[index].second;
+		for (index++; index < tier_ranges.size() && tier_ranges[index].first <= ending_frame + 1; index++)
+			ending_frame = std::max(ending_frame, tier_ranges[index].second);
+
+		// Add JSON object with start/end attributes
+		// Use strings, since int64_ts are not supported in JSON
+		Json::Value range;
+		range["start"] = std::to_string(starting_frame);
+		range["end"] = std::to_string(ending_frame);
+		ranges.append(range);
+	}
+
+	// Increment range version (only if the ranges have changed)
+	std::string new_ranges = ranges.toStyledString();
+	if (new_ranges != json_ranges) {
+		json_ranges = new_ranges;
+		range_version++;
+	}
+}
+
+// Generate JSON string of this object
+std::string CacheTiered::Json() {
+
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object
+Json::Value CacheTiered::JsonValue() {
+
+	// Frames move between tiers in the background, so always re-calculate ranges
+	CalculateRanges();
+
+	// Create root json object
+	Json::Value root = CacheBase::JsonValue(); // get parent properties
+	root["type"] = cache_type;
+	root["disk_max_bytes"] = std::to_string(disk_cache.GetMaxBytes());
+	root["path"] = disk_cache.JsonValue()["path"];
+	root["compressed"] = IsCompressed();
+	root["version"] = std::to_string(range_version);
+
+	// Parse and append range data (if any)
+	try {
+		const Json::Value ranges = openshot::stringToJson(json_ranges);
+		root["ranges"] = ranges;
+	} catch (...) { }
+
+	// return JsonValue
+	return root;
+}
+
+// Load JSON string into this object
+void CacheTiered::SetJson(const std::string value) {
+
+	try
+	{
+		// Parse string to Json::Value
+		const Json::Value root = openshot::stringToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Load Json::Value into this object
+void CacheTiered::SetJsonValue(const Json::Value root) {
+
+	// Remove all cached frames
+	Clear();
+
+	// Set parent data
+	CacheBase::SetJsonValue(root);
+
+	if (!root["type"].isNull())
+		cache_type = root["type"].asString();
+	if (!root["compressed"].isNull())
+		SetCompressed(root["compressed"].asBool());
+
+	// Set disk tier data
+	Json::Value disk_root;
+	if (!root["path"].isNull())
+		disk_root["path"] = root["path"];
+	if (!root["disk_max_bytes"].isNull())
+		disk_root["max_bytes"] = root["disk_max_bytes"];
+	if (!disk_root.isNull())
+		disk_cache.SetJsonValue(disk_root);
+}
@@ -0,0 +1,164 @@
+/**
+ * @file
+ * @brief Header file for CacheTiered class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_CACHE_TIERED_H
+#define OPENSHOT_CACHE_TIERED_H
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "CacheBase.h"
+#include "CacheDisk.h"
+#include "CacheMemory.h"
+
+namespace openshot {
+	class Frame;
+
+	/**
+	 * @brief This class is a two-tier (memory + disk) cache manager for Frame objects.
+	 *
+	 * Recently used frames are kept in memory (limited by max_bytes). When the memory tier is full, the
+	 * least recently used frames are handed to a background thread, which writes them into a CacheDisk.
+	 * Frames found on disk are promoted back into memory when requested. This allows a Timeline to keep
+	 * many more rendered frames around than would fit in RAM, without blocking the render thread on disk writes.
+	 *
+	 * @code
+	 * // 2 GB of frames in memory, and 20 GB on disk
+	 * openshot::CacheTiered* cache = new openshot::CacheTiered("", "RAW", 1.0, 1.0,
+	 *     2 * 1024 * 1024 * 1024LL, 20 * 1024 * 1024 * 1024LL);
+	 * t.SetCache(cache);
+	 * @endcode
+	 */
+	class CacheTiered : public CacheBase {
+	private:
+		CacheMemory memory_cache; ///< Hot tier (unlimited, since this class enforces max_bytes)
+		CacheDisk disk_cache; ///< Cold tier (limited by its own max bytes)
+
+		std::map<int64_t, CacheMemory::StoredFrame> pending_frames; ///< Frames waiting to be written to disk (still compressed, if the memory tier is)
+		std::mutex spillMutex; ///< Protects pending_frames and the spill thread state
+		std::mutex diskMutex; ///< Held while a frame is written to disk, until it leaves pending_frames
+		std::condition_variable spill_condition; ///< Wakes the spill thread when frames are pending
+		std::condition_variable spill_done_condition; ///< Signaled each time the spill thread finishes writing a frame
+		std::thread spill_thread; ///< Background thread which writes demoted frames to disk
+		int64_t spilling_frame; ///< The frame number currently being written to disk
+		bool is_spilling; ///< The spill thread is writing spilling_frame to disk
+		bool is_stopping; ///< Signal the spill thread to exit
+
+		std::string json_ranges; ///< JSON ranges of frame numbers
+		int64_t range_version; ///< The version of the JSON range data (incremented with each change)
+
+		/// Demote frames that exceed the max number of bytes (of the memory tier)
+		void CleanUp();
+
+		/// Calculate ranges of frames (across all tiers)
+		void CalculateRanges();
+
+		/// Remove a range of frames from the pending queue (and wait for any in-progress write)
+		void RemovePending(int64_t start_frame_number, int64_t end_frame_number);
+
+		/// Wait for any in-progress disk write of a range of frames (caller must hold spill_lock)
+		void WaitForSpill(std::unique_lock<std::mutex>& spill_lock, int64_t start_frame_number, int64_t end_frame_number);
+
+		/// Write pending frames to the disk tier (runs on spill_thread)
+		void SpillFrames();
+
+	public:
+		/// @brief Default constructor, no max bytes
+		/// @param cache_path The folder path of the disk tier (empty string = /tmp/preview-cache/)
+		/// @param format The image format for disk caching (ppm, jpg, png, raw)
+		/// @param quality The quality of the image (1.0=highest quality/slowest speed, 0.0=worst quality/fastest speed)
+		/// @param scale The scale factor for the disk images (1.0 = original size, 0.5=half size, 0.25=quarter size, etc...)
+		CacheTiered(std::string cache_path, std::string format, float quality, float scale);
+
+		/// @brief Constructor that sets the max bytes of each tier
+		/// @param cache_path The folder path of the disk tier (empty string = /tmp/preview-cache/)
+		/// @param format The image format for disk caching (ppm, jpg, png, raw)
+		/// @param quality The quality of the image (1.0=highest quality/slowest speed, 0.0=worst quality/fastest speed)
+		/// @param scale The scale factor for the disk images (1.0 = original size, 0.5=half size, 0.25=quarter size, etc...)
+		/// @param max_bytes The maximum bytes to keep in memory. Once exceeded, the oldest frames are moved to disk.
+		/// @param disk_max_bytes The maximum bytes to keep on disk. Once exceeded, the oldest frames on disk are purged.
+		CacheTiered(std::string cache_path, std::string format, float quality, float scale, int64_t max_bytes, int64_t disk_max_bytes);
+
+		// Default destructor
+		virtual ~CacheTiered();
+
+		/// @brief Add a Frame to the cache
+		/// @param frame The openshot::Frame object needing to be cached.
+		void Add(std::shared_ptr<openshot::Frame> frame);
+
+		/// @brief Set the policy which decides which frames are demoted (and purged from disk) first
+		/// @param policy The eviction policy (NULL = least recently used)
+		void SetEvictionPolicy(std::shared_ptr<openshot::CacheEvictionPolicy> policy);
+
+		/// Get the counters of this cache's activity (including the purges and lock waits of its tiers)
+		openshot::CacheMetrics GetMetrics();
+
+		/// Reset the counters of this cache's activity (and of its tiers)
+		void ResetMetrics();
+
+		/// Clear the cache of all frames (in all tiers)
+		void Clear();
+
+		/// @brief Check if frame is already contained in cache
+		/// @param frame_number The frame number to be checked
+		bool Contains(int64_t frame_number);
+
+		/// Count the frames in all tiers
+		int64_t Count();
+
+		/// @brief Get a frame from the cache (frames found on disk are moved back into memory)
+		/// @param frame_number The frame number of the cached frame
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t frame_number);
+
+		/// Gets the total bytes of all tiers
+		int64_t GetBytes();
+
+		/// Get the smallest frame number
+		std::shared_ptr<openshot::Frame> GetSmallestFrame();
+
+		/// Are the images of frames in the memory tier compressed?
+		bool IsCompressed() { return memory_cache.IsCompressed(); };
+
+		/// @brief Enable or disable compressed mode for the memory tier (see CacheMemory::SetCompressed). Compressed
+		/// frames are moved to the disk tier as-is, and only decoded by the background thread which writes them.
+		/// @param compressed Compress the images of added frames (trading some CPU time for memory)
+		void SetCompressed(bool compressed) { memory_cache.SetCompressed(compressed); };
+
+		/// Gets the maximum bytes value of the disk tier
+		int64_t GetDiskMaxBytes() { return disk_cache.GetMaxBytes(); };
+
+		/// @brief Set maximum bytes of the disk tier to a different amount
+		/// @param number_of_bytes The maximum bytes to keep on disk. Once exceeded, the oldest frames on disk are purged.
+		void SetDiskMaxBytes(int64_t number_of_bytes) { disk_cache.SetMaxBytes(number_of_bytes); };
+
+		/// @brief Remove a specific frame
+		/// @param frame_number The frame number of the cached frame
+		void Remove(int64_t frame_number);
+
+		/// @brief Remove a range of frames
+		/// @param start_frame_number The starting frame number of the cached frame
+		/// @param end_frame_number The ending frame number of the cached frame
+		void Remove(int64_t start_frame_number, int64_t end_frame_number);
+
+		// Get and Set JSON methods
+		std::string Json(); ///< Generate JSON string of this object
+		void SetJson(const std::string value); ///< Load JSON string into this object
+		Json::Value JsonValue(); ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root); ///< Load Json::Value into this object
+	};
+
+}
+
+#endif
@@ -16,6 +16,7 @@
 #include "Exceptions.h"
 #include "FFmpegReader.h"
 #include "FrameMapper.h"
+#include "ImageCompositor.h"
 #include "QtImageReader.h"
 #include "ChunkReader.h"
 #include "DummyReader.h"
@@ -405,12 +406,21 @@ std::shared_ptr<Frame> Clip::GetFrame(std::shared_ptr<openshot::Frame> backgroun
 		if (time.GetLength() > 1)
 			new_frame_number = time_mapped_number;
 
+		// Clips hidden by opaque clips above them only need their audio (so skip decoding video, effects, and compositing)
+		bool audio_only = options != NULL && options->is_hidden;
+
 		// Now that we have re-mapped what frame number is needed, go and get the frame pointer
-		std::shared_ptr<Frame> original_frame = GetOrCreateFrame(new_frame_number);
+		std::shared_ptr<Frame> original_frame = GetOrCreateFrame(new_frame_number, audio_only);
 
 		// Get time mapped frame number (used to increase speed, change direction, etc...)
 		// TODO: Handle variable # of samples, since this resamples audio for different speeds (only when time curve is set)
-		get_time_mapped_frame(original_frame, new_frame_number);
+		get_time_mapped_frame(original_frame, new_frame_number, audio_only);
+
+		if (audio_only) {
+			// Apply local audio effects to the frame (if any)
+			apply_effects(original_frame, true);
+			return original_frame;
+		}
 
 		// Apply local effects to the frame (if any)
 		apply_effects(original_frame);
@@ -424,8 +434,11 @@ std::shared_ptr<Frame> Clip::GetFrame(std::shared_ptr<openshot::Frame> backgroun
             }
         }
 
-		// Apply keyframe / transforms
-		apply_keyframes(original_frame, background_frame->GetImage());
+		// Apply keyframe / transforms (or let the timeline composite all layers at once)
+		if (options != NULL && options->layer != NULL)
+			*options->layer = get_image_layer(original_frame, background_frame->GetImage()->width(), background_frame->GetImage()->height());
+		else
+			apply_keyframes(original_frame, background_frame->GetImage());
 
 		// Return processed 'frame'
 		return original_frame;
@@ -435,6 +448,144 @@ std::shared_ptr<Frame> Clip::GetFrame(std::shared_ptr<openshot::Frame> backgroun
 		throw ReaderClosed("No Reader has been initialized for this Clip.  Call Reader(*reader) before calling this method.");
 }
 
+// Get an openshot::Frame object (with only its audio) for a specific frame number of this clip.
+std::shared_ptr<Frame> Clip::GetAudioFrame(int64_t frame_number)
+{
+	// Check for open reader (or throw exception)
+	if (!is_open)
+		throw ReaderClosed("The Clip is closed.  Call Open() before calling this method.");
+
+	if (reader)
+	{
+		// Adjust out of bounds frame number
+		frame_number = adjust_frame_number_minimum(frame_number);
+
+		// Is a time map detected
+		int64_t new_frame_number = frame_number;
+		if (time.GetLength() > 1)
+			new_frame_number = adjust_frame_number_minimum(time.GetLong(frame_number));
+
+		// Get the source frame (without decoding its image), and time map its audio
+		std::shared_ptr<Frame> original_frame = GetOrCreateFrame(new_frame_number, true);
+		get_time_mapped_frame(original_frame, new_frame_number, true);
+
+		// Apply local audio effects to the frame (if any)
+		apply_effects(original_frame, true);
+
+		return original_frame;
+	}
+	else
+		// Throw error if reader not initialized
+		throw ReaderClosed("No Reader has been initialized for this Clip.  Call Reader(*reader) before calling this method.");
+}
+
+// Get a range of frames of this clip, and deliver them to a callback (in order)
+void Clip::GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback)
+{
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("Clip::GetFrames", "start", start, "end", end);
+
+	// Apply keyframes and effects to many frames at once (the reader decodes its frames in order)
+	int threads = OPEN_MP_NUM_PROCESSORS;
+	FramePipeline(threads, threads * 2).Run(start, end, [this](int64_t number) { return GetFrame(number); }, callback);
+}
+
+// Determine if this clip's image covers the entire canvas (hiding everything below it) on a frame
+bool Clip::IsOpaque(int64_t frame_number, int width, int height)
+{
+	// Only video (without a waveform or effects, which can add transparency) can be opaque
+	if (!reader || !reader->info.has_video || Waveform() || !effects.empty() || width <= 0 || height <= 0)
+		return false;
+
+	// Find the source reader (inside the FrameMapper, if any), and check its pixel format for an alpha channel
+	ReaderBase* source_reader = reader;
+	if (source_reader->Name() == "FrameMapper" && ((FrameMapper*) source_reader)->Reader())
+		source_reader = ((FrameMapper*) source_reader)->Reader();
+	if (source_reader->Name() != "FFmpegReader" || source_reader->info.has_single_image)
+		return false;
+	const AVPixFmtDescriptor* pixel_format = av_pix_fmt_desc_get((AVPixelFormat) source_reader->info.pixel_format);
+	if (!pixel_format || (pixel_format->flags & (AV_PIX_FMT_FLAG_ALPHA | AV_PIX_FMT_FLAG_PAL)))
+		return false;
+
+	// Keyframes are evaluated on the time mapped frame number (like GetFrame)
+	frame_number = adjust_frame_number_minimum(frame_number);
+	if (time.GetLength() > 1)
+		frame_number = adjust_frame_number_minimum(time.GetLong(frame_number));
+	if (alpha.GetValue(frame_number) < 1.0 || has_video.GetInt(frame_number) == 0)
+		return false;
+
+	// The size of decoded images can be rounded (when scaled for the preview), so only scale modes
+	// which fill the canvas regardless of a rounded aspect ratio are checked (or SCALE_FIT with the
+	// exact aspect ratio of the canvas)
+	QSize source_image_size(reader->info.width, reader->info.height);
+	bool square_pixels = reader->info.pixel_ratio.num == reader->info.pixel_ratio.den;
+	bool same_aspect_ratio = int64_t(source_image_size.width()) * height == int64_t(source_image_size.height()) * width;
+	ScaleType scale_type = parentTrackedObject ? SCALE_STRETCH : scale;
+	if (source_image_size.isEmpty() || scale_type == SCALE_NONE || (scale_type == SCALE_FIT && !(square_pixels && same_aspect_ratio)))
+		return false;
+
+	// Map the source image onto the canvas
+	QTransform transform = get_transform(source_image_size, frame_number, width, height);
+	QRectF source_rect(QPointF(0.0, 0.0), QSizeF(source_image_size));
+	const double tolerance = 0.001;
+
+	if (transform.type() <= QTransform::TxScale) {
+		// A moved (and scaled) image must reach every edge of the canvas
+		QRectF image_rect = transform.mapRect(source_rect);
+		return image_rect.left() <= tolerance && image_rect.top() <= tolerance &&
+			image_rect.right() >= width - tolerance && image_rect.bottom() >= height - tolerance;
+	}
+
+	// A rotated (or sheared) image must contain every corner of the canvas
+	QPolygonF image_polygon = transform.map(QPolygonF(source_rect));
+	for (const QPointF& corner : {QPointF(0, 0), QPointF(width, 0), QPointF(0, height), QPointF(width, height)})
+		if (!image_polygon.containsPoint(corner, Qt::OddEvenFill))
+			return false;
+	return true;
+}
+
+// Determine if this clip's image (and where it is composited) is identical on 2 frames
+bool Clip::IsStatic(int64_t frame_number, int64_t other_frame_number)
+{
+	// Waveforms change on every frame (with the audio)
+	if (!reader || Waveform())
+		return false;
+
+	// Audio clips have no image at all
+	if (!reader->info.has_video)
+		return true;
+
+	// Effects, frame numbers, and parent objects can change the image on any frame
+	if (!effects.empty() || display != FRAME_DISPLAY_NONE || parentClipObject || parentTrackedObject)
+		return false;
+
+	// Keyframes are evaluated on the time mapped frame number (like GetFrame)
+	frame_number = adjust_frame_number_minimum(frame_number);
+	other_frame_number = adjust_frame_number_minimum(other_frame_number);
+	if (time.GetLength() > 1) {
+		frame_number = adjust_frame_number_minimum(time.GetLong(frame_number));
+		other_frame_number = adjust_frame_number_minimum(time.GetLong(other_frame_number));
+	}
+
+	// A time curve which holds a frame shows the same source frame (with the same keyframe values)
+	if (frame_number == other_frame_number)
+		return true;
+
+	// Otherwise, only a still image (inside the FrameMapper, if any) is the same on both frames
+	ReaderBase* source_reader = reader;
+	if (source_reader->Name() == "FrameMapper" && ((FrameMapper*) source_reader)->Reader())
+		source_reader = ((FrameMapper*) source_reader)->Reader();
+	if (!source_reader->info.has_single_image)
+		return false;
+
+	// Every keyframe which changes the image (or its transform) must have the same value
+	for (const Keyframe* keyframe : {&alpha, &scale_x, &scale_y, &location_x, &location_y, &rotation,
+									 &shear_x, &shear_y, &origin_x, &origin_y, &has_video})
+		if (keyframe->GetValue(frame_number) != keyframe->GetValue(other_frame_number))
+			return false;
+	return true;
+}
+
 // Look up an effect by ID
 openshot::EffectBase* Clip::GetEffect(const std::string& id)
 {
@@ -483,7 +634,7 @@ void Clip::reverse_buffer(juce::AudioBuffer<float>* buffer)
 }
 
 // Adjust the audio and image of a time mapped frame
-void Clip::get_time_mapped_frame(std::shared_ptr<Frame> frame, int64_t frame_number)
+void Clip::get_time_mapped_frame(std::shared_ptr<Frame> frame, int64_t frame_number, bool audio_only)
 {
 	// Check for valid reader
 	if (!reader)
@@ -508,7 +659,7 @@ void Clip::get_time_mapped_frame(std::shared_ptr<Frame> frame, int64_t frame_num
 
 		// Init audio vars
 		int channels = reader->info.channels;
-		int number_of_samples = GetOrCreateFrame(new_frame_number)->GetAudioSamplesCount();
+		int number_of_samples = GetOrCreateFrame(new_frame_number, audio_only)->GetAudioSamplesCount();
 
 		// Only resample audio if needed
 		if (reader->info.has_audio) {
@@ -525,7 +676,7 @@ void Clip::get_time_mapped_frame(std::shared_ptr<Frame> frame, int64_t frame_num
 				// Loop through channels, and get audio samples
 				for (int channel = 0; channel < channels; channel++)
 					// Get the audio samples for this channel
-					samples->addFrom(channel, 0, GetOrCreateFrame(new_frame_number)->GetAudioSamples(channel),
+					samples->addFrom(channel, 0, GetOrCreateFrame(new_frame_number, audio_only)->GetAudioSamples(channel),
 									 number_of_samples, 1.0f);
 
 				// Reverse the samples (if needed)
@@ -570,13 +721,13 @@ void Clip::get_time_mapped_frame(std::shared_ptr<Frame> frame, int64_t frame_num
 					for (int delta_frame = new_frame_number - (delta - 1);
 						 delta_frame <= new_frame_number; delta_frame++) {
 						// buffer to hold detal samples
-						int number_of_delta_samples = GetOrCreateFrame(delta_frame)->GetAudioSamplesCount();
+						int number_of_delta_samples = GetOrCreateFrame(delta_frame, audio_only)->GetAudioSamplesCount();
 						auto *delta_samples = new juce::AudioBuffer<float>(channels,
 						                                                   number_of_delta_samples);
 						delta_samples->clear();
 
 						for (int channel = 0; channel < channels; channel++)
-							delta_samples->addFrom(channel, 0, GetOrCreateFrame(delta_frame)->GetAudioSamples(channel),
+							delta_samples->addFrom(channel, 0, GetOrCreateFrame(delta_frame, audio_only)->GetAudioSamples(channel),
 												   number_of_delta_samples, 1.0f);
 
 						// Reverse the samples (if needed)
@@ -614,13 +765,13 @@ void Clip::get_time_mapped_frame(std::shared_ptr<Frame> frame, int64_t frame_num
 					for (int delta_frame = new_frame_number - (delta + 1);
 						 delta_frame >= new_frame_number; delta_frame--) {
 						// buffer to hold delta samples
-						int number_of_delta_samples = GetOrCreateFrame(delta_frame)->GetAudioSamplesCount();
+						int number_of_delta_samples = GetOrCreateFrame(delta_frame, audio_only)->GetAudioSamplesCount();
 						auto *delta_samples = new juce::AudioBuffer<float>(channels,
 						                                                   number_of_delta_samples);
 						delta_samples->clear();
 
 						for (int channel = 0; channel < channels; channel++)
-							delta_samples->addFrom(channel, 0, GetOrCreateFrame(delta_frame)->GetAudioSamples(channel),
+							delta_samples->addFrom(channel, 0, GetOrCreateFrame(delta_frame, audio_only)->GetAudioSamples(channel),
 												   number_of_delta_samples, 1.0f);
 
 						// Reverse the samples (if needed)
@@ -695,14 +846,14 @@ int64_t Clip::adjust_frame_number_minimum(int64_t frame_number)
 }
 
 // Get or generate a blank frame
-std::shared_ptr<Frame> Clip::GetOrCreateFrame(int64_t number)
+std::shared_ptr<Frame> Clip::GetOrCreateFrame(int64_t number, bool audio_only)
 {
 	try {
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod("Clip::GetOrCreateFrame (from reader)", "number", number);
+		ZmqLogger::Instance()->AppendDebugMethod("Clip::GetOrCreateFrame (from reader)", "number", number, "audio_only", audio_only);
 
 		// Attempt to get a frame (but this could fail if a reader has just been closed)
-		auto reader_frame = reader->GetFrame(number);
+		auto reader_frame = audio_only ? reader->GetAudioFrame(number) : reader->GetFrame(number);
 
 		// Return real frame
 		if (reader_frame) {
@@ -710,7 +861,7 @@ std::shared_ptr<Frame> Clip::GetOrCreateFrame(int64_t number)
 			// This allows a clip to modify the pixels and audio of this frame without
 			// changing the underlying reader's frame data
 			auto reader_copy = std::make_shared<Frame>(*reader_frame.get());
-                        if (has_video.GetInt(number) == 0)
+                        if (!audio_only && has_video.GetInt(number) == 0)
                             reader_copy->AddColor(QColor(Qt::transparent));
                         if (has_audio.GetInt(number) == 0)
                             reader_copy->AddAudioSilence(reader_copy->GetAudioSamplesCount());
@@ -1210,11 +1361,15 @@ void Clip::RemoveEffect(EffectBase* effect)
 }
 
 // Apply effects to the source frame (if any)
-void Clip::apply_effects(std::shared_ptr<Frame> frame)
+void Clip::apply_effects(std::shared_ptr<Frame> frame, bool audio_only)
 {
 	// Find Effects at this position and layer
 	for (auto effect : effects)
 	{
+		// Skip effects which do not change the audio (if only the audio is needed)
+		if (audio_only && !effect->info.has_audio)
+			continue;
+
 		// Apply the effect to this frame
 		frame = effect->GetFrame(frame, frame->number);
 
@@ -1229,20 +1384,36 @@ bool Clip::isEqual(double a, double b)
 
 // Apply keyframes to the source frame (if any)
 void Clip::apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<QImage> background_canvas) {
-    // Skip out if video was disabled or only an audio frame (no visualisation in use)
-    if (!Waveform() && !Reader()->info.has_video) {
+    // Get the clip's image (and its transform)
+    ImageLayer layer = get_image_layer(frame, background_canvas->width(), background_canvas->height());
+    if (!layer.image) {
         // Skip the rest of the image processing for performance reasons
         return;
     }
 
-    // Get image from clip
-    std::shared_ptr<QImage> source_image = frame->GetImage();
+    // Composite a new layer onto the image
+    ImageCompositor::CompositeLayers(*background_canvas, {layer});
+
+    // Debug output
+    ZmqLogger::Instance()->AppendDebugMethod("Clip::ApplyKeyframes (Transform: Composite Image Layer: Completed)", "frame->number", frame->number, "background_canvas->width()", background_canvas->width(), "background_canvas->height()", background_canvas->height());
+
+    // Add new QImage to frame
+    frame->AddImage(background_canvas);
+}
+
+// Get the clip's image, and where to composite it (based on the keyframes)
+ImageLayer Clip::get_image_layer(std::shared_ptr<Frame> frame, int width, int height) {
+    ImageLayer layer;
+
+    // Skip out if video was disabled or only an audio frame (no visualisation in use)
+    if (!Waveform() && !Reader()->info.has_video)
+        return layer;
 
     /* REPLACE IMAGE WITH WAVEFORM IMAGE (IF NEEDED) */
     if (Waveform())
     {
         // Debug output
-        ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Generate Waveform Image)", "frame->number", frame->number, "Waveform()", Waveform(), "background_canvas->width()", background_canvas->width(), "background_canvas->height()", background_canvas->height());
+        ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Generate Waveform Image)", "frame->number", frame->number, "Waveform()", Waveform(), "width", width, "height", height);
 
         // Get the color of the waveform
         int red = wave_color.red.GetInt(frame->number);
@@ -1251,26 +1422,15 @@ void Clip::apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<QImage>
         int alpha = wave_color.alpha.GetInt(frame->number);
 
         // Generate Waveform Dynamically (the size of the timeline)
-        source_image = frame->GetWaveform(background_canvas->width(), background_canvas->height(), red, green, blue, alpha);
-        frame->AddImage(source_image);
+        frame->AddImage(frame->GetWaveform(width, height, red, green, blue, alpha));
     }
 
     // Get transform from clip's keyframes
-    QTransform transform = get_transform(frame, background_canvas->width(), background_canvas->height());
+    layer.transform = get_transform(frame, width, height);
+    layer.image = frame->GetImage();
 
     // Debug output
-    ZmqLogger::Instance()->AppendDebugMethod("Clip::ApplyKeyframes (Transform: Composite Image Layer: Prepare)", "frame->number", frame->number, "background_canvas->width()", background_canvas->width(), "background_canvas->height()", background_canvas->height());
-
-    // Load timeline's new frame image into a QPainter
-    QPainter painter(background_canvas.get());
-    painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, true);
-
-    // Apply transform (translate, rotate, scale)
-    painter.setTransform(transform);
-
-    // Composite a new layer onto the image
-    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-    painter.drawImage(0, 0, *source_image);
+    ZmqLogger::Instance()->AppendDebugMethod("Clip::ApplyKeyframes (Transform: Composite Image Layer: Prepare)", "frame->number", frame->number, "width", width, "height", height);
 
     if (timeline) {
         Timeline *t = (Timeline *) timeline;
@@ -1297,14 +1457,11 @@ void Clip::apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<QImage>
             }
 
             // Draw frame number on top of image
-            painter.setPen(QColor("#ffffff"));
-            painter.drawText(20, 20, QString(frame_number_str.str().c_str()));
+            layer.text = QString(frame_number_str.str().c_str());
         }
     }
-    painter.end();
 
-    // Add new QImage to frame
-    frame->AddImage(background_canvas);
+    return layer;
 }
 
 // Apply keyframes to the source frame (if any)
@@ -1336,8 +1493,14 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 		ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Set Alpha & Opacity)", "alpha_value", alpha_value, "frame->number", frame->number);
 	}
 
+	return get_transform(source_image->size(), frame->number, width, height);
+}
+
+// Get QTransform from keyframes (without applying the alpha keyframe), for a source image size and frame number
+QTransform Clip::get_transform(QSize source_image_size, int64_t frame_number, int width, int height)
+{
 	/* RESIZE SOURCE IMAGE - based on scale type */
-	QSize source_size = source_image->size();
+	QSize source_size = source_image_size;
 
     // Apply stretch scale to correctly fit the bounding-box
 	if (parentTrackedObject){
@@ -1350,21 +1513,21 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 			source_size.scale(width, height, Qt::KeepAspectRatio);
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Scale: SCALE_FIT)", "frame->number", frame->number, "source_width", source_size.width(), "source_height", source_size.height());
+			ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Scale: SCALE_FIT)", "frame_number", frame_number, "source_width", source_size.width(), "source_height", source_size.height());
 			break;
 		}
 		case (SCALE_STRETCH): {
 			source_size.scale(width, height, Qt::IgnoreAspectRatio);
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Scale: SCALE_STRETCH)", "frame->number", frame->number, "source_width", source_size.width(), "source_height", source_size.height());
+			ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Scale: SCALE_STRETCH)", "frame_number", frame_number, "source_width", source_size.width(), "source_height", source_size.height());
 			break;
 		}
 		case (SCALE_CROP): {
 			source_size.scale(width, height, Qt::KeepAspectRatioByExpanding);
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Scale: SCALE_CROP)", "frame->number", frame->number, "source_width", source_size.width(), "source_height", source_size.height());
+			ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Scale: SCALE_CROP)", "frame_number", frame_number, "source_width", source_size.width(), "source_height", source_size.height());
 			break;
 		}
 		case (SCALE_NONE): {
@@ -1372,7 +1535,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 		    // to the preview window size (i.e. timeline / preview ratio). No further
 		    // scaling is needed here.
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Scale: SCALE_NONE)", "frame->number", frame->number, "source_width", source_size.width(), "source_height", source_size.height());
+			ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Scale: SCALE_NONE)", "frame_number", frame_number, "source_width", source_size.width(), "source_height", source_size.height());
 			break;
 		}
 	}
@@ -1392,7 +1555,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 		// Convert Clip's frame position to Timeline's frame position
 		long clip_start_position = round(Position() * info.fps.ToDouble()) + 1;
 		long clip_start_frame = (Start() * info.fps.ToDouble()) + 1;
-		double timeline_frame_number = frame->number + clip_start_position - clip_start_frame;
+		double timeline_frame_number = frame_number + clip_start_position - clip_start_frame;
 
 		// Get parent object's properties (Clip)
 		parentObject_location_x = parentClipObject->location_x.GetValue(timeline_frame_number);
@@ -1410,7 +1573,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 		// Convert Clip's frame position to Timeline's frame position
 		long clip_start_position = round(Position() * info.fps.ToDouble()) + 1;
 		long clip_start_frame = (Start() * info.fps.ToDouble()) + 1;
-		double timeline_frame_number = frame->number + clip_start_position - clip_start_frame;
+		double timeline_frame_number = frame_number + clip_start_position - clip_start_frame;
 
 		// Get parentTrackedObject's parent clip's properties
 		std::map<std::string, float> trackedObjectParentClipProperties = parentTrackedObject->GetParentClipProperties(timeline_frame_number);
@@ -1450,8 +1613,8 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 	float y = 0.0; // top
 
 	// Adjust size for scale x and scale y
-	float sx = scale_x.GetValue(frame->number); // percentage X scale
-	float sy = scale_y.GetValue(frame->number); // percentage Y scale
+	float sx = scale_x.GetValue(frame_number); // percentage X scale
+	float sy = scale_y.GetValue(frame_number); // percentage Y scale
 
 	// Change clip's scale to parentObject's scale
 	if(parentObject_scale_x != 0.0 && parentObject_scale_y != 0.0){
@@ -1498,21 +1661,21 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 	}
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Gravity)", "frame->number", frame->number, "source_clip->gravity", gravity, "scaled_source_width", scaled_source_width, "scaled_source_height", scaled_source_height);
+	ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Gravity)", "frame_number", frame_number, "source_clip->gravity", gravity, "scaled_source_width", scaled_source_width, "scaled_source_height", scaled_source_height);
 
 	QTransform transform;
 
 	/* LOCATION, ROTATION, AND SCALE */
-	float r = rotation.GetValue(frame->number) + parentObject_rotation; // rotate in degrees
-	x += (width * (location_x.GetValue(frame->number) + parentObject_location_x )); // move in percentage of final width
-	y += (height * (location_y.GetValue(frame->number) + parentObject_location_y )); // move in percentage of final height
-	float shear_x_value = shear_x.GetValue(frame->number) + parentObject_shear_x;
-	float shear_y_value = shear_y.GetValue(frame->number) + parentObject_shear_y;
-	float origin_x_value = origin_x.GetValue(frame->number);
-	float origin_y_value = origin_y.GetValue(frame->number);
+	float r = rotation.GetValue(frame_number) + parentObject_rotation; // rotate in degrees
+	x += (width * (location_x.GetValue(frame_number) + parentObject_location_x )); // move in percentage of final width
+	y += (height * (location_y.GetValue(frame_number) + parentObject_location_y )); // move in percentage of final height
+	float shear_x_value = shear_x.GetValue(frame_number) + parentObject_shear_x;
+	float shear_y_value = shear_y.GetValue(frame_number) + parentObject_shear_y;
+	float origin_x_value = origin_x.GetValue(frame_number);
+	float origin_y_value = origin_y.GetValue(frame_number);
 
 	// Transform source image (if needed)
-	ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Build QTransform - if needed)", "frame->number", frame->number, "x", x, "y", y, "r", r, "sx", sx, "sy", sy);
+	ZmqLogger::Instance()->AppendDebugMethod("Clip::get_transform (Build QTransform - if needed)", "frame_number", frame_number, "x", x, "y", y, "r", r, "sx", sx, "sy", sy);
 
 	if (!isEqual(x, 0) || !isEqual(y, 0)) {
 		// TRANSLATE/MOVE CLIP
@@ -1528,8 +1691,8 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 		transform.translate(-origin_x_offset,-origin_y_offset);
 	}
 	// SCALE CLIP (if needed)
-	float source_width_scale = (float(source_size.width()) / float(source_image->width())) * sx;
-	float source_height_scale = (float(source_size.height()) / float(source_image->height())) * sy;
+	float source_width_scale = (float(source_size.width()) / float(source_image_size.width())) * sx;
+	float source_height_scale = (float(source_size.height()) / float(source_image_size.height())) * sy;
 	if (!isEqual(source_width_scale, 1.0) || !isEqual(source_height_scale, 1.0)) {
 		transform.scale(source_width_scale, source_height_scale);
 	}
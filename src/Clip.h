@@ -33,6 +33,7 @@
 #include "Enums.h"
 #include "EffectBase.h"
 #include "EffectInfo.h"
+#include "ImageCompositor.h"
 #include "KeyFrame.h"
 #include "TrackedObjectBase.h"
 
@@ -123,23 +124,29 @@ namespace openshot {
 		/// Adjust frame number minimum value
 		int64_t adjust_frame_number_minimum(int64_t frame_number);
 
-		/// Apply effects to the source frame (if any)
-		void apply_effects(std::shared_ptr<openshot::Frame> frame);
+		/// Apply effects to the source frame (if any), or only the audio effects (if only the audio is needed)
+		void apply_effects(std::shared_ptr<openshot::Frame> frame, bool audio_only=false);
 
         /// Apply keyframes to an openshot::Frame and use an existing QImage as a background image (if any)
         void apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<QImage> background_canvas);
 
+        /// Get the clip's image, and where to composite it on a canvas (based on the keyframes)
+        openshot::ImageLayer get_image_layer(std::shared_ptr<openshot::Frame> frame, int width, int height);
+
         /// Get QTransform from keyframes
         QTransform get_transform(std::shared_ptr<Frame> frame, int width, int height);
 
+        /// Get QTransform from keyframes (without applying the alpha keyframe), for a source image size and frame number
+        QTransform get_transform(QSize source_image_size, int64_t frame_number, int width, int height);
+
 		/// Get file extension
 		std::string get_file_extension(std::string path);
 
-		/// Get a frame object or create a blank one
-		std::shared_ptr<openshot::Frame> GetOrCreateFrame(int64_t number);
+		/// Get a frame object or create a blank one (without its image, if only the audio is needed)
+		std::shared_ptr<openshot::Frame> GetOrCreateFrame(int64_t number, bool audio_only=false);
 
 		/// Adjust the audio and image of a time mapped frame
-		void get_time_mapped_frame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number);
+		void get_time_mapped_frame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number, bool audio_only=false);
 
 		/// Compare 2 floating point numbers
 		bool isEqual(double a, double b);
@@ -250,6 +257,50 @@ namespace openshot {
         /// such as, if it's a top clip. This info is used to apply global transitions and masks, if needed.
         std::shared_ptr<openshot::Frame> GetFrame(std::shared_ptr<openshot::Frame> background_frame, int64_t frame_number, openshot::TimelineInfoStruct* options);
 
+        /// @brief Get an openshot::Frame object for a specific frame number of this clip, with only its audio
+        ///
+        /// The source reader skips decoding the image (when it can), and only the audio of the frame is
+        /// time mapped. Effects which do not change the audio are skipped, and no keyframes are applied.
+        ///
+        /// @returns A new openshot::Frame object (with its audio, but maybe without an image)
+        /// @param frame_number The frame number (starting at 1) of the clip
+        std::shared_ptr<openshot::Frame> GetAudioFrame(int64_t frame_number);
+
+        /// @brief Get a range of frames of this clip, and deliver them to a callback (in order)
+        ///
+        /// Worker threads apply the keyframes and effects of the clip to the frames of the range concurrently
+        /// (ahead of the frame being delivered), and the frames are delivered in order on the calling thread.
+        ///
+        /// @param start The first frame number (starting at 1) of the range
+        /// @param end The last frame number of the range
+        /// @param callback The function which receives each frame (return false to stop early)
+        void GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback);
+
+        /// @brief Determine if this clip's image covers the entire canvas (hiding everything below it) on a frame
+        ///
+        /// The clip's transform (scale, gravity, location, rotation, shear, and parent objects), alpha keyframe,
+        /// and source pixel format are checked, without decoding the frame. The answer is conservative: clips
+        /// which might be partially transparent (such as clips with effects, waveforms, or a source which has
+        /// an alpha channel) or which might not reach every edge of the canvas are not opaque.
+        ///
+        /// @returns True if the clip hides everything below it
+        /// @param frame_number The frame number (starting at 1) of the clip
+        /// @param width The width of the canvas (i.e. the preview width of the timeline)
+        /// @param height The height of the canvas
+        bool IsOpaque(int64_t frame_number, int width, int height);
+
+        /// @brief Determine if this clip's image (and where it is composited) is identical on 2 frames
+        ///
+        /// Both frames must show the same source image (a still image, such as a title, or a time curve which
+        /// holds the same frame), and every keyframe which changes the image or its transform must have the same
+        /// value. Audio clips have no image, so they are always static. The answer is conservative: clips with
+        /// effects, waveforms, frame numbers, or parent objects are not static.
+        ///
+        /// @returns True if both frames of the clip have the same image
+        /// @param frame_number The frame number (starting at 1) of the clip
+        /// @param other_frame_number The other frame number of the clip
+        bool IsStatic(int64_t frame_number, int64_t other_frame_number);
+
 		/// Open the internal reader
 		void Open() override;
 
@@ -262,7 +313,7 @@ namespace openshot {
 
 		// Override End() method
 		float End() const; ///< Get end position (in seconds) of clip (trim end of video), which can be affected by the time curve.
-		void End(float value) { end = value; } ///< Set end position (in seconds) of clip (trim end of video)
+		void End(float value) { end = value; placement_changed(); } ///< Set end position (in seconds) of clip (trim end of video)
 
 		// Get and Set JSON methods
 		std::string Json() const override; ///< Generate JSON string of this object
@@ -46,6 +46,9 @@ namespace openshot {
 		/// Generate JSON choice for a property (dropdown properties)
 		Json::Value add_property_choice_json(std::string name, int value, int selected_value) const;
 
+		/// Mark the position, layer, or length of this clip as changed (so the parent timeline updates its index of clips)
+		void placement_changed() { if (timeline) timeline->PlacementChanged(); }
+
 	public:
 		CacheMemory cache;
 
@@ -94,10 +97,10 @@ namespace openshot {
 
 		// Set basic properties
 		void Id(std::string value) { id = value; } ///> Set the Id of this clip object
-		void Position(float value) { position = value; } ///< Set position on timeline (in seconds)
-		void Layer(int value) { layer = value; } ///< Set layer of clip on timeline (lower number is covered by higher numbers)
-		void Start(float value) { start = value; } ///< Set start position (in seconds) of clip (trim start of video)
-		void End(float value) { end = value; } ///< Set end position (in seconds) of clip (trim end of video)
+		void Position(float value) { position = value; placement_changed(); } ///< Set position on timeline (in seconds)
+		void Layer(int value) { layer = value; placement_changed(); } ///< Set layer of clip on timeline (lower number is covered by higher numbers)
+		void Start(float value) { start = value; placement_changed(); } ///< Set start position (in seconds) of clip (trim start of video)
+		void End(float value) { end = value; placement_changed(); } ///< Set end position (in seconds) of clip (trim end of video)
 		void ParentTimeline(openshot::TimelineBase* new_timeline) { timeline = new_timeline; } ///< Set associated Timeline pointer
 
 		// Get and Set JSON methods
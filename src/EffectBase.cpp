@@ -211,3 +211,18 @@ std::string EffectBase::ParentClipId() const{
 	else
 		return "";
 }
+
+// Get the scale of the parent timeline's proxy preview
+double EffectBase::ResolutionScale() {
+	// Only a proxy preview scales pixel measurements (not the size of a clip, relative to the timeline)
+	Timeline* parent_timeline = NULL;
+	Clip* parent_clip = (Clip *) ParentClip();
+	if (parent_clip && parent_clip->ParentTimeline())
+		parent_timeline = (Timeline *) parent_clip->ParentTimeline();
+	else if (ParentTimeline())
+		parent_timeline = (Timeline *) ParentTimeline();
+
+	if (!parent_timeline)
+		return 1.0;
+	return parent_timeline->ProxyScale();
+}
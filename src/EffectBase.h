@@ -90,6 +90,11 @@ namespace openshot
 		/// Return the ID of this effect's parent clip
 		std::string ParentClipId() const;
 
+		/// @brief Get the scale of the parent timeline's proxy preview (i.e. 0.5 for a half size proxy, and exactly
+		/// 1.0 when proxy mode is off). Effects multiply parameters measured in pixels (such as a blur radius) by this
+		/// scale, so they look the same in a proxy preview.
+		double ResolutionScale();
+
 		/// Get the indexes and IDs of all visible objects in the given frame
 		virtual std::string GetVisibleObjects(int64_t frame_number) const {return {}; };
 
@@ -112,7 +117,7 @@ namespace openshot
 		int Order() const { return order; }
 
 		/// Set the order that this effect should be executed.
-		void Order(int new_order) { order = new_order; }
+		void Order(int new_order) { order = new_order; placement_changed(); }
 
 		virtual ~EffectBase() = default;
 	};
@@ -15,11 +15,17 @@
 
 #include <thread>    // for std::this_thread::sleep_for
 #include <chrono>    // for std::chrono::milliseconds
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <map>
+#include <tuple>
 #include <unistd.h>
 
 #include "FFmpegUtilities.h"
 
 #include "FFmpegReader.h"
+#include "BufferPool.h"
 #include "Exceptions.h"
 #include "Timeline.h"
 #include "ZmqLogger.h"
@@ -62,6 +68,64 @@ typedef struct VAAPIDecodeContext {
 
 using namespace openshot;
 
+namespace {
+	// The scaling contexts of each thread which convert decoded images to RGBA. Frames can be converted on any
+	// thread (after their reader has moved on, or closed), and a thread can convert the frames of several readers
+	// (such as the clips of a timeline), so a context is kept for each source size, pixel format, and scale mode.
+	struct ImageConverters {
+		typedef std::tuple<int, int, int, int, int, int> Key; ///< Source width, height, and format, and target width, height, and scale mode
+		std::map<Key, SwsContext*> contexts;
+		~ImageConverters() { Clear(); }
+
+		// Get the context of a conversion (which is created the first time)
+		SwsContext* Get(const AVFrame *native_image, int width, int height, int scale_mode) {
+			Key key(native_image->width, native_image->height, native_image->format, width, height, scale_mode);
+			auto existing = contexts.find(key);
+			if (existing != contexts.end())
+				return existing->second;
+
+			// Only a few sizes are converted at once (so forget the old contexts, if there are too many)
+			if (contexts.size() >= 8)
+				Clear();
+			SwsContext *context = sws_getContext(native_image->width, native_image->height, (AVPixelFormat) native_image->format,
+												 width, height, PIX_FMT_RGBA, scale_mode, NULL, NULL, NULL);
+			if (context)
+				contexts[key] = context;
+			return context;
+		}
+
+		void Clear() {
+			for (auto& context : contexts)
+				sws_freeContext(context.second);
+			contexts.clear();
+		}
+	};
+	thread_local ImageConverters image_converters;
+
+	// Free a decoded image (copied from the decoder's frame by GetAVFrame)
+	void FreeNativeImage(AVFrame *native_image)
+	{
+		av_freep(&native_image->data[0]);
+#ifndef WIN32
+		AV_FREE_FRAME(&native_image);
+#endif
+	}
+
+	// Convert a decoded image to an RGBA image (and resize it)
+	std::shared_ptr<QImage> ConvertNativeImage(const AVFrame *native_image, int width, int height, QImage::Format image_format, int scale_mode)
+	{
+		// Allocate the image (from the buffer pool, since every frame needs one)
+		std::shared_ptr<QImage> image = BufferPool::Instance()->CreateImage(width, height, image_format);
+		uint8_t *image_data[4] = {image->bits(), NULL, NULL, NULL};
+		int image_linesize[4] = {static_cast<int>(image->bytesPerLine()), 0, 0, 0};
+
+		SwsContext *context = image_converters.Get(native_image, width, height, scale_mode);
+		if (context)
+			sws_scale(context, native_image->data, native_image->linesize, 0, native_image->height, image_data, image_linesize);
+		return image;
+	}
+}
+
 int hw_de_on = 0;
 #if USE_HW_ACCEL
 	AVPixelFormat hw_de_av_pix_fmt_global = AV_PIX_FMT_NONE;
@@ -71,10 +135,12 @@ int hw_de_on = 0;
 FFmpegReader::FFmpegReader(const std::string& path, bool inspect_reader)
 		: last_frame(0), is_seeking(0), seeking_pts(0), seeking_frame(0), seek_count(0),
 		  audio_pts_offset(99999), video_pts_offset(99999), path(path), is_video_seek(true), check_interlace(false),
-		  check_fps(false), enable_seek(true), is_open(false), seek_audio_frame_found(0), seek_video_frame_found(0),
+		  check_fps(false), enable_seek(true), segment_readers(0), is_open(false), seek_audio_frame_found(0), seek_video_frame_found(0),
 		  prev_samples(0), prev_pts(0), pts_total(0), pts_counter(0), is_duration_known(false), largest_frame_processed(0),
 		  current_video_frame(0), has_missing_frames(false), num_packets_since_video_frame(0), num_checks_since_final(0),
-		  packet(NULL), max_concurrent_frames(OPEN_MP_NUM_PROCESSORS) {
+		  packet(NULL), max_concurrent_frames(OPEN_MP_NUM_PROCESSORS), audio_only(false), skipped_video(false),
+		  seek_keyframe(std::numeric_limits<int64_t>::max()), seek_index_started(false), stop_seek_index(false), read_ahead_max_bytes(0), read_ahead_frame_bytes(0),
+		  read_ahead_position(0), read_ahead_thread_id(std::thread::id()), stop_read_ahead(false) {
 
 	// Initialize FFMpeg, and register all formats and codecs
 	AV_REGISTER_ALL
@@ -84,6 +150,7 @@ FFmpegReader::FFmpegReader(const std::string& path, bool inspect_reader)
 	working_cache.SetMaxBytesFromInfo(max_concurrent_frames * info.fps.ToDouble() * 2, info.width, info.height, info.sample_rate, info.channels);
 	missing_frames.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
 	final_cache.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
+	audio_cache.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
 
 	// Open and Close the reader, to populate its attributes (such as height, width, etc...)
 	if (inspect_reader) {
@@ -96,6 +163,10 @@ FFmpegReader::~FFmpegReader() {
 	if (is_open)
 		// Auto close reader if not already done
 		Close();
+
+	// Stop decoding ahead, and indexing the file (if still running)
+	StopReadAhead();
+	StopSeekIndex();
 }
 
 // This struct holds the associated video frame and starting sample # for an audio packet.
@@ -539,13 +610,34 @@ void FFmpegReader::Open() {
 		working_cache.SetMaxBytesFromInfo(max_concurrent_frames * info.fps.ToDouble() * 2, info.width, info.height, info.sample_rate, info.channels);
 		missing_frames.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
 		final_cache.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
+		audio_cache.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
+
+		// Make room for the frames decoded ahead (if any)
+		if (read_ahead_max_bytes > 0)
+			final_cache.SetMaxBytes(final_cache.GetMaxBytes() + read_ahead_max_bytes);
 
 		// Mark as "open"
 		is_open = true;
+
+		// Load the saved keyframes of the video stream (if any). Otherwise the file is indexed after the first seek.
+		LoadSeekIndex();
 	}
 }
 
 void FFmpegReader::Close() {
+	// Stop decoding ahead (unless the read-ahead thread is closing the reader, such as during a seek)
+	if (std::this_thread::get_id() != read_ahead_thread_id)
+		StopReadAhead();
+
+	// Stop indexing the file (an incomplete index is started over, after the next seek)
+	StopSeekIndex();
+
+	// Close the other readers of this file (used by GetFrames)
+	{
+		const std::lock_guard<std::mutex> lock(segment_readers_mutex);
+		open_segment_readers.clear();
+	}
+
 	// Close all objects, if reader is 'open'
 	if (is_open) {
 		// Mark as "closed"
@@ -579,8 +671,10 @@ void FFmpegReader::Close() {
 
 		// Clear final cache
 		final_cache.Clear();
+		audio_cache.Clear();
 		working_cache.Clear();
 		missing_frames.Clear();
+		skipped_video = false;
 
 		// Clear processed lists
 		{
@@ -620,6 +714,247 @@ bool FFmpegReader::HasAlbumArt() {
 		&& (pFormatCtx->streams[videoStream]->disposition & AV_DISPOSITION_ATTACHED_PIC);
 }
 
+// Load the seek index saved by another reader of this file (if any)
+bool FFmpegReader::LoadSeekIndex() {
+	// Only video streams are indexed
+	if (GetSeekIndex())
+		return true;
+	if (!info.has_video || info.has_single_image || HasAlbumArt())
+		return false;
+
+	// Load the index saved by another reader (if the file has not changed since)
+	auto saved_index = std::make_shared<SeekIndex>();
+	if (!saved_index->Load(SeekIndex::IndexPath(path), path))
+		return false;
+
+	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::LoadSeekIndex", "keyframes", saved_index->Count());
+
+	const std::lock_guard<std::mutex> lock(seek_index_mutex);
+	seek_index = saved_index;
+	return true;
+}
+
+// Load the saved seek index of this file, or start the indexing thread (if the file is not indexed yet)
+void FFmpegReader::StartSeekIndex() {
+	const std::lock_guard<std::mutex> thread_lock(seek_index_thread_mutex);
+
+	// Each file is only indexed once (unless the indexing is stopped early)
+	if (seek_index_started)
+		return;
+	seek_index_started = true;
+	if (LoadSeekIndex() || !info.has_video || info.has_single_image || HasAlbumArt())
+		return;
+
+	// Read the packets of the file on another thread
+	stop_seek_index = false;
+	seek_index_thread = std::thread(&FFmpegReader::IndexKeyframes, this, path);
+}
+
+// Stop the indexing thread (if any), and wait for it to finish
+void FFmpegReader::StopSeekIndex() {
+	// Tell the thread to stop first (so a thread waiting for the index is not blocked until the file is indexed)
+	stop_seek_index = true;
+
+	const std::lock_guard<std::mutex> thread_lock(seek_index_thread_mutex);
+	if (seek_index_thread.joinable())
+		seek_index_thread.join();
+	seek_index_started = false;
+}
+
+// Wait for the background indexing of the video stream to finish (if it is running)
+void FFmpegReader::WaitForSeekIndex() {
+	const std::lock_guard<std::mutex> thread_lock(seek_index_thread_mutex);
+	if (seek_index_thread.joinable())
+		seek_index_thread.join();
+}
+
+// Decode frames ahead of the last requested frame, on a background thread
+void FFmpegReader::SetReadAhead(int64_t max_bytes) {
+	if (max_bytes <= 0) {
+		StopReadAhead();
+		max_bytes = 0;
+	}
+
+	// Resize the final cache (if the reader is open), to make room for the frames decoded ahead
+	read_ahead_max_bytes = max_bytes;
+	if (is_open) {
+		const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+		final_cache.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
+		final_cache.SetMaxBytes(final_cache.GetMaxBytes() + read_ahead_max_bytes);
+	}
+	WakeReadAhead();
+}
+
+// Tell the read-ahead thread which frame was requested (and start the thread, if needed)
+void FFmpegReader::RequestReadAhead(int64_t requested_frame) {
+	if (read_ahead_max_bytes <= 0 || !is_open || std::this_thread::get_id() == read_ahead_thread_id)
+		return;
+
+	{
+		const std::lock_guard<std::mutex> lock(read_ahead_mutex);
+		read_ahead_position = requested_frame;
+		if (!read_ahead_thread.joinable()) {
+			stop_read_ahead = false;
+			read_ahead_thread = std::thread(&FFmpegReader::ReadAheadFrames, this);
+			read_ahead_thread_id = read_ahead_thread.get_id();
+		}
+	}
+	read_ahead_condition.notify_one();
+}
+
+// Stop the read-ahead thread (if any), and wait for it to finish
+void FFmpegReader::StopReadAhead() {
+	{
+		const std::lock_guard<std::mutex> lock(read_ahead_mutex);
+		if (!read_ahead_thread.joinable())
+			return;
+		stop_read_ahead = true;
+	}
+	read_ahead_condition.notify_one();
+	read_ahead_thread.join();
+	read_ahead_thread_id = std::thread::id();
+	stop_read_ahead = false;
+}
+
+// Wake the read-ahead thread (if it is waiting for getFrameMutex), after getFrameMutex is released
+void FFmpegReader::WakeReadAhead() {
+	// Lock (and release) read_ahead_mutex, so the thread is either waiting (and is notified) or has not checked getFrameMutex yet
+	{
+		const std::lock_guard<std::mutex> lock(read_ahead_mutex);
+	}
+	read_ahead_condition.notify_one();
+}
+
+// Find the next frame for the read-ahead thread to decode (after the last requested frame, within the max bytes)
+int64_t FFmpegReader::NextReadAheadFrame() {
+	int64_t position = 0;
+	{
+		const std::lock_guard<std::mutex> lock(read_ahead_mutex);
+		position = read_ahead_position;
+	}
+
+	// Skip the frames already decoded (which count towards the max bytes, using the size of the last frame decoded ahead)
+	const int64_t frame_bytes = read_ahead_frame_bytes;
+	int64_t bytes = 0;
+	for (int64_t number = position + 1; number <= info.video_length; number++) {
+		if (!final_cache.Contains(number))
+			return number;
+
+		bytes += frame_bytes;
+		if (bytes >= read_ahead_max_bytes)
+			break;
+	}
+	return 0;
+}
+
+// Decode frames ahead of the last requested frame (run by the read-ahead thread)
+void FFmpegReader::ReadAheadFrames() {
+	int64_t waited_position = -1;
+	while (!stop_read_ahead) {
+		// Wait for a frame to be requested (after all the frames ahead of the last request are decoded)
+		{
+			std::unique_lock<std::mutex> lock(read_ahead_mutex);
+			read_ahead_condition.wait(lock, [&] { return stop_read_ahead || read_ahead_position != waited_position; });
+			if (stop_read_ahead)
+				break;
+		}
+
+		int64_t number = NextReadAheadFrame();
+		if (number == 0) {
+			const std::lock_guard<std::mutex> lock(read_ahead_mutex);
+			waited_position = read_ahead_position;
+			continue;
+		}
+
+		// Only a single thread can decode at one time (so wait for GetFrame to release getFrameMutex, but stop waiting if
+		// the reader is closed). getFrameMutex is only tried (never waited for), since Close can hold it while stopping this thread.
+		std::unique_lock<std::recursive_mutex> frame_lock(getFrameMutex, std::defer_lock);
+		{
+			std::unique_lock<std::mutex> lock(read_ahead_mutex);
+			read_ahead_condition.wait(lock, [&] { return stop_read_ahead || frame_lock.try_lock(); });
+		}
+		if (!frame_lock.owns_lock())
+			break;
+
+		// Decode the frame (unless GetFrame already has)
+		std::shared_ptr<Frame> frame;
+		try {
+			if (is_open && !final_cache.Contains(number)) {
+				ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadAheadFrames", "frame", number, "last_frame", last_frame);
+				frame = ReadFrame(number);
+			}
+		} catch (...) {
+			// Stop decoding ahead (until the next request), and let GetFrame report the error
+			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadAheadFrames (Failed)", "frame", number);
+			const std::lock_guard<std::mutex> lock(read_ahead_mutex);
+			waited_position = read_ahead_position;
+		}
+		frame_lock.unlock();
+
+		// Convert the image on this thread (instead of the thread which gets the frame later)
+		if (frame && frame->GetNativeImage())
+			frame->GetImage();
+		if (frame)
+			read_ahead_frame_bytes = frame->GetBytes();
+
+		// Let a waiting GetFrame call decode first
+		std::this_thread::yield();
+	}
+}
+
+// Get the keyframes of the video stream
+std::shared_ptr<const SeekIndex> FFmpegReader::GetSeekIndex() {
+	const std::lock_guard<std::mutex> lock(seek_index_mutex);
+	return seek_index;
+}
+
+// Build the seek index of the video stream, from the keyframe flags of its packets
+void FFmpegReader::IndexKeyframes(std::string media_path) {
+	// Open the file a 2nd time (so reading its packets does not move the position of this reader)
+	AVFormatContext *index_format_ctx = NULL;
+	if (avformat_open_input(&index_format_ctx, media_path.c_str(), NULL, NULL) != 0)
+		return;
+	if (avformat_find_stream_info(index_format_ctx, NULL) < 0) {
+		avformat_close_input(&index_format_ctx);
+		return;
+	}
+
+	// Find the video stream (the same stream used by Open)
+	int index_stream = -1;
+	for (unsigned int i = 0; i < index_format_ctx->nb_streams && index_stream < 0; i++)
+		if (AV_GET_CODEC_TYPE(index_format_ctx->streams[i]) == AVMEDIA_TYPE_VIDEO)
+			index_stream = i;
+
+	// Read every packet (without decoding), and add the keyframes of the video stream. The keyframes use the same
+	// timestamps as GetVideoPTS() (the decoding timestamp, if any).
+	auto index = std::make_shared<SeekIndex>();
+	AVPacket *index_packet = new AVPacket();
+	while (index_stream >= 0 && !stop_seek_index && av_read_frame(index_format_ctx, index_packet) >= 0) {
+		if (index_packet->stream_index == index_stream && (index_packet->flags & AV_PKT_FLAG_KEY)) {
+			int64_t timestamp = index_packet->dts != AV_NOPTS_VALUE ? index_packet->dts : index_packet->pts;
+			if (timestamp != AV_NOPTS_VALUE)
+				index->Add(timestamp);
+		}
+		AV_FREE_PACKET(index_packet);
+	}
+	delete index_packet;
+	bool is_complete = index_stream >= 0 && !stop_seek_index;
+	avformat_close_input(&index_format_ctx);
+
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::IndexKeyframes", "is_complete", is_complete, "keyframes", index->Count());
+
+	// A partial index would skip keyframes (so it is never used)
+	if (!is_complete || index->Count() == 0)
+		return;
+
+	// Save the index (if a folder is set), so this file is not indexed again
+	index->Save(SeekIndex::IndexPath(media_path), media_path);
+
+	const std::lock_guard<std::mutex> lock(seek_index_mutex);
+	seek_index = index;
+}
+
 void FFmpegReader::UpdateAudioInfo() {
 	// Set values of FileInfo struct
 	info.has_audio = true;
@@ -835,50 +1170,343 @@ std::shared_ptr<Frame> FFmpegReader::GetFrame(int64_t requested_frame) {
 	if (frame) {
 		// Debug output
 		ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetFrame", "returned cached frame", requested_frame);
-
-		// Return the cached frame
-		return frame;
 	} else {
+        // Create a scoped lock, allowing only a single thread to decode at one time
+        const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+
         // Check the cache a 2nd time (due to a potential previous lock)
         frame = final_cache.GetFrame(requested_frame);
         if (frame) {
             // Debug output
             ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetFrame", "returned cached frame on 2nd look", requested_frame);
-
-            // Return the cached frame
         } else {
             // Frame is not in cache
-            // Reset seek count
-            seek_count = 0;
-
-            // Check for first frame (always need to get frame 1 before other frames, to correctly calculate offsets)
-            if (last_frame == 0 && requested_frame != 1)
-                // Get first frame
-                ReadStream(1);
-
-            // Are we within X frames of the requested frame?
-            int64_t diff = requested_frame - last_frame;
-            if (diff >= 1 && diff <= 20) {
-                // Continue walking the stream
-                frame = ReadStream(requested_frame);
-            } else {
-                // Greater than 30 frames away, or backwards, we need to seek to the nearest key frame
-                if (enable_seek)
-                    // Only seek if enabled
-                    Seek(requested_frame);
-
-                else if (!enable_seek && diff < 0) {
-                    // Start over, since we can't seek, and the requested frame is smaller than our position
-                    Close();
-                    Open();
-                }
-
-                // Then continue walking the stream
-                frame = ReadStream(requested_frame);
-            }
+            frame = ReadFrame(requested_frame);
         }
+	}
+
+	// Decode the frames after this one in the background (if enabled), now that this frame is ready
+	RequestReadAhead(requested_frame);
+
+	// Return the frame
+	return frame;
+}
+
+// Get a frame's audio, without decoding video packets
+std::shared_ptr<Frame> FFmpegReader::GetAudioFrame(int64_t requested_frame) {
+	// Only files with both streams have video packets to skip
+	if (!is_open || !info.has_video || !info.has_audio || info.has_single_image)
+		return GetFrame(requested_frame);
+
+	// Adjust for a requested frame that is too small or too large
+	if (requested_frame < 1)
+		requested_frame = 1;
+	if (requested_frame > info.video_length && is_duration_known)
+		requested_frame = info.video_length;
+
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAudioFrame", "requested_frame", requested_frame, "last_frame", last_frame);
+
+	// Check the caches for this frame (complete frames have audio too)
+	std::shared_ptr<Frame> frame = final_cache.GetFrame(requested_frame);
+	if (!frame)
+		frame = audio_cache.GetFrame(requested_frame);
+	if (frame)
 		return frame;
+
+	{
+		// Create a scoped lock, allowing only a single thread to decode at one time
+		const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+
+		// Check the caches a 2nd time (due to a potential previous lock)
+		frame = final_cache.GetFrame(requested_frame);
+		if (!frame)
+			frame = audio_cache.GetFrame(requested_frame);
+		if (!frame) {
+			// Read the stream, without decoding video packets
+			audio_only = true;
+			try {
+				frame = ReadFrame(requested_frame);
+			} catch (...) {
+				audio_only = false;
+				WakeReadAhead();
+				throw;
+			}
+			audio_only = false;
+		}
+	}
+
+	// Let the read-ahead thread (if any) decode again
+	WakeReadAhead();
+
+	return frame;
+}
+
+// Seek (if needed) and read the stream until we find the requested Frame
+std::shared_ptr<Frame> FFmpegReader::ReadFrame(int64_t requested_frame) {
+	// Reset seek count
+	seek_count = 0;
+
+	// Check for first frame (always need to get frame 1 before other frames, to correctly calculate offsets)
+	if (last_frame == 0 && requested_frame != 1)
+		// Get first frame
+		ReadStream(1);
+
+	// Video packets were skipped (by GetAudioFrame), so the video decoder needs to seek before decoding again
+	bool is_video_stale = skipped_video && !audio_only;
+
+	// Are we within X frames of the requested frame?
+	int64_t diff = requested_frame - last_frame;
+	if (diff >= 1 && diff <= 20 && !is_video_stale) {
+		// Continue walking the stream
+		return ReadStream(requested_frame);
+	}
+
+	// Would a seek land on the same keyframe as our position (i.e. the requested frame is further into the current
+	// group of pictures)? Then it is faster to keep walking the stream, than to seek back and decode it again.
+	std::shared_ptr<const SeekIndex> index = GetSeekIndex();
+	if (index && enable_seek && diff > 20 && diff < 1024 && !is_video_stale && last_frame > 0) {
+		int buffer_amount = std::max(max_concurrent_frames, 8);
+		int64_t target_keyframe = 0;
+		int64_t current_keyframe = 0;
+		if (index->Find(ConvertFrameToVideoPTS(requested_frame - buffer_amount), target_keyframe) &&
+			index->Find(ConvertFrameToVideoPTS(last_frame), current_keyframe) && target_keyframe == current_keyframe) {
+			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadFrame (Same keyframe, skip seek)", "requested_frame", requested_frame, "last_frame", last_frame, "keyframe", current_keyframe);
+			return ReadStream(requested_frame);
+		}
+	}
+
+	// Greater than 30 frames away, or backwards, we need to seek to the nearest key frame
+	if (enable_seek) {
+		// Index the keyframes of the video stream (in the background), so the next seeks are faster
+		StartSeekIndex();
+
+		// Only seek if enabled
+		Seek(requested_frame);
+	}
+
+	else if (!enable_seek && (diff < 0 || is_video_stale)) {
+		// Start over, since we can't seek, and the requested frame is smaller than our position
+		Close();
+		Open();
+	}
+
+	// Then continue walking the stream
+	return ReadStream(requested_frame);
+}
+
+// Get a range of frames, and deliver them to a callback (in order)
+void FFmpegReader::GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback) {
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetFrames", "start", start, "end", end, "max_concurrent_frames", max_concurrent_frames);
+
+	// Decode segments of a long range in parallel (with other readers of this file)
+	if (segment_readers > 1 && is_open && enable_seek && info.has_video && !info.has_single_image && !HasAlbumArt()) {
+		std::vector<int64_t> segments = GetSegments(start, end);
+		if (segments.size() > 1) {
+			GetSegmentFrames(segments, end, callback);
+			return;
+		}
+	}
+
+	// Decode the range on a single worker thread (frames are read from the stream in order)
+	FramePipeline(1, max_concurrent_frames).Run(start, end, [this](int64_t number) { return GetFrame(number); }, callback);
+}
+
+// Split a range of frames into segments, which start at keyframes (if the video stream is indexed)
+std::vector<int64_t> FFmpegReader::GetSegments(int64_t start, int64_t end) {
+	// Segments start at keyframes (if the file is indexed already). While the file is being indexed, the segments
+	// are not aligned to keyframes, since each reader seeks to the start of its segment anyway.
+	StartSeekIndex();
+	std::shared_ptr<const SeekIndex> index = GetSeekIndex();
+
+	// Each reader seeks before its segment, and decodes the frames before it (up to a group of pictures, plus the
+	// frames a seek goes back). So a segment is several groups of pictures long, but short enough that the
+	// segments kept in memory (1 per reader) stay under 2 GB.
+	const int64_t buffer_amount = std::max(max_concurrent_frames, 8);
+	int64_t group_length = 1;
+	if (index && index->Count() > 0)
+		group_length = std::max<int64_t>(1, info.video_length / index->Count());
+	int64_t frame_bytes = std::max<int64_t>(1, int64_t(info.width) * info.height * 4);
+	int64_t max_length = std::max<int64_t>(2 * buffer_amount, (int64_t(2) << 30) / frame_bytes / segment_readers);
+	int64_t segment_length = std::min(std::max(4 * std::max(group_length, buffer_amount), int64_t(60)), max_length);
+
+	// Convert between frame numbers and the timestamps of the index (the same way the stream is read)
+	double frames_per_timestamp = info.video_timebase.ToDouble() * info.fps.ToDouble();
+	int64_t offset = video_pts_offset == 99999 ? 0 : video_pts_offset;
+
+	std::vector<int64_t> segments = {start};
+	for (int64_t frame = start + segment_length; frame + segment_length / 2 <= end; frame = segments.back() + segment_length) {
+		// Start the next segment at the keyframe before this frame (unless that is too close to the last segment)
+		int64_t segment_start = frame;
+		int64_t keyframe = 0;
+		if (index && index->Find(round((frame - 1) / frames_per_timestamp) - offset, keyframe)) {
+			int64_t keyframe_number = round((keyframe + offset) * frames_per_timestamp) + 1;
+			if (keyframe_number >= segments.back() + segment_length / 2)
+				segment_start = keyframe_number;
+		}
+		segments.push_back(segment_start);
+	}
+
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetSegments", "start", start, "end", end, "segments", segments.size(), "segment_length", segment_length, "group_length", group_length);
+
+	return segments;
+}
+
+// Decode segments of a range of frames in parallel (with other readers of this file), and deliver the frames in order
+void FFmpegReader::GetSegmentFrames(const std::vector<int64_t>& segments, int64_t end, openshot::FrameCallback callback) {
+	// Take the other readers of this file which are still open from an earlier call (so a concurrent call opens its own)
+	std::vector<std::unique_ptr<FFmpegReader>> readers;
+	int reader_count = std::min<int>(segment_readers, segments.size());
+	{
+		const std::lock_guard<std::mutex> lock(segment_readers_mutex);
+		while ((int) readers.size() < reader_count && !open_segment_readers.empty()) {
+			readers.push_back(std::move(open_segment_readers.back()));
+			open_segment_readers.pop_back();
+		}
+	}
+
+	// The seek index and the parent clip (which sets the image size) can change between calls, and the frames decoded
+	// during an earlier call can be stale (since only the caches of this reader are cleared when the clip changes)
+	for (auto& reader : readers) {
+		{
+			const std::lock_guard<std::mutex> lock(reader->seek_index_mutex);
+			reader->seek_index = GetSeekIndex();
+		}
+		reader->ParentClip(ParentClip());
+		reader->final_cache.Clear();
+	}
+
+	// Open the rest (which share the seek index, and decode images at the same size)
+	while ((int) readers.size() < reader_count) {
+		std::unique_ptr<FFmpegReader> reader(new FFmpegReader(path, false));
+		reader->seek_index = GetSeekIndex();
+		reader->seek_index_started = true;
+		reader->ParentClip(ParentClip());
+		reader->Open();
+
+		// Decoded frames are handed to this reader (and its cache), so only the frames being decoded are kept
+		reader->final_cache.SetMaxBytesFromInfo(max_concurrent_frames, info.width, info.height, info.sample_rate, info.channels);
+		readers.push_back(std::move(reader));
+	}
+
+	// Frames decoded (but not delivered yet), and exceptions thrown while decoding frames
+	std::mutex segment_mutex;
+	std::condition_variable segment_condition;
+	std::map<int64_t, std::shared_ptr<Frame>> decoded_frames;
+	std::map<int64_t, std::exception_ptr> decode_errors;
+	size_t next_segment = 0;
+	int64_t next_deliver = segments.front();
+	bool stopped = false;
+
+	// Each reader decodes up to 1 segment ahead of the segment being delivered
+	int64_t max_ahead = 0;
+	for (size_t segment = 0; segment + 1 < segments.size(); segment++)
+		max_ahead = std::max(max_ahead, segments[segment + 1] - segments[segment]);
+	max_ahead *= reader_count;
+
+	// Each worker thread takes the next segment, and decodes its frames (in order) with its own reader
+	auto worker = [&](FFmpegReader* reader) {
+		while (true) {
+			size_t segment = 0;
+			{
+				const std::lock_guard<std::mutex> lock(segment_mutex);
+				if (stopped || next_segment >= segments.size())
+					return;
+				segment = next_segment++;
+			}
+
+			int64_t segment_end = segment + 1 < segments.size() ? segments[segment + 1] - 1 : end;
+			for (int64_t number = segments[segment]; number <= segment_end; number++) {
+				{
+					std::unique_lock<std::mutex> lock(segment_mutex);
+					segment_condition.wait(lock, [&] { return stopped || number < next_deliver + max_ahead; });
+					if (stopped)
+						return;
+				}
+
+				std::shared_ptr<Frame> frame;
+				std::exception_ptr error;
+				try {
+					frame = reader->GetFrame(number);
+
+					// Convert the image on this worker thread (instead of the thread delivering the frames)
+					if (frame->GetNativeImage())
+						frame->GetImage();
+				} catch (...) {
+					error = std::current_exception();
+				}
+
+				{
+					const std::lock_guard<std::mutex> lock(segment_mutex);
+					if (error)
+						decode_errors[number] = error;
+					else
+						decoded_frames[number] = frame;
+				}
+				segment_condition.notify_all();
+				if (error)
+					return;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (auto& reader : readers)
+		workers.emplace_back(worker, reader.get());
+
+	// Deliver each frame (in order) on the calling thread, and add it to the final cache of this reader
+	std::exception_ptr error;
+	for (int64_t number = segments.front(); number <= end; number++) {
+		std::shared_ptr<Frame> frame;
+		{
+			std::unique_lock<std::mutex> lock(segment_mutex);
+			segment_condition.wait(lock, [&] { return decoded_frames.count(number) || decode_errors.count(number); });
+			if (decode_errors.count(number)) {
+				error = decode_errors[number];
+			} else {
+				frame = decoded_frames[number];
+				decoded_frames.erase(number);
+				next_deliver = number + 1;
+			}
+		}
+		segment_condition.notify_all();
+		if (error)
+			break;
+
+		final_cache.Add(frame);
+		bool keep_going = false;
+		try {
+			keep_going = callback(frame);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		if (!keep_going)
+			break;
+	}
+
+	// Stop the worker threads (after their current frame), and wait for them
+	{
+		const std::lock_guard<std::mutex> lock(segment_mutex);
+		stopped = true;
+	}
+	segment_condition.notify_all();
+	for (auto& thread : workers)
+		thread.join();
+
+	// Keep the readers open for the next call (unless this reader was closed)
+	if (is_open) {
+		const std::lock_guard<std::mutex> lock(segment_readers_mutex);
+		for (auto& reader : readers)
+			open_segment_readers.push_back(std::move(reader));
 	}
+
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetSegmentFrames (Completed)", "segments", segments.size(), "readers", reader_count, "end", end);
+
+	if (error)
+		std::rethrow_exception(error);
 }
 
 // Read the stream until we find the requested Frame
@@ -894,8 +1522,11 @@ std::shared_ptr<Frame> FFmpegReader::ReadStream(int64_t requested_frame) {
 	int minimum_packets = 1;
 	int max_packets = 4096;
 
+	// Frames read for GetAudioFrame() have no image (so they are kept out of the final cache)
+	CacheMemory& frames = audio_only ? audio_cache : final_cache;
+
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadStream", "requested_frame", requested_frame, "max_concurrent_frames", max_concurrent_frames);
+	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadStream", "requested_frame", requested_frame, "max_concurrent_frames", max_concurrent_frames, "audio_only", audio_only);
 
 	// Loop through the stream until the correct frame is found
 	while (true) {
@@ -951,16 +1582,28 @@ std::shared_ptr<Frame> FFmpegReader::ReadStream(int64_t requested_frame) {
 				continue;
 			}
 
-			// Get the AVFrame from the current packet
-			frame_finished = GetAVFrame();
-
-			// Check if the AVFrame is finished and set it
-			if (frame_finished) {
-				// Update PTS / Frame Offset (if any)
+			if (audio_only) {
+				// Only audio was requested, so skip decoding (but keep track of the video position for seeks, and
+				// still check the working frames below)
 				UpdatePTSOffset(true);
+				if (is_seeking && !seek_video_frame_found) {
+					double video_seconds = double(GetVideoPTS() + video_pts_offset) * info.video_timebase.ToDouble();
+					seek_video_frame_found = std::max(int64_t(1), int64_t(round(video_seconds * info.fps.ToDouble())) + 1);
+				}
+				skipped_video = true;
 
-				// Process Video Packet
-				ProcessVideoPacket(requested_frame);
+			} else {
+				// Get the AVFrame from the current packet
+				frame_finished = GetAVFrame();
+
+				// Check if the AVFrame is finished and set it
+				if (frame_finished) {
+					// Update PTS / Frame Offset (if any)
+					UpdatePTSOffset(true);
+
+					// Process Video Packet
+					ProcessVideoPacket(requested_frame);
+				}
 			}
 
 		}
@@ -1004,7 +1647,7 @@ std::shared_ptr<Frame> FFmpegReader::ReadStream(int64_t requested_frame) {
 		}
 
 		// Check if requested 'final' frame is available
-		bool is_cache_found = (final_cache.GetFrame(requested_frame) != NULL);
+		bool is_cache_found = (frames.GetFrame(requested_frame) != NULL);
 
 		// Increment frames processed
 		packets_processed++;
@@ -1024,14 +1667,14 @@ std::shared_ptr<Frame> FFmpegReader::ReadStream(int64_t requested_frame) {
 		CheckWorkingFrames(end_of_stream, requested_frame);
 
 	// Return requested frame (if found)
-	std::shared_ptr<Frame> frame = final_cache.GetFrame(requested_frame);
+	std::shared_ptr<Frame> frame = frames.GetFrame(requested_frame);
 	if (frame)
 		// Return prepared frame
 		return frame;
 	else {
 
 		// Check if largest frame is still cached
-		frame = final_cache.GetFrame(largest_frame_processed);
+		frame = frames.GetFrame(largest_frame_processed);
 		if (frame) {
 			// return the largest processed frame (assuming it was the last in the video file)
 			return frame;
@@ -1240,15 +1883,6 @@ void FFmpegReader::ProcessVideoPacket(int64_t requested_frame) {
 	const std::lock_guard<std::recursive_mutex> lock(processingMutex);
 	processing_video_frames[current_frame] = current_frame;
 
-	// Create variables for a RGB Frame (since most videos are not in RGB, we must convert it)
-	AVFrame *pFrameRGB = nullptr;
-	uint8_t *buffer = nullptr;
-
-	// Allocate an AVFrame structure
-	pFrameRGB = AV_ALLOCATE_FRAME();
-	if (pFrameRGB == nullptr)
-		throw OutOfMemory("Failed to allocate frame buffer", path);
-
 	// Determine the max size of this source image (based on the timeline's size, the scaling mode,
 	// and the scaling keyframes). This is a performance improvement, to keep the images as small as possible,
 	// without losing quality. NOTE: We cannot go smaller than the timeline itself, or the add_layer timeline
@@ -1323,36 +1957,30 @@ void FFmpegReader::ProcessVideoPacket(int64_t requested_frame) {
 		}
 	}
 
-	// Determine required buffer size and allocate buffer
-	const int bytes_per_pixel = 4;
-	int buffer_size = width * height * bytes_per_pixel;
-	buffer = new unsigned char[buffer_size]();
-
-	// Copy picture data from one AVFrame (or AVPicture) to another one.
-	AV_COPY_PICTURE_DATA(pFrameRGB, buffer, PIX_FMT_RGBA, width, height);
-
+	// Keep the decoded image (in its native pixel format), and only convert it to RGBA when its pixels are needed.
+	// So a frame which is encoded again in the same pixel format (or which is never displayed) skips the conversion.
+	my_frame->width = info.width;
+	my_frame->height = original_height;
+	my_frame->format = pix_fmt;
+	std::shared_ptr<AVFrame> native_image(my_frame, FreeNativeImage);
+
+	// The image has no alpha channel (speed optimization), or an alpha channel which is converted to
+	// premultiplied when needed (slower).
+	QImage::Format image_format = QImage::Format_RGBA8888_Premultiplied;
+	if (ffmpeg_has_alpha(pix_fmt))
+		image_format = QImage::Format_RGBA8888;
 	int scale_mode = SWS_FAST_BILINEAR;
 	if (openshot::Settings::Instance()->HIGH_QUALITY_SCALING) {
 		scale_mode = SWS_BICUBIC;
 	}
-	SwsContext *img_convert_ctx = sws_getContext(info.width, info.height, AV_GET_CODEC_PIXEL_FORMAT(pStream, pCodecCtx), width,
-												 height, PIX_FMT_RGBA, scale_mode, NULL, NULL, NULL);
-
-	// Resize / Convert to RGB
-	sws_scale(img_convert_ctx, my_frame->data, my_frame->linesize, 0,
-			  original_height, pFrameRGB->data, pFrameRGB->linesize);
 
 	// Create or get the existing frame object
 	std::shared_ptr<Frame> f = CreateFrame(current_frame);
 
-	// Add Image data to frame
-	if (!ffmpeg_has_alpha(AV_GET_CODEC_PIXEL_FORMAT(pStream, pCodecCtx))) {
-		// Add image with no alpha channel, Speed optimization
-		f->AddImage(width, height, bytes_per_pixel, QImage::Format_RGBA8888_Premultiplied, buffer);
-	} else {
-		// Add image with alpha channel (this will be converted to premultipled when needed, but is slower)
-		f->AddImage(width, height, bytes_per_pixel, QImage::Format_RGBA8888, buffer);
-	}
+	// Add the decoded image to the frame (with the conversion to its RGBA size)
+	f->AddNativeImage(width, height, native_image, [native_image, width, height, image_format, scale_mode]() {
+		return ConvertNativeImage(native_image.get(), width, height, image_format, scale_mode);
+	});
 
 	// Update working cache
 	working_cache.Add(f);
@@ -1360,13 +1988,6 @@ void FFmpegReader::ProcessVideoPacket(int64_t requested_frame) {
 	// Keep track of last last_video_frame
 	last_video_frame = f;
 
-	// Free the RGB image
-	AV_FREE_FRAME(&pFrameRGB);
-
-	// Remove frame and packet
-	RemoveAVFrame(my_frame);
-	sws_freeContext(img_convert_ctx);
-
 	// Remove video frame from list of processing video frames
 	{
 		const std::lock_guard<std::recursive_mutex> lock(processingMutex);
@@ -1762,6 +2383,18 @@ void FFmpegReader::Seek(int64_t requested_frame) {
 		// Seek video stream (if any), except album arts
 		if (!seek_worked && info.has_video && !HasAlbumArt()) {
 			seek_target = ConvertFrameToVideoPTS(requested_frame - buffer_amount);
+
+			// Seek straight to the keyframe before the target (if the video stream is indexed), instead of
+			// an estimated timestamp. If the last seek went too far, step back to an earlier keyframe.
+			std::shared_ptr<const SeekIndex> index = GetSeekIndex();
+			if (seek_count == 1)
+				seek_keyframe = std::numeric_limits<int64_t>::max();
+			int64_t keyframe = 0;
+			if (index && index->Find(std::min(seek_target, seek_keyframe - 1), keyframe)) {
+				seek_target = keyframe;
+				seek_keyframe = keyframe;
+			}
+
 			if (av_seek_frame(pFormatCtx, info.video_stream_index, seek_target, AVSEEK_FLAG_BACKWARD) < 0) {
 				fprintf(stderr, "%s: error while seeking video stream\n", pFormatCtx->AV_FILENAME);
 			} else {
@@ -1790,8 +2423,10 @@ void FFmpegReader::Seek(int64_t requested_frame) {
 				avcodec_flush_buffers(aCodecCtx);
 
 			// Flush video buffer
-			if (info.has_video)
+			if (info.has_video) {
 				avcodec_flush_buffers(pCodecCtx);
+				skipped_video = false;
+			}
 
 			// Reset previous audio location to zero
 			previous_packet_location.frame = -1;
@@ -2103,7 +2738,7 @@ bool FFmpegReader::CheckMissingFrame(int64_t requested_frame) {
 	bool found_missing_frame = false;
 
 	// Special MP3 Handling (ignore more than 1 video frame)
-	if (info.has_audio and info.has_video) {
+	if (info.has_audio and info.has_video and !audio_only) {
 		// If MP3 with single video frame, handle this special case by copying the previously
 		// decoded image to the new frame. Otherwise, it will spend a huge amount of
 		// CPU time looking for missing images for all the audio-only frames.
@@ -2116,8 +2751,8 @@ bool FFmpegReader::CheckMissingFrame(int64_t requested_frame) {
 		}
 	}
 
-	// Check if requested video frame is a missing
-	if (missing_video_frames.count(requested_frame)) {
+	// Check if requested video frame is a missing (video packets are not decoded for GetAudioFrame)
+	if (!audio_only && missing_video_frames.count(requested_frame)) {
 		int64_t missing_source_frame = missing_video_frames.find(requested_frame)->second;
 
 		// Increment missing source frame check count (or init to 1)
@@ -2223,8 +2858,8 @@ void FFmpegReader::CheckWorkingFrames(bool end_of_stream, int64_t requested_fram
 			is_audio_ready = false; // don't finalize the last processed audio frame
 		bool is_seek_trash = IsPartialFrame(f->number);
 
-		// Adjust for available streams
-		if (!info.has_video) is_video_ready = true;
+		// Adjust for available streams (and audio only reads)
+		if (!info.has_video || audio_only) is_video_ready = true;
 		if (!info.has_audio) is_audio_ready = true;
 
 		// Make final any frames that get stuck (for whatever reason)
@@ -2264,8 +2899,11 @@ void FFmpegReader::CheckWorkingFrames(bool end_of_stream, int64_t requested_fram
 				// Reset counter since last 'final' frame
 				num_checks_since_final = 0;
 
-				// Move frame to final cache
-				final_cache.Add(f);
+				// Move frame to final cache (or the audio cache, since frames read for GetAudioFrame() have no image)
+				if (audio_only)
+					audio_cache.Add(f);
+				else
+					final_cache.Add(f);
 
 				// Add to missing cache (if another frame depends on it)
 				{
@@ -2487,9 +3125,15 @@ void FFmpegReader::SetJsonValue(const Json::Value root) {
 	ReaderBase::SetJsonValue(root);
 
 	// Set data from Json (if key is found)
-	if (!root["path"].isNull())
+	if (!root["path"].isNull() && root["path"].asString() != path) {
 		path = root["path"].asString();
 
+		// The seek index belongs to the previous file
+		StopSeekIndex();
+		const std::lock_guard<std::mutex> lock(seek_index_mutex);
+		seek_index.reset();
+	}
+
 	// Re-Open path, and re-init everything (if needed)
 	if (is_open) {
 		Close();
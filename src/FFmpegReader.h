@@ -21,14 +21,20 @@
 // Include FFmpeg headers and macros
 #include "FFmpegUtilities.h"
 
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
 #include <ctime>
 #include <iostream>
 #include <stdio.h>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "CacheMemory.h"
 #include "Clip.h"
 #include "OpenMPUtilities.h"
+#include "SeekIndex.h"
 #include "Settings.h"
 
 
@@ -94,6 +100,9 @@ namespace openshot {
 
 		CacheMemory working_cache;
 		CacheMemory missing_frames;
+		CacheMemory audio_cache; ///< Frames read by GetAudioFrame() (without images, so they are never in the final cache)
+		bool audio_only; ///< Is the stream being read for GetAudioFrame() (so video packets are not decoded)
+		bool skipped_video; ///< Have video packets been skipped since the last seek (so the video decoder must seek before decoding)
 		std::map<int64_t, int64_t> processing_video_frames;
 		std::multimap<int64_t, int64_t> processing_audio_frames;
 		std::map<int64_t, int64_t> processed_video_frames;
@@ -121,6 +130,26 @@ namespace openshot {
 		int seek_count;
 		int64_t seek_audio_frame_found;
 		int64_t seek_video_frame_found;
+		int64_t seek_keyframe; ///< The keyframe of the last seek (from the seek index), so a seek which went too far can step back to an earlier keyframe
+
+		std::shared_ptr<const openshot::SeekIndex> seek_index; ///< The keyframes of the video stream (NULL until indexed)
+		std::mutex seek_index_mutex; ///< Protects seek_index (which is set by the indexing thread)
+		std::thread seek_index_thread; ///< Reads the packets of the file (without decoding them) to build the seek index
+		std::mutex seek_index_thread_mutex; ///< Protects seek_index_thread and seek_index_started (since different threads start, stop, and wait for it)
+		bool seek_index_started; ///< The indexing of this file was started (or its saved index was loaded)
+		std::atomic<bool> stop_seek_index; ///< Tells the indexing thread to stop early
+
+		std::vector<std::unique_ptr<FFmpegReader>> open_segment_readers; ///< The other readers of this file (used by GetFrames), kept open until Close
+		std::mutex segment_readers_mutex; ///< Protects open_segment_readers
+
+		std::atomic<int64_t> read_ahead_max_bytes; ///< Max bytes of frames decoded ahead of the last requested frame (0 = no read-ahead)
+		std::atomic<int64_t> read_ahead_frame_bytes; ///< Bytes of the last frame decoded ahead (an estimate of each cached frame ahead)
+		int64_t read_ahead_position; ///< The last frame requested by GetFrame (the read-ahead thread decodes the frames after it)
+		std::thread read_ahead_thread; ///< Decodes frames ahead of the last requested frame (into the final cache)
+		std::atomic<std::thread::id> read_ahead_thread_id; ///< The id of read_ahead_thread (which can be read without read_ahead_mutex)
+		std::mutex read_ahead_mutex; ///< Protects read_ahead_position
+		std::condition_variable read_ahead_condition; ///< Wakes the read-ahead thread when a frame is requested, getFrameMutex is released (or it is stopped)
+		std::atomic<bool> stop_read_ahead; ///< Tells the read-ahead thread to stop
 
 		int64_t audio_pts_offset;
 		int64_t video_pts_offset;
@@ -180,6 +209,32 @@ namespace openshot {
 		/// Check if there's an album art
 		bool HasAlbumArt();
 
+		/// Build the seek index of the video stream, from the keyframe flags of its packets (run by the indexing thread)
+		void IndexKeyframes(std::string media_path);
+
+		/// Split a range of frames into segments, which start at keyframes (if the video stream is indexed)
+		/// @returns The first frame number of each segment
+		std::vector<int64_t> GetSegments(int64_t start, int64_t end);
+
+		/// Find the next frame for the read-ahead thread to decode (after the last requested frame, within the max bytes)
+		/// @returns The frame number, or 0 if there is nothing to decode
+		int64_t NextReadAheadFrame();
+
+		/// Decode frames ahead of the last requested frame (run by the read-ahead thread)
+		void ReadAheadFrames();
+
+		/// Tell the read-ahead thread which frame was requested (and start the thread, if needed)
+		void RequestReadAhead(int64_t requested_frame);
+
+		/// Stop the read-ahead thread (if any), and wait for it to finish
+		void StopReadAhead();
+
+		/// Wake the read-ahead thread (if it is waiting for getFrameMutex), after getFrameMutex is released
+		void WakeReadAhead();
+
+		/// Decode segments of a range of frames in parallel (with other readers of this file), and deliver the frames in order
+		void GetSegmentFrames(const std::vector<int64_t>& segments, int64_t end, openshot::FrameCallback callback);
+
 		/// Remove partial frames due to seek
 		bool IsPartialFrame(int64_t requested_frame);
 
@@ -192,6 +247,9 @@ namespace openshot {
 		/// Read the stream until we find the requested Frame
 		std::shared_ptr<openshot::Frame> ReadStream(int64_t requested_frame);
 
+		/// Seek (if needed) and read the stream until we find the requested Frame (with getFrameMutex locked)
+		std::shared_ptr<openshot::Frame> ReadFrame(int64_t requested_frame);
+
 		/// Remove AVFrame from cache (and deallocate its memory)
 		void RemoveAVFrame(AVFrame *);
 
@@ -201,6 +259,16 @@ namespace openshot {
 		/// Seek to a specific Frame.  This is not always frame accurate, it's more of an estimation on many codecs.
 		void Seek(int64_t requested_frame);
 
+		/// Load the seek index saved by another reader of this file (if any)
+		/// @returns True if the file is indexed
+		bool LoadSeekIndex();
+
+		/// Load the saved seek index of this file, or start the indexing thread (if the file is not indexed yet)
+		void StartSeekIndex();
+
+		/// Stop the indexing thread (if any), and wait for it to finish
+		void StopSeekIndex();
+
 		/// Update PTS Offset (if any)
 		void UpdatePTSOffset(bool is_video);
 
@@ -218,6 +286,14 @@ namespace openshot {
 		/// codecs have trouble seeking, and can introduce artifacts or blank images into the video.
 		bool enable_seek;
 
+		/// @brief Number of readers which decode a range of frames in parallel (in GetFrames), 0 or 1 to decode
+		/// the range with this reader only.
+		///
+		/// The range is split into segments (which start at keyframes, once the file is indexed), and each reader
+		/// opens the file again, and decodes the next segment which is not taken yet. The frames are delivered in
+		/// order, so segments ahead of the callback are kept in memory (up to 1 segment per reader).
+		int segment_readers;
+
 		/// @brief Constructor for FFmpegReader.
 		///
 		/// Sets (and possibly opens) the media file path,
@@ -241,6 +317,26 @@ namespace openshot {
 		/// @param requested_frame	The frame number that is requested.
 		std::shared_ptr<openshot::Frame> GetFrame(int64_t requested_frame) override;
 
+		/// @brief Get a frame's audio, without decoding video packets (i.e. for waveforms or audio export)
+		///
+		/// Cached frames are returned as is. Otherwise the stream is read without decoding or scaling
+		/// any video, and the frame has no image. These frames are kept in a separate cache (so GetFrame()
+		/// never returns them), and the next GetFrame() seeks, since the video decoder skipped packets.
+		///
+		/// @returns The requested frame (with its audio, but maybe without an image)
+		/// @param requested_frame	The frame number that is requested.
+		std::shared_ptr<openshot::Frame> GetAudioFrame(int64_t requested_frame) override;
+
+		/// @brief Get a range of frames, and deliver them to a callback (in order)
+		///
+		/// A worker thread decodes the range (in order, so the stream is never seeked) ahead of the
+		/// frame being delivered, so decoding overlaps with the work done by the callback.
+		///
+		/// @param start The first frame number of the range
+		/// @param end The last frame number of the range
+		/// @param callback The function which receives each frame (return false to stop early)
+		void GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback) override;
+
 		/// Determine if reader is open or closed
 		bool IsOpen() override { return is_open; };
 
@@ -258,6 +354,31 @@ namespace openshot {
 
 		/// Return true if frame can be read with GetFrame()
 		bool GetIsDurationKnown();
+
+		/// @brief Get the keyframes of the video stream, used to seek straight to the keyframe before a frame
+		///
+		/// The index is loaded from Settings::PATH_SEEK_INDEX when the file is opened (if this file was already
+		/// indexed). Otherwise the file is indexed in the background (by reading its packets, without decoding them),
+		/// starting at the first seek, so files which are only read in order are never indexed.
+		///
+		/// @returns The seek index (or NULL if the file has no video stream, or is not indexed yet)
+		std::shared_ptr<const openshot::SeekIndex> GetSeekIndex();
+
+		/// Wait for the background indexing of the video stream to finish (if it is running)
+		void WaitForSeekIndex();
+
+		/// @brief Decode frames ahead of the last requested frame, on a background thread
+		///
+		/// After each GetFrame() call, a background thread keeps reading the stream (and decoding and converting
+		/// its frames) into the final cache, until the frames ahead of the requested frame use the max bytes. So
+		/// frames requested in order (such as during playback) are usually already in the cache. The final cache
+		/// is enlarged by the max bytes.
+		///
+		/// @param max_bytes Max bytes of frames decoded ahead of the last requested frame (0 disables read-ahead)
+		void SetReadAhead(int64_t max_bytes);
+
+		/// Get the max bytes of frames decoded ahead of the last requested frame (0 if read-ahead is disabled)
+		int64_t GetReadAhead() const { return read_ahead_max_bytes; }
 	};
 
 }
@@ -782,8 +782,8 @@ void FFmpegWriter::WriteFrame(ReaderBase *reader, int64_t start, int64_t length)
 
 	// Loop through each frame (and encoded it)
 	for (int64_t number = start; number <= length; number++) {
-		// Get the frame
-		std::shared_ptr<Frame> f = reader->GetFrame(number);
+		// Get the frame (without its image, when only audio is written)
+		std::shared_ptr<Frame> f = info.has_video ? reader->GetFrame(number) : reader->GetAudioFrame(number);
 
 		// Encode frame
 		WriteFrame(f);
@@ -1951,6 +1951,33 @@ void FFmpegWriter::process_video_packet(std::shared_ptr<Frame> frame) {
 	if (source_image_height == 1 && source_image_width == 1)
 		return;
 
+	// Determine the pixel format of the encoder
+#if IS_FFMPEG_3_2
+	PixelFormat final_format = (AVPixelFormat)(video_st->codecpar->format);
+#if USE_HW_ACCEL
+	if (hw_en_on && hw_en_supported)
+		final_format = AV_PIX_FMT_NV12;
+#endif // USE_HW_ACCEL
+#else
+	PixelFormat final_format = video_codec_ctx->pix_fmt;
+#endif // IS_FFMPEG_3_2
+
+	// Copy the decoded image of the frame (if not converted to RGBA yet), when it already has the pixel format and
+	// size of the encoder (skipping the conversions to RGBA and back)
+	int bytes_final = 0;
+	std::shared_ptr<AVFrame> native_image = frame->GetNativeImage();
+	if (native_image && native_image->format == final_format &&
+		native_image->width == info.width && native_image->height == info.height) {
+		AVFrame *frame_final = allocate_avframe(final_format, info.width, info.height, &bytes_final, NULL);
+		av_image_copy(frame_final->data, frame_final->linesize, (const uint8_t **) native_image->data,
+					  native_image->linesize, final_format, info.width, info.height);
+		ZmqLogger::Instance()->AppendDebugMethod("FFmpegWriter::process_video_packet (Native image)", "frame->number", frame->number, "bytes_final", bytes_final);
+
+		// Add AVFrame to av_frames map
+		add_avframe(frame, frame_final);
+		return;
+	}
+
 	// Init rescalers (if not initialized yet)
 	if (image_rescalers.size() == 0)
 		InitScalers(source_image_width, source_image_height);
@@ -1963,7 +1990,6 @@ void FFmpegWriter::process_video_packet(std::shared_ptr<Frame> frame) {
 
     // Allocate an RGB frame & final output frame
     int bytes_source = 0;
-    int bytes_final = 0;
     AVFrame *frame_source = NULL;
     const uchar *pixels = NULL;
 
@@ -1972,22 +1998,7 @@ void FFmpegWriter::process_video_packet(std::shared_ptr<Frame> frame) {
 
     // Init AVFrame for source image & final (converted image)
     frame_source = allocate_avframe(PIX_FMT_RGBA, source_image_width, source_image_height, &bytes_source, (uint8_t *) pixels);
-#if IS_FFMPEG_3_2
-    AVFrame *frame_final;
-#if USE_HW_ACCEL
-    if (hw_en_on && hw_en_supported) {
-        frame_final = allocate_avframe(AV_PIX_FMT_NV12, info.width, info.height, &bytes_final, NULL);
-    } else
-#endif // USE_HW_ACCEL
-    {
-        frame_final = allocate_avframe(
-            (AVPixelFormat)(video_st->codecpar->format),
-            info.width, info.height, &bytes_final, NULL
-        );
-    }
-#else
-    AVFrame *frame_final = allocate_avframe(video_codec_ctx->pix_fmt, info.width, info.height, &bytes_final, NULL);
-#endif // IS_FFMPEG_3_2
+    AVFrame *frame_final = allocate_avframe(final_format, info.width, info.height, &bytes_final, NULL);
 
     // Fill with data
     AV_COPY_PICTURE_DATA(frame_source, (uint8_t *) pixels, PIX_FMT_RGBA, source_image_width, source_image_height);
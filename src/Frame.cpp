@@ -18,6 +18,7 @@
 #include "Frame.h"
 #include "AudioBufferSource.h"
 #include "AudioResampler.h"
+#include "BufferPool.h"
 #include "QtUtilities.h"
 
 #include <AppConfig.h>
@@ -41,9 +42,44 @@
 using namespace std;
 using namespace openshot;
 
+// A decoded image (in its native pixel format), which is shared by a frame and all its copies. It is converted
+// to RGBA at most once, so the copies of a cached frame (and the cached frame itself) share the converted image.
+struct Frame::NativeImage
+{
+	const std::shared_ptr<AVFrame> frame;
+	const std::function<std::shared_ptr<QImage>()> convert;
+	std::shared_ptr<QImage> converted;
+	std::mutex mutex;
+
+	NativeImage(std::shared_ptr<AVFrame> frame, std::function<std::shared_ptr<QImage>()> convert)
+		: frame(frame), convert(convert) {}
+
+	// Get the RGBA image (converting the native image the first time)
+	std::shared_ptr<QImage> GetConverted()
+	{
+		const std::lock_guard<std::mutex> lock(mutex);
+		if (!converted) {
+			converted = convert();
+			if (converted->format() != QImage::Format_RGBA8888_Premultiplied)
+				*converted = converted->convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+		}
+		return converted;
+	}
+
+	// Get the size in bytes of the native image (and the converted image, once it exists)
+	int64_t GetBytes()
+	{
+		int64_t bytes = std::max(0, AV_GET_IMAGE_SIZE((AVPixelFormat) frame->format, frame->width, frame->height));
+		const std::lock_guard<std::mutex> lock(mutex);
+		if (converted)
+			bytes += static_cast<int64_t>(converted->bytesPerLine()) * converted->height();
+		return bytes;
+	}
+};
+
 // Constructor - image & audio
 Frame::Frame(int64_t number, int width, int height, std::string color, int samples, int channels)
-	: audio(std::make_shared<juce::AudioBuffer<float>>(channels, samples)),
+	: audio(BufferPool::Instance()->CreateAudioBuffer(channels, samples)),
 	  number(number), width(width), height(height),
 	  pixel_ratio(1,1), color(color),
 	  channels(channels), channel_layout(LAYOUT_STEREO),
@@ -88,20 +124,28 @@ void Frame::DeepCopy(const Frame& other)
 {
 	number = other.number;
 	channels = other.channels;
-	width = other.width;
-	height = other.height;
 	channel_layout = other.channel_layout;
 	has_audio_data = other.has_audio_data;
-	has_image_data = other.has_image_data;
 	sample_rate = other.sample_rate;
 	pixel_ratio = Fraction(other.pixel_ratio.num, other.pixel_ratio.den);
 	color = other.color;
 	max_audio_sample = other.max_audio_sample;
 
-	if (other.image)
-		image = std::make_shared<QImage>(*(other.image));
-	if (other.audio)
-		audio = std::make_shared<juce::AudioBuffer<float>>(*(other.audio));
+	{
+		// The other frame's image can be converted (or replaced) by another thread while it is copied
+		const std::lock_guard<std::recursive_mutex> lock(other.addingImageMutex);
+		width = other.width;
+		height = other.height;
+		has_image_data = other.has_image_data;
+		if (other.image)
+			image = std::make_shared<QImage>(*(other.image));
+		// The native image is never modified (only converted once), so it is shared
+		native_image = other.native_image;
+	}
+	if (other.audio) {
+		audio = BufferPool::Instance()->CreateAudioBuffer(other.audio->getNumChannels(), other.audio->getNumSamples());
+		audio->makeCopyOf(*(other.audio), true);
+	}
 	if (other.wave_image)
 		wave_image = std::make_shared<QImage>(*(other.wave_image));
 }
@@ -110,6 +154,7 @@ void Frame::DeepCopy(const Frame& other)
 Frame::~Frame() {
 	// Clear all pointers
 	image.reset();
+	native_image.reset();
 	audio.reset();
 	#ifdef USE_OPENCV
 	imagecv.release();
@@ -434,9 +479,16 @@ juce::AudioBuffer<float> *Frame::GetAudioSampleBuffer()
 int64_t Frame::GetBytes()
 {
 	int64_t total_bytes = 0;
-	if (image) {
-		total_bytes += static_cast<int64_t>(
-		    width * height * sizeof(char) * 4);
+	{
+		const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+		if (image) {
+			total_bytes += static_cast<int64_t>(
+				width * height * sizeof(char) * 4);
+		}
+		if (native_image) {
+			// The decoded image can be much larger than the RGBA image (which is scaled to the preview size)
+			total_bytes += native_image->GetBytes();
+		}
 	}
 	if (audio) {
 		// approximate audio size (sample rate / 24 fps)
@@ -450,6 +502,9 @@ int64_t Frame::GetBytes()
 // Get pixel data (as packets)
 const unsigned char* Frame::GetPixels()
 {
+	// Convert the decoded image (if needed)
+	ConvertNativeImage();
+
 	// Check for blank image
 	if (!image)
 		// Fill with black
@@ -462,6 +517,9 @@ const unsigned char* Frame::GetPixels()
 // Get pixel data (for only a single scan-line)
 const unsigned char* Frame::GetPixels(int row)
 {
+	// Convert the decoded image (if needed)
+	ConvertNativeImage();
+
 	// Check for blank image
 	if (!image)
 		// Fill with black
@@ -473,6 +531,7 @@ const unsigned char* Frame::GetPixels(int row)
 
 // Check a specific pixel color value (returns True/False)
 bool Frame::CheckPixel(int row, int col, int red, int green, int blue, int alpha, int threshold) {
+	ConvertNativeImage();
 	int col_pos = col * 4; // Find column array position
 	if (!image || row < 0 || row >= (height - 1) ||
 		col_pos < 0 || col_pos >= (width - 1) ) {
@@ -739,7 +798,8 @@ void Frame::AddColor(const QColor& new_color)
 {
 	// Create new image object, and fill with pixel data
 	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
-	image = std::make_shared<QImage>(width, height, QImage::Format_RGBA8888_Premultiplied);
+	image = BufferPool::Instance()->CreateImage(width, height, QImage::Format_RGBA8888_Premultiplied);
+	native_image.reset();
 
 	// Fill with solid color
 	image->fill(new_color);
@@ -774,6 +834,7 @@ void Frame::AddImage(std::shared_ptr<QImage> new_image)
 	// assign image data
 	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
 	image = new_image;
+	native_image.reset();
 
 	// Always convert to Format_RGBA8888_Premultiplied (if different)
 	if (image->format() != QImage::Format_RGBA8888_Premultiplied)
@@ -785,6 +846,37 @@ void Frame::AddImage(std::shared_ptr<QImage> new_image)
 	has_image_data = true;
 }
 
+// Add (or replace) a decoded image, in its native pixel format (which is converted to RGBA when needed)
+void Frame::AddNativeImage(int new_width, int new_height, std::shared_ptr<AVFrame> new_native_image,
+						   std::function<std::shared_ptr<QImage>()> convert)
+{
+	// Ignore blank images
+	if (!new_native_image || !convert)
+		return;
+
+	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+	image.reset();
+	native_image = std::make_shared<NativeImage>(new_native_image, convert);
+
+	// Update height and width (of the RGBA image)
+	width = new_width;
+	height = new_height;
+	has_image_data = true;
+}
+
+// Convert the native image (if any) to the RGBA image
+void Frame::ConvertNativeImage()
+{
+	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+	if (!native_image)
+		return;
+
+	// The converted image is shared with the other copies of this frame (until one of them changes its pixels),
+	// and AddImage releases this frame's native image
+	std::shared_ptr<QImage> converted = native_image->GetConverted();
+	AddImage(std::make_shared<QImage>(*converted));
+}
+
 // Add (or replace) pixel data to the frame (for only the odd or even lines)
 void Frame::AddImage(std::shared_ptr<QImage> new_image, bool only_odd_lines)
 {
@@ -792,6 +884,9 @@ void Frame::AddImage(std::shared_ptr<QImage> new_image, bool only_odd_lines)
 	if (!new_image)
 		return;
 
+	// Convert the decoded image (if needed), so the new lines are merged into it
+	ConvertNativeImage();
+
 	// Check for blank source image
 	if (!image) {
 		// Replace the blank source image
@@ -888,6 +983,9 @@ void Frame::ApplyGainRamp(int destChannel, int destStartSample, int numSamples,
 // Get pointer to Magick++ image object
 std::shared_ptr<QImage> Frame::GetImage()
 {
+	// Convert the decoded image (if needed)
+	ConvertNativeImage();
+
 	// Check for blank image
 	if (!image)
 		// Fill with black
@@ -896,6 +994,15 @@ std::shared_ptr<QImage> Frame::GetImage()
     return image;
 }
 
+// Get the decoded image, in its native pixel format (if not converted to RGBA yet)
+std::shared_ptr<AVFrame> Frame::GetNativeImage()
+{
+	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+	if (!native_image)
+		return nullptr;
+	return native_image->frame;
+}
+
 #ifdef USE_OPENCV
 
 // Convert Qimage to Mat
@@ -912,6 +1019,9 @@ cv::Mat Frame::Qimage2mat( std::shared_ptr<QImage>& qimage) {
 // Get pointer to OpenCV image object
 cv::Mat Frame::GetImageCV()
 {
+	// Convert the decoded image (if needed)
+	ConvertNativeImage();
+
 	// Check for blank image
 	if (!image)
 		// Fill with black
@@ -941,7 +1051,9 @@ std::shared_ptr<QImage> Frame::Mat2Qimage(cv::Mat img){
 void Frame::SetImageCV(cv::Mat _image)
 {
 	imagecv = _image;
+	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
 	image = Mat2Qimage(_image);
+	native_image.reset();
 }
 #endif
 
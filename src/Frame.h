@@ -21,6 +21,7 @@
 	#undef int64
 #endif
 
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <sstream>
@@ -33,6 +34,7 @@
 #include <QImage>
 
 class QApplication;
+struct AVFrame;
 
 namespace juce {
     template <typename Type> class AudioBuffer;
@@ -92,9 +94,11 @@ namespace openshot
 	private:
 		std::shared_ptr<QImage> image;
 		std::shared_ptr<QImage> wave_image;
+		struct NativeImage;
+		std::shared_ptr<NativeImage> native_image; ///< The decoded image, in its native pixel format (until it is converted)
 
 		std::shared_ptr<QApplication> previewApp;
-		std::recursive_mutex addingImageMutex;
+		mutable std::recursive_mutex addingImageMutex;
 		std::recursive_mutex addingAudioMutex;
 		openshot::Fraction pixel_ratio;
 		int channels;
@@ -112,6 +116,9 @@ namespace openshot
 		/// Constrain a color value from 0 to 255
 		int constrain(int color_value);
 
+		/// Convert the native image (if any) to the RGBA image
+		void ConvertNativeImage();
+
 	public:
 		std::shared_ptr<juce::AudioBuffer<float>> audio;
 		int64_t number;	 ///< This is the frame number (starting at 1)
@@ -152,6 +159,20 @@ namespace openshot
 		/// Add (or replace) pixel data to the frame
 		void AddImage(std::shared_ptr<QImage> new_image);
 
+#ifndef SWIG
+		/// @brief Add (or replace) a decoded image, in its native pixel format (such as YUV)
+		///
+		/// The image is only converted to RGBA when its pixels are needed (such as by GetImage()), so a frame
+		/// which is encoded again in the same pixel format (or which is never displayed) skips the conversion.
+		///
+		/// @param new_width The width of the RGBA image
+		/// @param new_height The height of the RGBA image
+		/// @param new_native_image The decoded image
+		/// @param convert Converts the decoded image to an RGBA image (of the same width and height)
+		void AddNativeImage(int new_width, int new_height, std::shared_ptr<AVFrame> new_native_image,
+							std::function<std::shared_ptr<QImage>()> convert);
+#endif
+
 		/// Add (or replace) pixel data to the frame (for only the odd or even lines)
 		void AddImage(std::shared_ptr<QImage> new_image, bool only_odd_lines);
 
@@ -209,6 +230,11 @@ namespace openshot
 		/// Get pointer to Qt QImage image object
 		std::shared_ptr<QImage> GetImage();
 
+#ifndef SWIG
+		/// Get the decoded image, in its native pixel format (or nullptr once it is converted to RGBA, or replaced)
+		std::shared_ptr<AVFrame> GetNativeImage();
+#endif
+
 		/// Set Pixel Aspect Ratio
 		openshot::Fraction GetPixelRatio() { return pixel_ratio; };
 
@@ -46,6 +46,7 @@ FrameMapper::FrameMapper(ReaderBase *reader, Fraction target, PulldownType targe
 
 	// Adjust cache size based on size of frame and audio
 	final_cache.SetMaxBytesFromInfo(OPEN_MP_NUM_PROCESSORS * 2, info.width, info.height, info.sample_rate, info.channels);
+	audio_cache.SetMaxBytesFromInfo(OPEN_MP_NUM_PROCESSORS * 2, info.width, info.height, info.sample_rate, info.channels);
 }
 
 // Destructor
@@ -114,6 +115,7 @@ void FrameMapper::Init()
 
 	// Clear cache
 	final_cache.Clear();
+	audio_cache.Clear();
 
 	// Some framerates are handled special, and some use a generic Keyframe curve to
 	// map the framerates. These are the special framerates:
@@ -349,7 +351,7 @@ MappedFrame FrameMapper::GetMappedFrame(int64_t TargetFrameNumber)
 }
 
 // Get or generate a blank frame
-std::shared_ptr<Frame> FrameMapper::GetOrCreateFrame(int64_t number)
+std::shared_ptr<Frame> FrameMapper::GetOrCreateFrame(int64_t number, bool audio_only)
 {
 	std::shared_ptr<Frame> new_frame;
 
@@ -361,7 +363,10 @@ std::shared_ptr<Frame> FrameMapper::GetOrCreateFrame(int64_t number)
 		ZmqLogger::Instance()->AppendDebugMethod("FrameMapper::GetOrCreateFrame (from reader)", "number", number, "samples_in_frame", samples_in_frame);
 
 		// Attempt to get a frame (but this could fail if a reader has just been closed)
-		new_frame = reader->GetFrame(number);
+		if (audio_only)
+			new_frame = reader->GetAudioFrame(number);
+		else
+			new_frame = reader->GetFrame(number);
 
 		// Return real frame
 		return new_frame;
@@ -386,9 +391,28 @@ std::shared_ptr<Frame> FrameMapper::GetOrCreateFrame(int64_t number)
 // Get an openshot::Frame object for a specific frame number of this reader.
 std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 {
+	return MapFrame(requested_frame, false);
+}
+
+// Get an openshot::Frame object (with only its audio) for a specific frame number of this reader.
+std::shared_ptr<Frame> FrameMapper::GetAudioFrame(int64_t requested_frame)
+{
+	return MapFrame(requested_frame, true);
+}
+
+// Map a frame (with or without the images of the source frames)
+std::shared_ptr<Frame> FrameMapper::MapFrame(int64_t requested_frame, bool audio_only)
+{
+	// Audio only frames are kept in their own cache (since they have no images)
+	CacheMemory& frames_cache = audio_only ? audio_cache : final_cache;
+
 	// Check final cache, and just return the frame (if it's available)
 	std::shared_ptr<Frame> final_frame = final_cache.GetFrame(requested_frame);
 	if (final_frame) return final_frame;
+	if (audio_only) {
+		final_frame = audio_cache.GetFrame(requested_frame);
+		if (final_frame) return final_frame;
+	}
 
 	// Create a scoped lock, allowing only a single thread to run the following code at one time
 	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
@@ -412,6 +436,10 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 	// Check final cache a 2nd time (due to potential lock already generating this frame)
 	final_frame = final_cache.GetFrame(requested_frame);
 	if (final_frame) return final_frame;
+	if (audio_only) {
+		final_frame = audio_cache.GetFrame(requested_frame);
+		if (final_frame) return final_frame;
+	}
 
 	// Minimum number of frames to process (for performance reasons)
 	// Dialing this down to 1 for now, as it seems to improve performance, and reduce export crashes
@@ -432,7 +460,7 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 		std::shared_ptr<Frame> mapped_frame;
 
 		// Get the mapped frame (keeping the sample rate and channels the same as the original... for the moment)
-		mapped_frame = GetOrCreateFrame(mapped.Odd.Frame);
+		mapped_frame = GetOrCreateFrame(mapped.Odd.Frame, audio_only);
 
 		// Get # of channels in the actual frame
 		int channels_in_frame = mapped_frame->GetAudioChannelsCount();
@@ -454,7 +482,7 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 			info.fps.num == reader->info.fps.num &&
 			info.fps.den == reader->info.fps.den) {
 				// Add original frame to cache, and skip the rest (for performance reasons)
-				final_cache.Add(mapped_frame);
+				frames_cache.Add(mapped_frame);
 				continue;
 		}
 
@@ -465,13 +493,14 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 		frame->ChannelsLayout(mapped_frame->ChannelsLayout());
 
 
-		// Copy the image from the odd field
+		// Copy the image from the odd field (unless only the audio is needed)
 		std::shared_ptr<Frame> odd_frame;
-		odd_frame = GetOrCreateFrame(mapped.Odd.Frame);
+		if (!audio_only)
+			odd_frame = GetOrCreateFrame(mapped.Odd.Frame);
 
 		if (odd_frame)
 			frame->AddImage(std::make_shared<QImage>(*odd_frame->GetImage()), true);
-		if (mapped.Odd.Frame != mapped.Even.Frame) {
+		if (!audio_only && mapped.Odd.Frame != mapped.Even.Frame) {
 			// Add even lines (if different than the previous image)
 			std::shared_ptr<Frame> even_frame;
 			even_frame = GetOrCreateFrame(mapped.Even.Frame);
@@ -541,7 +570,7 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 			int number_to_copy = 0;
 
 			// number of original samples on this frame
-			std::shared_ptr<Frame> original_frame = GetOrCreateFrame(starting_frame);
+			std::shared_ptr<Frame> original_frame = GetOrCreateFrame(starting_frame, audio_only);
 			int original_samples = original_frame->GetAudioSamplesCount();
 
 			// Loop through each channel
@@ -590,12 +619,22 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 			ResampleMappedAudio(frame, mapped.Odd.Frame);
 
 		// Add frame to final cache
-		final_cache.Add(frame);
+		frames_cache.Add(frame);
 
 	} // for loop
 
 	// Return processed openshot::Frame
-	return final_cache.GetFrame(requested_frame);
+	return frames_cache.GetFrame(requested_frame);
+}
+
+// Get a range of frames, and deliver them to a callback (in order)
+void FrameMapper::GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback)
+{
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("FrameMapper::GetFrames", "start", start, "end", end);
+
+	// Map the range on a single worker thread (so the source reader reads its frames in order)
+	FramePipeline(1, OPEN_MP_NUM_PROCESSORS).Run(start, end, [this](int64_t number) { return GetFrame(number); }, callback);
 }
 
 void FrameMapper::PrintMapping(std::ostream* out)
@@ -665,6 +704,7 @@ void FrameMapper::Close()
 
 		// Clear cache
 		final_cache.Clear();
+		audio_cache.Clear();
 
 		// Deallocate resample buffer
 		if (avr) {
@@ -754,9 +794,11 @@ void FrameMapper::ChangeMapping(Fraction target_fps, PulldownType target_pulldow
 
 	// Clear cache
 	final_cache.Clear();
+	audio_cache.Clear();
 
 	// Adjust cache size based on size of frame and audio
 	final_cache.SetMaxBytesFromInfo(OPEN_MP_NUM_PROCESSORS * 2, info.width, info.height, info.sample_rate, info.channels);
+	audio_cache.SetMaxBytesFromInfo(OPEN_MP_NUM_PROCESSORS * 2, info.width, info.height, info.sample_rate, info.channels);
 
 	// Deallocate resample buffer
 	if (avr) {
@@ -125,6 +125,7 @@ namespace openshot
 		PulldownType pulldown;	// The pull-down technique
 		ReaderBase *reader;		// The source video reader
 		CacheMemory final_cache; 		// Cache of actual Frame objects
+		CacheMemory audio_cache; 		// Cache of Frame objects mapped by GetAudioFrame (without images)
 		bool is_dirty; 			// When this is true, the next call to GetFrame will re-init the mapping
 		float parent_position;  // Position of parent clip (which is used to generate the audio mapping)
 		float parent_start;     // Start of parent clip (which is used to generate the audio mapping)
@@ -134,8 +135,11 @@ namespace openshot
 		void AddField(int64_t frame);
 		void AddField(Field field);
 
-		// Get Frame or Generate Blank Frame
-		std::shared_ptr<Frame> GetOrCreateFrame(int64_t number);
+		// Get Frame or Generate Blank Frame (only its audio, if audio_only is true)
+		std::shared_ptr<Frame> GetOrCreateFrame(int64_t number, bool audio_only=false);
+
+		// Map a frame (without copying the images of the source frames, if audio_only is true)
+		std::shared_ptr<Frame> MapFrame(int64_t requested_frame, bool audio_only);
 
 		/// Adjust frame number for Clip position and start (which can result in a different number)
 		int64_t AdjustFrameNumber(int64_t clip_frame_number);
@@ -177,6 +181,26 @@ namespace openshot
 		/// @param requested_frame The frame number that is requested.
 		std::shared_ptr<Frame> GetFrame(int64_t requested_frame) override;
 
+		/// @brief Get a frame's mapped audio, without the images of the source frames
+		///
+		/// The source frames are requested with GetAudioFrame() (so the source reader can skip
+		/// decoding video), and the mapped frame has no image. These frames are kept in a separate
+		/// cache, so GetFrame() never returns them.
+		///
+		/// @returns The requested frame (with its audio, but maybe without an image)
+		/// @param requested_frame The frame number that is requested.
+		std::shared_ptr<Frame> GetAudioFrame(int64_t requested_frame) override;
+
+		/// @brief Get a range of frames, and deliver them to a callback (in order)
+		///
+		/// A worker thread maps the range (in order, so the source reader reads its frames in order)
+		/// ahead of the frame being delivered, so mapping overlaps with the work done by the callback.
+		///
+		/// @param start The first frame number of the range
+		/// @param end The last frame number of the range
+		/// @param callback The function which receives each frame (return false to stop early)
+		void GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback) override;
+
 		/// Determine if reader is open or closed
 		bool IsOpen() override;
 
@@ -0,0 +1,147 @@
+/**
+ * @file
+ * @brief Source file for FramePipeline class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "FramePipeline.h"
+#include "OpenMPUtilities.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace openshot;
+
+// The share of OpenMP threads of a worker thread (0 = not a worker thread of a pipeline)
+static thread_local int worker_openmp_threads = 0;
+
+// Default constructor
+FramePipeline::FramePipeline(int threads, int max_ahead)
+	: threads(std::max(0, threads)), max_ahead(std::max(1, max_ahead)) { }
+
+// Render a range of frames, and deliver them to a callback (in order)
+void FramePipeline::Run(int64_t start, int64_t end, RenderFunction render, FrameCallback callback)
+{
+	// Render each frame on the calling thread (if no worker threads)
+	if (threads == 0) {
+		for (int64_t number = start; number <= end; number++)
+			if (!callback(render(number)))
+				break;
+		return;
+	}
+
+	// Frames rendered (but not delivered yet), and exceptions thrown while rendering frames
+	std::mutex pipeline_mutex;
+	std::condition_variable pipeline_condition;
+	std::map<int64_t, std::shared_ptr<Frame>> rendered_frames;
+	std::map<int64_t, std::exception_ptr> render_errors;
+
+	// The next frame number to render (by any worker thread), and to deliver
+	int64_t next_render = start;
+	int64_t next_deliver = start;
+
+	// Stop rendering frames (after an error, or when the callback returns false)
+	bool stopped = false;
+
+	// Split the OpenMP threads of the calling thread between the worker threads
+	int64_t worker_count = std::min<int64_t>(threads, std::max<int64_t>(1, end - start + 1));
+	const int openmp_threads = std::max<int>(1, OpenMPThreads() / worker_count);
+
+	// Each worker thread renders the next frame number (unless it is too far ahead)
+	auto worker = [&]() {
+		worker_openmp_threads = openmp_threads;
+		while (true) {
+			int64_t number = 0;
+			{
+				std::unique_lock<std::mutex> lock(pipeline_mutex);
+				pipeline_condition.wait(lock, [&] { return stopped || next_render > end || next_render < next_deliver + max_ahead; });
+				if (stopped || next_render > end)
+					return;
+				number = next_render++;
+			}
+
+			std::shared_ptr<Frame> frame;
+			std::exception_ptr error;
+			try {
+				frame = render(number);
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			{
+				const std::lock_guard<std::mutex> lock(pipeline_mutex);
+				if (error)
+					render_errors[number] = error;
+				else
+					rendered_frames[number] = frame;
+			}
+			pipeline_condition.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int64_t index = 0; index < worker_count && start <= end; index++)
+		workers.emplace_back(worker);
+
+	// Deliver each frame (in order) on the calling thread
+	std::exception_ptr error;
+	for (int64_t number = start; number <= end; number++) {
+		std::shared_ptr<Frame> frame;
+		{
+			std::unique_lock<std::mutex> lock(pipeline_mutex);
+			pipeline_condition.wait(lock, [&] { return rendered_frames.count(number) || render_errors.count(number); });
+			if (render_errors.count(number)) {
+				error = render_errors[number];
+				stopped = true;
+			} else {
+				frame = rendered_frames[number];
+				rendered_frames.erase(number);
+				next_deliver = number + 1;
+			}
+		}
+		pipeline_condition.notify_all();
+		if (error)
+			break;
+
+		bool keep_going = false;
+		try {
+			keep_going = callback(frame);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		if (!keep_going) {
+			{
+				const std::lock_guard<std::mutex> lock(pipeline_mutex);
+				stopped = true;
+			}
+			pipeline_condition.notify_all();
+			break;
+		}
+	}
+
+	// Wait for the worker threads (which stop after their current frame)
+	for (auto& thread : workers)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+// Get the number of OpenMP threads a parallel region may use on the calling thread
+int FramePipeline::OpenMPThreads()
+{
+	if (worker_openmp_threads > 0)
+		return worker_openmp_threads;
+	return OPEN_MP_NUM_PROCESSORS;
+}
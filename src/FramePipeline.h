@@ -0,0 +1,77 @@
+/**
+ * @file
+ * @brief Header file for FramePipeline class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_FRAME_PIPELINE_H
+#define OPENSHOT_FRAME_PIPELINE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace openshot {
+	class Frame;
+
+	/// @brief A function which receives each frame of a range (in order)
+	///
+	/// Return false to stop the range early (no more frames are delivered).
+	typedef std::function<bool(std::shared_ptr<openshot::Frame>)> FrameCallback;
+
+	/**
+	 * @brief This class renders a range of frames with worker threads, and delivers them in order.
+	 *
+	 * Worker threads render the frames ahead of the frame being delivered (up to a max number of frames
+	 * ahead, which limits the memory used), while the calling thread passes each frame to a callback, in
+	 * order. With a single worker thread, this overlaps decoding with the work done by the callback (such
+	 * as encoding). With many worker threads, frames are also rendered concurrently (so the render function
+	 * must be thread-safe). If rendering a frame throws an exception, the exception is re-thrown on the
+	 * calling thread (after the frames before it are delivered).
+	 *
+	 * @code
+	 * // Render frames 1 to 100 with 8 threads (at most 16 frames ahead), and deliver them in order
+	 * openshot::FramePipeline pipeline(8, 16);
+	 * pipeline.Run(1, 100,
+	 *     [&](int64_t number) { return timeline.GetFrame(number); },
+	 *     [&](std::shared_ptr<openshot::Frame> frame) { writer.WriteFrame(frame); return true; });
+	 * @endcode
+	 */
+	class FramePipeline {
+	private:
+		int threads; ///< Number of worker threads (0 = render each frame on the calling thread)
+		int max_ahead; ///< Max number of frames rendered ahead of the frame being delivered
+
+	public:
+		/// A function which renders a frame number
+		typedef std::function<std::shared_ptr<openshot::Frame>(int64_t)> RenderFunction;
+
+		/// @brief Default constructor
+		/// @param threads Number of worker threads (0 = render each frame on the calling thread)
+		/// @param max_ahead Max number of frames rendered ahead of the frame being delivered
+		FramePipeline(int threads, int max_ahead);
+
+		/// @brief Render a range of frames, and deliver them to a callback (in order)
+		/// @param start The first frame number of the range
+		/// @param end The last frame number of the range
+		/// @param render The function which renders a frame number
+		/// @param callback The function which receives each frame (return false to stop early)
+		void Run(int64_t start, int64_t end, RenderFunction render, FrameCallback callback);
+
+		/// @brief Get the number of OpenMP threads a parallel region may use on the calling thread
+		///
+		/// The worker threads of a pipeline share the processors, so each worker only gets its share
+		/// of the OpenMP threads (instead of every worker starting a full team of threads).
+		/// @returns OPEN_MP_NUM_PROCESSORS (or the share of a worker thread, which is at least 1)
+		static int OpenMPThreads();
+	};
+
+}
+
+#endif
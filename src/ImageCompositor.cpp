@@ -0,0 +1,328 @@
+/**
+ * @file
+ * @brief Source file for ImageCompositor class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "ImageCompositor.h"
+#include "FramePipeline.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <omp.h>
+#include <QColor>
+#include <QPainter>
+#include <QRectF>
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define OPENSHOT_COMPOSITOR_SSE2
+	#include <emmintrin.h>
+#endif
+#if defined(OPENSHOT_COMPOSITOR_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	// AVX2 is selected at runtime (if the CPU supports it)
+	#define OPENSHOT_COMPOSITOR_AVX2
+	#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define OPENSHOT_COMPOSITOR_NEON
+	#include <arm_neon.h>
+#endif
+
+using namespace openshot;
+
+// Smallest number of pixels to blend in parallel (smaller images are not worth starting threads for)
+static const int PARALLEL_PIXELS = 128 * 128;
+
+// Multiply the 4 channels of a pixel by an alpha value (rounded the same way as Qt's BYTE_MUL)
+static inline uint32_t byte_mul(uint32_t pixel, uint32_t alpha)
+{
+	uint32_t rb = (pixel & 0xff00ff) * alpha;
+	rb = ((rb + ((rb >> 8) & 0xff00ff) + 0x800080) >> 8) & 0xff00ff;
+	uint32_t ag = ((pixel >> 8) & 0xff00ff) * alpha;
+	ag = (ag + ((ag >> 8) & 0xff00ff) + 0x800080) & 0xff00ff00;
+	return ag | rb;
+}
+
+// Blend pixels (one at a time)
+static void blend_row_scalar(uint32_t* destination, const uint32_t* source, int count)
+{
+	for (int x = 0; x < count; x++) {
+		uint32_t pixel = source[x];
+		if (pixel >= 0xff000000)
+			destination[x] = pixel;
+		else if (pixel != 0)
+			destination[x] = pixel + byte_mul(destination[x], 255 - (pixel >> 24));
+	}
+}
+
+#ifdef OPENSHOT_COMPOSITOR_SSE2
+// Blend pixels (4 at a time)
+static void blend_row_sse2(uint32_t* destination, const uint32_t* source, int count)
+{
+	const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+	const __m128i color_mask = _mm_set1_epi32(0x00ff00ff);
+	const __m128i half = _mm_set1_epi16(0x80);
+	const __m128i max_alpha = _mm_set1_epi16(0xff);
+	const __m128i zero = _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 4 <= count; x += 4) {
+		__m128i pixels = _mm_loadu_si128((const __m128i*) (source + x));
+
+		// Opaque pixels replace the destination, and transparent pixels do nothing
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(pixels, alpha_mask), alpha_mask)) == 0xffff) {
+			_mm_storeu_si128((__m128i*) (destination + x), pixels);
+			continue;
+		}
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(pixels, zero)) == 0xffff)
+			continue;
+
+		// Inverse alpha of each pixel (in both 16 bit halves)
+		__m128i alpha = _mm_srli_epi32(pixels, 24);
+		alpha = _mm_sub_epi16(max_alpha, _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16)));
+
+		// Multiply the destination by the inverse alpha (red & blue, and alpha & green)
+		__m128i background = _mm_loadu_si128((const __m128i*) (destination + x));
+		__m128i rb = _mm_mullo_epi16(_mm_and_si128(background, color_mask), alpha);
+		__m128i ag = _mm_mullo_epi16(_mm_srli_epi16(background, 8), alpha);
+		rb = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(rb, _mm_srli_epi16(rb, 8)), half), 8);
+		ag = _mm_andnot_si128(color_mask, _mm_add_epi16(_mm_add_epi16(ag, _mm_srli_epi16(ag, 8)), half));
+		background = _mm_or_si128(ag, rb);
+
+		_mm_storeu_si128((__m128i*) (destination + x), _mm_add_epi8(pixels, background));
+	}
+
+	blend_row_scalar(destination + x, source + x, count - x);
+}
+#endif
+
+#ifdef OPENSHOT_COMPOSITOR_AVX2
+// Blend pixels (8 at a time)
+__attribute__((target("avx2")))
+static void blend_row_avx2(uint32_t* destination, const uint32_t* source, int count)
+{
+	const __m256i alpha_mask = _mm256_set1_epi32(0xff000000);
+	const __m256i color_mask = _mm256_set1_epi32(0x00ff00ff);
+	const __m256i half = _mm256_set1_epi16(0x80);
+	const __m256i max_alpha = _mm256_set1_epi16(0xff);
+	const __m256i zero = _mm256_setzero_si256();
+
+	int x = 0;
+	for (; x + 8 <= count; x += 8) {
+		__m256i pixels = _mm256_loadu_si256((const __m256i*) (source + x));
+
+		// Opaque pixels replace the destination, and transparent pixels do nothing
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(pixels, alpha_mask), alpha_mask)) == -1) {
+			_mm256_storeu_si256((__m256i*) (destination + x), pixels);
+			continue;
+		}
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(pixels, zero)) == -1)
+			continue;
+
+		// Inverse alpha of each pixel (in both 16 bit halves)
+		__m256i alpha = _mm256_srli_epi32(pixels, 24);
+		alpha = _mm256_sub_epi16(max_alpha, _mm256_or_si256(alpha, _mm256_slli_epi32(alpha, 16)));
+
+		// Multiply the destination by the inverse alpha (red & blue, and alpha & green)
+		__m256i background = _mm256_loadu_si256((const __m256i*) (destination + x));
+		__m256i rb = _mm256_mullo_epi16(_mm256_and_si256(background, color_mask), alpha);
+		__m256i ag = _mm256_mullo_epi16(_mm256_srli_epi16(background, 8), alpha);
+		rb = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(rb, _mm256_srli_epi16(rb, 8)), half), 8);
+		ag = _mm256_andnot_si256(color_mask, _mm256_add_epi16(_mm256_add_epi16(ag, _mm256_srli_epi16(ag, 8)), half));
+		background = _mm256_or_si256(ag, rb);
+
+		_mm256_storeu_si256((__m256i*) (destination + x), _mm256_add_epi8(pixels, background));
+	}
+
+	blend_row_scalar(destination + x, source + x, count - x);
+}
+#endif
+
+#ifdef OPENSHOT_COMPOSITOR_NEON
+// Blend pixels (4 at a time)
+static void blend_row_neon(uint32_t* destination, const uint32_t* source, int count)
+{
+	int x = 0;
+	for (; x + 4 <= count; x += 4) {
+		uint32x4_t pixels = vld1q_u32(source + x);
+		uint32x4_t alpha = vshrq_n_u32(pixels, 24);
+
+#ifdef __aarch64__
+		// Opaque pixels replace the destination, and transparent pixels do nothing
+		if (vminvq_u32(alpha) == 255) {
+			vst1q_u32(destination + x, pixels);
+			continue;
+		}
+		if (vmaxvq_u32(pixels) == 0)
+			continue;
+#endif
+
+		// Inverse alpha of each pixel (in all 4 channels)
+		uint8x16_t inverse_alpha = vmvnq_u8(vreinterpretq_u8_u32(vmulq_n_u32(alpha, 0x01010101)));
+
+		// Multiply the destination by the inverse alpha (rounded like Qt's BYTE_MUL)
+		uint8x16_t background = vreinterpretq_u8_u32(vld1q_u32(destination + x));
+		uint16x8_t low = vmull_u8(vget_low_u8(background), vget_low_u8(inverse_alpha));
+		uint16x8_t high = vmull_u8(vget_high_u8(background), vget_high_u8(inverse_alpha));
+		background = vcombine_u8(vraddhn_u16(low, vshrq_n_u16(low, 8)), vraddhn_u16(high, vshrq_n_u16(high, 8)));
+
+		vst1q_u32(destination + x, vreinterpretq_u32_u8(vaddq_u8(vreinterpretq_u8_u32(pixels), background)));
+	}
+
+	blend_row_scalar(destination + x, source + x, count - x);
+}
+#endif
+
+// Choose the fastest way to blend pixels on this CPU
+typedef void (*BlendRowFunction)(uint32_t*, const uint32_t*, int);
+static BlendRowFunction select_blend_row()
+{
+#ifdef OPENSHOT_COMPOSITOR_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		return blend_row_avx2;
+#endif
+#if defined(OPENSHOT_COMPOSITOR_SSE2)
+	return blend_row_sse2;
+#elif defined(OPENSHOT_COMPOSITOR_NEON)
+	return blend_row_neon;
+#else
+	return blend_row_scalar;
+#endif
+}
+
+// Blend a row of premultiplied pixels onto another row
+void ImageCompositor::BlendRow(uint32_t* destination, const uint32_t* source, int count)
+{
+	static const BlendRowFunction blend_row = select_blend_row();
+	blend_row(destination, source, count);
+}
+
+// Determine if the fast path supports compositing an image (with a transform) onto another image
+bool ImageCompositor::CanComposite(const QImage& destination, const QImage& source, const QTransform& transform)
+{
+	if (destination.isNull() || source.isNull() || destination.format() != source.format())
+		return false;
+
+	// The alpha of each pixel must be its highest 8 bits (RGBA8888 is only stored that way on little endian CPUs)
+	if (source.format() != QImage::Format_ARGB32_Premultiplied &&
+		(source.format() != QImage::Format_RGBA8888_Premultiplied || Q_BYTE_ORDER != Q_LITTLE_ENDIAN))
+		return false;
+
+	// Only moves by whole pixels are supported (QPainter filters anything else)
+	const double tolerance = 0.001;
+	return transform.type() <= QTransform::TxTranslate &&
+		std::abs(transform.dx() - std::round(transform.dx())) < tolerance &&
+		std::abs(transform.dy() - std::round(transform.dy())) < tolerance;
+}
+
+// Composite an image (with a transform) onto another image
+bool ImageCompositor::Composite(QImage& destination, const QImage& source, const QTransform& transform)
+{
+	if (!CanComposite(destination, source, transform))
+		return false;
+
+	// Find the part of the source image which lands on the destination image
+	int offset_x = std::lround(transform.dx());
+	int offset_y = std::lround(transform.dy());
+	int left = std::max(0, offset_x);
+	int top = std::max(0, offset_y);
+	int right = std::min(destination.width(), offset_x + source.width());
+	int bottom = std::min(destination.height(), offset_y + source.height());
+	if (left >= right || top >= bottom)
+		return true;
+
+	const int width = right - left;
+	const int height = bottom - top;
+	unsigned char* destination_pixels = destination.bits();
+	const unsigned char* source_pixels = source.constBits();
+	const int destination_bytes_per_line = destination.bytesPerLine();
+	const int source_bytes_per_line = source.bytesPerLine();
+
+	// Blend each row (in parallel, for large images, with this thread's share of the OpenMP threads)
+	const int threads = FramePipeline::OpenMPThreads();
+	#pragma omp parallel for num_threads(threads) if (threads > 1 && width * height >= PARALLEL_PIXELS && !omp_in_parallel()) schedule(static)
+	for (int row = 0; row < height; row++) {
+		uint32_t* destination_row = (uint32_t*) (destination_pixels + int64_t(top + row) * destination_bytes_per_line) + left;
+		const uint32_t* source_row = (const uint32_t*) (source_pixels + int64_t(top + row - offset_y) * source_bytes_per_line) + (left - offset_x);
+		BlendRow(destination_row, source_row, width);
+	}
+
+	return true;
+}
+
+// Composite all layers (in order) onto a tile of an image
+static void composite_tile(unsigned char* pixels, const QImage& destination, int tile, int tile_height, const std::vector<ImageLayer>& layers)
+{
+	// Each tile is an image which shares the destination's pixels
+	const int bytes_per_line = destination.bytesPerLine();
+	const int top = tile * tile_height;
+	QImage tile_image(pixels + int64_t(top) * bytes_per_line, destination.width(),
+		std::min(tile_height, destination.height() - top), bytes_per_line, destination.format());
+	const QRectF tile_rect(tile_image.rect());
+
+	for (const auto& layer : layers) {
+		if (!layer.image)
+			continue;
+
+		// Move the layer up (relative to the tile), and skip it if it does not reach this tile
+		// (allowing 1 extra pixel for antialiased edges)
+		QTransform transform = layer.transform * QTransform::fromTranslate(0, -top);
+		QRectF layer_rect = transform.mapRect(QRectF(layer.image->rect())).adjusted(-1, -1, 1, 1);
+		bool overlaps_tile = layer_rect.intersects(tile_rect);
+		if (!overlaps_tile && layer.text.isEmpty())
+			continue;
+
+		// Composite the layer (without a QPainter, if the image is only moved by whole pixels)
+		if (overlaps_tile && !ImageCompositor::Composite(tile_image, *layer.image, transform)) {
+			QPainter painter(&tile_image);
+			painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, true);
+			painter.setTransform(transform);
+			painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+			painter.drawImage(0, 0, *layer.image);
+			painter.end();
+		}
+
+		// Draw the text over the layer
+		if (!layer.text.isEmpty()) {
+			QPainter painter(&tile_image);
+			painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, true);
+			painter.setTransform(transform);
+			painter.setPen(QColor("#ffffff"));
+			painter.drawText(20, 20, layer.text);
+			painter.end();
+		}
+	}
+}
+
+// Composite layers (in order) onto an image, by compositing all layers of each tile in parallel
+void ImageCompositor::CompositeLayers(QImage& destination, const std::vector<ImageLayer>& layers, int tile_height)
+{
+	if (destination.isNull() || layers.empty())
+		return;
+
+	// Get the pixels once (so the image is not detached by each thread)
+	unsigned char* pixels = destination.bits();
+	tile_height = std::max(1, tile_height);
+	const int tile_count = (destination.height() + tile_height - 1) / tile_height;
+
+	if (omp_in_parallel()) {
+		// Inside a parallel region (such as a RenderGraph), each tile is a task for the threads of that region
+		#pragma omp taskloop grainsize(1)
+		for (int tile = 0; tile < tile_count; tile++)
+			composite_tile(pixels, destination, tile, tile_height, layers);
+	} else {
+		// Only use this thread's share of the OpenMP threads (a worker of a FramePipeline shares them with the other workers)
+		const int threads = FramePipeline::OpenMPThreads();
+		#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(dynamic)
+		for (int tile = 0; tile < tile_count; tile++)
+			composite_tile(pixels, destination, tile, tile_height, layers);
+	}
+}
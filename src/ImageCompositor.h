@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @brief Header file for ImageCompositor class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_IMAGE_COMPOSITOR_H
+#define OPENSHOT_IMAGE_COMPOSITOR_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <QImage>
+#include <QString>
+#include <QTransform>
+
+namespace openshot {
+
+	/**
+	 * @brief This struct contains an image to composite (such as a clip's frame), and where to composite it
+	 */
+	struct ImageLayer {
+		std::shared_ptr<QImage> image; ///< The image (nothing is composited if NULL)
+		QTransform transform; ///< The transform of the image (relative to the canvas)
+		QString text; ///< Optional text drawn over the image (using the same transform), such as a frame number
+	};
+
+	/**
+	 * @brief This class composites images (such as the layers of a timeline frame), without a QPainter when possible.
+	 *
+	 * Images which are only moved by whole pixels are composited without a QPainter (most clips are
+	 * already decoded at the size of the timeline, so their transform only moves them, or does nothing). These images are blended row by row (in parallel), with SIMD instructions
+	 * (SSE2, AVX2 or NEON, when available), using the same premultiplied alpha SourceOver math as Qt.
+	 * Any other transform (such as a scale, rotation, shear, or a move by part of a pixel, which are
+	 * filtered by QPainter) is not supported by Composite(), and must be composited with a QPainter
+	 * instead (which CompositeLayers() does).
+	 *
+	 * @code
+	 * // Composite a clip's image (using a QPainter, if the fast path does not support the transform)
+	 * if (!openshot::ImageCompositor::Composite(*background, *source, transform)) {
+	 *     QPainter painter(background.get());
+	 *     painter.setTransform(transform);
+	 *     painter.drawImage(0, 0, *source);
+	 * }
+	 * @endcode
+	 */
+	class ImageCompositor {
+	public:
+		/// @brief Determine if the fast path supports compositing an image (with a transform) onto another image
+		/// @returns True if both images are premultiplied RGBA (or ARGB32), and the transform only moves by whole pixels
+		/// @param destination The image to composite onto
+		/// @param source The image to composite
+		/// @param transform The transform of the source image (relative to the destination image)
+		static bool CanComposite(const QImage& destination, const QImage& source, const QTransform& transform);
+
+		/// @brief Composite an image (with a transform) onto another image, using the SourceOver composition mode
+		/// @returns False (without changing the destination) if the fast path does not support these images or transform
+		/// @param destination The image to composite onto
+		/// @param source The image to composite
+		/// @param transform The transform of the source image (relative to the destination image)
+		static bool Composite(QImage& destination, const QImage& source, const QTransform& transform);
+
+		/// @brief Composite layers (in order) onto an image, by compositing all layers of each tile in parallel
+		///
+		/// The image is split into tiles (bands of rows), and each tile is composited by a single thread, from
+		/// the bottom layer to the top layer. Layers which are moved by whole pixels use the fast path, and any
+		/// other layer is drawn with a QPainter (clipped to the tile).
+		///
+		/// @param destination The image to composite onto
+		/// @param layers The layers to composite (from the bottom layer to the top layer)
+		/// @param tile_height The number of rows in each tile
+		static void CompositeLayers(QImage& destination, const std::vector<openshot::ImageLayer>& layers, int tile_height=64);
+
+		/// @brief Blend a row of premultiplied pixels onto another row (using the SourceOver composition mode)
+		/// @param destination The pixels to blend onto
+		/// @param source The pixels to blend (with their alpha in the highest 8 bits)
+		/// @param count The number of pixels
+		static void BlendRow(uint32_t* destination, const uint32_t* source, int count);
+	};
+
+}
+
+#endif
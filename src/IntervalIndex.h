@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @brief Header file for IntervalIndex class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_INTERVAL_INDEX_H
+#define OPENSHOT_INTERVAL_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace openshot {
+
+	/**
+	 * @brief This class finds the items (such as clips or effects) which overlap a range of frame numbers.
+	 *
+	 * Items are added with the range of frames they cover, and then Build() sorts them by their first
+	 * frame, and stores the last frame covered by each sub-tree of an implicit (balanced) binary search
+	 * tree. Each search skips the sub-trees which end before the requested range, so finding the k
+	 * overlapping items of n items costs O(log n + k) instead of O(n). Items are found in order of their
+	 * first frame (and items with the same first frame in the order they were added).
+	 *
+	 * The index is not updated in place. Add all items (again) and call Build() after they change.
+	 *
+	 * @code
+	 * openshot::IntervalIndex<openshot::Clip*> index;
+	 * index.Add(1, 100, &clip1);
+	 * index.Add(50, 150, &clip2);
+	 * index.Build();
+	 *
+	 * // Returns clip1 and clip2
+	 * std::vector<openshot::Clip*> clips = index.Find(75, 75);
+	 * @endcode
+	 */
+	template<typename T>
+	class IntervalIndex {
+	private:
+		/// An item, and the range of frames it covers
+		struct Interval {
+			int64_t start;
+			int64_t end;
+			T value;
+		};
+
+		std::vector<Interval> intervals; ///< All items (sorted by their first frame, once built)
+		std::vector<int64_t> max_ends; ///< The last frame covered by the sub-tree rooted at each item
+
+		/// Find the last frame covered by the items between lo and hi (exclusive)
+		int64_t build(size_t lo, size_t hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			int64_t max_end = intervals[mid].end;
+			if (lo < mid)
+				max_end = std::max(max_end, build(lo, mid));
+			if (mid + 1 < hi)
+				max_end = std::max(max_end, build(mid + 1, hi));
+			max_ends[mid] = max_end;
+			return max_end;
+		}
+
+		/// Find the items between lo and hi (exclusive) which overlap a range of frames
+		template<typename Callback>
+		void find(size_t lo, size_t hi, int64_t start, int64_t end, Callback& callback) const {
+			if (lo >= hi)
+				return;
+			size_t mid = lo + (hi - lo) / 2;
+
+			// Skip this sub-tree (if it ends before the range)
+			if (max_ends[mid] < start)
+				return;
+
+			find(lo, mid, start, end, callback);
+
+			// Items to the right start after this item (so skip them if this item starts after the range)
+			if (intervals[mid].start > end)
+				return;
+			if (intervals[mid].end >= start)
+				callback(intervals[mid].value);
+
+			find(mid + 1, hi, start, end, callback);
+		}
+
+	public:
+		/// @brief Add an item (which is not found until Build() is called)
+		/// @param start The first frame covered by the item
+		/// @param end The last frame covered by the item
+		/// @param value The item
+		void Add(int64_t start, int64_t end, T value) {
+			intervals.push_back({start, end, value});
+		}
+
+		/// Sort the added items, so they can be found
+		void Build() {
+			std::stable_sort(intervals.begin(), intervals.end(),
+				[](const Interval& a, const Interval& b) { return a.start < b.start; });
+			max_ends.assign(intervals.size(), 0);
+			if (!intervals.empty())
+				build(0, intervals.size());
+		}
+
+		/// Remove all items
+		void Clear() {
+			intervals.clear();
+			max_ends.clear();
+		}
+
+		/// Count the items in the index
+		size_t Count() const { return intervals.size(); }
+
+		/// @brief Call a function for each item which overlaps a range of frames (in order of their first frame)
+		/// @param start The first frame of the range
+		/// @param end The last frame of the range
+		/// @param callback The function to call (with each overlapping item)
+		template<typename Callback>
+		void Find(int64_t start, int64_t end, Callback callback) const {
+			if (max_ends.size() == intervals.size())
+				find(0, intervals.size(), start, end, callback);
+		}
+
+		/// @brief Find the items which overlap a range of frames (in order of their first frame)
+		/// @param start The first frame of the range
+		/// @param end The last frame of the range
+		std::vector<T> Find(int64_t start, int64_t end) const {
+			std::vector<T> values;
+			Find(start, end, [&values](const T& value) { values.push_back(value); });
+			return values;
+		}
+	};
+
+}
+
+#endif
@@ -106,8 +106,12 @@
 #include "AudioBufferSource.h"
 #include "AudioReaderSource.h"
 #include "AudioResampler.h"
+#include "BufferPool.h"
 #include "CacheDisk.h"
+#include "CacheEvictionPolicy.h"
 #include "CacheMemory.h"
+#include "CacheSharded.h"
+#include "CacheTiered.h"
 #include "ChunkReader.h"
 #include "ChunkWriter.h"
 #include "Clip.h"
@@ -126,6 +130,9 @@
 #include "Fraction.h"
 #include "Frame.h"
 #include "FrameMapper.h"
+#include "FramePipeline.h"
+#include "ImageCompositor.h"
+#include "IntervalIndex.h"
 #ifdef USE_IMAGEMAGICK
 	#include "ImageReader.h"
 	#include "ImageWriter.h"
@@ -138,6 +145,8 @@
 #include "QtHtmlReader.h"
 #include "QtImageReader.h"
 #include "QtTextReader.h"
+#include "RenderGraph.h"
+#include "SeekIndex.h"
 #include "TimelineBase.h"
 #include "Timeline.h"
 #include "Settings.h"
@@ -90,6 +90,13 @@ namespace openshot
                 increment = -1;
             }
 
+            // Keep the frames around the playhead (if the cache uses a playhead eviction policy)
+            if (reader->GetCache()) {
+                auto playhead_policy = std::dynamic_pointer_cast<PlayheadEvictionPolicy>(reader->GetCache()->GetEvictionPolicy());
+                if (playhead_policy)
+                    playhead_policy->SetPlayhead(current_display_frame, speed);
+            }
+
 			// Always cache frames from the current display position to our maximum (based on the cache size).
 			// Frames which are already cached are basically free. Only uncached frames have a big CPU cost.
 			// By always looping through the expected frame range, we can fill-in missing frames caused by a
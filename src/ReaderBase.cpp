@@ -250,3 +250,13 @@ openshot::ClipBase* ReaderBase::ParentClip() {
 void ReaderBase::ParentClip(openshot::ClipBase* new_clip) {
 	clip = new_clip;
 }
+
+// Get an openshot::Frame whose audio is needed, but whose image is not
+std::shared_ptr<openshot::Frame> ReaderBase::GetAudioFrame(int64_t number) {
+	return GetFrame(number);
+}
+
+// Get a range of frames, and deliver them to a callback (in order)
+void ReaderBase::GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback) {
+	FramePipeline(0, 1).Run(start, end, [this](int64_t number) { return GetFrame(number); }, callback);
+}
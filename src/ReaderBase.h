@@ -22,6 +22,7 @@
 
 #include "ChannelLayouts.h"
 #include "Fraction.h"
+#include "FramePipeline.h"
 #include "Json.h"
 
 namespace openshot
@@ -111,6 +112,26 @@ namespace openshot
 		/// @param[in] number The frame number that is requested.
 		virtual std::shared_ptr<openshot::Frame> GetFrame(int64_t number) = 0;
 
+		/// @brief Get an openshot::Frame whose audio is needed, but whose image is not (i.e. for waveforms or audio export)
+		///
+		/// Readers which can skip their image work (such as decoding, scaling, and compositing) override this, and
+		/// return a frame whose image may be blank. By default, the complete frame is requested with GetFrame().
+		///
+		/// @returns The requested frame (with its audio)
+		/// @param[in] number The frame number that is requested.
+		virtual std::shared_ptr<openshot::Frame> GetAudioFrame(int64_t number);
+
+		/// @brief Get a range of frames, and deliver them to a callback (in order)
+		///
+		/// Exporters and thumbnailers should use this method (instead of calling GetFrame for each frame),
+		/// since readers which can decode or render frames ahead override it, and deliver the range from
+		/// a pipeline of worker threads. By default, each frame is requested with GetFrame().
+		///
+		/// @param start The first frame number of the range
+		/// @param end The last frame number of the range
+		/// @param callback The function which receives each frame (return false to stop early)
+		virtual void GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback);
+
 		/// Determine if reader is open or closed
 		virtual bool IsOpen() = 0;
 
@@ -0,0 +1,155 @@
+/**
+ * @file
+ * @brief Source file for RenderGraph class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <omp.h>
+
+#include "ZmqLogger.h"
+
+using namespace openshot;
+
+// Default constructor
+RenderGraph::RenderGraph(int64_t frame_number) : frame_number(frame_number), duration(0.0) { }
+
+// Add a node to the graph
+size_t RenderGraph::AddNode(const std::string& name, std::function<void()> work, const std::vector<size_t>& dependencies)
+{
+	Node node;
+	node.name = name;
+	node.work = work;
+	node.start = 0.0;
+	node.duration = 0.0;
+	node.thread = 0;
+
+	// Only depend on nodes which are already added (so the graph has no cycles)
+	for (size_t dependency : dependencies)
+		if (dependency < nodes.size() && std::find(node.dependencies.begin(), node.dependencies.end(), dependency) == node.dependencies.end())
+			node.dependencies.push_back(dependency);
+
+	nodes.push_back(node);
+	return nodes.size() - 1;
+}
+
+// Run every node of the graph (each node after its dependencies), and wait for them to finish
+void RenderGraph::Run(int threads)
+{
+	using double_ms = std::chrono::duration<double, std::milli>;
+	const size_t node_count = nodes.size();
+	if (node_count == 0)
+		return;
+
+	// Count the unfinished dependencies of each node, and find the nodes waiting for each node
+	std::unique_ptr<std::atomic<int>[]> remaining(new std::atomic<int>[node_count]);
+	std::vector<std::vector<size_t>> dependents(node_count);
+	std::vector<size_t> ready;
+	for (size_t index = 0; index < node_count; index++) {
+		remaining[index] = nodes[index].dependencies.size();
+		for (size_t dependency : nodes[index].dependencies)
+			dependents[dependency].push_back(index);
+		if (nodes[index].dependencies.empty())
+			ready.push_back(index);
+	}
+
+	// The first exception thrown by a node (re-thrown after every node has run)
+	std::mutex error_mutex;
+	std::exception_ptr error;
+
+	// Run a node, then start the nodes which were only waiting for it (as new tasks)
+	const auto graph_start = std::chrono::steady_clock::now();
+	std::function<void(size_t)> run_node = [&](size_t index) {
+		Node& node = nodes[index];
+		const auto node_start = std::chrono::steady_clock::now();
+		node.thread = omp_get_thread_num();
+		try {
+			if (node.work)
+				node.work();
+		} catch (...) {
+			const std::lock_guard<std::mutex> lock(error_mutex);
+			if (!error)
+				error = std::current_exception();
+		}
+		const auto node_end = std::chrono::steady_clock::now();
+		node.start = double_ms(node_start - graph_start).count();
+		node.duration = double_ms(node_end - node_start).count();
+
+		// Release the work (and anything it captured)
+		node.work = nullptr;
+
+		for (size_t dependent : dependents[index]) {
+			if (--remaining[dependent] == 0) {
+				#pragma omp task firstprivate(dependent) shared(run_node)
+				run_node(dependent);
+			}
+		}
+	};
+
+	// A single thread starts the ready nodes, and the team runs the tasks (until every node has run). Inside
+	// another parallel region, the nodes run on this thread.
+	threads = std::max(1, threads);
+	#pragma omp parallel num_threads(threads) if (threads > 1 && !omp_in_parallel())
+	{
+		#pragma omp single
+		{
+			for (size_t index : ready) {
+				#pragma omp task firstprivate(index) shared(run_node)
+				run_node(index);
+			}
+		}
+	}
+	duration = double_ms(std::chrono::steady_clock::now() - graph_start).count();
+
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("RenderGraph::Run", "frame_number", frame_number, "nodes", node_count, "threads", threads, "duration", duration);
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+// Generate JSON string of this object
+std::string RenderGraph::Json() const {
+
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object
+Json::Value RenderGraph::JsonValue() const {
+
+	// Create root json object
+	Json::Value root;
+	root["frame_number"] = Json::Int64(frame_number);
+	root["duration"] = duration;
+	root["nodes"] = Json::Value(Json::arrayValue);
+	for (size_t index = 0; index < nodes.size(); index++) {
+		const Node& node = nodes[index];
+		Json::Value node_json;
+		node_json["id"] = Json::UInt64(index);
+		node_json["name"] = node.name;
+		node_json["dependencies"] = Json::Value(Json::arrayValue);
+		for (size_t dependency : node.dependencies)
+			node_json["dependencies"].append(Json::UInt64(dependency));
+		node_json["start"] = node.start;
+		node_json["duration"] = node.duration;
+		node_json["thread"] = node.thread;
+		root["nodes"].append(node_json);
+	}
+
+	// return JsonValue
+	return root;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @brief Header file for RenderGraph class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_RENDER_GRAPH_H
+#define OPENSHOT_RENDER_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Json.h"
+
+namespace openshot {
+
+	/**
+	 * @brief This class runs the steps of rendering a frame (such as getting each clip's frame, compositing,
+	 * and mixing audio) as a graph, so steps which do not depend on each other run in parallel.
+	 *
+	 * Each node of the graph is a step, which runs after the nodes it depends on. Run() starts every node
+	 * without dependencies as an OpenMP task, and each finished node starts the nodes which were waiting
+	 * for it, so the threads of the team take whichever steps are ready. The start time, duration, and
+	 * thread of each node are recorded, and the graph can be exported as JSON (for debugging slow frames).
+	 *
+	 * If a node throws an exception, the other nodes still run, and the first exception is re-thrown by
+	 * Run().
+	 *
+	 * @code
+	 * openshot::RenderGraph graph(frame_number);
+	 * size_t clip1 = graph.AddNode("clip 1", [&]() { frame1 = clip1.GetFrame(frame_number); });
+	 * size_t clip2 = graph.AddNode("clip 2", [&]() { frame2 = clip2.GetFrame(frame_number); });
+	 * graph.AddNode("composite", [&]() { ... }, {clip1, clip2});
+	 * graph.Run(8);
+	 *
+	 * // Print the timing of each step
+	 * std::cout << graph.Json();
+	 * @endcode
+	 */
+	class RenderGraph {
+	public:
+		/// A step of rendering a frame
+		struct Node {
+			std::string name; ///< The name of the step (i.e. "composite")
+			std::vector<size_t> dependencies; ///< The nodes which must finish before this node runs
+			std::function<void()> work; ///< The work of this step (released after it runs)
+			double start; ///< When this node started (in milliseconds since the graph started running)
+			double duration; ///< How long this node ran (in milliseconds)
+			int thread; ///< The OpenMP thread number which ran this node
+		};
+
+	private:
+		int64_t frame_number; ///< The frame number rendered by this graph
+		std::vector<Node> nodes; ///< The nodes (in the order they were added)
+		double duration; ///< How long the whole graph ran (in milliseconds)
+
+	public:
+		/// @brief Default constructor
+		/// @param frame_number The frame number rendered by this graph
+		RenderGraph(int64_t frame_number=0);
+
+		/// @brief Add a node to the graph
+		/// @returns The index of the new node (used as a dependency of later nodes)
+		/// @param name The name of the step (i.e. "composite")
+		/// @param work The work of this step
+		/// @param dependencies The nodes which must finish before this node runs (nodes which are not added yet are ignored, so the graph has no cycles)
+		size_t AddNode(const std::string& name, std::function<void()> work, const std::vector<size_t>& dependencies={});
+
+		/// @brief Run every node of the graph (each node after its dependencies), and wait for them to finish
+		/// @param threads The max number of threads which run nodes at once
+		void Run(int threads);
+
+		/// Get the nodes of the graph (with their timing, once the graph has run)
+		const std::vector<openshot::RenderGraph::Node>& Nodes() const { return nodes; }
+
+		/// Get the frame number rendered by this graph
+		int64_t FrameNumber() const { return frame_number; }
+
+		/// Get how long the whole graph ran (in milliseconds)
+		double Duration() const { return duration; }
+
+		// Get JSON methods
+		std::string Json() const; ///< Generate JSON string of this object
+		Json::Value JsonValue() const; ///< Generate Json::Value for this object
+	};
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @brief Source file for SeekIndex class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "SeekIndex.h"
+
+#include "Settings.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QSaveFile>
+#include <QString>
+
+#include <algorithm>
+
+using namespace openshot;
+
+namespace {
+	// An index file is a text file, which starts with a header line, followed by the size and modified time
+	// (in milliseconds) of the media file, and then one keyframe timestamp per line.
+	const char INDEX_FILE_HEADER[] = "OSSI 1";
+
+	// Get the size and modified time of a media file (as saved in an index file)
+	QByteArray MediaStamp(const std::string& media_path)
+	{
+		QFileInfo media_file(QString::fromStdString(media_path));
+		if (!media_file.exists())
+			return QByteArray();
+		return QByteArray::number(media_file.size()) + " " + QByteArray::number(media_file.lastModified().toMSecsSinceEpoch());
+	}
+}
+
+// Add a keyframe to the index
+void SeekIndex::Add(int64_t timestamp)
+{
+	// Keyframes are almost always added in order
+	if (keyframes.empty() || timestamp > keyframes.back()) {
+		keyframes.push_back(timestamp);
+		return;
+	}
+
+	auto position = std::lower_bound(keyframes.begin(), keyframes.end(), timestamp);
+	if (*position != timestamp)
+		keyframes.insert(position, timestamp);
+}
+
+// Find the last keyframe at (or before) a timestamp
+bool SeekIndex::Find(int64_t timestamp, int64_t& keyframe) const
+{
+	auto position = std::upper_bound(keyframes.begin(), keyframes.end(), timestamp);
+	if (position == keyframes.begin())
+		return false;
+
+	keyframe = *(position - 1);
+	return true;
+}
+
+// Load an index saved for a media file
+bool SeekIndex::Load(const std::string& index_path, const std::string& media_path)
+{
+	QFile index_file(QString::fromStdString(index_path));
+	if (index_path.empty() || !index_file.open(QIODevice::ReadOnly))
+		return false;
+
+	// Check the header, and the size and modified time of the media file
+	QList<QByteArray> lines = index_file.readAll().split('\n');
+	QByteArray media_stamp = MediaStamp(media_path);
+	if (lines.size() < 2 || lines[0].trimmed() != INDEX_FILE_HEADER || media_stamp.isEmpty() || lines[1].trimmed() != media_stamp)
+		return false;
+
+	std::vector<int64_t> loaded_keyframes;
+	for (int line = 2; line < lines.size(); line++) {
+		QByteArray value = lines[line].trimmed();
+		if (value.isEmpty())
+			continue;
+
+		bool ok = false;
+		int64_t timestamp = value.toLongLong(&ok);
+		if (!ok)
+			return false;
+		loaded_keyframes.push_back(timestamp);
+	}
+
+	// Sort the keyframes (in case the file was edited)
+	std::sort(loaded_keyframes.begin(), loaded_keyframes.end());
+	loaded_keyframes.erase(std::unique(loaded_keyframes.begin(), loaded_keyframes.end()), loaded_keyframes.end());
+	keyframes.swap(loaded_keyframes);
+	return true;
+}
+
+// Save this index for a media file
+bool SeekIndex::Save(const std::string& index_path, const std::string& media_path) const
+{
+	QByteArray media_stamp = MediaStamp(media_path);
+	if (index_path.empty() || media_stamp.isEmpty())
+		return false;
+
+	// Create the folder (if needed), and replace the index file at once (so a partial index is never loaded)
+	QFileInfo index_info(QString::fromStdString(index_path));
+	QDir().mkpath(index_info.absolutePath());
+	QSaveFile index_file(index_info.filePath());
+	if (!index_file.open(QIODevice::WriteOnly))
+		return false;
+
+	QByteArray contents;
+	contents.reserve(keyframes.size() * 12 + 64);
+	contents += INDEX_FILE_HEADER;
+	contents += "\n" + media_stamp + "\n";
+	for (int64_t timestamp : keyframes)
+		contents += QByteArray::number(qlonglong(timestamp)) + "\n";
+	index_file.write(contents);
+
+	return index_file.commit();
+}
+
+// Get the path of the index file for a media file
+std::string SeekIndex::IndexPath(const std::string& media_path)
+{
+	const std::string& folder = Settings::Instance()->PATH_SEEK_INDEX;
+	if (folder.empty())
+		return "";
+
+	// Name the index after a hash of the media file's full path
+	QByteArray absolute_path = QFileInfo(QString::fromStdString(media_path)).absoluteFilePath().toUtf8();
+	QString hash = QString::fromLatin1(QCryptographicHash::hash(absolute_path, QCryptographicHash::Md5).toHex());
+	return QDir(QString::fromStdString(folder)).filePath(hash + ".index").toStdString();
+}
@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @brief Header file for SeekIndex class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_SEEK_INDEX_H
+#define OPENSHOT_SEEK_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace openshot {
+
+	/**
+	 * @brief This class contains the keyframes (timestamps of the packets which can be decoded on their own) of a
+	 * video stream, so a reader can seek straight to the keyframe before any frame.
+	 *
+	 * Building the index means reading every packet of a file (without decoding them), so an index can be saved to
+	 * a file, and loaded the next time the same media file is opened. A saved index is only loaded if the size and
+	 * modified time of the media file still match.
+	 *
+	 * @code
+	 * openshot::SeekIndex index;
+	 * index.Add(0);
+	 * index.Add(250);
+	 *
+	 * int64_t keyframe = 0;
+	 * if (index.Find(300, keyframe))
+	 *     std::cout << keyframe; // 250
+	 * @endcode
+	 */
+	class SeekIndex {
+	private:
+		std::vector<int64_t> keyframes; ///< The timestamps of the keyframes (sorted, without duplicates)
+
+	public:
+		/// @brief Add a keyframe to the index
+		/// @param timestamp The timestamp of the keyframe (in the stream's time base)
+		void Add(int64_t timestamp);
+
+		/// Get the number of keyframes in the index
+		size_t Count() const { return keyframes.size(); }
+
+		/// @brief Find the last keyframe at (or before) a timestamp
+		/// @returns False if there is no keyframe at (or before) the timestamp
+		/// @param timestamp The timestamp to find (in the stream's time base)
+		/// @param keyframe Set to the timestamp of the keyframe (if found)
+		bool Find(int64_t timestamp, int64_t& keyframe) const;
+
+		/// @brief Load an index saved for a media file
+		/// @returns False (leaving this index unchanged) if the index file is missing or invalid, or the media file
+		/// has changed since the index was saved
+		/// @param index_path The path of the index file
+		/// @param media_path The path of the media file
+		bool Load(const std::string& index_path, const std::string& media_path);
+
+		/// @brief Save this index for a media file
+		/// @returns False if the index file could not be written
+		/// @param index_path The path of the index file
+		/// @param media_path The path of the media file (its size and modified time are saved with the index)
+		bool Save(const std::string& index_path, const std::string& media_path) const;
+
+		/// @brief Get the path of the index file for a media file, in Settings::PATH_SEEK_INDEX
+		/// @returns An empty string if Settings::PATH_SEEK_INDEX is not set
+		/// @param media_path The path of the media file
+		static std::string IndexPath(const std::string& media_path);
+	};
+
+}
+
+#endif
@@ -92,6 +92,10 @@ namespace openshot {
 		/// paths depend on the location of OpenShot transitions and files)
 		std::string PATH_OPENSHOT_INSTALL = "";
 
+		/// The folder where the seek indexes of video files are saved (so each file is only indexed once). If empty,
+		/// indexes are only kept in memory, and built again each time a file is opened.
+		std::string PATH_SEEK_INDEX = "";
+
  		/// Whether to dump ZeroMQ debug messages to stderr
 		bool DEBUG_TO_STDERR = false;
 
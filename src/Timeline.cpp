@@ -22,12 +22,19 @@
 #include <QDir>
 #include <QFileInfo>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
 using namespace openshot;
 
 // Default Constructor for the timeline (which sets the canvas width and height)
 Timeline::Timeline(int width, int height, Fraction fps, int sample_rate, int channels, ChannelLayout channel_layout) :
 		is_open(false), auto_map_clips(true), managed_cache(true), path(""),
-		max_concurrent_frames(OPEN_MP_NUM_PROCESSORS)
+		max_concurrent_frames(OPEN_MP_NUM_PROCESSORS), rendering_count(0),
+		index_changed(true), index_placement_version(0), static_frame_number(0), proxy_scale(1.0),
+		cache_key_changed(false)
 {
 	// Create CrashHandler and Attach (incase of errors)
 	CrashHandler::Instance();
@@ -78,7 +85,9 @@ Timeline::Timeline(const ReaderInfo info) : Timeline::Timeline(
 // Constructor for the timeline (which loads a JSON structure from a file path, and initializes a timeline)
 Timeline::Timeline(const std::string& projectPath, bool convert_absolute_paths) :
 		is_open(false), auto_map_clips(true), managed_cache(true), path(projectPath),
-		max_concurrent_frames(OPEN_MP_NUM_PROCESSORS) {
+		max_concurrent_frames(OPEN_MP_NUM_PROCESSORS), rendering_count(0),
+		index_changed(true), index_placement_version(0), static_frame_number(0), proxy_scale(1.0),
+		cache_key_changed(false) {
 
 	// Create CrashHandler and Attach (incase of errors)
 	CrashHandler::Instance();
@@ -207,6 +216,9 @@ Timeline::~Timeline() {
 	if (is_open)
 		// Auto Close if not already
 		Close();
+	else if (cache_key_changed)
+		// Key the persisted frames by the changed content
+		update_cache_key(true);
 
 	// Free all allocated frame mappers
 	std::set<FrameMapper *>::iterator it;
@@ -339,6 +351,10 @@ std::string Timeline::GetTrackedObjectValues(std::string id, int64_t frame_numbe
 // Add an openshot::Clip to the timeline
 void Timeline::AddClip(Clip* clip)
 {
+	// Get lock (prevent getting frames while this happens)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
 	// Assign timeline to clip
 	clip->ParentTimeline(this);
 
@@ -354,6 +370,7 @@ void Timeline::AddClip(Clip* clip)
 
 	// Add clip to list
 	clips.push_back(clip);
+	index_changed = true;
 
 	// Sort clips
 	sort_clips();
@@ -362,11 +379,16 @@ void Timeline::AddClip(Clip* clip)
 // Add an effect to the timeline
 void Timeline::AddEffect(EffectBase* effect)
 {
+	// Get lock (prevent getting frames while this happens)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
 	// Assign timeline to effect
 	effect->ParentTimeline(this);
 
 	// Add effect to list
 	effects.push_back(effect);
+	index_changed = true;
 
 	// Sort effects
 	sort_effects();
@@ -375,13 +397,24 @@ void Timeline::AddEffect(EffectBase* effect)
 // Remove an effect from the timeline
 void Timeline::RemoveEffect(EffectBase* effect)
 {
+	// Get lock (prevent getting frames while this happens)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
 	effects.remove(effect);
+	index_changed = true;
 }
 
 // Remove an openshot::Clip to the timeline
 void Timeline::RemoveClip(Clip* clip)
 {
+	// Get lock (prevent getting frames while this happens)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
 	clips.remove(clip);
+	open_clips.erase(clip);
+	index_changed = true;
 }
 
 // Look up a clip
@@ -469,6 +502,7 @@ void Timeline::apply_mapper_to_clip(Clip* clip)
 {
     // Get lock (prevent getting frames while this happens)
     const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+    wait_for_renders();
 
 	// Determine type of reader
 	ReaderBase* clip_reader = NULL;
@@ -498,6 +532,7 @@ void Timeline::ApplyMapperToClips()
 {
 	// Clear all cached frames
 	ClearAllCache();
+	index_changed = true;
 
 	// Loop through all clips
 	for (auto clip : clips)
@@ -524,32 +559,24 @@ std::shared_ptr<Frame> Timeline::apply_effects(std::shared_ptr<Frame> frame, int
 	ZmqLogger::Instance()->AppendDebugMethod("Timeline::apply_effects", "frame->number", frame->number, "timeline_frame_number", timeline_frame_number, "layer", layer);
 
 	// Find Effects at this position and layer
-	for (auto effect : effects)
-	{
-		// Does clip intersect the current requested time
-		long effect_start_position = round(effect->Position() * info.fps.ToDouble()) + 1;
-		long effect_end_position = round((effect->Position() + (effect->Duration())) * info.fps.ToDouble()) + 1;
+	std::shared_ptr<const TimelineIndex> effect_index = get_index();
+	auto layer_effects = effect_index->effects.find(layer);
+	if (layer_effects == effect_index->effects.end())
+		return frame;
 
-		bool does_effect_intersect = (effect_start_position <= timeline_frame_number && effect_end_position >= timeline_frame_number && effect->Layer() == layer);
+	// Effects are found in order of position (and effects at the same position in the order they were sorted)
+	layer_effects->second.Find(timeline_frame_number, timeline_frame_number, [&](EffectBase* effect) {
+		// Determine the frame needed for this effect (based on the position on the timeline)
+		long effect_start_position = round(effect->Position() * info.fps.ToDouble()) + 1;
+		long effect_start_frame = (effect->Start() * info.fps.ToDouble()) + 1;
+		long effect_frame_number = timeline_frame_number - effect_start_position + effect_start_frame;
 
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod("Timeline::apply_effects (Does effect intersect)", "effect->Position()", effect->Position(), "does_effect_intersect", does_effect_intersect, "timeline_frame_number", timeline_frame_number, "layer", layer);
-
-		// Clip is visible
-		if (does_effect_intersect)
-		{
-			// Determine the frame needed for this clip (based on the position on the timeline)
-            long effect_start_frame = (effect->Start() * info.fps.ToDouble()) + 1;
-			long effect_frame_number = timeline_frame_number - effect_start_position + effect_start_frame;
-
-			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("Timeline::apply_effects (Process Effect)", "effect_frame_number", effect_frame_number, "does_effect_intersect", does_effect_intersect);
-
-			// Apply the effect to this frame
-			frame = effect->GetFrame(frame, effect_frame_number);
-		}
+		ZmqLogger::Instance()->AppendDebugMethod("Timeline::apply_effects (Process Effect)", "effect->Position()", effect->Position(), "effect_frame_number", effect_frame_number, "timeline_frame_number", timeline_frame_number, "layer", layer);
 
-	} // end effect loop
+		// Apply the effect to this frame
+		frame = effect->GetFrame(frame, effect_frame_number);
+	}); // end effect loop
 
 	// Return modified frame
 	return frame;
@@ -586,29 +613,45 @@ std::shared_ptr<Frame> Timeline::GetOrCreateFrame(std::shared_ptr<Frame> backgro
 	return new_frame;
 }
 
-// Process a new layer of video or audio
-void Timeline::add_layer(std::shared_ptr<Frame> new_frame, Clip* source_clip, int64_t clip_frame_number, bool is_top_clip, float max_volume)
+// Get the frame of a new layer of video or audio
+std::shared_ptr<Frame> Timeline::get_layer(std::shared_ptr<Frame> new_frame, Clip* source_clip, int64_t clip_frame_number, bool is_top_clip, bool is_hidden, ImageLayer* image_layer)
 {
+	// Hidden clips (covered by opaque clips above them) are only needed for their audio
+	if (is_hidden && (!source_clip->Reader()->info.has_audio || source_clip->has_audio.GetInt(clip_frame_number) == 0 ||
+		(source_clip->volume.GetValue(clip_frame_number - 1) == 0.0 && source_clip->volume.GetValue(clip_frame_number) == 0.0))) {
+		// Debug output
+		ZmqLogger::Instance()->AppendDebugMethod("Timeline::get_layer (Skip hidden clip)", "new_frame->number", new_frame->number, "clip_frame_number", clip_frame_number);
+		return nullptr;
+	}
+
     // Create timeline options (with details about this current frame request)
     TimelineInfoStruct* options = new TimelineInfoStruct();
     options->is_top_clip = is_top_clip;
+    options->is_hidden = is_hidden;
+    options->layer = image_layer;
 
     // Get the clip's frame, composited on top of the current timeline frame
 	std::shared_ptr<Frame> source_frame;
 	source_frame = GetOrCreateFrame(new_frame, source_clip, clip_frame_number, options);
     delete options;
 
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("Timeline::get_layer", "new_frame->number", new_frame->number, "clip_frame_number", clip_frame_number);
+
+	return source_frame;
+}
+
+// Mix the audio of a new layer
+void Timeline::mix_layer(std::shared_ptr<Frame> new_frame, std::shared_ptr<Frame> source_frame, Clip* source_clip, int64_t clip_frame_number, float max_volume)
+{
 	// No frame found... so bail
 	if (!source_frame)
 		return;
 
-	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("Timeline::add_layer", "new_frame->number", new_frame->number, "clip_frame_number", clip_frame_number);
-
 	/* COPY AUDIO - with correct volume */
 	if (source_clip->Reader()->info.has_audio) {
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod("Timeline::add_layer (Copy Audio)", "source_clip->Reader()->info.has_audio", source_clip->Reader()->info.has_audio, "source_frame->GetAudioChannelsCount()", source_frame->GetAudioChannelsCount(), "info.channels", info.channels, "clip_frame_number", clip_frame_number);
+		ZmqLogger::Instance()->AppendDebugMethod("Timeline::mix_layer (Copy Audio)", "source_clip->Reader()->info.has_audio", source_clip->Reader()->info.has_audio, "source_frame->GetAudioChannelsCount()", source_frame->GetAudioChannelsCount(), "info.channels", info.channels, "clip_frame_number", clip_frame_number);
 
 		if (source_frame->GetAudioChannelsCount() == info.channels && source_clip->has_audio.GetInt(clip_frame_number) != 0)
 			for (int channel = 0; channel < source_frame->GetAudioChannelsCount(); channel++)
@@ -661,11 +704,11 @@ void Timeline::add_layer(std::shared_ptr<Frame> new_frame, Clip* source_clip, in
 			}
 		else
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("Timeline::add_layer (No Audio Copied - Wrong # of Channels)", "source_clip->Reader()->info.has_audio", source_clip->Reader()->info.has_audio, "source_frame->GetAudioChannelsCount()", source_frame->GetAudioChannelsCount(), "info.channels", info.channels, "clip_frame_number", clip_frame_number);
+			ZmqLogger::Instance()->AppendDebugMethod("Timeline::mix_layer (No Audio Copied - Wrong # of Channels)", "source_clip->Reader()->info.has_audio", source_clip->Reader()->info.has_audio, "source_frame->GetAudioChannelsCount()", source_frame->GetAudioChannelsCount(), "info.channels", info.channels, "clip_frame_number", clip_frame_number);
 	}
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("Timeline::add_layer (Transform: Composite Image Layer: Completed)", "source_frame->number", source_frame->number, "new_frame->GetImage()->width()", new_frame->GetImage()->width(), "new_frame->GetImage()->height()", new_frame->GetImage()->height());
+	ZmqLogger::Instance()->AppendDebugMethod("Timeline::mix_layer (Completed)", "source_frame->number", source_frame->number, "new_frame->GetAudioSamplesCount()", new_frame->GetAudioSamplesCount());
 }
 
 // Update the list of 'opened' clips
@@ -676,7 +719,15 @@ void Timeline::update_open_clips(Clip *clip, bool does_clip_intersect)
 	// is clip already in list?
 	bool clip_found = open_clips.count(clip);
 
+	// Clips used by other frames being rendered stay open (until they are no longer used)
+	bool clip_rendering = false;
 	if (clip_found && !does_clip_intersect)
+	{
+		const std::lock_guard<std::mutex> render_lock(render_mutex);
+		clip_rendering = rendering_clips.count(clip);
+	}
+
+	if (clip_found && !does_clip_intersect && !clip_rendering)
 	{
 		// Remove clip from 'opened' list, because it's closed now
 		open_clips.erase(clip);
@@ -702,6 +753,13 @@ void Timeline::update_open_clips(Clip *clip, bool does_clip_intersect)
 	ZmqLogger::Instance()->AppendDebugMethod("Timeline::update_open_clips (after)", "does_clip_intersect", does_clip_intersect, "clip_found", clip_found, "closing_clips.size()", closing_clips.size(), "open_clips.size()", open_clips.size());
 }
 
+// Wait for all frames being composited to finish
+void Timeline::wait_for_renders()
+{
+	std::unique_lock<std::mutex> render_lock(render_mutex);
+	render_condition.wait(render_lock, [this] { return rendering_count == 0; });
+}
+
 // Sort clips by position on the timeline
 void Timeline::sort_clips()
 {
@@ -724,6 +782,10 @@ void Timeline::Close()
 {
 	ZmqLogger::Instance()->AppendDebugMethod("Timeline::Close");
 
+	// Get lock (prevent getting frames while this happens)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
 	// Close all open clips
 	for (auto clip : clips)
 	{
@@ -734,8 +796,13 @@ void Timeline::Close()
 	// Mark timeline as closed
 	is_open = false;
 
-	// Clear cache
-	if (final_cache)
+	// Key the persisted frames by the content changed since it was keyed (if any)
+	if (cache_key_changed)
+		update_cache_key(true);
+
+	// Clear cache (unless its frames are persisted, to be reused the next time this content is opened)
+	CacheDisk* disk_cache = dynamic_cast<CacheDisk*>(final_cache);
+	if (final_cache && !(disk_cache && disk_cache->IsPersistent()))
 		final_cache->Clear();
 }
 
@@ -753,6 +820,18 @@ bool Timeline::isEqual(double a, double b)
 
 // Get an openshot::Frame object for a specific frame number of this reader.
 std::shared_ptr<Frame> Timeline::GetFrame(int64_t requested_frame)
+{
+	return render_frame(requested_frame, false);
+}
+
+// Get an openshot::Frame object (with only its audio) for a specific frame number of this reader.
+std::shared_ptr<Frame> Timeline::GetAudioFrame(int64_t requested_frame)
+{
+	return render_frame(requested_frame, true);
+}
+
+// Render a frame (or only mix its audio)
+std::shared_ptr<Frame> Timeline::render_frame(int64_t requested_frame, bool audio_only)
 {
 
 	// Adjust out of bounds frame number
@@ -761,7 +840,6 @@ std::shared_ptr<Frame> Timeline::GetFrame(int64_t requested_frame)
 
 	// Check cache
 	std::shared_ptr<Frame> frame;
-	std::lock_guard<std::mutex> guard(get_frame_mutex);
 	frame = final_cache->GetFrame(requested_frame);
 	if (frame) {
 		// Debug output
@@ -770,128 +848,292 @@ std::shared_ptr<Frame> Timeline::GetFrame(int64_t requested_frame)
 		// Return cached frame
 		return frame;
 	}
-	else
+
+	// Claim this frame number (or wait for the thread which is already rendering it). Different
+	// frame numbers are rendered concurrently, but each frame is only rendered once.
 	{
-		// Create a scoped lock, allowing only a single thread to run the following code at one time
-		const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+		std::unique_lock<std::mutex> render_lock(render_mutex);
+		render_condition.wait(render_lock, [&] { return rendering_frames.count(requested_frame) == 0; });
+		rendering_frames.insert(requested_frame);
+	}
 
-		// Check for open reader (or throw exception)
-		if (!is_open)
-			throw ReaderClosed("The Timeline is closed.  Call Open() before calling this method.");
+	// The layers of this frame (found while holding getFrameMutex, and composited after releasing it)
+	std::vector<TimelineLayer> layers;
+	std::shared_ptr<Frame> static_frame;
+	bool compositing = false;
+
+	// Release the claim on this frame number (and on the clips used by its layers)
+	auto finish_render = [&]() {
+		{
+			const std::lock_guard<std::mutex> render_lock(render_mutex);
+			rendering_frames.erase(requested_frame);
+			if (compositing) {
+				rendering_count--;
+				for (const auto& layer : layers)
+					if (--rendering_clips[layer.clip] == 0)
+						rendering_clips.erase(layer.clip);
+			}
+		}
+		render_condition.notify_all();
+	};
+
+	try {
+		{
+			// Create a scoped lock, allowing only a single thread to find the layers (and open or close clips) at one time
+			const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+
+			// Check for open reader (or throw exception)
+			if (!is_open)
+				throw ReaderClosed("The Timeline is closed.  Call Open() before calling this method.");
+
+			// Check cache again (due to locking)
+			frame = final_cache->GetFrame(requested_frame);
+			if (frame) {
+				// Debug output
+				ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Cached frame found on 2nd look)", "requested_frame", requested_frame);
+
+				// Return cached frame
+				finish_render();
+				return frame;
+			}
+
+			// Get a list of clips that intersect with the requested section of timeline
+			// This also opens the readers for intersecting clips, and marks non-intersecting clips as 'needs closing'
+			std::vector<Clip*> nearby_clips;
+			nearby_clips = find_intersecting_clips(requested_frame, 1, true);
 
-		// Check cache again (due to locking)
-		frame = final_cache->GetFrame(requested_frame);
-		if (frame) {
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Cached frame found on 2nd look)", "requested_frame", requested_frame);
+			ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Loop through clips)", "requested_frame", requested_frame, "clips.size()", clips.size(), "nearby_clips.size()", nearby_clips.size());
+
+			// Find the top clip on each layer (the clip which starts last, when clips overlap), and the total
+			// volume of all clips (once for all clips, instead of comparing every pair of clips)
+			std::map<int, long> top_clip_positions;
+			float max_volume = 0.0;
+			for (auto nearby_clip : nearby_clips)
+			{
+				long nearby_clip_start_position = round(nearby_clip->Position() * info.fps.ToDouble()) + 1;
+				long nearby_clip_end_position = round((nearby_clip->Position() + nearby_clip->Duration()) * info.fps.ToDouble()) + 1;
+				long nearby_clip_start_frame = (nearby_clip->Start() * info.fps.ToDouble()) + 1;
+				long nearby_clip_frame_number = requested_frame - nearby_clip_start_position + nearby_clip_start_frame;
+
+				if (nearby_clip_start_position > requested_frame || nearby_clip_end_position < requested_frame)
+					continue;
+
+				// Determine top clip position on this layer
+				auto top_clip_position = top_clip_positions.find(nearby_clip->Layer());
+				if (top_clip_position == top_clip_positions.end())
+					top_clip_positions[nearby_clip->Layer()] = nearby_clip_start_position;
+				else
+					top_clip_position->second = std::max(top_clip_position->second, nearby_clip_start_position);
+
+				// Determine max volume of overlapping clips
+				if (nearby_clip->Reader() && nearby_clip->Reader()->info.has_audio &&
+						nearby_clip->has_audio.GetInt(nearby_clip_frame_number) != 0) {
+						max_volume += nearby_clip->volume.GetValue(nearby_clip_frame_number);
+				}
+			}
+
+			// Find Clips near this time
+			for (auto clip : nearby_clips)
+			{
+				long clip_start_position = round(clip->Position() * info.fps.ToDouble()) + 1;
+				long clip_end_position = round((clip->Position() + clip->Duration()) * info.fps.ToDouble()) + 1;
+
+				bool does_clip_intersect = (clip_start_position <= requested_frame && clip_end_position >= requested_frame);
+
+				// Debug output
+				ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Does clip intersect)", "requested_frame", requested_frame, "clip->Position()", clip->Position(), "clip->Duration()", clip->Duration(), "does_clip_intersect", does_clip_intersect);
+
+				// Clip is visible
+				if (does_clip_intersect)
+				{
+					// Determine if clip is "top" clip on this layer (only happens when multiple clips are overlapping)
+					bool is_top_clip = (clip_start_position >= top_clip_positions[clip->Layer()]);
+
+					// Determine the frame needed for this clip (based on the position on the timeline)
+					long clip_start_frame = (clip->Start() * info.fps.ToDouble()) + 1;
+					long clip_frame_number = requested_frame - clip_start_position + clip_start_frame;
+
+					// Debug output
+					ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Calculate clip's frame #)", "clip->Position()", clip->Position(), "clip->Start()", clip->Start(), "info.fps.ToFloat()", info.fps.ToFloat(), "clip_frame_number", clip_frame_number);
 
-			// Return cached frame
-			return frame;
+					// Add clip's frame as layer (once the lock is released)
+					layers.push_back({clip, clip_frame_number, is_top_clip, max_volume, false});
+
+				} else {
+					// Debug output
+					ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (clip does not intersect)",
+															 "requested_frame", requested_frame, "does_clip_intersect",
+															 does_clip_intersect);
+				}
+
+			} // end clip loop
+
+			// Without an image, every layer is hidden (only its audio is needed)
+			if (audio_only) {
+				for (auto& layer : layers)
+					layer.is_hidden = true;
+			}
+
+			// Find the highest layer which covers the entire frame (the layers below it are hidden)
+			else if (!layers.empty()) {
+				std::shared_ptr<const TimelineIndex> effect_index = get_index();
+				for (size_t opaque_layer = layers.size(); opaque_layer-- > 0;) {
+					const TimelineLayer& layer = layers[opaque_layer];
+					if (!layer.clip->IsOpaque(layer.clip_frame_number, preview_width, preview_height))
+						continue;
+
+					// Timeline effects (applied to the top clip of a layer) can add transparency
+					auto layer_effects = effect_index->effects.find(layer.clip->Layer());
+					if (layer.is_top_clip && layer_effects != effect_index->effects.end() &&
+						!layer_effects->second.Find(requested_frame, requested_frame).empty())
+						continue;
+
+					// Debug output
+					ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Opaque layer found)", "requested_frame", requested_frame, "layer", layer.clip->Layer(), "hidden layers", opaque_layer);
+
+					for (size_t hidden_layer = 0; hidden_layer < opaque_layer; hidden_layer++)
+						layers[hidden_layer].is_hidden = true;
+					break;
+				}
+			}
+
+			// Reuse the image of a cached frame (if every visible layer is the same still image)
+			if (!audio_only)
+				static_frame = find_static_frame(requested_frame, layers);
+
+			// Keep these clips open (and the clips and effects unchanged) until this frame is composited
+			const std::lock_guard<std::mutex> render_lock(render_mutex);
+			rendering_count++;
+			for (const auto& layer : layers)
+				rendering_clips[layer.clip]++;
+			compositing = true;
 		}
 
-		// Minimum number of frames to process (for performance reasons)
-		int minimum_frames = OPEN_MP_NUM_PROCESSORS;
-
-		// Get a list of clips that intersect with the requested section of timeline
-		// This also opens the readers for intersecting clips, and marks non-intersecting clips as 'needs closing'
-		std::vector<Clip*> nearby_clips;
-		nearby_clips = find_intersecting_clips(requested_frame, 1, true);
-
-        // Debug output
-        ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (processing frame)", "requested_frame", requested_frame, "omp_get_thread_num()", omp_get_thread_num());
-
-        // Init some basic properties about this frame
-        int samples_in_frame = Frame::GetSamplesPerFrame(requested_frame, info.fps, info.sample_rate, info.channels);
-
-        // Create blank frame (which will become the requested frame)
-        std::shared_ptr<Frame> new_frame(std::make_shared<Frame>(requested_frame, preview_width, preview_height, "#000000", samples_in_frame, info.channels));
-        new_frame->AddAudioSilence(samples_in_frame);
-        new_frame->SampleRate(info.sample_rate);
-        new_frame->ChannelsLayout(info.channel_layout);
-
-        // Debug output
-        ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Adding solid color)", "requested_frame", requested_frame, "info.width", info.width, "info.height", info.height);
-
-        // Add Background Color to 1st layer (if animated or not black)
-        if ((color.red.GetCount() > 1 || color.green.GetCount() > 1 || color.blue.GetCount() > 1) ||
-            (color.red.GetValue(requested_frame) != 0.0 || color.green.GetValue(requested_frame) != 0.0 || color.blue.GetValue(requested_frame) != 0.0))
-        new_frame->AddColor(preview_width, preview_height, color.GetColorHex(requested_frame));
-
-        // Debug output
-        ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Loop through clips)", "requested_frame", requested_frame, "clips.size()", clips.size(), "nearby_clips.size()", nearby_clips.size());
-
-        // Find Clips near this time
-        for (auto clip : nearby_clips)
-        {
-            long clip_start_position = round(clip->Position() * info.fps.ToDouble()) + 1;
-            long clip_end_position = round((clip->Position() + clip->Duration()) * info.fps.ToDouble()) + 1;
-
-            bool does_clip_intersect = (clip_start_position <= requested_frame && clip_end_position >= requested_frame);
-
-            // Debug output
-            ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Does clip intersect)", "requested_frame", requested_frame, "clip->Position()", clip->Position(), "clip->Duration()", clip->Duration(), "does_clip_intersect", does_clip_intersect);
-
-            // Clip is visible
-            if (does_clip_intersect)
-            {
-                // Determine if clip is "top" clip on this layer (only happens when multiple clips are overlapping)
-                bool is_top_clip = true;
-                float max_volume = 0.0;
-                for (auto nearby_clip : nearby_clips)
-                {
-                    long nearby_clip_start_position = round(nearby_clip->Position() * info.fps.ToDouble()) + 1;
-                    long nearby_clip_end_position = round((nearby_clip->Position() + nearby_clip->Duration()) * info.fps.ToDouble()) + 1;
-                    long nearby_clip_start_frame = (nearby_clip->Start() * info.fps.ToDouble()) + 1;
-                    long nearby_clip_frame_number = requested_frame - nearby_clip_start_position + nearby_clip_start_frame;
-
-                    // Determine if top clip
-                    if (clip->Id() != nearby_clip->Id() && clip->Layer() == nearby_clip->Layer() &&
-                            nearby_clip_start_position <= requested_frame && nearby_clip_end_position >= requested_frame &&
-                            nearby_clip_start_position > clip_start_position && is_top_clip == true) {
-                        is_top_clip = false;
-                    }
-
-                    // Determine max volume of overlapping clips
-                    if (nearby_clip->Reader() && nearby_clip->Reader()->info.has_audio &&
-                            nearby_clip->has_audio.GetInt(nearby_clip_frame_number) != 0 &&
-                            nearby_clip_start_position <= requested_frame && nearby_clip_end_position >= requested_frame) {
-                            max_volume += nearby_clip->volume.GetValue(nearby_clip_frame_number);
-                    }
-                }
-
-                // Determine the frame needed for this clip (based on the position on the timeline)
-                long clip_start_frame = (clip->Start() * info.fps.ToDouble()) + 1;
-                long clip_frame_number = requested_frame - clip_start_position + clip_start_frame;
-
-                // Debug output
-                ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Calculate clip's frame #)", "clip->Position()", clip->Position(), "clip->Start()", clip->Start(), "info.fps.ToFloat()", info.fps.ToFloat(), "clip_frame_number", clip_frame_number);
-
-                // Add clip's frame as layer
-                add_layer(new_frame, clip, clip_frame_number, is_top_clip, max_volume);
-
-            } else {
-                // Debug output
-                ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (clip does not intersect)",
-                                                         "requested_frame", requested_frame, "does_clip_intersect",
-                                                         does_clip_intersect);
-            }
-
-        } // end clip loop
-
-        // Debug output
-        ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Add frame to cache)", "requested_frame", requested_frame, "info.width", info.width, "info.height", info.height);
-
-        // Set frame # on mapped frame
-        new_frame->SetFrameNumber(requested_frame);
-
-        // Add final frame to cache
-        final_cache->Add(new_frame);
-
-		// Return frame (or blank frame)
-		return new_frame;
+		// Debug output
+		ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (processing frame)", "requested_frame", requested_frame, "audio_only", audio_only, "omp_get_thread_num()", omp_get_thread_num());
+
+		// Init some basic properties about this frame
+		int samples_in_frame = Frame::GetSamplesPerFrame(requested_frame, info.fps, info.sample_rate, info.channels);
+
+		// Create blank frame (which will become the requested frame)
+		std::shared_ptr<Frame> new_frame(std::make_shared<Frame>(requested_frame, preview_width, preview_height, "#000000", samples_in_frame, info.channels));
+		new_frame->AddAudioSilence(samples_in_frame);
+		new_frame->SampleRate(info.sample_rate);
+		new_frame->ChannelsLayout(info.channel_layout);
+
+		// Clips only add their audio, if the image is not needed (or is reused)
+		bool needs_image = !audio_only && !static_frame;
+		if (needs_image) {
+			// Debug output
+			ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Adding solid color)", "requested_frame", requested_frame, "info.width", info.width, "info.height", info.height);
+
+			// Add Background Color to 1st layer (if animated or not black)
+			if ((color.red.GetCount() > 1 || color.green.GetCount() > 1 || color.blue.GetCount() > 1) ||
+				(color.red.GetValue(requested_frame) != 0.0 || color.green.GetValue(requested_frame) != 0.0 || color.blue.GetValue(requested_frame) != 0.0))
+			new_frame->AddColor(preview_width, preview_height, color.GetColorHex(requested_frame));
+
+			// Create the image before the clips (which use it as their background) run in parallel
+			new_frame->GetImage();
+		}
+
+		// Build the render graph of this frame: each layer's clip frame (decoded, mapped, with its effects and transform)
+		// is a separate branch, and then the images are composited while the audio is mixed
+		RenderGraph graph(requested_frame);
+		std::vector<ImageLayer> image_layers(layers.size());
+		std::vector<std::shared_ptr<Frame>> source_frames(layers.size());
+		std::vector<size_t> clip_nodes;
+		for (size_t index = 0; index < layers.size(); index++) {
+			bool is_hidden = layers[index].is_hidden || !needs_image;
+			clip_nodes.push_back(graph.AddNode("clip " + layers[index].clip->Id() + (is_hidden ? " (audio)" : ""), [&, index, is_hidden]() {
+				const TimelineLayer& layer = layers[index];
+				source_frames[index] = get_layer(new_frame, layer.clip, layer.clip_frame_number, layer.is_top_clip, is_hidden, is_hidden ? NULL : &image_layers[index]);
+			}));
+		}
+		if (needs_image) {
+			graph.AddNode("composite", [&]() {
+				// Composite all layers at once (in parallel tiles of the frame)
+				ImageCompositor::CompositeLayers(*new_frame->GetImage(), image_layers);
+			}, clip_nodes);
+		}
+		graph.AddNode("mix", [&]() {
+			// Mix the audio of each layer (in order)
+			for (size_t index = 0; index < layers.size(); index++)
+				mix_layer(new_frame, source_frames[index], layers[index].clip, layers[index].clip_frame_number, layers[index].max_volume);
+		}, clip_nodes);
+
+		// Run the graph (clips in parallel, if there is more than one, with this thread's share of the OpenMP threads)
+		graph.Run(clip_nodes.size() > 1 ? FramePipeline::OpenMPThreads() : 1);
+		{
+			const std::lock_guard<std::mutex> render_lock(render_mutex);
+			last_render_graph = std::make_shared<const RenderGraph>(graph);
+		}
+
+		// Set frame # on mapped frame
+		new_frame->SetFrameNumber(requested_frame);
+
+		if (audio_only) {
+			// This frame is not cached (the final cache only contains complete frames)
+			finish_render();
+			return new_frame;
+		}
+
+		if (static_frame) {
+			// Share the image of the static frame (QImage copies its pixels only if either image is changed)
+			ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Reuse static frame)", "requested_frame", requested_frame, "static_frame->number", static_frame->number);
+			new_frame->AddImage(std::make_shared<QImage>(*static_frame->GetImage()));
+		} else {
+			// Remember this frame, if other frames can reuse its image (every visible layer is a still image, without effects)
+			bool is_static = !has_timeline_effects(requested_frame);
+			for (const auto& layer : layers)
+				is_static = is_static && (layer.is_hidden || layer.clip->IsStatic(layer.clip_frame_number, layer.clip_frame_number));
+			if (is_static) {
+				const std::lock_guard<std::mutex> render_lock(render_mutex);
+				static_frame_number = requested_frame;
+				static_frame_layers = layers;
+			}
+		}
+
+		// Debug output
+		ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrame (Add frame to cache)", "requested_frame", requested_frame, "info.width", info.width, "info.height", info.height);
+
+		// Add final frame to cache
+		final_cache->Add(new_frame);
+		frame = new_frame;
+
+	} catch (...) {
+		finish_render();
+		throw;
 	}
+	finish_render();
+
+	// Return frame (or blank frame)
+	return frame;
 }
 
+// Get a range of frames, and deliver them to a callback (in order)
+void Timeline::GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback)
+{
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("Timeline::GetFrames", "start", start, "end", end, "max_concurrent_frames", max_concurrent_frames);
+
+	// Render many frames at once (GetFrame renders different frame numbers concurrently)
+	FramePipeline(max_concurrent_frames, max_concurrent_frames * 2).Run(start, end, [this](int64_t number) { return GetFrame(number); }, callback);
+}
+
+// Get the render graph of the last rendered frame (with the timing of each step), as JSON
+std::string Timeline::RenderGraphJSON() {
+	std::shared_ptr<const RenderGraph> graph;
+	{
+		const std::lock_guard<std::mutex> render_lock(render_mutex);
+		graph = last_render_graph;
+	}
+
+	// No frame was rendered yet
+	if (!graph)
+		return "{}";
+	return graph->Json();
+}
 
 // Find intersecting clips (or non intersecting clips)
 std::vector<Clip*> Timeline::find_intersecting_clips(int64_t requested_frame, int number_of_frames, bool include)
@@ -900,46 +1142,170 @@ std::vector<Clip*> Timeline::find_intersecting_clips(int64_t requested_frame, in
 	std::vector<Clip*> matching_clips;
 
 	// Calculate time of frame
-	float min_requested_frame = requested_frame;
-	float max_requested_frame = requested_frame + (number_of_frames - 1);
+	int64_t min_requested_frame = requested_frame;
+	int64_t max_requested_frame = requested_frame + (number_of_frames - 1);
+
+	// Find Clips at this time (on each layer, from the bottom layer to the top layer)
+	std::shared_ptr<const TimelineIndex> clip_index = get_index();
+	std::set<Clip*> intersecting_clips;
+	for (const auto& layer : clip_index->clips)
+		layer.second.Find(min_requested_frame, max_requested_frame, [&](Clip* clip) {
+			intersecting_clips.insert(clip);
+			if (include)
+				// Add the intersecting clip
+				matching_clips.push_back(clip);
+		});
 
-	// Re-Sort Clips (since they likely changed)
-	sort_clips();
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("Timeline::find_intersecting_clips", "requested_frame", requested_frame, "min_requested_frame", min_requested_frame, "max_requested_frame", max_requested_frame, "intersecting_clips.size()", intersecting_clips.size());
+
+	// Close the open clips which no longer intersect (only opened clips need to be checked)
+	std::vector<Clip*> opened_clips;
+	for (const auto& open_clip : open_clips)
+		opened_clips.push_back(open_clip.first);
+	for (auto clip : opened_clips)
+		if (!intersecting_clips.count(clip))
+			update_open_clips(clip, false);
+
+	// Open the intersecting clips
+	for (auto clip : intersecting_clips)
+		update_open_clips(clip, true);
+
+	if (!include)
+		// Add the non-intersecting clips
+		for (auto clip : clips)
+			if (!intersecting_clips.count(clip))
+				matching_clips.push_back(clip);
 
-	// Find Clips at this time
+	// return list
+	return matching_clips;
+}
+
+// Get the index of clips and effects (which is rebuilt if any clip or effect changed)
+std::shared_ptr<const Timeline::TimelineIndex> Timeline::get_index()
+{
+	const std::lock_guard<std::mutex> lock(index_mutex);
+
+	// Clips or effects are only re-indexed after they change
+	int64_t placement_version = PlacementVersion();
+	if (index && !index_changed && index_placement_version == placement_version)
+		return index;
+	index_changed = false;
+	index_placement_version = placement_version;
+
+	// Index each clip and effect by the range of timeline frames it covers
+	auto new_index = std::make_shared<TimelineIndex>();
+	double fps = info.fps.ToDouble();
 	for (auto clip : clips)
 	{
-		// Does clip intersect the current requested time
-		long clip_start_position = round(clip->Position() * info.fps.ToDouble()) + 1;
-		long clip_end_position = round((clip->Position() + clip->Duration()) * info.fps.ToDouble()) + 1;
+		long clip_start_position = round(clip->Position() * fps) + 1;
+		long clip_end_position = round((clip->Position() + clip->Duration()) * fps) + 1;
+		new_index->clips[clip->Layer()].Add(clip_start_position, clip_end_position, clip);
+	}
+	// Effects at the same position are applied in order (which can change without re-sorting the effects)
+	std::vector<EffectBase*> sorted_effects(effects.begin(), effects.end());
+	std::stable_sort(sorted_effects.begin(), sorted_effects.end(), CompareEffects());
+	for (auto effect : sorted_effects)
+	{
+		long effect_start_position = round(effect->Position() * fps) + 1;
+		long effect_end_position = round((effect->Position() + effect->Duration()) * fps) + 1;
+		new_index->effects[effect->Layer()].Add(effect_start_position, effect_end_position, effect);
+	}
+	for (auto& layer : new_index->clips)
+		layer.second.Build();
+	for (auto& layer : new_index->effects)
+		layer.second.Build();
 
-		bool does_clip_intersect =
-                (clip_start_position <= min_requested_frame || clip_start_position <= max_requested_frame) &&
-                (clip_end_position >= min_requested_frame || clip_end_position >= max_requested_frame);
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("Timeline::get_index (Rebuilt index)", "clips.size()", clips.size(), "effects.size()", effects.size());
 
-		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod("Timeline::find_intersecting_clips (Is clip near or intersecting)", "requested_frame", requested_frame, "min_requested_frame", min_requested_frame, "max_requested_frame", max_requested_frame, "clip->Position()", clip->Position(), "does_clip_intersect", does_clip_intersect);
+	index = new_index;
+	return index;
+}
 
-		// Open (or schedule for closing) this clip, based on if it's intersecting or not
-		update_open_clips(clip, does_clip_intersect);
+// Find a cached frame with the same image as a frame (when every visible layer of both frames is static)
+std::shared_ptr<Frame> Timeline::find_static_frame(int64_t requested_frame, const std::vector<TimelineLayer>& layers)
+{
+	// Get the last static frame (and its layers)
+	int64_t number = 0;
+	std::vector<TimelineLayer> static_layers;
+	{
+		const std::lock_guard<std::mutex> render_lock(render_mutex);
+		number = static_frame_number;
+		static_layers = static_frame_layers;
+	}
+	if (number == 0 || number == requested_frame || layers.empty() || layers.size() != static_layers.size())
+		return nullptr;
 
-		// Clip is visible
-		if (does_clip_intersect && include)
-			// Add the intersecting clip
-			matching_clips.push_back(clip);
+	// The same clips must be visible (and hidden), and each visible clip must have the same image and transform
+	for (size_t index = 0; index < layers.size(); index++) {
+		const TimelineLayer& layer = layers[index];
+		const TimelineLayer& static_layer = static_layers[index];
+		if (layer.clip != static_layer.clip || layer.is_top_clip != static_layer.is_top_clip || layer.is_hidden != static_layer.is_hidden)
+			return nullptr;
+		if (!layer.is_hidden && !layer.clip->IsStatic(layer.clip_frame_number, static_layer.clip_frame_number))
+			return nullptr;
+	}
 
-		else if (!does_clip_intersect && !include)
-			// Add the non-intersecting clip
-			matching_clips.push_back(clip);
+	// The background color must match (and no timeline effects can change either frame)
+	if (color.GetColorHex(requested_frame) != color.GetColorHex(number) ||
+		has_timeline_effects(requested_frame) || has_timeline_effects(number))
+		return nullptr;
 
-	} // end clip loop
+	// Frames are removed from the cache when a clip or effect changes them (so a cached frame is never stale), but
+	// the preview size can change without clearing the cache
+	std::shared_ptr<Frame> static_frame = final_cache->GetFrame(number);
+	if (!static_frame || static_frame->GetWidth() != preview_width || static_frame->GetHeight() != preview_height)
+		return nullptr;
+	return static_frame;
+}
 
-	// return list
-	return matching_clips;
+// Determine if any timeline effect is applied to a frame
+bool Timeline::has_timeline_effects(int64_t requested_frame)
+{
+	std::shared_ptr<const TimelineIndex> effect_index = get_index();
+	for (const auto& layer_effects : effect_index->effects)
+		if (!layer_effects.second.Find(requested_frame, requested_frame).empty())
+			return true;
+	return false;
+}
+
+// Key a persistent CacheDisk (if that is the final cache) by the current content of this timeline
+void Timeline::update_cache_key(bool keep_frames) {
+	cache_key_changed = false;
+	CacheDisk* disk_cache = dynamic_cast<CacheDisk*>(final_cache);
+	if (disk_cache && disk_cache->IsPersistent())
+		disk_cache->SetContentKey(CacheKey(), keep_frames);
+}
+
+// Mark the key of a persistent CacheDisk (if that is the final cache) as changed
+void Timeline::change_cache_key() {
+	CacheDisk* disk_cache = dynamic_cast<CacheDisk*>(final_cache);
+	if (cache_key_changed || !disk_cache || !disk_cache->IsPersistent())
+		return;
+
+	disk_cache->ContentChanged();
+	cache_key_changed = true;
+}
+
+// Get the key of the rendered content
+std::string Timeline::CacheKey() const {
+	// Frames rendered at another preview size (or proxy scale) are different content
+	std::stringstream key;
+	key << Json() << "preview " << preview_width << "x" << preview_height << " proxy " << ProxyScale();
+	return key.str();
 }
 
 // Set the cache object used by this reader
 void Timeline::SetCache(CacheBase* new_cache) {
+	// Get lock (prevent getting frames while this happens)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
+	// Key the persisted frames of the previous cache by the changed content (if any)
+	if (cache_key_changed)
+		update_cache_key(true);
+
 	// Destroy previous cache (if managed by timeline)
 	if (managed_cache && final_cache) {
 		delete final_cache;
@@ -997,6 +1363,7 @@ void Timeline::SetJson(const std::string value) {
 
 	// Get lock (prevent getting frames while this happens)
 	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
 
 	// Parse JSON string into JSON objects
 	try
@@ -1015,6 +1382,10 @@ void Timeline::SetJson(const std::string value) {
 // Load Json::Value into this object
 void Timeline::SetJsonValue(const Json::Value root) {
 
+	// Get lock (prevent getting frames while this happens)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
 	// Close timeline before we do anything (this also removes all open and closing clips)
 	bool was_open = is_open;
 	Close();
@@ -1029,6 +1400,7 @@ void Timeline::SetJsonValue(const Json::Value root) {
 	if (!root["clips"].isNull()) {
 		// Clear existing clips
 		clips.clear();
+		index_changed = true;
 
 		// loop through clips
 		for (const Json::Value existing_clip : root["clips"]) {
@@ -1053,6 +1425,7 @@ void Timeline::SetJsonValue(const Json::Value root) {
 	if (!root["effects"].isNull()) {
 		// Clear existing effects
 		effects.clear();
+		index_changed = true;
 
 		// loop through effects
 		for (const Json::Value existing_effect :root["effects"]) {
@@ -1079,13 +1452,17 @@ void Timeline::SetJsonValue(const Json::Value root) {
 		info.video_length = info.fps.ToFloat() * info.duration;
 	}
 
-	// Update preview settings
+	// Update preview settings (and turn proxy mode off)
 	preview_width = info.width;
 	preview_height = info.height;
+	proxy_scale = 1.0;
 
 	// Re-open if needed
 	if (was_open)
 		Open();
+
+	// Use the persisted frames of this content (if any)
+	update_cache_key(false);
 }
 
 // Apply a special formatted JSON object, which represents a change to the timeline (insert, update, delete)
@@ -1093,6 +1470,7 @@ void Timeline::ApplyJsonDiff(std::string value) {
 
     // Get lock (prevent getting frames while this happens)
     const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+    wait_for_renders();
 
 	// Parse JSON string into JSON objects
 	try
@@ -1116,6 +1494,9 @@ void Timeline::ApplyJsonDiff(std::string value) {
 				apply_json_to_timeline(change);
 
 		}
+
+		// The frames still in the cache are valid for the changed content (which is keyed later)
+		change_cache_key();
 	}
 	catch (const std::exception& e)
 	{
@@ -1173,13 +1554,22 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 				for (auto e : effect_list)
 				{
 					if (e->Id() == effect_id) {
+						// Find the frames of the clip affected by this change (effects use the clip's frame numbers)
+						int64_t changed_start = std::numeric_limits<int64_t>::max();
+						int64_t changed_end = std::numeric_limits<int64_t>::min();
+						if (change_type != "update" || !find_changed_frames(e->JsonValue(), change["value"], changed_start, changed_end)) {
+							changed_start = std::numeric_limits<int64_t>::min();
+							changed_end = std::numeric_limits<int64_t>::max();
+						}
+
 						// Apply the change to the effect directly
-						apply_json_to_effects(change, e);
+						if (change_type == "update")
+							e->SetJsonValue(change["value"]);
+						else
+							apply_json_to_effects(change, e);
 
-						// Calculate start and end frames that this impacts, and remove those frames from the cache
-                        int64_t new_starting_frame = (existing_clip->Position() * info.fps.ToDouble()) + 1;
-                        int64_t new_ending_frame = ((existing_clip->Position() + existing_clip->Duration()) * info.fps.ToDouble()) + 1;
-                        final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
+						// Remove those frames from the cache
+						remove_changed_frames(existing_clip, changed_start, changed_end);
 
 						return; // effect found, don't update clip
 					}
@@ -1188,16 +1578,23 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 		}
 	}
 
-	// Calculate start and end frames that this impacts, and remove those frames from the cache
+	// Calculate start and end frames that the new value impacts
+	bool has_new_range = false;
+	int64_t new_starting_frame = 0;
+	int64_t new_ending_frame = 0;
 	if (!change["value"].isArray() && !change["value"]["position"].isNull()) {
-		int64_t new_starting_frame = (change["value"]["position"].asDouble() * info.fps.ToDouble()) + 1;
-		int64_t new_ending_frame = ((change["value"]["position"].asDouble() + change["value"]["end"].asDouble() - change["value"]["start"].asDouble()) * info.fps.ToDouble()) + 1;
-		final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
+		has_new_range = true;
+		new_starting_frame = (change["value"]["position"].asDouble() * info.fps.ToDouble()) + 1;
+		new_ending_frame = ((change["value"]["position"].asDouble() + change["value"]["end"].asDouble() - change["value"]["start"].asDouble()) * info.fps.ToDouble()) + 1;
 	}
 
 	// Determine type of change operation
 	if (change_type == "insert") {
 
+		// Remove the frames covered by the new clip from the cache
+		if (has_new_range)
+			final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
+
 		// Create new clip
 		Clip *clip = new Clip();
 		clip->SetJsonValue(change["value"]); // Set properties of new clip from JSON
@@ -1211,17 +1608,44 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 		// Update existing clip
 		if (existing_clip) {
 
-			// Calculate start and end frames that this impacts, and remove those frames from the cache
-			int64_t old_starting_frame = (existing_clip->Position() * info.fps.ToDouble()) + 1;
-			int64_t old_ending_frame = ((existing_clip->Position() + existing_clip->Duration()) * info.fps.ToDouble()) + 1;
-			final_cache->Remove(old_starting_frame - 8, old_ending_frame + 8);
+			// Compare against the clip's own reader (and not the FrameMapper which wraps it)
+			Json::Value old_value = existing_clip->JsonValue();
+			if (existing_clip->Reader() && existing_clip->Reader()->Name() == "FrameMapper") {
+				FrameMapper* mapper = (FrameMapper*) existing_clip->Reader();
+				if (mapper->Reader())
+					old_value["reader"] = mapper->Reader()->JsonValue();
+			}
+
+			int64_t changed_start = std::numeric_limits<int64_t>::max();
+			int64_t changed_end = std::numeric_limits<int64_t>::min();
+			if (find_changed_frames(old_value, change["value"], changed_start, changed_end)) {
+				// Only keyframes changed, so only remove the frames where their values changed (or all the clip's
+				// frames, if it gets a time curve, which maps its keyframes to other timeline frames)
+				const Json::Value& new_value = change["value"];
+				if (new_value["time"]["Points"].size() > 1) {
+					changed_start = std::numeric_limits<int64_t>::min();
+					changed_end = std::numeric_limits<int64_t>::max();
+				}
+				remove_changed_frames(existing_clip, changed_start, changed_end);
 
-            // Remove cache on clip's Reader (if found)
-            if (existing_clip->Reader() && existing_clip->Reader()->GetCache())
-                existing_clip->Reader()->GetCache()->Remove(old_starting_frame - 8, old_ending_frame + 8);
+			} else {
+				// Calculate start and end frames that this impacts, and remove those frames from the cache
+				int64_t old_starting_frame = (existing_clip->Position() * info.fps.ToDouble()) + 1;
+				int64_t old_ending_frame = ((existing_clip->Position() + existing_clip->Duration()) * info.fps.ToDouble()) + 1;
+				final_cache->Remove(old_starting_frame - 8, old_ending_frame + 8);
+				if (has_new_range)
+					final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
+
+				// Remove cache on clip's Reader (if found), which uses the clip's frame numbers
+				int64_t clip_starting_frame = (existing_clip->Start() * info.fps.ToDouble()) + 1;
+				int64_t clip_ending_frame = (existing_clip->End() * info.fps.ToDouble()) + 1;
+				if (existing_clip->Reader() && existing_clip->Reader()->GetCache())
+					existing_clip->Reader()->GetCache()->Remove(clip_starting_frame - 8, clip_ending_frame + 8);
+			}
 
 			// Update clip properties from JSON
 			existing_clip->SetJsonValue(change["value"]);
+			sort_clips();
 
 			// Apply framemapper (or update existing framemapper)
 			apply_mapper_to_clip(existing_clip);
@@ -1287,16 +1711,23 @@ void Timeline::apply_json_to_effects(Json::Value change, EffectBase* existing_ef
 	// Get key and type of change
 	std::string change_type = change["type"].asString();
 
-	// Calculate start and end frames that this impacts, and remove those frames from the cache
+	// Calculate start and end frames that the new value impacts
+	bool has_new_range = false;
+	int64_t new_starting_frame = 0;
+	int64_t new_ending_frame = 0;
 	if (!change["value"].isArray() && !change["value"]["position"].isNull()) {
-		int64_t new_starting_frame = (change["value"]["position"].asDouble() * info.fps.ToDouble()) + 1;
-		int64_t new_ending_frame = ((change["value"]["position"].asDouble() + change["value"]["end"].asDouble() - change["value"]["start"].asDouble()) * info.fps.ToDouble()) + 1;
-		final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
+		has_new_range = true;
+		new_starting_frame = (change["value"]["position"].asDouble() * info.fps.ToDouble()) + 1;
+		new_ending_frame = ((change["value"]["position"].asDouble() + change["value"]["end"].asDouble() - change["value"]["start"].asDouble()) * info.fps.ToDouble()) + 1;
 	}
 
 	// Determine type of change operation
 	if (change_type == "insert") {
 
+		// Remove the frames covered by the new effect from the cache
+		if (has_new_range)
+			final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
+
 		// Determine type of effect
 		std::string effect_type = change["value"]["type"].asString();
 
@@ -1318,13 +1749,24 @@ void Timeline::apply_json_to_effects(Json::Value change, EffectBase* existing_ef
 		// Update existing effect
 		if (existing_effect) {
 
-			// Calculate start and end frames that this impacts, and remove those frames from the cache
-			int64_t old_starting_frame = (existing_effect->Position() * info.fps.ToDouble()) + 1;
-			int64_t old_ending_frame = ((existing_effect->Position() + existing_effect->Duration()) * info.fps.ToDouble()) + 1;
-			final_cache->Remove(old_starting_frame - 8, old_ending_frame + 8);
+			int64_t changed_start = std::numeric_limits<int64_t>::max();
+			int64_t changed_end = std::numeric_limits<int64_t>::min();
+			if (find_changed_frames(existing_effect->JsonValue(), change["value"], changed_start, changed_end)) {
+				// Only keyframes changed, so only remove the frames where their values changed
+				remove_changed_frames(existing_effect, changed_start, changed_end);
+
+			} else {
+				// Calculate start and end frames that this impacts, and remove those frames from the cache
+				int64_t old_starting_frame = (existing_effect->Position() * info.fps.ToDouble()) + 1;
+				int64_t old_ending_frame = ((existing_effect->Position() + existing_effect->Duration()) * info.fps.ToDouble()) + 1;
+				final_cache->Remove(old_starting_frame - 8, old_ending_frame + 8);
+				if (has_new_range)
+					final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
+			}
 
 			// Update effect properties from JSON
 			existing_effect->SetJsonValue(change["value"]);
+			sort_effects();
 		}
 
 	} else if (change_type == "delete") {
@@ -1354,8 +1796,29 @@ void Timeline::apply_json_to_timeline(Json::Value change) {
 	if (change["key"].size() >= 2)
 		sub_key = change["key"][(uint)1].asString();
 
-	// Clear entire cache
-	ClearAllCache();
+	// Remove the frames affected by this change from the cache
+	if (root_key == "color" || root_key == "viewport_scale" || root_key == "viewport_x" || root_key == "viewport_y") {
+		// Keyframes only affect the frames where their values change (and never the clips' caches)
+		Json::Value old_properties;
+		Json::Value new_properties;
+		old_properties["color"] = color.JsonValue();
+		old_properties["viewport_scale"] = viewport_scale.JsonValue();
+		old_properties["viewport_x"] = viewport_x.JsonValue();
+		old_properties["viewport_y"] = viewport_y.JsonValue();
+		new_properties[root_key] = change["value"];
+
+		int64_t changed_start = std::numeric_limits<int64_t>::max();
+		int64_t changed_end = std::numeric_limits<int64_t>::min();
+		if (change_type == "update" && sub_key == "" && find_changed_frames(old_properties, new_properties, changed_start, changed_end))
+			remove_changed_frames(changed_start, changed_end);
+		else
+			final_cache->Clear();
+
+	} else if (root_key != "duration") {
+		// Clear entire cache (the duration does not change any frames, but everything else does)
+		ClearAllCache();
+		index_changed = true;
+	}
 
 	// Determine type of change operation
 	if (change_type == "insert" || change_type == "update") {
@@ -1467,15 +1930,120 @@ void Timeline::apply_json_to_timeline(Json::Value change) {
 
 }
 
+// Find the range of frames affected by a change to the JSON properties of an object
+bool Timeline::find_changed_frames(const Json::Value& old_value, const Json::Value& new_value, int64_t& start_frame, int64_t& end_frame) {
+
+	if (!old_value.isObject() || !new_value.isObject())
+		return false;
+
+	for (const auto& key : new_value.getMemberNames()) {
+		// Ignore unchanged values, and keys which are not properties of this object
+		if (!old_value.isMember(key) || old_value[key] == new_value[key])
+			continue;
+
+		const Json::Value& old_property = old_value[key];
+		const Json::Value& new_property = new_value[key];
+		if (old_property.isObject() && old_property.isMember("Points") && new_property.isObject()) {
+			// Compare normalized keyframes (so equivalent points are not treated as changes)
+			Keyframe old_keyframe;
+			Keyframe new_keyframe;
+			old_keyframe.SetJsonValue(old_property);
+			new_keyframe.SetJsonValue(new_property);
+			const Json::Value old_points = old_keyframe.JsonValue()["Points"];
+			const Json::Value new_points = new_keyframe.JsonValue()["Points"];
+			int old_count = old_points.size();
+			int new_count = new_points.size();
+
+			// Count the identical points at the start and end of both keyframes
+			int first = 0;
+			while (first < old_count && first < new_count && old_points[first] == new_points[first])
+				first++;
+			int last = 0;
+			while (last < old_count - first && last < new_count - first &&
+				   old_points[old_count - 1 - last] == new_points[new_count - 1 - last])
+				last++;
+			if (first == old_count && first == new_count)
+				continue;
+
+			// Values only change between the nearest identical points (and values before the first
+			// point, or after the last point, are held constant)
+			if (first > 0)
+				start_frame = std::min(start_frame, (int64_t) floor(old_points[first - 1]["co"]["X"].asDouble()));
+			else
+				start_frame = std::numeric_limits<int64_t>::min();
+			if (last > 0)
+				end_frame = std::max(end_frame, (int64_t) ceil(old_points[old_count - last]["co"]["X"].asDouble()));
+			else
+				end_frame = std::numeric_limits<int64_t>::max();
+
+		} else if (old_property.isObject() && new_property.isObject()) {
+			// Nested objects, such as a Color (which is made of keyframes)
+			if (!find_changed_frames(old_property, new_property, start_frame, end_frame))
+				return false;
+
+		} else {
+			// Any other property may affect every frame
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Remove a range of timeline frames (and a few frames of padding) from the final cache
+void Timeline::remove_changed_frames(int64_t start_frame, int64_t end_frame) {
+
+	if (start_frame > end_frame)
+		return;
+
+	start_frame = std::max(start_frame, (int64_t) 1);
+	if (end_frame < std::numeric_limits<int64_t>::max() - 8)
+		end_frame += 8;
+	final_cache->Remove(start_frame - 8, end_frame);
+}
+
+// Remove a range of a clip's or effect's frames (in the object's own frame numbers) from the final cache
+void Timeline::remove_changed_frames(ClipBase* object, int64_t start_frame, int64_t end_frame) {
+
+	if (start_frame > end_frame)
+		return;
+
+	// The keyframes of a clip (and its effects) are evaluated at the clip's time-mapped frame numbers, which do
+	// not map linearly to timeline frames with a time curve (such as a speed change, reverse or freeze)
+	Clip* clip = dynamic_cast<Clip*>(object);
+	if (clip && clip->time.GetLength() > 1) {
+		start_frame = std::numeric_limits<int64_t>::min();
+		end_frame = std::numeric_limits<int64_t>::max();
+	}
+
+	int64_t object_start_position = round(object->Position() * info.fps.ToDouble()) + 1;
+	int64_t object_end_position = round((object->Position() + object->Duration()) * info.fps.ToDouble()) + 1;
+	int64_t object_start_frame = (object->Start() * info.fps.ToDouble()) + 1;
+	int64_t object_end_frame = object_start_frame + (object_end_position - object_start_position);
+
+	// Limit the range to the object's frames, and convert to timeline frame numbers
+	start_frame = std::max(start_frame, object_start_frame) - object_start_frame + object_start_position;
+	end_frame = std::min(end_frame, object_end_frame) - object_start_frame + object_start_position;
+	remove_changed_frames(start_frame, end_frame);
+}
+
 // Clear all caches
 void Timeline::ClearAllCache() {
 
     // Get lock (prevent getting frames while this happens)
     const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+    wait_for_renders();
 
     // Clear primary cache
     final_cache->Clear();
 
+    // Clear the caches of all clips
+    clear_reader_caches();
+}
+
+// Clear the caches of all clips (and their nested readers)
+void Timeline::clear_reader_caches() {
+
     // Loop through all clips
     for (auto clip : clips)
     {
@@ -1494,6 +2062,16 @@ void Timeline::ClearAllCache() {
 // Set Max Image Size (used for performance optimization). Convenience function for setting
 // Settings::Instance()->MAX_WIDTH and Settings::Instance()->MAX_HEIGHT.
 void Timeline::SetMaxSize(int width, int height) {
+	// Get lock (prevent getting frames while this happens), and finish the frames being rendered at the current size
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
+	// A preview size (which is not a proxy scale) turns proxy mode off
+	set_preview_size(width, height, 1.0);
+}
+
+// Set the preview size (and proxy scale), which the frames being rendered must not be using
+void Timeline::set_preview_size(int width, int height, double scale) {
 	// Maintain aspect ratio regardless of what size is passed in
 	QSize display_ratio_size = QSize(info.width, info.height);
 	QSize proposed_size = QSize(std::min(width, info.width), std::min(height, info.height));
@@ -1501,7 +2079,47 @@ void Timeline::SetMaxSize(int width, int height) {
 	// Scale QSize up to proposed size
 	display_ratio_size.scale(proposed_size, Qt::KeepAspectRatio);
 
+	if (display_ratio_size.width() == preview_width && display_ratio_size.height() == preview_height && scale == proxy_scale)
+		return;
+
+	// Key the persisted frames by the content changed since it was keyed (at the previous size)
+	if (cache_key_changed)
+		update_cache_key(true);
+
 	// Update preview settings
 	preview_width = display_ratio_size.width();
 	preview_height = display_ratio_size.height();
+	proxy_scale = scale;
+
+	// Use the persisted frames of the new size (if any), and keep the frames of the previous size
+	update_cache_key(false);
+}
+
+// Render a proxy (smaller) version of each frame, for a faster preview
+void Timeline::SetProxyScale(double scale) {
+	// Get lock (prevent getting frames while this happens), and finish the frames being rendered at the current size
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_renders();
+
+	// Limit the scale (to at least 1 pixel, and no larger than the timeline)
+	scale = std::min(std::max(scale, 0.0), 1.0);
+	set_preview_size(std::max(1, int(round(info.width * scale))), std::max(1, int(round(info.height * scale))), scale);
+
+	// Debug output
+	ZmqLogger::Instance()->AppendDebugMethod("Timeline::SetProxyScale", "scale", scale, "preview_width", preview_width, "preview_height", preview_height);
+
+	// Cached frames (in the timeline and its readers) were rendered at the previous size. A persistent cache
+	// keeps them under the key of the previous size (and already uses the frames of the new size).
+	CacheDisk* disk_cache = dynamic_cast<CacheDisk*>(final_cache);
+	if (disk_cache && disk_cache->IsPersistent())
+		clear_reader_caches();
+	else
+		ClearAllCache();
+}
+
+// Get the size of each rendered frame, relative to the timeline's size
+double Timeline::ProxyScale() const {
+	if (proxy_scale >= 1.0 || info.width <= 0)
+		return 1.0;
+	return preview_width / double(info.width);
 }
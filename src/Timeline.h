@@ -13,10 +13,14 @@
 #ifndef OPENSHOT_TIMELINE_H
 #define OPENSHOT_TIMELINE_H
 
+#include <atomic>
+#include <condition_variable>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <vector>
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
 #include <QtCore/QRegularExpression>
@@ -29,7 +33,10 @@
 #include "EffectBase.h"
 #include "Fraction.h"
 #include "Frame.h"
+#include "ImageCompositor.h"
+#include "IntervalIndex.h"
 #include "KeyFrame.h"
+#include "RenderGraph.h"
 #ifdef USE_OPENCV
 #include "TrackedObjectBBox.h"
 #endif
@@ -159,13 +166,44 @@ namespace openshot {
 		std::set<openshot::FrameMapper*> allocated_frame_mappers; ///< all the frame mappers we allocated and must free
 		bool managed_cache; ///< Does this timeline instance manage the cache object
 		std::string path; ///< Optional path of loaded UTF-8 OpenShot JSON project file
-		std::mutex get_frame_mutex; ///< Mutex to protect GetFrame method from different threads calling it
+		std::mutex render_mutex; ///< Mutex to protect the frames and clips being rendered (outside of getFrameMutex)
+		std::condition_variable render_condition; ///< Notified each time a frame finishes rendering
+		std::set<int64_t> rendering_frames; ///< Frame numbers being rendered (so each frame is only rendered once)
+		std::map<openshot::Clip*, int> rendering_clips; ///< Clips used by the frames being rendered (which must stay open)
+		int rendering_count; ///< Number of frames being composited (outside of getFrameMutex)
 		int max_concurrent_frames; ///< Max concurrent frames to process at one time
 
 		std::map<std::string, std::shared_ptr<openshot::TrackedObjectBase>> tracked_objects; ///< map of TrackedObjectBBoxes and their IDs
 
-		/// Process a new layer of video or audio
-		void add_layer(std::shared_ptr<openshot::Frame> new_frame, openshot::Clip* source_clip, int64_t clip_frame_number, bool is_top_clip, float max_volume);
+		/// Index of the clips and effects on each layer, by the range of timeline frames they cover
+		struct TimelineIndex {
+			std::map<int, openshot::IntervalIndex<openshot::Clip*>> clips; ///< Clips on each layer
+			std::map<int, openshot::IntervalIndex<openshot::EffectBase*>> effects; ///< Effects on each layer
+		};
+		std::shared_ptr<const TimelineIndex> index; ///< Index of clips and effects (rebuilt after they change)
+		std::mutex index_mutex; ///< Mutex to protect the index
+		std::atomic<bool> index_changed; ///< Have clips or effects been added or removed since the index was built
+		int64_t index_placement_version; ///< PlacementVersion() when the index was built
+
+		/// A clip's frame to composite (or mix) on a timeline frame
+		struct TimelineLayer {
+			openshot::Clip* clip; ///< The clip
+			int64_t clip_frame_number; ///< The frame number of the clip
+			bool is_top_clip; ///< Is this the top clip on its layer (which timeline effects are applied to)
+			float max_volume; ///< The total volume of all clips on this timeline frame
+			bool is_hidden; ///< Is the clip hidden by an opaque clip above it (only its audio is needed)
+		};
+		std::shared_ptr<const openshot::RenderGraph> last_render_graph; ///< The render graph of the last rendered frame (protected by render_mutex)
+		int64_t static_frame_number; ///< The last rendered frame whose image could be reused by other frames (or 0)
+		std::vector<TimelineLayer> static_frame_layers; ///< The layers of static_frame_number (protected by render_mutex)
+		double proxy_scale; ///< The scale set by SetProxyScale (1.0 when proxy mode is off)
+		bool cache_key_changed; ///< The JSON changed since a persistent final cache was keyed (it is keyed again on Close)
+
+		/// Get the frame of a new layer of video or audio (hidden layers are only needed for their audio), returning its image to composite
+		std::shared_ptr<openshot::Frame> get_layer(std::shared_ptr<openshot::Frame> new_frame, openshot::Clip* source_clip, int64_t clip_frame_number, bool is_top_clip, bool is_hidden, openshot::ImageLayer* image_layer);
+
+		/// Mix the audio of a new layer (from the frame returned by get_layer) into the timeline frame
+		void mix_layer(std::shared_ptr<openshot::Frame> new_frame, std::shared_ptr<openshot::Frame> source_frame, openshot::Clip* source_clip, int64_t clip_frame_number, float max_volume);
 
 		/// Apply a FrameMapper to a clip which matches the settings of this timeline
 		void apply_mapper_to_clip(openshot::Clip* clip);
@@ -179,6 +217,38 @@ namespace openshot {
 		/// Calculate time of a frame number, based on a framerate
 		double calculate_time(int64_t number, openshot::Fraction rate);
 
+		/// Find the range of frames affected by a change to the JSON properties of an object (such as a Clip)
+		///
+		/// Keyframes only affect the frames between the nearest unchanged points around each changed point.
+		/// The range is widened to include those frames (in the object's own frame numbers).
+		///
+		/// @returns False if a property other than a Keyframe changed (so every frame of the object is affected)
+		/// @param old_value The current JSON properties of the object
+		/// @param new_value The new JSON properties of the object (keys which are not properties of the object are ignored)
+		/// @param start_frame The first affected frame (widened by this method)
+		/// @param end_frame The last affected frame (widened by this method)
+		bool find_changed_frames(const Json::Value& old_value, const Json::Value& new_value, int64_t& start_frame, int64_t& end_frame);
+
+		/// Remove a range of timeline frames (and a few frames of padding) from the final cache
+		void remove_changed_frames(int64_t start_frame, int64_t end_frame);
+
+		/// Remove a range of a clip's or effect's frames (in the object's own frame numbers) from the final cache
+		void remove_changed_frames(openshot::ClipBase* object, int64_t start_frame, int64_t end_frame);
+
+		/// Key a persistent CacheDisk (if that is the final cache) by the current CacheKey() of this timeline
+		/// @param keep_frames Keep the cached frames (since they are still valid for the new JSON)
+		void update_cache_key(bool keep_frames);
+
+		/// Set the preview size and proxy scale (the caller must hold getFrameMutex, with no frames being rendered)
+		void set_preview_size(int width, int height, double scale);
+
+		/// Clear the caches of all clips (and their nested readers)
+		void clear_reader_caches();
+
+		/// Mark the key of a persistent CacheDisk (if that is the final cache) as changed by a JSON diff. The cache
+		/// is keyed again once (when the timeline is closed, or its cache or size changes), instead of after each diff.
+		void change_cache_key();
+
 		/// Find intersecting (or non-intersecting) openshot::Clip objects
 		///
 		/// @returns A list of openshot::Clip objects
@@ -187,6 +257,22 @@ namespace openshot {
 		/// @param include Include or Exclude intersecting clips
 		std::vector<openshot::Clip*> find_intersecting_clips(int64_t requested_frame, int number_of_frames, bool include);
 
+		/// Get the index of clips and effects (which is rebuilt if any clip or effect changed)
+		std::shared_ptr<const TimelineIndex> get_index();
+
+		/// Find a cached frame with the same image as a frame (when every visible layer of both frames is static)
+		///
+		/// @returns The cached frame (or NULL if no cached frame has the same image)
+		/// @param requested_frame The frame number that is requested.
+		/// @param layers The layers of the requested frame
+		std::shared_ptr<openshot::Frame> find_static_frame(int64_t requested_frame, const std::vector<TimelineLayer>& layers);
+
+		/// Determine if any timeline effect is applied to a frame
+		bool has_timeline_effects(int64_t requested_frame);
+
+		/// Render a frame (or only mix the audio of its clips, if audio_only is true)
+		std::shared_ptr<openshot::Frame> render_frame(int64_t requested_frame, bool audio_only);
+
 		/// Get a clip's frame or generate a blank frame
 		std::shared_ptr<openshot::Frame> GetOrCreateFrame(std::shared_ptr<Frame> background_frame, openshot::Clip* clip, int64_t number, openshot::TimelineInfoStruct* options);
 
@@ -202,6 +288,9 @@ namespace openshot {
 		/// Update the list of 'opened' clips
 		void update_open_clips(openshot::Clip *clip, bool does_clip_intersect);
 
+		/// Wait for all frames being composited to finish (the caller must hold getFrameMutex, so no new frames start)
+		void wait_for_renders();
+
 	public:
 
 		/// @brief Constructor for the timeline (which configures the default frame properties)
@@ -293,14 +382,52 @@ namespace openshot {
 
 		/// Set the cache object used by this reader. You must now manage the lifecycle
 		/// of this cache object though (Timeline will not delete it for you).
+		///
+		/// If the cache is a CacheDisk which is persisted (see CacheDisk::SetContentKey), the timeline keys it by
+		/// CacheKey() whenever its JSON or preview size is set, and after JSON diffs (once the timeline is closed).
 		void SetCache(openshot::CacheBase* new_cache);
 
+		/// Get the key of the rendered content (the JSON, preview size, and proxy scale of this timeline), which
+		/// a persistent CacheDisk is keyed by
+		std::string CacheKey() const;
+
 		/// Get an openshot::Frame object for a specific frame number of this timeline.
 		///
+		/// This method can be called by many threads at once, and different frame numbers are rendered
+		/// concurrently. Changes to the clips and effects (AddClip, ApplyJsonDiff, etc...) wait for the
+		/// frames being rendered to finish.
+		///
 		/// @returns The requested frame (containing the image)
 		/// @param requested_frame The frame number that is requested.
 		std::shared_ptr<openshot::Frame> GetFrame(int64_t requested_frame) override;
 
+		/// @brief Get an openshot::Frame object for a specific frame number of this timeline, with only its audio
+		///
+		/// The audio of each clip is mixed (like GetFrame), but no images are decoded, scaled, or composited, and
+		/// video-only clips are skipped. The frame is not cached, and a cached (complete) frame is returned if found.
+		///
+		/// @returns The requested frame (with its audio, but without an image)
+		/// @param requested_frame The frame number that is requested.
+		std::shared_ptr<openshot::Frame> GetAudioFrame(int64_t requested_frame) override;
+
+		/// @brief Get a range of frames, and deliver them to a callback (in order)
+		///
+		/// Worker threads render the frames of the range concurrently (ahead of the frame being delivered),
+		/// and the frames are delivered in order on the calling thread.
+		///
+		/// @param start The first frame number of the range
+		/// @param end The last frame number of the range
+		/// @param callback The function which receives each frame (return false to stop early)
+		void GetFrames(int64_t start, int64_t end, openshot::FrameCallback callback) override;
+
+		/// @brief Get the render graph of the last rendered frame, as JSON (for debugging)
+		///
+		/// Each frame is rendered as a graph of steps: the frame of each clip (decoded, mapped, with its
+		/// effects and transform) is a separate branch (which run in parallel), and then the images are
+		/// composited while the audio is mixed. The JSON contains each step (node), the steps it waited
+		/// for, when it started, how long it took (in milliseconds), and which thread ran it.
+		std::string RenderGraphJSON();
+
 		// Curves for the viewport
 		openshot::Keyframe viewport_scale; ///<Curve representing the scale of the viewport (0 to 100)
 		openshot::Keyframe viewport_x; ///<Curve representing the x coordinate for the viewport
@@ -322,9 +449,24 @@ namespace openshot {
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
 		/// Set Max Image Size (used for performance optimization). Convenience function for setting
-		/// Settings::Instance()->MAX_WIDTH and Settings::Instance()->MAX_HEIGHT.
+		/// Settings::Instance()->MAX_WIDTH and Settings::Instance()->MAX_HEIGHT. This turns proxy mode off
+		/// (see SetProxyScale), and waits for the frames being rendered at the previous size.
 		void SetMaxSize(int width, int height);
 
+		/// @brief Render a proxy (smaller) version of each frame, for a faster preview
+		///
+		/// The preview size is set to the timeline's size multiplied by the scale, so every reader decodes its
+		/// images at the proxy size (instead of scaling full size images down later), every effect runs on the smaller
+		/// images (with its pixel measurements, such as a blur radius, scaled to match), and the layers are composited
+		/// at the proxy size. All cached frames are cleared (since they were rendered at the previous size).
+		/// @param scale The size of each frame, relative to the timeline's size (from 0.0 to 1.0, i.e. 0.5 is half size)
+		void SetProxyScale(double scale);
+
+		/// Get the size of each rendered frame, relative to the timeline's size (i.e. 0.5 is half size), which
+		/// is exactly 1.0 when proxy mode is off (even if a smaller preview size was set with SetMaxSize, which
+		/// also turns proxy mode off)
+		double ProxyScale() const;
+
 		/// @brief Apply a special formatted JSON object, which represents a change to the timeline (add, update, delete)
 		/// This is primarily designed to keep the timeline (and its child objects... such as clips and effects) in sync
 		/// with another application... such as OpenShot Video Editor (http://www.openshot.org).
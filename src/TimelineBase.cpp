@@ -16,6 +16,7 @@ using namespace openshot;
 
 /// Constructor for the base timeline
 TimelineBase::TimelineBase()
-    : preview_width(1920),
+    : placement_version(0),
+      preview_width(1920),
       preview_height(1080) { }
 
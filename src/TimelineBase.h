@@ -13,6 +13,7 @@
 #ifndef OPENSHOT_TIMELINE_BASE_H
 #define OPENSHOT_TIMELINE_BASE_H
 
+#include <atomic>
 #include <cstdint>
 #include <list>
 
@@ -20,6 +21,7 @@
 namespace openshot {
     // Forward decl
     class Clip;
+    struct ImageLayer;
 
     /**
      * @brief This struct contains info about the current Timeline clip instance
@@ -32,12 +34,16 @@ namespace openshot {
     struct TimelineInfoStruct
     {
         bool is_top_clip;                 ///< Is clip on top (if overlapping another clip)
+        bool is_hidden;                   ///< Is clip hidden by opaque clips above it (only its audio is needed)
+        openshot::ImageLayer* layer;      ///< If set, the clip's image is returned here (and composited later), instead of onto the background frame
     };
 
 	/**
 	 * @brief This class represents a timeline (used for building generic timeline implementations)
 	 */
 	class TimelineBase {
+	private:
+		std::atomic<int64_t> placement_version; ///< Changes each time a clip or effect of this timeline is moved, trimmed, or changes layers
 
 	public:
 		int preview_width; ///< Optional preview width of timeline image. If your preview window is smaller than the timeline, it's recommended to set this.
@@ -51,6 +57,12 @@ namespace openshot {
 		/// the TimelineBase class
 		virtual std::list<openshot::Clip*> Clips() = 0;
 
+		/// Mark the position, layer, or length of a clip or effect of this timeline as changed (so the timeline updates its index of clips)
+		void PlacementChanged() { placement_version++; }
+
+		/// Get a number which changes each time a clip or effect of this timeline is moved, trimmed, or changes layers
+		int64_t PlacementVersion() const { return placement_version; }
+
 		virtual ~TimelineBase() = default;
 	};
 }
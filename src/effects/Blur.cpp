@@ -11,6 +11,11 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "Blur.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BufferPool.h"
 #include "Exceptions.h"
 
 using namespace openshot;
@@ -51,18 +56,25 @@ std::shared_ptr<openshot::Frame> Blur::GetFrame(std::shared_ptr<openshot::Frame>
 	// Get the frame's image
 	std::shared_ptr<QImage> frame_image = frame->GetImage();
 
-	// Get the current blur radius
-	int horizontal_radius_value = horizontal_radius.GetValue(frame_number);
-	int vertical_radius_value = vertical_radius.GetValue(frame_number);
+	// Get the current blur radius (scaled down in a proxy preview, without scaling a blur away)
+	double resolution_scale = ResolutionScale();
+	double horizontal_radius_full = horizontal_radius.GetValue(frame_number);
+	double vertical_radius_full = vertical_radius.GetValue(frame_number);
+	int horizontal_radius_value = round(horizontal_radius_full * resolution_scale);
+	int vertical_radius_value = round(vertical_radius_full * resolution_scale);
+	if (round(horizontal_radius_full) > 0)
+		horizontal_radius_value = std::max(1, horizontal_radius_value);
+	if (round(vertical_radius_full) > 0)
+		vertical_radius_value = std::max(1, vertical_radius_value);
 	float sigma_value = sigma.GetValue(frame_number);
 	int iteration_value = iterations.GetInt(frame_number);
 
 	int w = frame_image->width();
 	int h = frame_image->height();
 
-	// Grab two copies of the image pixel data
-	QImage image_copy = frame_image->copy();
-	std::shared_ptr<QImage> frame_image_2 = std::make_shared<QImage>(image_copy);
+	// Get a second image to blur into (every pass overwrites all of its pixels, so the pixels
+	// are not copied), from the buffer pool
+	std::shared_ptr<QImage> frame_image_2 = BufferPool::Instance()->CreateImage(w, h, frame_image->format());
 
 	// Loop through each iteration
 	for (int iteration = 0; iteration < iteration_value; ++iteration)
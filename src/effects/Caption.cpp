@@ -65,17 +65,21 @@ void Caption::init_effect_details()
 
 // Set the caption string to use (see VTT format)
 std::string Caption::CaptionText() {
+	const std::lock_guard<std::mutex> lock(caption_mutex);
 	return caption_text;
 }
 
 // Get the caption string
 void Caption::CaptionText(std::string new_caption_text) {
+	const std::lock_guard<std::mutex> lock(caption_mutex);
 	caption_text = new_caption_text;
 	is_dirty = true;
 }
 
 // Process regex string only when dirty
-void Caption::process_regex() {
+std::vector<QRegularExpressionMatch> Caption::process_regex() {
+	const std::lock_guard<std::mutex> lock(caption_mutex);
+
 	if (is_dirty) {
 		is_dirty = false;
 
@@ -99,6 +103,9 @@ void Caption::process_regex() {
 			}
 		}
 	}
+
+	// Return a copy (the matches are implicitly shared, so this is cheap)
+	return matchedCaptions;
 }
 
 // This method is required for all derived classes of EffectBase, and returns a
@@ -106,7 +113,7 @@ void Caption::process_regex() {
 std::shared_ptr<openshot::Frame> Caption::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
 	// Process regex (if needed)
-	process_regex();
+	std::vector<QRegularExpressionMatch> captions = process_regex();
 
 	// Get the Clip and Timeline pointers (if available)
 	Clip* clip = (Clip*) ParentClip();
@@ -195,7 +202,7 @@ std::shared_ptr<openshot::Frame> Caption::GetFrame(std::shared_ptr<openshot::Fra
 	painter.setBrush(brush);
 
 	// Loop through matches and find text to display (if any)
-	for (auto match = matchedCaptions.begin(); match != matchedCaptions.end(); match++) {
+	for (auto match = captions.begin(); match != captions.end(); match++) {
 
 		// Build timestamp (00:00:04.000 --> 00:00:06.500)
 		int64_t start_frame = ((match->captured(1).toFloat() * 60.0 * 60.0 ) + (match->captured(2).toFloat() * 60.0 ) +
@@ -365,12 +372,13 @@ void Caption::SetJsonValue(const Json::Value root) {
 		top.SetJsonValue(root["top"]);
 	if (!root["right"].isNull())
 		right.SetJsonValue(root["right"]);
-	if (!root["caption_text"].isNull())
-		caption_text = root["caption_text"].asString();
 	if (!root["caption_font"].isNull())
 		font_name = root["caption_font"].asString();
 
 	// Mark effect as dirty to reparse Regex
+	const std::lock_guard<std::mutex> lock(caption_mutex);
+	if (!root["caption_text"].isNull())
+		caption_text = root["caption_text"].asString();
 	is_dirty = true;
 }
 
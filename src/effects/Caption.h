@@ -14,6 +14,7 @@
 #define OPENSHOT_CAPTION_EFFECT_H
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <QFont>
@@ -43,12 +44,13 @@ private:
 	QFontMetrics* metrics;       ///< Font metrics object
 	QFont* font; 			     ///< QFont object
 	bool is_dirty;
+	std::mutex caption_mutex;    ///< Protects the caption text and matches (frames are rendered concurrently)
 
 	/// Init effect settings
 	void init_effect_details();
 
-	/// Process regex capture
-	void process_regex();
+	/// Process regex capture (if needed), and get the matched captions
+	std::vector<QRegularExpressionMatch> process_regex();
 
 
 public:
@@ -70,7 +70,9 @@ std::shared_ptr<openshot::Frame> Mask::GetFrame(std::shared_ptr<openshot::Frame>
 	if (!reader)
 		return frame;
 
-	// Get mask image (if missing or different size than frame image)
+	// Get mask image (if missing or different size than frame image). Frames can be rendered
+	// by many threads, so each one keeps its own reference to the mask it uses.
+	std::shared_ptr<QImage> mask_image;
 	#pragma omp critical (open_mask_reader)
 	{
 		if (!original_mask || !reader->info.has_single_image || needs_refresh ||
@@ -86,20 +88,21 @@ std::shared_ptr<openshot::Frame> Mask::GetFrame(std::shared_ptr<openshot::Frame>
 					frame_image->width(), frame_image->height(),
 					Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
 		}
-	}
+		mask_image = original_mask;
 
-	// Refresh no longer needed
-	needs_refresh = false;
+		// Refresh no longer needed
+		needs_refresh = false;
+	}
 
 	// Get pixel arrays
 	unsigned char *pixels = (unsigned char *) frame_image->bits();
-	unsigned char *mask_pixels = (unsigned char *) original_mask->bits();
+	unsigned char *mask_pixels = (unsigned char *) mask_image->bits();
 
 	double contrast_value = (contrast.GetValue(frame_number));
 	double brightness_value = (brightness.GetValue(frame_number));
 
 	// Loop through mask pixels, and apply average gray value to frame alpha channel
-	for (int pixel = 0, byte_index=0; pixel < original_mask->width() * original_mask->height(); pixel++, byte_index+=4)
+	for (int pixel = 0, byte_index=0; pixel < mask_image->width() * mask_image->height(); pixel++, byte_index+=4)
 	{
 		// Get the RGB values from the pixel
 		int R = mask_pixels[byte_index];
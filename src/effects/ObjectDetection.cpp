@@ -77,6 +77,9 @@ std::shared_ptr<Frame> ObjectDetection::GetFrame(std::shared_ptr<Frame> frame, i
         return frame;
     }
 
+    // Prevent the detections from being reloaded while they are used
+    std::shared_lock<std::shared_timed_mutex> lock(data_mutex);
+
     // Initialize the Qt rectangle that will hold the positions of the bounding-box
 	std::vector<QRectF> boxRects;
 	// Initialize the image of the TrackedObject child clip
@@ -87,7 +90,7 @@ std::shared_ptr<Frame> ObjectDetection::GetFrame(std::shared_ptr<Frame> frame, i
         float fw = cv_image.size().width;
         float fh = cv_image.size().height;
 
-        DetectionData detections = detectionsData[frame_number];
+        const DetectionData& detections = detectionsData.at(frame_number);
         for(int i = 0; i<detections.boxes.size(); i++){
 
             // Does not show boxes with confidence below the threshold
@@ -299,6 +302,7 @@ bool ObjectDetection::LoadObjDetectdData(std::string inputFilePath){
     }
 
     // Make sure classNames, detectionsData and trackedObjects are empty
+    std::unique_lock<std::shared_timed_mutex> lock(data_mutex);
     classNames.clear();
     detectionsData.clear();
     trackedObjects.clear();
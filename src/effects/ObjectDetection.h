@@ -17,6 +17,7 @@
 #include "EffectBase.h"
 
 #include <memory>
+#include <shared_mutex>
 
 #include "OpenCVUtilities.h"
 
@@ -63,6 +64,9 @@ namespace openshot
 
         std::vector<cv::Scalar> classesColor;
 
+        /// Protects the detections and tracked objects while they are loaded (frames are rendered concurrently)
+        std::shared_timed_mutex data_mutex;
+
         /// Draw class name and confidence score on top of the bounding box
         Keyframe display_box_text;
         /// Minimum confidence value to display the detected objects
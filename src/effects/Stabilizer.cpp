@@ -70,7 +70,17 @@ std::shared_ptr<Frame> Stabilizer::GetFrame(std::shared_ptr<Frame> frame, int64_
 	if(!frame_image.empty()){
 
 		// Check if track data exists for the requested frame
-		if(transformationData.find(frame_number) != transformationData.end()){
+		bool has_data = false;
+		EffectTransformParam transform;
+		{
+			std::shared_lock<std::shared_timed_mutex> lock(data_mutex);
+			auto data = transformationData.find(frame_number);
+			if (data != transformationData.end()) {
+				transform = data->second;
+				has_data = true;
+			}
+		}
+		if(has_data){
 
 			float zoom_value = zoom.GetValue(frame_number);
 
@@ -78,13 +88,13 @@ std::shared_ptr<Frame> Stabilizer::GetFrame(std::shared_ptr<Frame> frame, int64_
 			cv::Mat T(2,3,CV_64F);
 
 			// Set rotation matrix values
-			T.at<double>(0,0) = cos(transformationData[frame_number].da);
-			T.at<double>(0,1) = -sin(transformationData[frame_number].da);
-			T.at<double>(1,0) = sin(transformationData[frame_number].da);
-			T.at<double>(1,1) = cos(transformationData[frame_number].da);
+			T.at<double>(0,0) = cos(transform.da);
+			T.at<double>(0,1) = -sin(transform.da);
+			T.at<double>(1,0) = sin(transform.da);
+			T.at<double>(1,1) = cos(transform.da);
 
-			T.at<double>(0,2) = transformationData[frame_number].dx * frame_image.size().width;
-			T.at<double>(1,2) = transformationData[frame_number].dy * frame_image.size().height;
+			T.at<double>(0,2) = transform.dx * frame_image.size().width;
+			T.at<double>(1,2) = transform.dy * frame_image.size().height;
 
 			// Apply rotation matrix to image
 			cv::Mat frame_stabilized;
@@ -116,6 +126,7 @@ bool Stabilizer::LoadStabilizedData(std::string inputFilePath){
     }
 
     // Make sure the data maps are empty
+    std::unique_lock<std::shared_timed_mutex> lock(data_mutex);
     transformationData.clear();
     trajectoryData.clear();
 
@@ -17,6 +17,7 @@
 #include "EffectBase.h"
 
 #include <memory>
+#include <shared_mutex>
 
 #include "Json.h"
 #include "KeyFrame.h"
@@ -70,6 +71,7 @@ namespace openshot
         void init_effect_details();
         std::string protobuf_data_path;
         Keyframe zoom;
+        std::shared_timed_mutex data_mutex; ///< Protects the data maps while they are loaded (frames are rendered concurrently)
 
     public:
         std::string teste;
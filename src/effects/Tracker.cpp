@@ -85,6 +85,9 @@ void Tracker::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<Frame> Tracker::GetFrame(std::shared_ptr<Frame> frame, int64_t frame_number)
 {
+	// Prevent the bounding-box data from being reloaded while it is used
+	std::shared_lock<std::shared_timed_mutex> lock(data_mutex);
+
     // Get the frame's image
 	cv::Mat frame_image = frame->GetImageCV();
 
@@ -310,6 +313,7 @@ void Tracker::SetJsonValue(const Json::Value root) {
 	if (!root["protobuf_data_path"].isNull() && protobuf_data_path.size() <= 1)
 	{
 		protobuf_data_path = root["protobuf_data_path"].asString();
+		std::unique_lock<std::shared_timed_mutex> lock(data_mutex);
 		if(!trackedData->LoadBoxData(protobuf_data_path))
 		{
 			std::clog << "Invalid protobuf data path " << protobuf_data_path << '\n';
@@ -17,6 +17,7 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <shared_mutex>
 
 #include "EffectBase.h"
 
@@ -47,6 +48,9 @@ namespace openshot
         Fraction BaseFPS;
         double TimeScale;
 
+        /// Protects the bounding-box data while it is (re)loaded, since frames are rendered concurrently
+        std::shared_timed_mutex data_mutex;
+
     public:
         std::string protobuf_data_path; ///< Path to the protobuf file that holds the bounding-box data
         std::shared_ptr<TrackedObjectBBox> trackedData; ///< Pointer to an object that holds the bounding-box data and it's Keyframes
@@ -64,6 +64,13 @@ std::shared_ptr<openshot::Frame> Wave::GetFrame(std::shared_ptr<openshot::Frame>
 	double shift_x_value = shift_x.GetValue(frame_number);
 	double speed_y_value = speed_y.GetValue(frame_number);
 
+	// The wave is measured in pixels (so scale it down in a proxy preview)
+	double resolution_scale = ResolutionScale();
+	if (resolution_scale > 0.0) {
+		wavelength_value /= resolution_scale;
+		amplitude_value *= resolution_scale;
+	}
+
 	// Loop through pixels
 	#pragma omp parallel for
 	for (int pixel = 0; pixel < pixel_count; ++pixel)
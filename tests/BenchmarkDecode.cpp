@@ -0,0 +1,43 @@
+/**
+ * @file
+ * @brief Unit tests for the video decoding benchmark (examples/BenchmarkDecode.h)
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <cmath>
+#include <sstream>
+
+#include <catch2/catch.hpp>
+
+#include "BenchmarkDecode.h"
+
+using namespace openshot;
+
+TEST_CASE( "decode benchmark", "[libopenshot][benchmark]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "test.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	// Decoding (and converting) real frames takes a measurable, finite time
+	double decode_fps = RunDecodeBenchmark(r, 30);
+	CHECK(std::isfinite(decode_fps));
+	CHECK(decode_fps > 0.0);
+	CHECK(decode_fps < 1000000.0);
+
+	// So does scaling, with a new context per frame and with a reused context
+	for (bool reuse_context : {false, true}) {
+		double scale_fps = RunScaleBenchmark(r.info.width, r.info.height, r.info.width / 2, r.info.height / 2, reuse_context, 10);
+		CHECK(std::isfinite(scale_fps));
+		CHECK(scale_fps > 0.0);
+	}
+
+	r.Close();
+}
@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::BufferPool
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include <catch2/catch.hpp>
+
+#include "BufferPool.h"
+#include "Frame.h"
+
+#include <AppConfig.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace openshot;
+
+TEST_CASE( "recycle buffers", "[libopenshot][bufferpool]" )
+{
+	BufferPool* pool = BufferPool::Instance();
+	pool->Clear();
+	CHECK(pool->GetBytes() == 0);
+
+	// Released buffers are handed out again (for similar sizes)
+	unsigned char* buffer = pool->Allocate(100000);
+	pool->Release(buffer);
+	CHECK(pool->GetBytes() >= 100000);
+	CHECK(pool->Allocate(100001) == buffer);
+	CHECK(pool->GetBytes() == 0);
+
+	// Other sizes get their own buffer
+	unsigned char* other = pool->Allocate(500000);
+	CHECK(other != buffer);
+	pool->Release(other);
+	pool->Release(buffer);
+
+	// A full pool frees released buffers
+	pool->SetMaxBytes(0);
+	CHECK(pool->GetBytes() == 0);
+	pool->Release(pool->Allocate(100000));
+	CHECK(pool->GetBytes() == 0);
+
+	// Restore default
+	pool->SetMaxBytes(256 * 1024 * 1024);
+}
+
+TEST_CASE( "recycle images and audio", "[libopenshot][bufferpool]" )
+{
+	BufferPool* pool = BufferPool::Instance();
+	pool->Clear();
+
+	// Pixels of images are returned to the pool, when the image is destroyed
+	const unsigned char* pixels;
+	{
+		auto image = pool->CreateImage(320, 240, QImage::Format_RGBA8888_Premultiplied);
+		CHECK(image->width() == 320);
+		CHECK(image->height() == 240);
+		CHECK(image->bytesPerLine() == 320 * 4);
+		pixels = image->constBits();
+	}
+	CHECK(pool->GetBytes() >= 320 * 240 * 4);
+	CHECK(pool->CreateImage(320, 240, QImage::Format_RGBA8888_Premultiplied)->constBits() == pixels);
+
+	// Audio buffers are returned to the pool (counting the whole bucket they were allocated for)
+	pool->Clear();
+	const float* samples;
+	{
+		auto audio = pool->CreateAudioBuffer(2, 1601);
+		CHECK(audio->getNumChannels() == 2);
+		CHECK(audio->getNumSamples() == 1601);
+		samples = audio->getReadPointer(0);
+	}
+	CHECK(pool->GetBytes() == int64_t(2) * 2048 * sizeof(float));
+
+	// And reused for similar sizes (with the same number of channels)
+	{
+		auto audio = pool->CreateAudioBuffer(2, 1602);
+		CHECK(audio->getNumSamples() == 1602);
+		CHECK(audio->getReadPointer(0) == samples);
+		CHECK(pool->GetBytes() == 0);
+	}
+	auto audio = pool->CreateAudioBuffer(1, 500);
+	CHECK(audio->getNumChannels() == 1);
+	CHECK(audio->getNumSamples() == 500);
+	CHECK(audio->getReadPointer(0) != samples);
+	CHECK(pool->GetBytes() == int64_t(2) * 2048 * sizeof(float));
+
+	// Resized buffers are not pooled
+	{
+		auto resized = pool->CreateAudioBuffer(2, 1000);
+		resized->setSize(2, 4000);
+	}
+	CHECK(pool->GetBytes() == int64_t(2) * 2048 * sizeof(float));
+
+	// Frames use pooled buffers
+	{
+		auto f = std::make_shared<Frame>(1, 320, 240, "#ff0000", 500, 2);
+		f->AddColor(320, 240, "#ff0000");
+		CHECK(f->CheckPixel(0, 0, 255, 0, 0, 255, 0));
+	}
+	CHECK(pool->GetBytes() >= 320 * 240 * 4);
+}
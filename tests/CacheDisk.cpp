@@ -12,6 +12,9 @@
 
 #include <memory>
 #include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
 
 #include <catch2/catch.hpp>
 
@@ -200,6 +203,251 @@ TEST_CASE( "multiple remove", "[libopenshot][cachedisk]" )
 	temp_path.removeRecursively();
 }
 
+TEST_CASE( "raw format", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/raw-format/");
+
+	// Create cache object (raw frames are stored unscaled)
+	CacheDisk c(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+
+	// Add a frame with image and audio data
+	auto f = std::make_shared<Frame>(1, 64, 48, "#00FF00");
+	f->AddColor(64, 48, "#00FF00");
+	f->ResizeAudio(2, 500, 44100, LAYOUT_STEREO);
+	float samples[500];
+	for (int s = 0; s < 500; s++)
+		samples[s] = s / 500.0;
+	f->AddAudio(true, 0, 0, samples, 500, 1.0);
+	f->AddAudio(true, 1, 0, samples, 500, -1.0);
+	c.Add(f);
+
+	CHECK(c.Count() == 1);
+	CHECK(temp_path.exists("1.raw"));
+	CHECK_FALSE(temp_path.exists("1.audio"));
+
+	// Read frame back from disk cache
+	auto cached = c.GetFrame(1);
+	REQUIRE(cached != nullptr);
+	CHECK(cached->GetWidth() == 64);
+	CHECK(cached->GetHeight() == 48);
+	CHECK(cached->CheckPixel(10, 10, 0, 255, 0, 255, 0));
+	CHECK(cached->GetAudioChannelsCount() == 2);
+	CHECK(cached->GetAudioSamplesCount() == 500);
+	CHECK(cached->ChannelsLayout() == LAYOUT_STEREO);
+	CHECK(cached->SampleRate() == 44100);
+	CHECK(cached->GetAudioSamples(0)[250] == Approx(0.5f));
+	CHECK(cached->GetAudioSamples(1)[250] == Approx(-0.5f));
+
+	// Files with an invalid header (such as a negative image size) are rejected
+	auto f2 = std::make_shared<Frame>(2, 64, 48, "#00FF00");
+	f2->AddColor(64, 48, "#00FF00");
+	c.Add(f2);
+	QFile corrupted_file(temp_path.filePath("2.raw"));
+	REQUIRE(corrupted_file.open(QIODevice::ReadWrite));
+	int32_t invalid_size[2] = {-1, -1};
+	corrupted_file.seek(8); // after the magic number and version
+	corrupted_file.write(reinterpret_cast<const char*>(invalid_size), sizeof(invalid_size));
+	corrupted_file.close();
+	CHECK(c.GetFrame(2) == nullptr);
+
+	// Removing the frame deletes its file
+	c.Remove(1);
+	CHECK_FALSE(temp_path.exists("1.raw"));
+
+	// Clean up
+	c.Clear();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "persistent index", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/persistent-index/");
+	temp_path.removeRecursively();
+
+	{
+		// Cache frames of a project
+		CacheDisk c(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+		CHECK_FALSE(c.IsPersistent());
+		c.SetContentKey("project A");
+		CHECK(c.IsPersistent());
+		for (int i = 1; i <= 10; i++) {
+			auto f = std::make_shared<Frame>(i, 32, 24, "#FF0000");
+			f->AddColor(32, 24, "#FF0000");
+			c.Add(f);
+		}
+		CHECK(c.Count() == 10);
+	}
+
+	// Reopening the same project reuses the cached frames
+	CacheDisk c(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+	CHECK(c.Count() == 0);
+	c.SetContentKey("project A");
+	CHECK(c.Count() == 10);
+	auto cached = c.GetFrame(5);
+	REQUIRE(cached != nullptr);
+	CHECK(cached->CheckPixel(10, 10, 255, 0, 0, 255, 0));
+
+	// Other content has its own frames
+	c.SetContentKey("project B");
+	CHECK(c.Count() == 0);
+	auto f = std::make_shared<Frame>(100, 32, 24, "#0000FF");
+	f->AddColor(32, 24, "#0000FF");
+	c.Add(f);
+	c.SetContentKey("project A");
+	CHECK(c.Count() == 10);
+	CHECK_FALSE(c.Contains(100));
+
+	// Corrupted files are detected by their checksum
+	QDirIterator files(temp_path.path(), QStringList() << "3.raw", QDir::Files, QDirIterator::Subdirectories);
+	REQUIRE(files.hasNext());
+	QFile corrupted_file(files.next());
+	REQUIRE(corrupted_file.open(QIODevice::ReadWrite));
+	corrupted_file.seek(corrupted_file.size() - 4);
+	corrupted_file.write("XXXX", 4);
+	corrupted_file.close();
+	CHECK(c.GetFrame(3) == nullptr);
+	CHECK_FALSE(c.Contains(3));
+	CHECK(c.GetFrame(4) != nullptr);
+
+	// Frames can be moved to new content
+	c.SetContentKey("project A (edited)", true);
+	CHECK(c.Count() == 9);
+	c.SetContentKey("project A");
+	CHECK(c.Count() == 0);
+
+	// The folders of other content are garbage collected, when the cache is full
+	CHECK(temp_path.entryList(QDir::Dirs | QDir::NoDotAndDotDot).size() == 3);
+	c.SetMaxBytes(1);
+	c.SetContentKey("project C");
+	CHECK(temp_path.entryList(QDir::Dirs | QDir::NoDotAndDotDot).size() == 1);
+
+	// Clean up
+	c.Clear();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "persistent JSON update", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/persistent-json/");
+	temp_path.removeRecursively();
+
+	CacheDisk c(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+	c.SetContentKey("project A");
+	for (int i = 1; i <= 5; i++) {
+		auto f = std::make_shared<Frame>(i, 32, 24, "#FF0000");
+		f->AddColor(32, 24, "#FF0000");
+		c.Add(f);
+	}
+
+	// Updating the settings of a persisted cache keeps its frames
+	Json::Value root = c.JsonValue();
+	root["max_bytes"] = "1000000";
+	c.SetJsonValue(root);
+	CHECK(c.GetMaxBytes() == 1000000);
+	CHECK(c.Count() == 5);
+	REQUIRE(c.GetFrame(3) != nullptr);
+
+	// And so does moving it to another folder (which has no frames of this content yet)
+	QDir other_path = QDir::tempPath() + QString("/persistent-json-other/");
+	other_path.removeRecursively();
+	root["path"] = other_path.path().toStdString();
+	c.SetJsonValue(root);
+	CHECK(c.Count() == 0);
+	CHECK(c.IsPersistent());
+	root["path"] = temp_path.path().toStdString();
+	c.SetJsonValue(root);
+	CHECK(c.Count() == 5);
+
+	// Clean up
+	c.Clear();
+	temp_path.removeRecursively();
+	other_path.removeRecursively();
+}
+
+TEST_CASE( "persistent content changes", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/persistent-changes/");
+	temp_path.removeRecursively();
+
+	CacheDisk c(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+	c.SetContentKey("project A");
+	for (int i = 1; i <= 5; i++) {
+		auto f = std::make_shared<Frame>(i, 32, 24, "#FF0000");
+		f->AddColor(32, 24, "#FF0000");
+		c.Add(f);
+	}
+
+	// While the content changes, the frames are kept (but no longer persisted for the previous content)
+	c.ContentChanged();
+	c.Remove(5);
+	auto f = std::make_shared<Frame>(6, 32, 24, "#00FF00");
+	f->AddColor(32, 24, "#00FF00");
+	c.Add(f);
+	CHECK(c.Count() == 5);
+	{
+		CacheDisk other(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+		other.SetContentKey("project A");
+		CHECK(other.Count() == 0);
+	}
+
+	// Keying the changed content persists the frames again
+	c.SetContentKey("project A (edited)", true);
+	CHECK(c.Count() == 5);
+	{
+		CacheDisk other(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+		other.SetContentKey("project A (edited)");
+		CHECK(other.Count() == 5);
+		CHECK(other.Contains(6));
+	}
+
+	// And so does changing back to the same content (such as with an undo)
+	c.ContentChanged();
+	c.SetContentKey("project A (edited)", true);
+	{
+		CacheDisk other(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+		other.SetContentKey("project A (edited)");
+		CHECK(other.Count() == 5);
+	}
+
+	// Clean up
+	c.Clear();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "metrics", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/metrics/");
+	temp_path.removeRecursively();
+
+	// Frames of different sizes
+	CacheDisk c(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+	auto small_frame = std::make_shared<Frame>(1, 32, 24, "#FF0000");
+	small_frame->AddColor(32, 24, "#FF0000");
+	auto large_frame = std::make_shared<Frame>(2, 320, 240, "#FF0000");
+	large_frame->AddColor(320, 240, "#FF0000");
+	c.Add(small_frame);
+	c.Add(large_frame);
+	REQUIRE(c.GetFrame(2) != nullptr);
+
+	// The actual sizes of the files are counted
+	QDirIterator files(temp_path.path(), QStringList() << "2.raw", QDir::Files, QDirIterator::Subdirectories);
+	REQUIRE(files.hasNext());
+	int64_t large_bytes = QFileInfo(files.next()).size();
+	CacheMetrics metrics = c.GetMetrics();
+	CHECK(metrics.inserts == 2);
+	CHECK(metrics.bytes_in > large_bytes);
+	CHECK(metrics.bytes_out == large_bytes);
+
+	// And so does the running total of the cache's size
+	CHECK(c.GetBytes() == metrics.bytes_in);
+	c.Remove(2);
+	CHECK(c.GetBytes() == metrics.bytes_in - large_bytes);
+
+	// Clean up
+	c.Clear();
+	temp_path.removeRecursively();
+}
+
 TEST_CASE( "JSON", "[libopenshot][cachedisk]" )
 {
 	QDir temp_path = QDir::tempPath() + QString("/cache_json/");
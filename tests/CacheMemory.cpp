@@ -10,6 +10,7 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <cstring>
 #include <memory>
 #include <QDir>
 
@@ -296,6 +297,255 @@ TEST_CASE( "multiple remove", "[libopenshot][cachememory]" )
 
 
 
+TEST_CASE( "MoveToFront and GetBytes", "[libopenshot][cachememory]" )
+{
+	// Create cache object (with room for roughly 20 frames)
+	CacheMemory c(250 * 1024);
+
+	// Add 20 frames, and track the expected size
+	int64_t expected_bytes = 0;
+	for (int i = 1; i <= 20; i++)
+	{
+		auto f = std::make_shared<Frame>(i, 320, 240, "#000000");
+		f->AddColor(320, 240, "#000000");
+		expected_bytes += f->GetBytes();
+		c.Add(f);
+	}
+	CHECK(c.GetBytes() == expected_bytes);
+
+	// Freshen the oldest frame, so it is not the next one evicted
+	c.MoveToFront(1);
+
+	// Add a new frame, which forces the oldest frame out
+	auto f21 = std::make_shared<Frame>(21, 320, 240, "#000000");
+	f21->AddColor(320, 240, "#000000");
+	c.Add(f21);
+
+	CHECK(c.Count() == 20);
+	CHECK(c.GetFrame(1) != nullptr);
+	CHECK(c.GetFrame(2) == nullptr);
+	CHECK(c.GetBytes() == expected_bytes);
+
+	// Removing frames should reduce the byte total
+	c.Remove(10, 15);
+	CHECK(c.Count() == 14);
+	CHECK(c.GetBytes() == expected_bytes - (6 * f21->GetBytes()));
+
+	// Clearing the cache resets the byte total
+	c.Clear();
+	CHECK(c.GetBytes() == 0);
+}
+
+
+TEST_CASE( "refresh the size of changed frames", "[libopenshot][cachememory]" )
+{
+	CacheMemory c;
+
+	// A frame which gets its image after it is cached
+	auto f1 = std::make_shared<Frame>(1, 320, 240, "#000000");
+	c.Add(f1);
+	int64_t added_bytes = c.GetBytes();
+	f1->AddColor(640, 480, "#000000");
+	CHECK(f1->GetBytes() > added_bytes);
+
+	// Looking up the frame refreshes the byte total
+	c.GetFrame(1);
+	CHECK(c.GetBytes() == f1->GetBytes());
+
+	// And so does moving it to the front
+	f1->AddColor(1280, 720, "#000000");
+	c.MoveToFront(1);
+	CHECK(c.GetBytes() == f1->GetBytes());
+
+	// Removing the frame leaves nothing behind
+	c.Remove(1);
+	CHECK(c.GetBytes() == 0);
+}
+
+TEST_CASE( "compressed", "[libopenshot][cachememory]" )
+{
+	// Create cache object (with room for roughly 20 uncompressed frames)
+	CacheMemory c(250 * 1024);
+	c.SetCompressed(true);
+	CHECK(c.IsCompressed());
+
+	// Create a frame with a gradient (so every compression opcode is used), and audio
+	auto image = std::make_shared<QImage>(320, 240, QImage::Format_RGBA8888_Premultiplied);
+	for (int row = 0; row < 240; row++) {
+		unsigned char* pixels = image->scanLine(row);
+		for (int col = 0; col < 320; col++) {
+			pixels[col * 4 + 0] = col < 160 ? 0 : (col * 7 + row) % 256;
+			pixels[col * 4 + 1] = row % 256;
+			pixels[col * 4 + 2] = (col / 4) % 256;
+			pixels[col * 4 + 3] = row < 120 ? 255 : 128;
+		}
+	}
+	auto f1 = std::make_shared<Frame>(1, 320, 240, "#000000");
+	f1->AddImage(image);
+	f1->SetPixelRatio(4, 3);
+	f1->ResizeAudio(2, 500, 48000, LAYOUT_STEREO);
+	float samples[500];
+	for (int i = 0; i < 500; i++)
+		samples[i] = i / 500.0;
+	f1->AddAudio(true, 1, 0, samples, 500, 1.0);
+	c.Add(f1);
+
+	// The cached size is the compressed size
+	CHECK(c.GetBytes() > 0);
+	CHECK(c.GetBytes() < f1->GetBytes());
+
+	// The decoded frame is an identical copy
+	auto copy = c.GetFrame(1);
+	REQUIRE(copy != nullptr);
+	CHECK(copy != f1);
+	CHECK(copy->number == 1);
+	REQUIRE(copy->GetWidth() == 320);
+	REQUIRE(copy->GetHeight() == 240);
+	bool same_pixels = true;
+	for (int row = 0; row < 240; row++)
+		if (memcmp(copy->GetImage()->constScanLine(row), image->constScanLine(row), 320 * 4) != 0)
+			same_pixels = false;
+	CHECK(same_pixels);
+	CHECK(copy->GetPixelRatio().num == 4);
+	CHECK(copy->GetPixelRatio().den == 3);
+	CHECK(copy->SampleRate() == 48000);
+	CHECK(copy->GetAudioChannelsCount() == 2);
+	REQUIRE(copy->GetAudioSamplesCount() == 500);
+	CHECK(copy->GetAudioSamples(0)[250] == 0.0f);
+	CHECK(copy->GetAudioSamples(1)[250] == samples[250]);
+
+	// Flat frames compress very well, so many more frames fit
+	for (int i = 2; i <= 100; i++)
+	{
+		auto f = std::make_shared<Frame>(i, 320, 240, "#000000");
+		f->AddColor(320, 240, "#000000");
+		c.Add(f);
+	}
+	CHECK(c.Count() == 100);
+
+	// Frames added after compression is disabled are stored as-is
+	c.SetCompressed(false);
+	auto f101 = std::make_shared<Frame>(101, 320, 240, "#000000");
+	f101->AddColor(320, 240, "#000000");
+	c.Add(f101);
+	CHECK(c.GetFrame(101) == f101);
+	CHECK(c.GetFrame(100) != nullptr);
+}
+
+
+TEST_CASE( "eviction policy", "[libopenshot][cachememory]" )
+{
+	// Room for 25 frames
+	auto f = std::make_shared<Frame>(1, 32, 24, "#000000");
+	f->AddColor(32, 24, "#000000");
+	int64_t frame_bytes = f->GetBytes();
+
+	// Least recently used frames are purged first (by default)
+	CacheMemory lru(frame_bytes * 25);
+	CHECK(lru.GetEvictionPolicy() == nullptr);
+	for (int i = 80; i < 130; i++) {
+		auto frame = std::make_shared<Frame>(i, 32, 24, "#000000");
+		frame->AddColor(32, 24, "#000000");
+		lru.Add(frame);
+	}
+	CHECK(lru.Count() == 25);
+	CHECK_FALSE(lru.Contains(100));
+	CHECK(lru.Contains(129));
+
+	// Frames far from the playhead (especially behind it) are purged first
+	auto policy = std::make_shared<PlayheadEvictionPolicy>(4.5);
+	policy->SetPlayhead(100, 1);
+	CacheMemory c(frame_bytes * 25);
+	c.SetEvictionPolicy(policy);
+	CHECK(c.GetEvictionPolicy() == policy);
+	for (int i = 80; i < 130; i++) {
+		auto frame = std::make_shared<Frame>(i, 32, 24, "#000000");
+		frame->AddColor(32, 24, "#000000");
+		c.Add(frame);
+	}
+	CHECK(c.Count() == 25);
+	CHECK_FALSE(c.Contains(95));
+	CHECK(c.Contains(96));
+	CHECK(c.Contains(100));
+	CHECK(c.Contains(120));
+	CHECK_FALSE(c.Contains(121));
+
+	// Scores follow the playback direction
+	CHECK(policy->EvictionScore(110, 0) == Approx(10.0));
+	CHECK(policy->EvictionScore(90, 0) == Approx(45.0));
+	policy->SetPlayhead(100, -2);
+	CHECK(policy->EvictionScore(110, 0) == Approx(45.0));
+	CHECK(policy->EvictionScore(90, 0) == Approx(10.0));
+	policy->SetPlayhead(100, 0);
+	CHECK(policy->EvictionScore(90, 0) == Approx(10.0));
+	CHECK(c.GetOldestFrame()->number == 120);
+
+	// Ties go to the older frame (120 was just used)
+	policy->SetPlayhead(108, 0);
+	CHECK(c.GetOldestFrame()->number == 96);
+
+	// Policies which score the age of frames are scored once per clean up (the same frames are purged)
+	class OddFramesFirst : public CacheEvictionPolicy {
+	public:
+		std::string Name() { return "OddFramesFirst"; }
+		double EvictionScore(int64_t frame_number, int64_t age) { return (frame_number % 2 ? 1000.0 : 0.0) + age; }
+	};
+	CacheMemory odd(frame_bytes * 25);
+	odd.SetEvictionPolicy(std::make_shared<OddFramesFirst>());
+	for (int i = 1; i <= 50; i++) {
+		auto frame = std::make_shared<Frame>(i, 32, 24, "#000000");
+		frame->AddColor(32, 24, "#000000");
+		odd.Add(frame);
+	}
+	CHECK(odd.Count() == 25);
+	for (int i = 1; i <= 50; i++)
+		CHECK(odd.Contains(i) == (i % 2 == 0));
+	CHECK(odd.GetOldestFrame()->number == 2);
+
+	// Hits and misses are counted
+	c.ResetMetrics();
+	CHECK(c.GetFrame(100) != nullptr);
+	CHECK(c.GetFrame(80) == nullptr);
+	CHECK(c.GetFrame(81) == nullptr);
+	CHECK(c.GetHits() == 1);
+	CHECK(c.GetMisses() == 2);
+}
+
+TEST_CASE( "metrics", "[libopenshot][cachememory]" )
+{
+	// Room for 20 frames
+	auto f = std::make_shared<Frame>(1, 32, 24, "#000000");
+	f->AddColor(32, 24, "#000000");
+	int64_t frame_bytes = f->GetBytes();
+	CacheMemory c(frame_bytes * 20);
+
+	for (int i = 1; i <= 30; i++) {
+		auto frame = std::make_shared<Frame>(i, 32, 24, "#000000");
+		frame->AddColor(32, 24, "#000000");
+		c.Add(frame);
+	}
+	c.Add(c.GetFrame(30));
+	c.GetFrame(1);
+
+	CacheMetrics metrics = c.GetMetrics();
+	CHECK(metrics.inserts == 30);
+	CHECK(metrics.evictions == 10);
+	CHECK(metrics.hits == 1);
+	CHECK(metrics.misses == 1);
+	CHECK(metrics.bytes_in == frame_bytes * 30);
+	CHECK(metrics.bytes_out == frame_bytes);
+	CHECK(metrics.lock_wait_ns >= 0);
+
+	// Metrics are included in the JSON
+	Json::Value root = c.JsonValue();
+	CHECK(root["metrics"]["inserts"].asString() == "30");
+	CHECK(root["metrics"]["evictions"].asString() == "10");
+
+	c.ResetMetrics();
+	CHECK(c.GetMetrics().inserts == 0);
+	CHECK(c.GetMetrics().evictions == 0);
+}
+
 TEST_CASE( "JSON", "[libopenshot][cachememory]" )
 {
 	// Create memory cache object
@@ -0,0 +1,198 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::CacheSharded
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "CacheSharded.h"
+#include "Frame.h"
+#include "Json.h"
+
+using namespace openshot;
+
+TEST_CASE( "default constructor", "[libopenshot][cachesharded]" )
+{
+	// Create cache object
+	CacheSharded c;
+
+	// Loop 50 times
+	for (int i = 0; i < 50; i++)
+	{
+		// Add blank frame to the cache
+		auto f = std::make_shared<Frame>();
+		f->number = i;
+		c.Add(f);
+	}
+
+	CHECK(c.Count() == 50); // Cache should have all frames, with no limit
+	CHECK(c.GetMaxBytes() == 0); // Max frames should default to 0
+	CHECK(c.GetShardCount() == 16);
+
+	// Shard count is rounded up to a power of 2
+	CacheSharded c2(0, 5);
+	CHECK(c2.GetShardCount() == 8);
+}
+
+TEST_CASE( "MaxBytes constructor", "[libopenshot][cachesharded]" )
+{
+	// Create cache object (with a max of 5 previous items)
+	CacheSharded c(250 * 1024);
+
+	// Loop 20 times
+	for (int i = 30; i > 0; i--)
+	{
+		// Add blank frame to the cache
+		auto f = std::make_shared<Frame>(i, 320, 240, "#000000");
+		f->AddColor(320, 240, "#000000");
+		c.Add(f);
+	}
+
+	// Cache should have all 20
+	CHECK(c.Count() == 20);
+
+	// Add 10 frames again
+	for (int i = 10; i > 0; i--)
+	{
+		// Add blank frame to the cache
+		auto f = std::make_shared<Frame>(i, 320, 240, "#000000");
+		f->AddColor(320, 240, "#000000");
+		c.Add(f);
+	}
+
+	// Count should be 20, since we're more frames than can be cached.
+	CHECK(c.Count() == 20);
+
+	// Check which items the cache kept (oldest frames are purged across all shards)
+	CHECK(c.GetFrame(1) != nullptr);
+	CHECK(c.GetFrame(10) != nullptr);
+	CHECK(c.GetFrame(11) != nullptr);
+	CHECK(c.GetFrame(19) != nullptr);
+	CHECK(c.GetFrame(20) != nullptr);
+	CHECK(c.GetFrame(21) == nullptr);
+	CHECK(c.GetFrame(30) == nullptr);
+}
+
+TEST_CASE( "MoveToFront", "[libopenshot][cachesharded]" )
+{
+	// Create cache object
+	CacheSharded c(250 * 1024);
+
+	for (int i = 1; i <= 20; i++)
+	{
+		auto f = std::make_shared<Frame>(i, 320, 240, "#000000");
+		f->AddColor(320, 240, "#000000");
+		c.Add(f);
+	}
+
+	// Freshen the oldest frame, so it is not the next one purged
+	c.MoveToFront(1);
+
+	auto f21 = std::make_shared<Frame>(21, 320, 240, "#000000");
+	f21->AddColor(320, 240, "#000000");
+	c.Add(f21);
+
+	CHECK(c.Count() == 20);
+	CHECK(c.GetFrame(1) != nullptr);
+	CHECK(c.GetFrame(2) == nullptr);
+	CHECK(c.GetBytes() == 20 * f21->GetBytes());
+}
+
+TEST_CASE( "Remove", "[libopenshot][cachesharded]" )
+{
+	// Create cache object
+	CacheSharded c;
+
+	for (int i = 1; i <= 20; i++)
+	{
+		auto f = std::make_shared<Frame>();
+		f->number = i;
+		c.Add(f);
+	}
+
+	// Remove a single frame
+	c.Remove(17);
+	CHECK(c.Count() == 19);
+	CHECK_FALSE(c.Contains(17));
+
+	// Remove a range of frames
+	c.Remove(16, 18);
+	CHECK(c.Count() == 17);
+
+	// Check smallest frame
+	CHECK(c.GetSmallestFrame()->number == 1);
+	c.Remove(1, 3);
+	CHECK(c.GetSmallestFrame()->number == 4);
+
+	// Remove all remaining frames
+	c.Remove(1, 20);
+	CHECK(c.Count() == 0);
+	CHECK(c.GetBytes() == 0);
+}
+
+TEST_CASE( "multiple threads", "[libopenshot][cachesharded]" )
+{
+	// Create cache object (with room for roughly 100 frames)
+	auto sample = std::make_shared<Frame>(1, 64, 64, "#000000");
+	sample->AddColor(64, 64, "#000000");
+	CacheSharded c(sample->GetBytes() * 100);
+
+	// Add and get frames from many threads at once
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; t++) {
+		threads.push_back(std::thread([&c, t]() {
+			for (int i = 1; i <= 500; i++) {
+				int64_t frame_number = (i * 7 + t * 13) % 300 + 1;
+				if (!c.GetFrame(frame_number)) {
+					auto f = std::make_shared<Frame>(frame_number, 64, 64, "#000000");
+					f->AddColor(64, 64, "#000000");
+					c.Add(f);
+				}
+			}
+		}));
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	// Byte total and count stay consistent with each other
+	CHECK(c.Count() <= 100 + 8);
+	CHECK(c.GetBytes() == c.Count() * sample->GetBytes());
+
+	c.Clear();
+	CHECK(c.Count() == 0);
+	CHECK(c.GetBytes() == 0);
+}
+
+TEST_CASE( "JSON", "[libopenshot][cachesharded]" )
+{
+	// Create memory cache object
+	CacheSharded c;
+
+	// Add some frames (out of order)
+	auto f3 = std::make_shared<Frame>(3, 1280, 720, "Blue", 500, 2);
+	c.Add(f3);
+	CHECK((int)c.JsonValue()["ranges"].size() == 1);
+	CHECK(c.JsonValue()["version"].asString() == "1");
+
+	auto f1 = std::make_shared<Frame>(1, 1280, 720, "Blue", 500, 2);
+	c.Add(f1);
+	CHECK((int)c.JsonValue()["ranges"].size() == 2);
+	CHECK(c.JsonValue()["version"].asString() == "2");
+
+	auto f2 = std::make_shared<Frame>(2, 1280, 720, "Blue", 500, 2);
+	c.Add(f2);
+	CHECK((int)c.JsonValue()["ranges"].size() == 1);
+	CHECK(c.JsonValue()["version"].asString() == "3");
+	CHECK(c.JsonValue()["type"].asString() == "CacheSharded");
+}
@@ -0,0 +1,165 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::CacheTiered
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <QDir>
+
+#include <catch2/catch.hpp>
+
+#include "CacheTiered.h"
+#include "Frame.h"
+#include "Json.h"
+
+using namespace openshot;
+
+TEST_CASE( "default constructor", "[libopenshot][cachetiered]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/tiered-constructor/");
+
+	// Create cache object
+	CacheTiered c(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+
+	for (int i = 0; i < 50; i++)
+	{
+		// Add blank frame to the cache
+		auto f = std::make_shared<Frame>();
+		f->number = i;
+		c.Add(f);
+	}
+
+	CHECK(c.Count() == 50); // Cache should have all frames, with no limit
+	CHECK(c.GetMaxBytes() == 0); // Max bytes should default to 0
+	CHECK(c.GetDiskMaxBytes() == 0);
+
+	// Clean up
+	c.Clear();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "demote and promote frames", "[libopenshot][cachetiered]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/tiered-demote/");
+
+	// Create cache object (with room for roughly 20 frames in memory)
+	CacheTiered c(temp_path.path().toStdString(), "RAW", 1.0, 1.0, 250 * 1024, 0);
+
+	for (int i = 1; i <= 30; i++)
+	{
+		// Add frame with picture and audio data
+		auto f = std::make_shared<Frame>(i, 320, 240, "#0000FF");
+		f->AddColor(320, 240, "#0000FF");
+		f->ResizeAudio(2, 500, 44100, LAYOUT_STEREO);
+		f->AddAudioSilence(500);
+		c.Add(f);
+	}
+
+	// No frames are lost (oldest frames are on disk, or on their way there)
+	CHECK(c.Count() == 30);
+	CHECK(c.Contains(1));
+	CHECK(c.Contains(30));
+	CHECK_FALSE(c.Contains(31));
+
+	// Demoted frames are promoted back into memory
+	auto f = c.GetFrame(1);
+	REQUIRE(f != nullptr);
+	CHECK(f->number == 1);
+	CHECK(f->GetWidth() == 320);
+	CHECK(f->GetHeight() == 240);
+	CHECK(f->CheckPixel(10, 10, 0, 0, 255, 255, 0));
+	CHECK(f->GetAudioSamplesCount() == 500);
+	CHECK(c.Count() == 30);
+
+	// Remove frames from every tier
+	c.Remove(1, 15);
+	CHECK(c.Count() == 15);
+	CHECK(c.GetFrame(1) == nullptr);
+	CHECK(c.GetFrame(5) == nullptr);
+	CHECK(c.GetFrame(16) != nullptr);
+
+	// Clean up
+	c.Clear();
+	CHECK(c.Count() == 0);
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "demote compressed frames", "[libopenshot][cachetiered]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/tiered-compressed/");
+
+	// A compressed memory tier (with room for 20 frames)
+	auto f1 = std::make_shared<Frame>(1, 320, 240, "#00FF00");
+	f1->AddColor(320, 240, "#00FF00");
+	CacheMemory sizing;
+	sizing.SetCompressed(true);
+	sizing.Add(f1);
+	CacheTiered c(temp_path.path().toStdString(), "RAW", 1.0, 1.0, sizing.GetBytes() * 20, 0);
+	c.SetCompressed(true);
+	CHECK(c.IsCompressed());
+
+	for (int i = 1; i <= 30; i++)
+	{
+		auto f = std::make_shared<Frame>(i, 320, 240, "#00FF00");
+		f->AddColor(320, 240, "#00FF00");
+		c.Add(f);
+	}
+	CHECK(c.Count() == 30);
+
+	// Compressed frames are decoded when they are written to disk, or promoted
+	for (int64_t number : {1, 5, 30}) {
+		auto f = c.GetFrame(number);
+		REQUIRE(f != nullptr);
+		CHECK(f->number == number);
+		CHECK(f->CheckPixel(10, 10, 0, 255, 0, 255, 0));
+	}
+	CHECK(c.Count() == 30);
+
+	// Clean up
+	c.Clear();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "JSON", "[libopenshot][cachetiered]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/tiered-json/");
+
+	// Create cache object (with room for roughly 20 frames in memory)
+	CacheTiered c(temp_path.path().toStdString(), "RAW", 1.0, 1.0, 250 * 1024, 0);
+
+	// Add frames 1-30 (some of which are demoted to disk), and 40-45
+	for (int i = 1; i <= 45; i++)
+	{
+		if (i > 30 && i < 40)
+			continue;
+		auto f = std::make_shared<Frame>(i, 320, 240, "#000000");
+		f->AddColor(320, 240, "#000000");
+		c.Add(f);
+	}
+
+	// Ranges are merged across tiers
+	Json::Value root = c.JsonValue();
+	CHECK(root["type"].asString() == "CacheTiered");
+	REQUIRE((int)root["ranges"].size() == 2);
+	CHECK(root["ranges"][0]["start"].asString() == "1");
+	CHECK(root["ranges"][0]["end"].asString() == "30");
+	CHECK(root["ranges"][1]["start"].asString() == "40");
+	CHECK(root["ranges"][1]["end"].asString() == "45");
+
+	// Version only changes with the ranges
+	std::string version = root["version"].asString();
+	CHECK(c.JsonValue()["version"].asString() == version);
+	c.Remove(45);
+	CHECK(c.JsonValue()["version"].asString() != version);
+
+	// Clean up
+	c.Clear();
+	temp_path.removeRecursively();
+}
@@ -277,3 +277,50 @@ TEST_CASE( "has_video", "[libopenshot][clip]" )
     CHECK(i3->size() == f3_size);
     CHECK(i3->pixelColor(20, 20) != trans_color);
 }
+
+TEST_CASE( "IsOpaque", "[libopenshot][clip]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	openshot::Clip c1(path.str());
+
+	// A 16:9 video covers a 16:9 canvas (but not a 4:3 canvas, unless cropped)
+	CHECK(c1.IsOpaque(1, 1280, 720));
+	CHECK(c1.IsOpaque(1, 640, 360));
+	CHECK_FALSE(c1.IsOpaque(1, 640, 480));
+	c1.scale = openshot::SCALE_CROP;
+	CHECK(c1.IsOpaque(1, 640, 480));
+	c1.scale = openshot::SCALE_FIT;
+
+	// Partially transparent
+	c1.alpha.AddPoint(10.0, 1.0);
+	c1.alpha.AddPoint(20.0, 0.5);
+	CHECK(c1.IsOpaque(10, 1280, 720));
+	CHECK_FALSE(c1.IsOpaque(15, 1280, 720));
+	c1.alpha = openshot::Keyframe(1.0);
+
+	// Moved away from an edge
+	c1.location_x.AddPoint(1.0, 0.1);
+	CHECK_FALSE(c1.IsOpaque(1, 1280, 720));
+	c1.location_x = openshot::Keyframe(0.0);
+
+	// Rotated (which only covers the canvas when scaled up)
+	c1.rotation.AddPoint(1.0, 10.0);
+	CHECK_FALSE(c1.IsOpaque(1, 1280, 720));
+	c1.scale_x.AddPoint(1.0, 2.0);
+	c1.scale_y.AddPoint(1.0, 2.0);
+	CHECK(c1.IsOpaque(1, 1280, 720));
+
+	// Effects can add transparency
+	openshot::Negate negate;
+	c1.AddEffect(&negate);
+	CHECK_FALSE(c1.IsOpaque(1, 1280, 720));
+	c1.RemoveEffect(&negate);
+	CHECK(c1.IsOpaque(1, 1280, 720));
+
+	// Images (which can have an alpha channel) are never opaque
+	std::stringstream image_path;
+	image_path << TEST_MEDIA_PATH << "front.png";
+	openshot::Clip c2(image_path.str());
+	CHECK_FALSE(c2.IsOpaque(1, 1280, 720));
+}
@@ -10,8 +10,11 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <chrono>
 #include <sstream>
+#include <map>
 #include <memory>
+#include <thread>
 
 #include <catch2/catch.hpp>
 
@@ -225,6 +228,41 @@ TEST_CASE( "Multiple_Open_and_Close", "[libopenshot][ffmpegreader]" )
 	r.Close();
 }
 
+TEST_CASE( "GetAudioFrame", "[libopenshot][ffmpegreader]" )
+{
+	// Create 2 readers (one reads complete frames, the other only reads audio)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r1(path.str());
+	FFmpegReader r2(path.str());
+	r1.Open();
+	r2.Open();
+
+	// The audio matches the complete frames
+	for (int64_t number = 1; number <= 30; number++) {
+		std::shared_ptr<Frame> expected = r1.GetFrame(number);
+		std::shared_ptr<Frame> f = r2.GetAudioFrame(number);
+		CHECK(f->number == number);
+		REQUIRE(f->GetAudioSamplesCount() == expected->GetAudioSamplesCount());
+		for (int channel = 0; channel < f->GetAudioChannelsCount(); channel++)
+			for (int sample = 0; sample < f->GetAudioSamplesCount(); sample += 50)
+				CHECK(f->GetAudioSamples(channel)[sample] == Approx(expected->GetAudioSamples(channel)[sample]).margin(0.00001));
+	}
+
+	// Frames without images are never returned by GetFrame (and the video is decoded again)
+	std::shared_ptr<Frame> f = r2.GetFrame(20);
+	CHECK(f->number == 20);
+	CHECK(f->has_image_data);
+	CHECK(f->GetImage()->width() == 1280);
+	CHECK(f->GetImage()->height() == 720);
+
+	// Complete frames are returned by GetAudioFrame (if cached)
+	CHECK(r2.GetAudioFrame(20) == f);
+
+	r1.Close();
+	r2.Close();
+}
+
 TEST_CASE( "verify parent Timeline", "[libopenshot][ffmpegreader]" )
 {
 	// Create a reader
@@ -284,3 +322,231 @@ TEST_CASE( "DisplayInfo", "[libopenshot][ffmpegreader]" )
 	// Compare a [0, expected.size()) substring of output to expected
 	CHECK(output.str().substr(0, expected.size()) == expected);
 }
+
+TEST_CASE( "Seek with a seek index", "[libopenshot][ffmpegreader]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+
+	// Read frames in order (without seeking)
+	FFmpegReader r1(path.str());
+	r1.enable_seek = false;
+	r1.Open();
+	std::map<int64_t, std::shared_ptr<Frame>> expected;
+	for (int64_t number = 1; number <= 320; number++) {
+		std::shared_ptr<Frame> f = r1.GetFrame(number);
+		if (number == 100 || number == 250 || number == 300 || number == 320)
+			expected[number] = f;
+	}
+	r1.Close();
+
+	// Reading frames in order does not index the file
+	FFmpegReader r2(path.str());
+	r2.Open();
+	for (int64_t number = 1; number <= 10; number++)
+		r2.GetFrame(number);
+	r2.WaitForSeekIndex();
+	CHECK(r2.GetSeekIndex() == nullptr);
+
+	// Closing the reader stops indexing (which starts at the first seek), and reopening it starts over
+	r2.GetFrame(300);
+	r2.Close();
+
+	// The keyframes are indexed in the background
+	r2.Open();
+	std::shared_ptr<Frame> first = r2.GetFrame(300);
+	r2.WaitForSeekIndex();
+	std::shared_ptr<const SeekIndex> index = r2.GetSeekIndex();
+	REQUIRE(index != nullptr);
+	CHECK(index->Count() > 1);
+	CHECK(*first->GetImage() == *expected[300]->GetImage());
+
+	// Seeking (forward, backward, and within a group of pictures) returns the same frames
+	for (int64_t number : {100, 250, 320, 300}) {
+		std::shared_ptr<Frame> f = r2.GetFrame(number);
+		CHECK(f->number == number);
+		CHECK(*f->GetImage() == *expected[number]->GetImage());
+	}
+	r2.Close();
+}
+
+TEST_CASE( "GetFrames with segment readers", "[libopenshot][ffmpegreader]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+
+	// Decode the range in order (with a single reader)
+	FFmpegReader r1(path.str());
+	r1.Open();
+	std::map<int64_t, std::shared_ptr<Frame>> expected;
+	r1.GetFrames(1, 400, [&](std::shared_ptr<Frame> f) {
+		if (f->number % 25 == 0)
+			expected[f->number] = f;
+		return true;
+	});
+	r1.Close();
+
+	// Decode segments of the range in parallel (delivered in order, and added to the reader's cache)
+	FFmpegReader r2(path.str());
+	r2.segment_readers = 4;
+	r2.Open();
+	int64_t next = 1;
+	r2.GetFrames(1, 400, [&](std::shared_ptr<Frame> f) {
+		CHECK(f->number == next);
+		CHECK(f->GetNativeImage() == nullptr); // converted by the worker threads
+		if (expected.count(f->number))
+			CHECK(*f->GetImage() == *expected[f->number]->GetImage());
+		next++;
+		return true;
+	});
+	CHECK(next == 401);
+	CHECK(r2.GetCache()->GetFrame(400) != nullptr);
+
+	// The file was indexed in the background (without waiting for it), and now the segments start at keyframes
+	r2.WaitForSeekIndex();
+	REQUIRE(r2.GetSeekIndex() != nullptr);
+	next = 1;
+	r2.GetFrames(1, 400, [&](std::shared_ptr<Frame> f) {
+		CHECK(f->number == next);
+		if (expected.count(f->number))
+			CHECK(*f->GetImage() == *expected[f->number]->GetImage());
+		next++;
+		return true;
+	});
+	CHECK(next == 401);
+
+	// Stop early
+	int delivered = 0;
+	r2.GetFrames(100, 400, [&](std::shared_ptr<Frame> f) { return ++delivered < 10; });
+	CHECK(delivered == 10);
+	r2.Close();
+
+	// The segment readers (kept open between calls) are closed with the reader, and opened again after it is opened
+	r2.Open();
+	next = 200;
+	r2.GetFrames(200, 400, [&](std::shared_ptr<Frame> f) {
+		CHECK(f->number == next);
+		if (expected.count(f->number))
+			CHECK(*f->GetImage() == *expected[f->number]->GetImage());
+		next++;
+		return true;
+	});
+	CHECK(next == 401);
+	r2.Close();
+}
+
+TEST_CASE( "Read ahead", "[libopenshot][ffmpegreader]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+
+	// Read frames in order (without reading ahead)
+	FFmpegReader r1(path.str());
+	r1.Open();
+	std::map<int64_t, std::shared_ptr<Frame>> expected;
+	for (int64_t number = 1; number <= 60; number++)
+		expected[number] = r1.GetFrame(number);
+	r1.Close();
+
+	FFmpegReader r2(path.str());
+	CHECK(r2.GetReadAhead() == 0);
+	r2.SetReadAhead(int64_t(256) * 1024 * 1024);
+	CHECK(r2.GetReadAhead() == int64_t(256) * 1024 * 1024);
+	r2.Open();
+
+	// The frames after a requested frame are decoded in the background
+	r2.GetFrame(1);
+	for (int wait = 0; wait < 500 && !r2.GetCache()->GetFrame(20); wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	CHECK(r2.GetCache()->GetFrame(20) != nullptr);
+
+	// And match the frames read without reading ahead
+	for (int64_t number = 1; number <= 60; number++) {
+		std::shared_ptr<Frame> f = r2.GetFrame(number);
+		CHECK(f->number == number);
+		CHECK(*f->GetImage() == *expected[number]->GetImage());
+	}
+
+	// Seeking back (while reading ahead), and closing the reader, stops the read-ahead thread safely
+	CHECK(*r2.GetFrame(10)->GetImage() == *expected[10]->GetImage());
+	r2.Close();
+	r2.SetReadAhead(0);
+	CHECK(r2.GetReadAhead() == 0);
+
+	// Only the frames within the max bytes are decoded ahead (about 4 frames of 1280x720 RGBA)
+	FFmpegReader r3(path.str());
+	r3.SetReadAhead(int64_t(4) * 1280 * 720 * 4);
+	r3.Open();
+	r3.GetFrame(1);
+	for (int wait = 0; wait < 500 && !r3.GetCache()->Contains(3); wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	CHECK(r3.GetCache()->Contains(3));
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	CHECK_FALSE(r3.GetCache()->Contains(40));
+	r3.Close();
+}
+
+TEST_CASE( "Convert decoded images to RGBA when needed", "[libopenshot][ffmpegreader]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	// The frame keeps its decoded image (in its native pixel format) until its pixels are needed
+	std::shared_ptr<Frame> f = r.GetFrame(30);
+	CHECK(f->has_image_data);
+	CHECK(f->GetWidth() == 1280);
+	CHECK(f->GetHeight() == 720);
+	CHECK(f->GetNativeImage() != nullptr);
+
+	// A copy shares the decoded image (and converts it to the same pixels)
+	Frame copy(*f);
+	CHECK(copy.GetNativeImage() == f->GetNativeImage());
+
+	std::shared_ptr<QImage> image = f->GetImage();
+	CHECK(f->GetNativeImage() == nullptr);
+	CHECK(image->width() == 1280);
+	CHECK(image->height() == 720);
+	CHECK(image->format() == QImage::Format_RGBA8888_Premultiplied);
+	CHECK(f->GetImage() == image);
+	CHECK(*copy.GetImage() == *image);
+	CHECK(copy.GetNativeImage() == nullptr);
+
+	// The image is converted once, and shared by the copies (until they change their pixels)
+	CHECK(copy.GetImage()->constBits() == image->constBits());
+
+	r.Close();
+}
+
+TEST_CASE( "Size of decoded images which are scaled down", "[libopenshot][ffmpegreader]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	Clip c1(&r);
+	Timeline t1(640, 480, Fraction(30,1), 44100, 2, LAYOUT_STEREO);
+	t1.AddClip(&c1);
+	r.Open();
+
+	// The decoded image (1280x720 YUV) is larger than the RGBA image it is converted to (640x360)
+	std::shared_ptr<Frame> f = r.GetFrame(30);
+	REQUIRE(f->GetNativeImage() != nullptr);
+	CHECK(f->GetWidth() == 640);
+	CHECK(f->GetHeight() == 360);
+	int64_t audio_bytes = (f->SampleRate() / 24.0) * sizeof(float);
+	int64_t native_bytes = f->GetBytes() - audio_bytes;
+	CHECK(native_bytes == 1280 * 720 * 3 / 2);
+
+	// A copy converts the shared image, which is counted by the frame it was copied from
+	Frame copy(*f);
+	copy.GetImage();
+	CHECK(f->GetBytes() == audio_bytes + native_bytes + 640 * 360 * 4);
+	CHECK(copy.GetBytes() == audio_bytes + 640 * 360 * 4);
+
+	// Once converted, only the RGBA image is counted
+	f->GetImage();
+	CHECK(f->GetBytes() == audio_bytes + 640 * 360 * 4);
+
+	r.Close();
+}
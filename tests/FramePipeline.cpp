@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::FramePipeline
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "FramePipeline.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+TEST_CASE( "deliver frames in order", "[libopenshot][framepipeline]" )
+{
+	for (int threads : {0, 1, 8}) {
+		std::atomic<int> rendering(0);
+		std::atomic<int> max_rendering(0);
+		std::vector<int64_t> delivered;
+
+		FramePipeline pipeline(threads, 16);
+		pipeline.Run(1, 100,
+			[&](int64_t number) {
+				int count = ++rendering;
+				int previous = max_rendering;
+				while (count > previous && !max_rendering.compare_exchange_weak(previous, count)) { }
+				auto frame = std::make_shared<Frame>(number, 2, 2, "#000000");
+				--rendering;
+				return frame;
+			},
+			[&](std::shared_ptr<Frame> frame) {
+				delivered.push_back(frame->number);
+				return true;
+			});
+
+		// Every frame is delivered once (in order)
+		REQUIRE(delivered.size() == 100);
+		for (int64_t number = 1; number <= 100; number++)
+			CHECK(delivered[number - 1] == number);
+		CHECK(max_rendering <= std::max(threads, 1));
+	}
+}
+
+TEST_CASE( "stop early", "[libopenshot][framepipeline]" )
+{
+	std::atomic<int64_t> max_rendered(0);
+	std::vector<int64_t> delivered;
+
+	FramePipeline pipeline(4, 8);
+	pipeline.Run(1, 1000,
+		[&](int64_t number) {
+			int64_t previous = max_rendered;
+			while (number > previous && !max_rendered.compare_exchange_weak(previous, number)) { }
+			return std::make_shared<Frame>(number, 2, 2, "#000000");
+		},
+		[&](std::shared_ptr<Frame> frame) {
+			delivered.push_back(frame->number);
+			return frame->number < 10;
+		});
+
+	// Frames after the callback returns false are not delivered (and only a few are rendered ahead)
+	CHECK(delivered.size() == 10);
+	CHECK(max_rendered <= 10 + 8);
+}
+
+TEST_CASE( "rethrow render errors", "[libopenshot][framepipeline]" )
+{
+	std::vector<int64_t> delivered;
+
+	FramePipeline pipeline(4, 8);
+	CHECK_THROWS_AS(pipeline.Run(1, 100,
+		[&](int64_t number) {
+			if (number == 20)
+				throw std::runtime_error("Could not render frame");
+			return std::make_shared<Frame>(number, 2, 2, "#000000");
+		},
+		[&](std::shared_ptr<Frame> frame) {
+			delivered.push_back(frame->number);
+			return true;
+		}), std::runtime_error);
+
+	// The frames before the error are delivered
+	CHECK(delivered.size() == 19);
+
+	// Empty ranges deliver nothing
+	delivered.clear();
+	pipeline.Run(10, 1, [&](int64_t number) { return std::make_shared<Frame>(number, 2, 2, "#000000"); },
+		[&](std::shared_ptr<Frame> frame) { delivered.push_back(frame->number); return true; });
+	CHECK(delivered.empty());
+}
+
+TEST_CASE( "share OpenMP threads between workers", "[libopenshot][framepipeline]" )
+{
+	const int all_threads = FramePipeline::OpenMPThreads();
+	CHECK(all_threads >= 1);
+
+	// Each worker thread only gets its share of the OpenMP threads (at least 1)
+	std::atomic<int> max_threads(0);
+	FramePipeline(4, 8).Run(1, 20,
+		[&](int64_t number) {
+			int threads = FramePipeline::OpenMPThreads();
+			int previous = max_threads;
+			while (threads > previous && !max_threads.compare_exchange_weak(previous, threads)) { }
+			return std::make_shared<Frame>(number, 2, 2, "#000000");
+		},
+		[&](std::shared_ptr<Frame> frame) { return true; });
+	CHECK(max_threads == std::max(1, all_threads / 4));
+
+	// The calling thread keeps all of them
+	CHECK(FramePipeline::OpenMPThreads() == all_threads);
+}
@@ -0,0 +1,158 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ImageCompositor
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <QImage>
+#include <QPainter>
+#include <QPointF>
+#include <QTransform>
+
+#include "ImageCompositor.h"
+
+using namespace openshot;
+
+// Create an image of random premultiplied pixels (including opaque and transparent pixels)
+static QImage random_image(int width, int height, unsigned int seed)
+{
+	std::mt19937 random(seed);
+	QImage image(width, height, QImage::Format_RGBA8888_Premultiplied);
+	for (int y = 0; y < height; y++) {
+		unsigned char* pixels = image.scanLine(y);
+		for (int x = 0; x < width; x++) {
+			int alpha = random() % 3 == 0 ? 255 : random() % 256;
+			for (int channel = 0; channel < 3; channel++)
+				pixels[x * 4 + channel] = random() % (alpha + 1);
+			pixels[x * 4 + 3] = alpha;
+		}
+	}
+	return image;
+}
+
+// Find the largest difference between the channels of 2 images
+static int max_difference(const QImage& a, const QImage& b)
+{
+	int difference = 0;
+	for (int y = 0; y < a.height(); y++)
+		for (int x = 0; x < a.width() * 4; x++)
+			difference = std::max(difference, std::abs(a.constScanLine(y)[x] - b.constScanLine(y)[x]));
+	return difference;
+}
+
+TEST_CASE( "blend rows", "[libopenshot][imagecompositor]" )
+{
+	// Opaque, transparent, and half transparent (premultiplied) pixels, with a partial SIMD block at the end
+	std::vector<uint32_t> source = {0xff102030, 0x00000000, 0x80404040, 0xff000000, 0x00000000, 0x80000000, 0xffffffff, 0x80808080, 0x00000000};
+	std::vector<uint32_t> destination(source.size(), 0xff8040c0);
+	ImageCompositor::BlendRow(destination.data(), source.data(), source.size());
+
+	CHECK(destination[0] == 0xff102030);
+	CHECK(destination[1] == 0xff8040c0);
+	CHECK(destination[2] == 0xff8060a0);
+	CHECK(destination[3] == 0xff000000);
+	CHECK(destination[4] == 0xff8040c0);
+	CHECK(destination[5] == 0xff402060);
+	CHECK(destination[6] == 0xffffffff);
+	CHECK(destination[7] == 0xffc0a0e0);
+	CHECK(destination[8] == 0xff8040c0);
+}
+
+TEST_CASE( "match QPainter for whole pixel moves", "[libopenshot][imagecompositor]" )
+{
+	QImage source = random_image(70, 30, 1);
+	QImage background = random_image(64, 48, 2);
+
+	for (QPointF offset : {QPointF(0, 0), QPointF(5, 3), QPointF(-7, -4), QPointF(60, 40), QPointF(-69, 0), QPointF(100, 0)}) {
+		QTransform transform = QTransform::fromTranslate(offset.x(), offset.y());
+
+		QImage expected = background.copy();
+		QPainter painter(&expected);
+		painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform, true);
+		painter.setTransform(transform);
+		painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+		painter.drawImage(0, 0, source);
+		painter.end();
+
+		QImage composited = background.copy();
+		CHECK(ImageCompositor::CanComposite(composited, source, transform));
+		CHECK(ImageCompositor::Composite(composited, source, transform));
+		CHECK(max_difference(composited, expected) <= 1);
+	}
+
+	// Large enough to blend rows in parallel
+	QImage large_source = random_image(1280, 720, 3);
+	QImage large_background = random_image(1280, 720, 4);
+	QImage expected = large_background.copy();
+	QPainter painter(&expected);
+	painter.drawImage(-3, 2, large_source);
+	painter.end();
+	CHECK(ImageCompositor::Composite(large_background, large_source, QTransform::fromTranslate(-3, 2)));
+	CHECK(max_difference(large_background, expected) <= 1);
+}
+
+TEST_CASE( "unsupported transforms and formats", "[libopenshot][imagecompositor]" )
+{
+	QImage source = random_image(16, 16, 5);
+	QImage background = random_image(16, 16, 6);
+	QImage original = background.copy();
+
+	QTransform rotated;
+	rotated.rotate(10);
+	CHECK_FALSE(ImageCompositor::Composite(background, source, rotated));
+	CHECK_FALSE(ImageCompositor::Composite(background, source, QTransform::fromScale(2, 2)));
+	CHECK_FALSE(ImageCompositor::Composite(background, source, QTransform::fromTranslate(0.5, 0)));
+	CHECK_FALSE(ImageCompositor::Composite(background, source.convertToFormat(QImage::Format_RGB32), QTransform()));
+	CHECK(background == original);
+}
+
+TEST_CASE( "composite layers in tiles", "[libopenshot][imagecompositor]" )
+{
+	QImage background = random_image(200, 150, 7);
+
+	// A rotated layer, a scaled layer, a layer moved by part of a pixel, and a layer moved by whole pixels
+	std::vector<ImageLayer> layers(5);
+	layers[0].image = std::make_shared<QImage>(random_image(120, 80, 8));
+	layers[0].transform.translate(40, 30).rotate(20);
+	layers[1].image = std::make_shared<QImage>(random_image(50, 40, 9));
+	layers[1].transform.translate(10, 90).scale(1.5, 0.75);
+	layers[2].image = std::make_shared<QImage>(random_image(60, 60, 10));
+	layers[2].transform.translate(100.5, 20.25);
+	layers[3].image = std::make_shared<QImage>(random_image(80, 30, 11));
+	layers[3].transform.translate(-10, 130);
+
+	// Layers without an image are skipped
+	layers[4].transform.translate(5, 5);
+
+	QImage expected = background.copy();
+	for (const auto& layer : layers) {
+		if (!layer.image)
+			continue;
+		QPainter painter(&expected);
+		painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, true);
+		painter.setTransform(layer.transform);
+		painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+		painter.drawImage(0, 0, *layer.image);
+		painter.end();
+	}
+
+	for (int tile_height : {1, 7, 64, 1000}) {
+		QImage composited = background.copy();
+		ImageCompositor::CompositeLayers(composited, layers, tile_height);
+		CHECK(max_difference(composited, expected) <= 2);
+	}
+}
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::IntervalIndex
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "IntervalIndex.h"
+
+using namespace openshot;
+
+TEST_CASE( "find overlapping items", "[libopenshot][intervalindex]" )
+{
+	IntervalIndex<int> index;
+	CHECK(index.Find(1, 100).empty());
+
+	index.Add(50, 150, 2);
+	index.Add(1, 100, 1);
+	index.Add(200, 300, 3);
+	index.Add(50, 60, 4);
+
+	// Items are not found until the index is built
+	CHECK(index.Find(75, 75).empty());
+	index.Build();
+	CHECK(index.Count() == 4);
+
+	// Items are found in order of their first frame (and then the order they were added)
+	CHECK(index.Find(75, 75) == std::vector<int>({1, 2}));
+	CHECK(index.Find(55, 55) == std::vector<int>({1, 2, 4}));
+	CHECK(index.Find(100, 100) == std::vector<int>({1, 2}));
+	CHECK(index.Find(101, 101) == std::vector<int>({2}));
+	CHECK(index.Find(151, 199).empty());
+	CHECK(index.Find(140, 210) == std::vector<int>({2, 3}));
+	CHECK(index.Find(301, 1000).empty());
+
+	index.Clear();
+	CHECK(index.Count() == 0);
+	CHECK(index.Find(75, 75).empty());
+}
+
+TEST_CASE( "match a linear search", "[libopenshot][intervalindex]" )
+{
+	std::mt19937 generator(1234);
+	std::uniform_int_distribution<int> positions(1, 10000);
+	std::uniform_int_distribution<int> lengths(0, 500);
+
+	// Index thousands of random items
+	std::vector<std::pair<int, int>> items;
+	IntervalIndex<int> index;
+	for (int i = 0; i < 5000; i++) {
+		int start = positions(generator);
+		int end = start + lengths(generator);
+		items.push_back({start, end});
+		index.Add(start, end, i);
+	}
+	index.Build();
+
+	for (int i = 0; i < 200; i++) {
+		int start = positions(generator);
+		int end = start + lengths(generator) / 10;
+
+		// Find the same items (in the same order) as a linear search
+		std::vector<int> expected;
+		for (int item = 0; item < int(items.size()); item++)
+			if (items[item].first <= end && items[item].second >= start)
+				expected.push_back(item);
+		std::stable_sort(expected.begin(), expected.end(), [&items](int a, int b) { return items[a].first < items[b].first; });
+
+		CHECK(index.Find(start, end) == expected);
+	}
+}
@@ -0,0 +1,100 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::RenderGraph
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "RenderGraph.h"
+
+using namespace openshot;
+
+TEST_CASE( "run nodes after their dependencies", "[libopenshot][rendergraph]" )
+{
+	for (int threads : {1, 4}) {
+		// 2 branches (which can run at once), joined by 2 nodes (which can also run at once)
+		std::atomic<int> order(0);
+		std::vector<int> finished(5, -1);
+		RenderGraph graph(10);
+		auto step = [&](int node) {
+			return [&, node]() {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				finished[node] = order++;
+			};
+		};
+		size_t branch1 = graph.AddNode("branch 1", step(0));
+		size_t branch2 = graph.AddNode("branch 2", step(1));
+		size_t join1 = graph.AddNode("join 1", step(2), {branch1, branch2});
+		size_t join2 = graph.AddNode("join 2", step(3), {branch1, branch2});
+		graph.AddNode("last", step(4), {join1, join2});
+		graph.Run(threads);
+
+		CHECK(finished[2] > finished[0]);
+		CHECK(finished[2] > finished[1]);
+		CHECK(finished[3] > finished[0]);
+		CHECK(finished[3] > finished[1]);
+		CHECK(finished[4] == 4);
+
+		// Each node is timed
+		REQUIRE(graph.Nodes().size() == 5);
+		CHECK(graph.FrameNumber() == 10);
+		for (const auto& node : graph.Nodes())
+			CHECK(node.duration > 0.0);
+		CHECK(graph.Nodes()[4].start >= graph.Nodes()[2].start + graph.Nodes()[2].duration);
+		CHECK(graph.Duration() >= graph.Nodes()[4].start + graph.Nodes()[4].duration);
+	}
+}
+
+TEST_CASE( "ignore dependencies on later nodes", "[libopenshot][rendergraph]" )
+{
+	RenderGraph graph;
+	int runs = 0;
+	size_t first = graph.AddNode("first", [&]() { runs++; }, {0, 5});
+	graph.AddNode("second", [&]() { runs++; }, {first, first});
+	CHECK(graph.Nodes()[0].dependencies.empty());
+	CHECK(graph.Nodes()[1].dependencies.size() == 1);
+
+	graph.Run(2);
+	CHECK(runs == 2);
+}
+
+TEST_CASE( "re-throw exceptions after every node runs", "[libopenshot][rendergraph]" )
+{
+	RenderGraph graph;
+	bool ran = false;
+	size_t failing = graph.AddNode("failing", []() { throw std::runtime_error("failed"); });
+	graph.AddNode("after", [&]() { ran = true; }, {failing});
+
+	CHECK_THROWS_AS(graph.Run(4), std::runtime_error);
+	CHECK(ran);
+}
+
+TEST_CASE( "export nodes as JSON", "[libopenshot][rendergraph]" )
+{
+	RenderGraph graph(3);
+	size_t clip = graph.AddNode("clip", []() { });
+	graph.AddNode("composite", []() { }, {clip});
+	graph.Run(1);
+
+	Json::Value root = graph.JsonValue();
+	CHECK(root["frame_number"].asInt64() == 3);
+	REQUIRE(root["nodes"].size() == 2);
+	CHECK(root["nodes"][0]["name"].asString() == "clip");
+	CHECK(root["nodes"][1]["name"].asString() == "composite");
+	REQUIRE(root["nodes"][1]["dependencies"].size() == 1);
+	CHECK(root["nodes"][1]["dependencies"][0].asUInt64() == 0);
+	CHECK(root["nodes"][1]["duration"].isDouble());
+}
@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::SeekIndex
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <string>
+
+#include <catch2/catch.hpp>
+
+#include <QDir>
+#include <QFile>
+
+#include "SeekIndex.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "find the keyframe before a timestamp", "[libopenshot][seekindex]" )
+{
+	// Keyframes added out of order (and twice)
+	SeekIndex index;
+	index.Add(0);
+	index.Add(500);
+	index.Add(250);
+	index.Add(250);
+	index.Add(1000);
+	CHECK(index.Count() == 4);
+
+	int64_t keyframe = -1;
+	CHECK_FALSE(index.Find(-1, keyframe));
+	CHECK(keyframe == -1);
+	CHECK(index.Find(0, keyframe));
+	CHECK(keyframe == 0);
+	CHECK(index.Find(249, keyframe));
+	CHECK(keyframe == 0);
+	CHECK(index.Find(250, keyframe));
+	CHECK(keyframe == 250);
+	CHECK(index.Find(999, keyframe));
+	CHECK(keyframe == 500);
+	CHECK(index.Find(5000, keyframe));
+	CHECK(keyframe == 1000);
+
+	// An empty index has no keyframes
+	SeekIndex empty;
+	CHECK_FALSE(empty.Find(100, keyframe));
+}
+
+TEST_CASE( "save and load an index", "[libopenshot][seekindex]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/seek-index/");
+	temp_path.mkpath(".");
+
+	// A media file (only its size and modified time matter)
+	std::string media_path = temp_path.filePath("media.mp4").toStdString();
+	QFile media_file(QString::fromStdString(media_path));
+	REQUIRE(media_file.open(QIODevice::WriteOnly));
+	media_file.write("not really a video");
+	media_file.close();
+
+	// Name index files after the media file (in the index folder)
+	std::string index_path = SeekIndex::IndexPath(media_path);
+	CHECK(index_path.empty());
+	Settings::Instance()->PATH_SEEK_INDEX = temp_path.filePath("indexes").toStdString();
+	index_path = SeekIndex::IndexPath(media_path);
+	CHECK(index_path.find(temp_path.filePath("indexes").toStdString()) == 0);
+	CHECK(index_path == SeekIndex::IndexPath(media_path));
+	CHECK(index_path != SeekIndex::IndexPath(temp_path.filePath("other.mp4").toStdString()));
+
+	SeekIndex index;
+	for (int64_t timestamp = -1001; timestamp < 100000; timestamp += 3003)
+		index.Add(timestamp);
+	REQUIRE(index.Save(index_path, media_path));
+
+	SeekIndex loaded;
+	REQUIRE(loaded.Load(index_path, media_path));
+	CHECK(loaded.Count() == index.Count());
+	int64_t keyframe = 0;
+	CHECK(loaded.Find(-1, keyframe));
+	CHECK(keyframe == -1001);
+	CHECK(loaded.Find(50000, keyframe));
+	CHECK(keyframe == 47047);
+
+	// A missing index, or an index of another file, is not loaded
+	SeekIndex missing;
+	CHECK_FALSE(missing.Load(index_path + ".missing", media_path));
+	CHECK_FALSE(missing.Load(index_path, temp_path.filePath("other.mp4").toStdString()));
+	CHECK(missing.Count() == 0);
+
+	// The index is stale once the media file changes
+	REQUIRE(media_file.open(QIODevice::Append));
+	media_file.write(" (edited)");
+	media_file.close();
+	CHECK_FALSE(missing.Load(index_path, media_path));
+
+	// Clean up
+	Settings::Instance()->PATH_SEEK_INDEX = "";
+	temp_path.removeRecursively();
+}
@@ -14,14 +14,21 @@
 #include <sstream>
 #include <memory>
 #include <list>
+#include <thread>
+#include <vector>
 
 #include <catch2/catch.hpp>
 
 #include "Timeline.h"
+#include "CacheDisk.h"
+#include "CacheMemory.h"
 #include "Clip.h"
+#include "FFmpegReader.h"
 #include "Frame.h"
 #include "Fraction.h"
+#include "audio_effects/Distortion.h"
 #include "effects/Blur.h"
+#include "effects/Brightness.h"
 #include "effects/Negate.h"
 
 using namespace openshot;
@@ -587,3 +594,618 @@ TEST_CASE( "GetMaxFrame and GetMaxTime", "[libopenshot][timeline]" )
 	CHECK(t.GetMaxFrame() == 125 * 30 + 1);
 	CHECK(t.GetMaxTime() == Approx(125.0).margin(0.001));
 }
+
+TEST_CASE( "persistent disk cache is keyed by the timeline JSON", "[libopenshot][timeline]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/timeline-persistent-cache/");
+	temp_path.removeRecursively();
+
+	// Create a timeline (with a persisted disk cache)
+	CacheDisk cache(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+	cache.SetContentKey("new project");
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.SetCache(&cache);
+
+	// Setting the JSON switches the cache to the frames of that content
+	t.SetJson(t.Json());
+	t.Open();
+	cache.Add(std::make_shared<Frame>(1, 2, 2, "#000000"));
+	CHECK(cache.Count() == 1);
+
+	// Another session of the same project finds its frames
+	std::string previous_key = t.CacheKey();
+	{
+		CacheDisk other(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+		other.SetContentKey(previous_key);
+		CHECK(other.Contains(1));
+	}
+
+	// A JSON diff keeps the (still valid) frames, but they are only keyed by the changed content once the
+	// timeline is closed (and no longer match the previous content)
+	Json::Value change;
+	change["type"] = "update";
+	change["key"].append("duration");
+	change["value"] = 600.0;
+	Json::Value changes(Json::arrayValue);
+	changes.append(change);
+	t.ApplyJsonDiff(changes.toStyledString());
+	t.ApplyJsonDiff(changes.toStyledString());
+	CHECK(t.CacheKey() != previous_key);
+	CHECK(cache.Contains(1));
+	{
+		CacheDisk other(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+		other.SetContentKey(previous_key);
+		CHECK_FALSE(other.Contains(1));
+		other.SetContentKey(t.CacheKey());
+		CHECK_FALSE(other.Contains(1));
+	}
+	t.Close();
+	CHECK(cache.Contains(1));
+	{
+		CacheDisk other(temp_path.path().toStdString(), "RAW", 1.0, 1.0);
+		other.SetContentKey(t.CacheKey());
+		CHECK(other.Contains(1));
+	}
+
+	// Frames rendered at another preview size are different content (and are kept for that size)
+	t.SetMaxSize(320, 240);
+	CHECK_FALSE(cache.Contains(1));
+	t.SetMaxSize(640, 480);
+	CHECK(cache.Contains(1));
+
+	// Clean up
+	cache.Clear();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "ApplyJsonDiff removes changed frames from cache", "[libopenshot][timeline]" )
+{
+	// Create a timeline (with an unlimited cache)
+	CacheMemory cache;
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.SetCache(&cache);
+
+	// Add a clip at 10 seconds (timeline frames 301 to 901), with an alpha keyframe
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "interlaced.png";
+	Clip clip1(path1.str());
+	clip1.Id("CLIP00001");
+	clip1.Layer(1);
+	clip1.Position(10);
+	clip1.End(20);
+	clip1.alpha = Keyframe();
+	clip1.alpha.AddPoint(1, 1.0);
+	clip1.alpha.AddPoint(100, 1.0);
+	clip1.alpha.AddPoint(200, 1.0);
+	t.AddClip(&clip1);
+
+	// Fill the cache with timeline frames
+	for (int i = 1; i <= 1000; i++)
+		cache.Add(std::make_shared<Frame>(i, 2, 2, "#000000"));
+
+	// Change the middle alpha point (clip frame 100)
+	Json::Value value = clip1.JsonValue();
+	value.removeMember("reader");
+	Keyframe alpha;
+	alpha.AddPoint(1, 1.0);
+	alpha.AddPoint(100, 0.5);
+	alpha.AddPoint(200, 1.0);
+	value["alpha"] = alpha.JsonValue();
+
+	Json::Value change;
+	change["type"] = "update";
+	change["key"].append("clips");
+	change["key"].append(Json::Value(Json::objectValue));
+	change["key"][1]["id"] = "CLIP00001";
+	change["value"] = value;
+	Json::Value changes(Json::arrayValue);
+	changes.append(change);
+	t.ApplyJsonDiff(changes.toStyledString());
+
+	// Only frames between the neighboring points (clip frames 1 to 200) are removed
+	CHECK(cache.Contains(1));
+	CHECK(cache.Contains(290));
+	CHECK_FALSE(cache.Contains(301));
+	CHECK_FALSE(cache.Contains(400));
+	CHECK_FALSE(cache.Contains(500));
+	CHECK(cache.Contains(510));
+	CHECK(cache.Contains(900));
+
+	// Moving the clip removes all of its frames
+	value["alpha"] = alpha.JsonValue();
+	value["position"] = 5.0;
+	changes[0]["value"] = value;
+	t.ApplyJsonDiff(changes.toStyledString());
+
+	CHECK(cache.Contains(1));
+	CHECK_FALSE(cache.Contains(151));
+	CHECK_FALSE(cache.Contains(700));
+	CHECK_FALSE(cache.Contains(900));
+	CHECK(cache.Contains(1000));
+}
+
+TEST_CASE( "ApplyJsonDiff removes changed frames of a reversed clip", "[libopenshot][timeline]" )
+{
+	// Create a timeline (with an unlimited cache)
+	CacheMemory cache;
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.SetCache(&cache);
+
+	// Add a reversed clip at 10 seconds (timeline frames 301 to 601), with an alpha keyframe
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "interlaced.png";
+	Clip clip1(path1.str());
+	clip1.Id("CLIP00001");
+	clip1.Layer(1);
+	clip1.Position(10);
+	clip1.time = Keyframe();
+	clip1.time.AddPoint(1, 300);
+	clip1.time.AddPoint(300, 1);
+	clip1.alpha = Keyframe();
+	clip1.alpha.AddPoint(1, 1.0);
+	clip1.alpha.AddPoint(100, 1.0);
+	clip1.alpha.AddPoint(200, 1.0);
+	t.AddClip(&clip1);
+
+	// Fill the cache with timeline frames
+	for (int i = 1; i <= 1000; i++)
+		cache.Add(std::make_shared<Frame>(i, 2, 2, "#000000"));
+
+	// Change the middle alpha point (clip frame 100, which is evaluated at the end of the reversed clip)
+	Json::Value value = clip1.JsonValue();
+	value.removeMember("reader");
+	Keyframe alpha;
+	alpha.AddPoint(1, 1.0);
+	alpha.AddPoint(100, 0.5);
+	alpha.AddPoint(200, 1.0);
+	value["alpha"] = alpha.JsonValue();
+
+	Json::Value change;
+	change["type"] = "update";
+	change["key"].append("clips");
+	change["key"].append(Json::Value(Json::objectValue));
+	change["key"][1]["id"] = "CLIP00001";
+	change["value"] = value;
+	Json::Value changes(Json::arrayValue);
+	changes.append(change);
+	t.ApplyJsonDiff(changes.toStyledString());
+
+	// All frames of the clip are removed
+	CHECK(cache.Contains(290));
+	CHECK_FALSE(cache.Contains(301));
+	CHECK_FALSE(cache.Contains(450));
+	CHECK_FALSE(cache.Contains(550));
+	CHECK_FALSE(cache.Contains(601));
+	CHECK(cache.Contains(700));
+}
+
+TEST_CASE( "GetFrame from many threads", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "test.mp4";
+	std::stringstream path_overlay;
+	path_overlay << TEST_MEDIA_PATH << "front3.png";
+
+	// Create 2 identical timelines (one rendered by a single thread, the other by many threads)
+	Clip clip_video1(path.str());
+	Clip clip_overlay1(path_overlay.str());
+	Clip clip_video2(path.str());
+	Clip clip_overlay2(path_overlay.str());
+	Timeline t1(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	Timeline t2(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	for (auto clip : {&clip_overlay1, &clip_overlay2}) {
+		clip->Layer(1);
+		clip->Position(0.5);
+		clip->End(0.5);
+	}
+	t1.AddClip(&clip_video1);
+	t1.AddClip(&clip_overlay1);
+	t2.AddClip(&clip_video2);
+	t2.AddClip(&clip_overlay2);
+	t1.Open();
+	t2.Open();
+
+	// Render the same frames (including duplicate requests) from 8 threads at once
+	const int frames = 48;
+	std::vector<std::shared_ptr<Frame>> rendered(frames + 1);
+	std::vector<std::thread> threads;
+	for (int thread_index = 0; thread_index < 8; thread_index++) {
+		threads.emplace_back([&t2, &rendered, thread_index]() {
+			for (int64_t number = 1 + thread_index % 4; number <= frames; number += 4) {
+				std::shared_ptr<Frame> f = t2.GetFrame(number);
+				if (thread_index < 4)
+					rendered[number] = f;
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	// Each frame matches the frame rendered by a single thread
+	for (int64_t number = 1; number <= frames; number++) {
+		std::shared_ptr<Frame> expected = t1.GetFrame(number);
+		REQUIRE(rendered[number]);
+		CHECK(rendered[number]->number == number);
+		CHECK(*rendered[number]->GetImage() == *expected->GetImage());
+	}
+
+	t1.Close();
+	t2.Close();
+}
+
+TEST_CASE( "moved clips are found at their new position", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "test.mp4";
+	Clip clip_video(path.str());
+	clip_video.Layer(0);
+	clip_video.Position(0.0);
+
+	Timeline t(1280, 720, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.AddClip(&clip_video);
+	t.Open();
+
+	int pixel_row = 200;
+	int pixel_index = 230 * 4; // pixel 230 (4 bytes per pixel)
+
+	std::shared_ptr<Frame> f = t.GetFrame(1);
+	CHECK((int)f->GetPixels(pixel_row)[pixel_index + 1] == Approx(191).margin(5));
+
+	// Move the clip (without telling the timeline), so frame 1 is empty
+	clip_video.Position(10.0);
+	t.ClearAllCache();
+	f = t.GetFrame(1);
+	CHECK((int)f->GetPixels(pixel_row)[pixel_index] == 0);
+	CHECK((int)f->GetPixels(pixel_row)[pixel_index + 1] == 0);
+	CHECK((int)f->GetPixels(pixel_row)[pixel_index + 2] == 0);
+
+	// The clip's first frame is now at 10 seconds
+	f = t.GetFrame(301);
+	CHECK((int)f->GetPixels(pixel_row)[pixel_index + 1] == Approx(191).margin(5));
+
+	t.Close();
+
+	// Moving a clip only changes the placement version of its own timeline
+	Timeline other(1280, 720, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	int64_t version = t.PlacementVersion();
+	int64_t other_version = other.PlacementVersion();
+	clip_video.Position(5.0);
+	CHECK(t.PlacementVersion() != version);
+	CHECK(other.PlacementVersion() == other_version);
+}
+
+TEST_CASE( "changed effect order is applied", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "test.mp4";
+	Clip clip_video(path.str());
+	clip_video.Layer(0);
+	clip_video.Position(0.0);
+
+	// Brighten and negate the clip's layer (effects with a higher order are applied first)
+	Brightness brightness(Keyframe(0.25), Keyframe(0.0));
+	Negate negate;
+	negate.Order(1);
+	brightness.End(10.0);
+	negate.End(10.0);
+
+	Timeline t(1280, 720, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.AddClip(&clip_video);
+	t.AddEffect(&brightness);
+	t.AddEffect(&negate);
+	t.Open();
+
+	int pixel_row = 200;
+	int pixel_index = 230 * 4; // pixel 230 (4 bytes per pixel)
+
+	// Negated (255 - 191), then brightened (+ 64)
+	std::shared_ptr<Frame> f = t.GetFrame(1);
+	CHECK((int)f->GetPixels(pixel_row)[pixel_index + 1] == Approx(128).margin(5));
+
+	// Change the order (without telling the timeline): brightened (191 + 64), then negated
+	brightness.Order(2);
+	t.ClearAllCache();
+	f = t.GetFrame(1);
+	CHECK((int)f->GetPixels(pixel_row)[pixel_index + 1] == Approx(0).margin(5));
+
+	t.Close();
+}
+
+TEST_CASE( "GetFrames delivers a range in order", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "test.mp4";
+	Clip clip_video1(path.str());
+	Clip clip_video2(path.str());
+
+	// Create 2 identical timelines (one rendered frame by frame, the other by range)
+	Timeline t1(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	Timeline t2(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t1.AddClip(&clip_video1);
+	t2.AddClip(&clip_video2);
+	t1.Open();
+	t2.Open();
+
+	std::vector<std::shared_ptr<Frame>> frames;
+	t2.GetFrames(10, 40, [&frames](std::shared_ptr<Frame> frame) {
+		frames.push_back(frame);
+		return true;
+	});
+
+	REQUIRE(frames.size() == 31);
+	for (int64_t number = 10; number <= 40; number++) {
+		std::shared_ptr<Frame> expected = t1.GetFrame(number);
+		CHECK(frames[number - 10]->number == number);
+		CHECK(*frames[number - 10]->GetImage() == *expected->GetImage());
+	}
+
+	// Stop the range early
+	frames.clear();
+	t2.GetFrames(50, 100, [&frames](std::shared_ptr<Frame> frame) {
+		frames.push_back(frame);
+		return frames.size() < 5;
+	});
+	CHECK(frames.size() == 5);
+	CHECK(frames.back()->number == 54);
+
+	t1.Close();
+	t2.Close();
+}
+
+TEST_CASE( "audio effects of hidden clips", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	std::stringstream path_audio;
+	path_audio << TEST_MEDIA_PATH << "piano.wav";
+
+	// Create 2 timelines with a distorted audio clip (in the 2nd one it is covered by an opaque, silent video)
+	Clip clip_audio1(path_audio.str());
+	Clip clip_audio2(path_audio.str());
+	Distortion distortion1(HARD_CLIPPING, Keyframe(10.0), Keyframe(-10.0), Keyframe(5.0));
+	Distortion distortion2(HARD_CLIPPING, Keyframe(10.0), Keyframe(-10.0), Keyframe(5.0));
+	clip_audio1.AddEffect(&distortion1);
+	clip_audio2.AddEffect(&distortion2);
+	Clip clip_video(path.str());
+	clip_video.Layer(1);
+	clip_video.volume = Keyframe(0.0);
+
+	Timeline t1(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	Timeline t2(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t1.AddClip(&clip_audio1);
+	t2.AddClip(&clip_audio2);
+	t2.AddClip(&clip_video);
+	t1.Open();
+	t2.Open();
+
+	// The hidden clip's audio is still distorted
+	for (int64_t number = 1; number <= 30; number++) {
+		std::shared_ptr<Frame> expected = t1.GetFrame(number);
+		std::shared_ptr<Frame> f = t2.GetFrame(number);
+		REQUIRE(f->GetAudioSamplesCount() == expected->GetAudioSamplesCount());
+		for (int channel = 0; channel < f->GetAudioChannelsCount(); channel++)
+			for (int sample = 0; sample < f->GetAudioSamplesCount(); sample += 50)
+				CHECK(f->GetAudioSamples(channel)[sample] == Approx(expected->GetAudioSamples(channel)[sample]).margin(0.00001));
+	}
+
+	t1.Close();
+	t2.Close();
+}
+
+TEST_CASE( "GetAudioFrame mixes audio without rendering images", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	std::stringstream path_audio;
+	path_audio << TEST_MEDIA_PATH << "piano.wav";
+
+	// Create 2 identical timelines (one rendered completely, the other only mixing audio)
+	Clip clip_video1(path.str());
+	Clip clip_video2(path.str());
+	Clip clip_audio1(path_audio.str());
+	Clip clip_audio2(path_audio.str());
+	clip_audio1.Layer(1);
+	clip_audio2.Layer(1);
+	clip_audio1.volume = Keyframe(0.5);
+	clip_audio2.volume = Keyframe(0.5);
+
+	Timeline t1(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	Timeline t2(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t1.AddClip(&clip_video1);
+	t1.AddClip(&clip_audio1);
+	t2.AddClip(&clip_video2);
+	t2.AddClip(&clip_audio2);
+	t1.Open();
+	t2.Open();
+
+	for (int64_t number = 1; number <= 30; number++) {
+		std::shared_ptr<Frame> expected = t1.GetFrame(number);
+		std::shared_ptr<Frame> f = t2.GetAudioFrame(number);
+		CHECK(f->number == number);
+		CHECK_FALSE(f->has_image_data);
+		REQUIRE(f->GetAudioSamplesCount() == expected->GetAudioSamplesCount());
+		for (int channel = 0; channel < f->GetAudioChannelsCount(); channel++)
+			for (int sample = 0; sample < f->GetAudioSamplesCount(); sample += 50)
+				CHECK(f->GetAudioSamples(channel)[sample] == Approx(expected->GetAudioSamples(channel)[sample]).margin(0.00001));
+	}
+
+	// Audio frames are not cached (so the complete frame is rendered later)
+	CHECK(t2.GetCache()->GetFrame(10) == nullptr);
+	std::shared_ptr<Frame> f = t2.GetFrame(10);
+	CHECK(*f->GetImage() == *t1.GetFrame(10)->GetImage());
+
+	// Complete frames are returned by GetAudioFrame (if cached)
+	CHECK(t2.GetAudioFrame(10) == f);
+
+	t1.Close();
+	t2.Close();
+}
+
+TEST_CASE( "static frames share one image", "[libopenshot][timeline]" )
+{
+	std::stringstream path_image;
+	path_image << TEST_MEDIA_PATH << "front.png";
+	std::stringstream path_audio;
+	path_audio << TEST_MEDIA_PATH << "piano.wav";
+
+	// A still image (with audio below it)
+	Clip clip_image(path_image.str());
+	Clip clip_audio(path_audio.str());
+	clip_image.Layer(1);
+
+	Timeline t(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.AddClip(&clip_image);
+	t.AddClip(&clip_audio);
+	t.Open();
+
+	// The same audio (without the image)
+	Clip clip_audio_only(path_audio.str());
+	Timeline t_audio(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t_audio.AddClip(&clip_audio_only);
+	t_audio.Open();
+
+	// Audio clips have no image (so they are static too)
+	CHECK(clip_image.IsStatic(1, 20));
+	CHECK(clip_audio.IsStatic(1, 20));
+
+	// Every frame shares the pixels of the first frame (but has its own audio)
+	std::shared_ptr<Frame> first = t.GetFrame(1);
+	for (int64_t number = 2; number <= 20; number++) {
+		std::shared_ptr<Frame> f = t.GetFrame(number);
+		CHECK(f->number == number);
+		CHECK(f->GetImage()->constBits() == first->GetImage()->constBits());
+
+		std::shared_ptr<Frame> expected = t_audio.GetFrame(number);
+		REQUIRE(f->GetAudioSamplesCount() == expected->GetAudioSamplesCount());
+		for (int sample = 0; sample < f->GetAudioSamplesCount(); sample += 50)
+			CHECK(f->GetAudioSamples(0)[sample] == Approx(expected->GetAudioSamples(0)[sample]).margin(0.00001));
+	}
+
+	// Moving the image changes every frame
+	t.ClearAllCache();
+	clip_image.location_x.AddPoint(1, 0.0);
+	clip_image.location_x.AddPoint(20, 0.5);
+	CHECK_FALSE(clip_image.IsStatic(1, 20));
+	first = t.GetFrame(1);
+	std::shared_ptr<Frame> last = t.GetFrame(20);
+	CHECK(last->GetImage()->constBits() != first->GetImage()->constBits());
+	CHECK_FALSE(*last->GetImage() == *first->GetImage());
+
+	t.Close();
+	t_audio.Close();
+}
+
+TEST_CASE( "RenderGraphJSON", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front.png";
+	Clip clip1(path.str());
+	Clip clip2(path.str());
+	clip1.Id("clip1");
+	clip2.Id("clip2");
+	clip1.Layer(1);
+	clip2.Layer(2);
+	clip2.scale = SCALE_NONE;
+
+	Timeline t(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.AddClip(&clip1);
+	t.AddClip(&clip2);
+	t.Open();
+
+	// Nothing rendered yet
+	CHECK(t.RenderGraphJSON() == "{}");
+
+	t.GetFrame(5);
+	Json::Value root = openshot::stringToJson(t.RenderGraphJSON());
+	CHECK(root["frame_number"].asInt64() == 5);
+
+	// A node for each clip, and the composite and mix nodes (which depend on every clip)
+	REQUIRE(root["nodes"].size() == 4);
+	CHECK(root["nodes"][0]["name"].asString().find("clip clip1") == 0);
+	CHECK(root["nodes"][1]["name"].asString().find("clip clip2") == 0);
+	CHECK(root["nodes"][2]["name"].asString() == "composite");
+	CHECK(root["nodes"][3]["name"].asString() == "mix");
+	CHECK(root["nodes"][2]["dependencies"].size() == 2);
+	CHECK(root["nodes"][3]["dependencies"].size() == 2);
+
+	t.Close();
+}
+
+TEST_CASE( "SetProxyScale", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Clip clip(path.str());
+	Blur blur(Keyframe(6.0), Keyframe(6.0), Keyframe(3.0), Keyframe(1.0));
+	clip.AddEffect(&blur);
+
+	Timeline t(1280, 720, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.AddClip(&clip);
+	t.Open();
+
+	std::shared_ptr<Frame> f = t.GetFrame(24);
+	CHECK(t.ProxyScale() == Approx(1.0));
+	CHECK(f->GetWidth() == 1280);
+	CHECK(f->GetHeight() == 720);
+
+	// Half size frames (composited from half size clip images)
+	t.SetProxyScale(0.5);
+	CHECK(t.ProxyScale() == Approx(0.5));
+	f = t.GetFrame(24);
+	CHECK(f->GetWidth() == 640);
+	CHECK(f->GetHeight() == 360);
+	CHECK(clip.GetFrame(24)->GetWidth() == 640);
+
+	// Pixel measurements of effects are scaled to the proxy size
+	CHECK(blur.ResolutionScale() == Approx(0.5));
+
+	// But a small blur is not scaled away
+	t.SetProxyScale(0.25);
+	Blur small_blur(Keyframe(1.0), Keyframe(1.0), Keyframe(3.0), Keyframe(1.0));
+	small_blur.ParentTimeline(&t);
+	CHECK(small_blur.ResolutionScale() == Approx(0.25));
+	std::shared_ptr<Frame> source = std::make_shared<Frame>(*clip.Reader()->GetFrame(24));
+	std::shared_ptr<Frame> blurred = small_blur.GetFrame(std::make_shared<Frame>(*source), 24);
+	CHECK_FALSE(*blurred->GetImage() == *source->GetImage());
+
+	// Back to full size
+	t.SetProxyScale(1.0);
+	CHECK(t.GetFrame(24)->GetWidth() == 1280);
+	CHECK(blur.ResolutionScale() == 1.0);
+
+	// A preview size (which is not a proxy scale) turns proxy mode off
+	t.SetProxyScale(0.5);
+	t.SetMaxSize(640, 360);
+	CHECK(t.ProxyScale() == 1.0);
+	CHECK(blur.ResolutionScale() == 1.0);
+
+	t.Close();
+}
+
+TEST_CASE( "effects are not scaled without a proxy", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+
+	// A clip larger than the timeline (which is not a proxy preview)
+	Clip clip(path.str());
+	Blur blur(Keyframe(6.0), Keyframe(6.0), Keyframe(3.0), Keyframe(1.0));
+	clip.AddEffect(&blur);
+	Timeline t(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.AddClip(&clip);
+	t.Open();
+	CHECK(t.ProxyScale() == 1.0);
+	CHECK(blur.ResolutionScale() == 1.0);
+
+	// The clip's blur is the same as a blur without any timeline
+	FFmpegReader r(path.str());
+	r.Open();
+	std::shared_ptr<Frame> source = r.GetFrame(24);
+	Blur baseline(Keyframe(6.0), Keyframe(6.0), Keyframe(3.0), Keyframe(1.0));
+	std::shared_ptr<Frame> expected = baseline.GetFrame(std::make_shared<Frame>(*source), 24);
+	std::shared_ptr<Frame> f = blur.GetFrame(std::make_shared<Frame>(*source), 24);
+	CHECK(*f->GetImage() == *expected->GetImage());
+
+	r.Close();
+	t.Close();
+}